@@ -202,6 +202,61 @@ namespace foonathan
                 traits::deallocate_array(alloc, ptr, count, size, alignment);
             }
 
+            void allocate_nodes(std::size_t count, std::size_t size, std::size_t alignment,
+                                void** nodes)
+            {
+                std::lock_guard<actual_mutex> lock(*this);
+                auto&&                        alloc = get_allocator();
+                traits::allocate_nodes(alloc, count, size, alignment, nodes);
+            }
+
+            void deallocate_nodes(void** nodes, std::size_t count, std::size_t size,
+                                  std::size_t alignment) noexcept
+            {
+                std::lock_guard<actual_mutex> lock(*this);
+                auto&&                        alloc = get_allocator();
+                traits::deallocate_nodes(alloc, nodes, count, size, alignment);
+            }
+
+            bool try_expand_node(void* node, std::size_t old_size, std::size_t new_size,
+                                 std::size_t alignment) noexcept
+            {
+                // serves both traits, but only the composable one checks the ownership
+                using resize_traits =
+                    typename std::conditional<composable::value, composable_traits, traits>::type;
+                std::lock_guard<actual_mutex> lock(*this);
+                auto&&                        alloc = get_allocator();
+                return resize_traits::try_expand_node(alloc, node, old_size, new_size, alignment);
+            }
+
+            bool try_shrink_node(void* node, std::size_t old_size, std::size_t new_size,
+                                 std::size_t alignment) noexcept
+            {
+                // serves both traits, but only the composable one checks the ownership
+                using resize_traits =
+                    typename std::conditional<composable::value, composable_traits, traits>::type;
+                std::lock_guard<actual_mutex> lock(*this);
+                auto&&                        alloc = get_allocator();
+                return resize_traits::try_shrink_node(alloc, node, old_size, new_size, alignment);
+            }
+
+            void* reallocate_array(void* array, std::size_t old_count, std::size_t new_count,
+                                   std::size_t size, std::size_t alignment)
+            {
+                std::lock_guard<actual_mutex> lock(*this);
+                auto&&                        alloc = get_allocator();
+                return traits::reallocate_array(alloc, array, old_count, new_count, size,
+                                                alignment);
+            }
+
+            memory_block allocate_at_least(std::size_t count, std::size_t size,
+                                           std::size_t alignment)
+            {
+                std::lock_guard<actual_mutex> lock(*this);
+                auto&&                        alloc = get_allocator();
+                return traits::allocate_at_least(alloc, count, size, alignment);
+            }
+
             std::size_t max_node_size() const
             {
                 std::lock_guard<actual_mutex> lock(*this);
@@ -268,6 +323,38 @@ namespace foonathan
                 auto&&                        alloc = get_allocator();
                 return composable_traits::try_deallocate_array(alloc, ptr, count, size, alignment);
             }
+
+            FOONATHAN_ENABLE_IF(composable::value)
+            bool try_allocate_nodes(std::size_t count, std::size_t size, std::size_t alignment,
+                                    void** nodes) noexcept
+            {
+                FOONATHAN_MEMORY_ASSERT(is_composable());
+                std::lock_guard<actual_mutex> lock(*this);
+                auto&&                        alloc = get_allocator();
+                return composable_traits::try_allocate_nodes(alloc, count, size, alignment, nodes);
+            }
+
+            FOONATHAN_ENABLE_IF(composable::value)
+            bool try_deallocate_nodes(void** nodes, std::size_t count, std::size_t size,
+                                      std::size_t alignment) noexcept
+            {
+                FOONATHAN_MEMORY_ASSERT(is_composable());
+                std::lock_guard<actual_mutex> lock(*this);
+                auto&&                        alloc = get_allocator();
+                return composable_traits::try_deallocate_nodes(alloc, nodes, count, size,
+                                                               alignment);
+            }
+
+            FOONATHAN_ENABLE_IF(composable::value)
+            void* try_reallocate_array(void* array, std::size_t old_count, std::size_t new_count,
+                                       std::size_t size, std::size_t alignment) noexcept
+            {
+                FOONATHAN_MEMORY_ASSERT(is_composable());
+                std::lock_guard<actual_mutex> lock(*this);
+                auto&&                        alloc = get_allocator();
+                return composable_traits::try_reallocate_array(alloc, array, old_count, new_count,
+                                                               size, alignment);
+            }
             /// @}
 
             /// @{
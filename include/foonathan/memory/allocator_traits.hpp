@@ -15,6 +15,7 @@
 #include "config.hpp"
 
 #if FOONATHAN_HOSTED_IMPLEMENTATION
+#include <cstring>
 #include <memory>
 #endif
 
@@ -22,6 +23,36 @@ namespace foonathan
 {
     namespace memory
     {
+        /// A memory block.
+        /// It is defined by its starting address and size.
+        /// \ingroup core
+        struct memory_block
+        {
+            void*       memory; ///< The address of the memory block (might be \c nullptr).
+            std::size_t size;   ///< The size of the memory block (might be \c 0).
+
+            /// \effects Creates an invalid memory block with starting address \c nullptr and size \c 0.
+            memory_block() noexcept : memory_block(nullptr, std::size_t(0)) {}
+
+            /// \effects Creates a memory block from a given starting address and size.
+            memory_block(void* mem, std::size_t s) noexcept : memory(mem), size(s) {}
+
+            /// \effects Creates a memory block from a [begin,end) range.
+            memory_block(void* begin, void* end) noexcept
+            : memory_block(begin, static_cast<std::size_t>(static_cast<char*>(end)
+                                                           - static_cast<char*>(begin)))
+            {
+            }
+
+            /// \returns Whether or not a pointer is inside the memory.
+            bool contains(const void* address) const noexcept
+            {
+                auto mem  = static_cast<const char*>(memory);
+                auto addr = static_cast<const char*>(address);
+                return addr >= mem && addr < mem + size;
+            }
+        };
+
         namespace detail
         {
             template <class Allocator>
@@ -48,8 +79,173 @@ namespace foonathan
                 using valid = std::integral_constant<bool, !custom_construct::value
                                                                && !custom_destroy::value>;
             };
+
+            // batch allocation for allocators without native support
+            // allocates each node on its own, already allocated nodes are freed again on failure
+            template <class Traits>
+            void allocate_nodes_each(typename Traits::allocator_type& state, std::size_t count,
+                                     std::size_t size, std::size_t alignment, void** nodes)
+            {
+                std::size_t i = 0u;
+#if FOONATHAN_HAS_EXCEPTION_SUPPORT
+                try
+                {
+#endif
+                    for (; i != count; ++i)
+                        nodes[i] = Traits::allocate_node(state, size, alignment);
+#if FOONATHAN_HAS_EXCEPTION_SUPPORT
+                }
+                catch (...)
+                {
+                    while (i != 0u)
+                        Traits::deallocate_node(state, nodes[--i], size, alignment);
+                    throw;
+                }
+#endif
+            }
+
+            template <class Traits>
+            void deallocate_nodes_each(typename Traits::allocator_type& state, void** nodes,
+                                       std::size_t count, std::size_t size,
+                                       std::size_t alignment) noexcept
+            {
+                for (std::size_t i = 0u; i != count; ++i)
+                    Traits::deallocate_node(state, nodes[i], size, alignment);
+            }
+
+            template <class CompositionTraits>
+            bool try_allocate_nodes_each(typename CompositionTraits::allocator_type& state,
+                                         std::size_t count, std::size_t size,
+                                         std::size_t alignment, void** nodes) noexcept
+            {
+                for (std::size_t i = 0u; i != count; ++i)
+                {
+                    nodes[i] = CompositionTraits::try_allocate_node(state, size, alignment);
+                    if (!nodes[i])
+                    {
+                        while (i != 0u)
+                            CompositionTraits::try_deallocate_node(state, nodes[--i], size,
+                                                                   alignment);
+                        return false;
+                    }
+                }
+                return true;
+            }
+
+            // all nodes must come from the same allocator, so the first one decides
+            template <class CompositionTraits>
+            bool try_deallocate_nodes_each(typename CompositionTraits::allocator_type& state,
+                                           void** nodes, std::size_t count, std::size_t size,
+                                           std::size_t alignment) noexcept
+            {
+                if (count == 0u)
+                    return true;
+                else if (!CompositionTraits::try_deallocate_node(state, nodes[0], size, alignment))
+                    return false;
+
+                for (std::size_t i = 1u; i != count; ++i)
+                {
+                    auto result =
+                        CompositionTraits::try_deallocate_node(state, nodes[i], size, alignment);
+                    FOONATHAN_MEMORY_ASSERT_MSG(result, "nodes from different allocators");
+                    (void)result;
+                }
+                return true;
+            }
+
+            inline void copy_memory(void* dest, const void* src, std::size_t size) noexcept
+            {
+#if FOONATHAN_HOSTED_IMPLEMENTATION
+                std::memcpy(dest, src, size);
+#else
+                auto d = static_cast<unsigned char*>(dest);
+                auto s = static_cast<const unsigned char*>(src);
+                for (std::size_t i = 0u; i != size; ++i)
+                    d[i] = s[i];
+#endif
+            }
+
+            // resizes in place if possible
+            template <class Traits>
+            bool try_resize_in_place(typename Traits::allocator_type& state, void* array,
+                                     std::size_t old_size, std::size_t new_size,
+                                     std::size_t alignment) noexcept
+            {
+                if (new_size > old_size)
+                    return Traits::try_expand_node(state, array, old_size, new_size, alignment);
+                else if (new_size < old_size)
+                    return Traits::try_shrink_node(state, array, old_size, new_size, alignment);
+                return true;
+            }
+
+            // size feedback for allocators that can resize in place,
+            // the array is expanded by the padding the next allocation needs anyway
+            template <class Traits>
+            memory_block allocate_array_at_least(typename Traits::allocator_type& state,
+                                                 std::size_t count, std::size_t size,
+                                                 std::size_t alignment)
+            {
+                auto mem    = Traits::allocate_array(state, count, size, alignment);
+                auto bytes  = count * size;
+                auto actual = round_up_to_multiple_of_alignment(bytes, max_alignment);
+                actual -= actual % size;
+                if (actual == bytes
+                    || !Traits::try_expand_node(state, mem, bytes, actual, alignment))
+                    return {mem, bytes};
+                return {mem, actual};
+            }
+
+            // reallocation for allocators without native support
+            // resizes in place if possible, otherwise allocates a new array and copies
+            template <class Traits>
+            void* reallocate_array_copy(typename Traits::allocator_type& state, void* array,
+                                        std::size_t old_count, std::size_t new_count,
+                                        std::size_t size, std::size_t alignment)
+            {
+                if (try_resize_in_place<Traits>(state, array, old_count * size, new_count * size,
+                                                alignment))
+                    return array;
+
+                auto result = Traits::allocate_array(state, new_count, size, alignment);
+                copy_memory(result, array, (old_count < new_count ? old_count : new_count) * size);
+                Traits::deallocate_array(state, array, old_count, size, alignment);
+                return result;
+            }
+
+            // the array is only deallocated after copying,
+            // if that fails it was not owned and the new one is deallocated again
+            template <class CompositionTraits>
+            void* try_reallocate_array_copy(typename CompositionTraits::allocator_type& state,
+                                            void* array, std::size_t old_count,
+                                            std::size_t new_count, std::size_t size,
+                                            std::size_t alignment) noexcept
+            {
+                if (try_resize_in_place<CompositionTraits>(state, array, old_count * size,
+                                                           new_count * size, alignment))
+                    return array;
+
+                auto result =
+                    CompositionTraits::try_allocate_array(state, new_count, size, alignment);
+                if (!result)
+                    return nullptr;
+                copy_memory(result, array, (old_count < new_count ? old_count : new_count) * size);
+                if (!CompositionTraits::try_deallocate_array(state, array, old_count, size,
+                                                             alignment))
+                {
+                    CompositionTraits::try_deallocate_array(state, result, new_count, size,
+                                                            alignment);
+                    return nullptr;
+                }
+                return result;
+            }
         } // namespace detail
 
+        template <class Allocator>
+        class allocator_traits;
+
+        template <class Allocator>
+        class composable_allocator_traits;
+
         /// Traits class that checks whether or not a standard \c Allocator can be used as \concept{concept_rawallocator,RawAllocator}.
         /// It checks the existence of a custom \c construct(), \c destroy() function, if provided,
         /// it cannot be used since it would not be called.<br>
@@ -281,6 +477,115 @@ namespace foonathan
             {
                 return detail::max_alignment;
             }
+
+            //=== allocate_nodes() ===//
+            // first try Allocator::allocate_nodes
+            // then allocate each node on its own
+            template <class Allocator>
+            auto allocate_nodes(full_concept, Allocator& alloc, std::size_t count,
+                                std::size_t size, std::size_t alignment, void** nodes)
+                -> FOONATHAN_AUTO_RETURN_TYPE(alloc.allocate_nodes(count, size, alignment, nodes),
+                                              void)
+
+                    template <class Allocator>
+                    void allocate_nodes(min_concept, Allocator& alloc, std::size_t count,
+                                        std::size_t size, std::size_t alignment, void** nodes)
+            {
+                detail::allocate_nodes_each<allocator_traits<Allocator>>(alloc, count, size,
+                                                                         alignment, nodes);
+            }
+
+            //=== deallocate_nodes() ===//
+            // first try Allocator::deallocate_nodes
+            // then deallocate each node on its own
+            template <class Allocator>
+            auto deallocate_nodes(full_concept, Allocator& alloc, void** nodes, std::size_t count,
+                                  std::size_t size, std::size_t alignment) noexcept
+                -> FOONATHAN_AUTO_RETURN_TYPE(alloc.deallocate_nodes(nodes, count, size, alignment),
+                                              void)
+
+                    template <class Allocator>
+                    void deallocate_nodes(min_concept, Allocator& alloc, void** nodes,
+                                          std::size_t count, std::size_t size,
+                                          std::size_t alignment) noexcept
+            {
+                detail::deallocate_nodes_each<allocator_traits<Allocator>>(alloc, nodes, count,
+                                                                           size, alignment);
+            }
+
+            //=== try_expand_node() ===//
+            // first try Allocator::try_expand_node
+            // then fail
+            template <class Allocator>
+            auto try_expand_node(full_concept, Allocator& alloc, void* node, std::size_t old_size,
+                                 std::size_t new_size, std::size_t alignment) noexcept
+                -> FOONATHAN_AUTO_RETURN_TYPE(alloc.try_expand_node(node, old_size, new_size,
+                                                                    alignment),
+                                              bool)
+
+                    template <class Allocator>
+                    bool try_expand_node(min_concept, Allocator&, void*, std::size_t, std::size_t,
+                                         std::size_t) noexcept
+            {
+                return false;
+            }
+
+            //=== try_shrink_node() ===//
+            // first try Allocator::try_shrink_node
+            // then fail
+            template <class Allocator>
+            auto try_shrink_node(full_concept, Allocator& alloc, void* node, std::size_t old_size,
+                                 std::size_t new_size, std::size_t alignment) noexcept
+                -> FOONATHAN_AUTO_RETURN_TYPE(alloc.try_shrink_node(node, old_size, new_size,
+                                                                    alignment),
+                                              bool)
+
+                    template <class Allocator>
+                    bool try_shrink_node(min_concept, Allocator&, void*, std::size_t, std::size_t,
+                                         std::size_t) noexcept
+            {
+                return false;
+            }
+
+            //=== reallocate_array() ===//
+            // first try Allocator::reallocate_array
+            // then resize in place or allocate, copy and deallocate
+            template <class Allocator>
+            auto reallocate_array(full_concept, Allocator& alloc, void* array,
+                                  std::size_t old_count, std::size_t new_count, std::size_t size,
+                                  std::size_t alignment)
+                -> FOONATHAN_AUTO_RETURN_TYPE(alloc.reallocate_array(array, old_count, new_count,
+                                                                     size, alignment),
+                                              void*)
+
+                    template <class Allocator>
+                    void* reallocate_array(min_concept, Allocator& alloc, void* array,
+                                           std::size_t old_count, std::size_t new_count,
+                                           std::size_t size, std::size_t alignment)
+            {
+                return detail::reallocate_array_copy<allocator_traits<Allocator>>(alloc, array,
+                                                                                  old_count,
+                                                                                  new_count, size,
+                                                                                  alignment);
+            }
+
+            //=== allocate_at_least() ===//
+            // first try Allocator::allocate_at_least
+            // then allocate exactly the requested array
+            template <class Allocator>
+            auto allocate_at_least(full_concept, Allocator& alloc, std::size_t count,
+                                   std::size_t size, std::size_t alignment)
+                -> FOONATHAN_AUTO_RETURN_TYPE(alloc.allocate_at_least(count, size, alignment),
+                                              memory_block)
+
+                    template <class Allocator>
+                    memory_block allocate_at_least(min_concept, Allocator& alloc,
+                                                   std::size_t count, std::size_t size,
+                                                   std::size_t alignment)
+            {
+                return {allocator_traits<Allocator>::allocate_array(alloc, count, size, alignment),
+                        count * size};
+            }
         } // namespace traits_detail
 
         /// The default specialization of the allocator_traits for a \concept{concept_rawallocator,RawAllocator}.
@@ -335,6 +640,67 @@ namespace foonathan
                                                 size, alignment);
             }
 
+            static void allocate_nodes(allocator_type& state, std::size_t count, std::size_t size,
+                                       std::size_t alignment, void** nodes)
+            {
+                static_assert(allocator_is_raw_allocator<Allocator>::value,
+                              "Allocator cannot be used as RawAllocator because it provides custom "
+                              "construct()/destroy()");
+                traits_detail::allocate_nodes(traits_detail::full_concept{}, state, count, size,
+                                              alignment, nodes);
+            }
+
+            static void deallocate_nodes(allocator_type& state, void** nodes, std::size_t count,
+                                         std::size_t size, std::size_t alignment) noexcept
+            {
+                static_assert(allocator_is_raw_allocator<Allocator>::value,
+                              "Allocator cannot be used as RawAllocator because it provides custom "
+                              "construct()/destroy()");
+                traits_detail::deallocate_nodes(traits_detail::full_concept{}, state, nodes, count,
+                                                size, alignment);
+            }
+
+            static bool try_expand_node(allocator_type& state, void* node, std::size_t old_size,
+                                        std::size_t new_size, std::size_t alignment) noexcept
+            {
+                static_assert(allocator_is_raw_allocator<Allocator>::value,
+                              "Allocator cannot be used as RawAllocator because it provides custom "
+                              "construct()/destroy()");
+                return traits_detail::try_expand_node(traits_detail::full_concept{}, state, node,
+                                                      old_size, new_size, alignment);
+            }
+
+            static bool try_shrink_node(allocator_type& state, void* node, std::size_t old_size,
+                                        std::size_t new_size, std::size_t alignment) noexcept
+            {
+                static_assert(allocator_is_raw_allocator<Allocator>::value,
+                              "Allocator cannot be used as RawAllocator because it provides custom "
+                              "construct()/destroy()");
+                return traits_detail::try_shrink_node(traits_detail::full_concept{}, state, node,
+                                                      old_size, new_size, alignment);
+            }
+
+            static void* reallocate_array(allocator_type& state, void* array,
+                                          std::size_t old_count, std::size_t new_count,
+                                          std::size_t size, std::size_t alignment)
+            {
+                static_assert(allocator_is_raw_allocator<Allocator>::value,
+                              "Allocator cannot be used as RawAllocator because it provides custom "
+                              "construct()/destroy()");
+                return traits_detail::reallocate_array(traits_detail::full_concept{}, state, array,
+                                                       old_count, new_count, size, alignment);
+            }
+
+            static memory_block allocate_at_least(allocator_type& state, std::size_t count,
+                                                  std::size_t size, std::size_t alignment)
+            {
+                static_assert(allocator_is_raw_allocator<Allocator>::value,
+                              "Allocator cannot be used as RawAllocator because it provides custom "
+                              "construct()/destroy()");
+                return traits_detail::allocate_at_least(traits_detail::full_concept{}, state, count,
+                                                        size, alignment);
+            }
+
             static std::size_t max_node_size(const allocator_type& state)
             {
                 static_assert(allocator_is_raw_allocator<Allocator>::value,
@@ -489,6 +855,66 @@ namespace foonathan
             {
                 return try_deallocate_node(full_concept{}, alloc, ptr, count * size, alignment);
             }
+
+            //=== try_allocate_nodes() ===//
+            // first try Allocator::try_allocate_nodes
+            // then allocate each node on its own
+            template <class Allocator>
+            auto try_allocate_nodes(full_concept, Allocator& alloc, std::size_t count,
+                                    std::size_t size, std::size_t alignment, void** nodes) noexcept
+                -> FOONATHAN_AUTO_RETURN_TYPE(alloc.try_allocate_nodes(count, size, alignment,
+                                                                       nodes),
+                                              bool)
+
+                    template <class Allocator>
+                    bool try_allocate_nodes(min_concept, Allocator& alloc, std::size_t count,
+                                            std::size_t size, std::size_t alignment,
+                                            void** nodes) noexcept
+            {
+                return detail::try_allocate_nodes_each<composable_allocator_traits<Allocator>>(
+                    alloc, count, size, alignment, nodes);
+            }
+
+            //=== try_deallocate_nodes() ===//
+            // first try Allocator::try_deallocate_nodes
+            // then deallocate each node on its own
+            template <class Allocator>
+            auto try_deallocate_nodes(full_concept, Allocator& alloc, void** nodes,
+                                      std::size_t count, std::size_t size,
+                                      std::size_t alignment) noexcept
+                -> FOONATHAN_AUTO_RETURN_TYPE(alloc.try_deallocate_nodes(nodes, count, size,
+                                                                         alignment),
+                                              bool)
+
+                    template <class Allocator>
+                    bool try_deallocate_nodes(min_concept, Allocator& alloc, void** nodes,
+                                              std::size_t count, std::size_t size,
+                                              std::size_t alignment) noexcept
+            {
+                return detail::try_deallocate_nodes_each<composable_allocator_traits<Allocator>>(
+                    alloc, nodes, count, size, alignment);
+            }
+
+            //=== try_reallocate_array() ===//
+            // first try Allocator::try_reallocate_array
+            // then resize in place or allocate, copy and deallocate
+            template <class Allocator>
+            auto try_reallocate_array(full_concept, Allocator& alloc, void* array,
+                                      std::size_t old_count, std::size_t new_count,
+                                      std::size_t size, std::size_t alignment) noexcept
+                -> FOONATHAN_AUTO_RETURN_TYPE(alloc.try_reallocate_array(array, old_count,
+                                                                         new_count, size,
+                                                                         alignment),
+                                              void*)
+
+                    template <class Allocator>
+                    void* try_reallocate_array(min_concept, Allocator& alloc, void* array,
+                                               std::size_t old_count, std::size_t new_count,
+                                               std::size_t size, std::size_t alignment) noexcept
+            {
+                return detail::try_reallocate_array_copy<composable_allocator_traits<Allocator>>(
+                    alloc, array, old_count, new_count, size, alignment);
+            }
         } // namespace traits_detail
 
         /// The default specialization of the composable_allocator_traits for a \concept{concept_composableallocator,ComposableAllocator}.
@@ -537,6 +963,55 @@ namespace foonathan
                                                            array, count, size, alignment);
             }
 
+            static bool try_allocate_nodes(allocator_type& state, std::size_t count,
+                                           std::size_t size, std::size_t alignment,
+                                           void** nodes) noexcept
+            {
+                static_assert(is_raw_allocator<Allocator>::value,
+                              "ComposableAllocator must be RawAllocator");
+                return traits_detail::try_allocate_nodes(traits_detail::full_concept{}, state,
+                                                         count, size, alignment, nodes);
+            }
+
+            static bool try_deallocate_nodes(allocator_type& state, void** nodes,
+                                             std::size_t count, std::size_t size,
+                                             std::size_t alignment) noexcept
+            {
+                static_assert(is_raw_allocator<Allocator>::value,
+                              "ComposableAllocator must be RawAllocator");
+                return traits_detail::try_deallocate_nodes(traits_detail::full_concept{}, state,
+                                                           nodes, count, size, alignment);
+            }
+
+            static bool try_expand_node(allocator_type& state, void* node, std::size_t old_size,
+                                        std::size_t new_size, std::size_t alignment) noexcept
+            {
+                static_assert(is_raw_allocator<Allocator>::value,
+                              "ComposableAllocator must be RawAllocator");
+                return traits_detail::try_expand_node(traits_detail::full_concept{}, state, node,
+                                                      old_size, new_size, alignment);
+            }
+
+            static bool try_shrink_node(allocator_type& state, void* node, std::size_t old_size,
+                                        std::size_t new_size, std::size_t alignment) noexcept
+            {
+                static_assert(is_raw_allocator<Allocator>::value,
+                              "ComposableAllocator must be RawAllocator");
+                return traits_detail::try_shrink_node(traits_detail::full_concept{}, state, node,
+                                                      old_size, new_size, alignment);
+            }
+
+            static void* try_reallocate_array(allocator_type& state, void* array,
+                                              std::size_t old_count, std::size_t new_count,
+                                              std::size_t size, std::size_t alignment) noexcept
+            {
+                static_assert(is_raw_allocator<Allocator>::value,
+                              "ComposableAllocator must be RawAllocator");
+                return traits_detail::try_reallocate_array(traits_detail::full_concept{}, state,
+                                                           array, old_count, new_count, size,
+                                                           alignment);
+            }
+
 #if !defined(DOXYGEN)
             using foonathan_memory_default_traits = std::true_type;
 #endif
@@ -0,0 +1,500 @@
+// Copyright (C) 2015-2025 Jonathan Müller and foonathan/memory contributors
+// SPDX-License-Identifier: Zlib
+
+#ifndef FOONATHAN_MEMORY_CONCURRENT_MEMORY_STACK_HPP_INCLUDED
+#define FOONATHAN_MEMORY_CONCURRENT_MEMORY_STACK_HPP_INCLUDED
+
+/// \file
+/// Class \ref foonathan::memory::concurrent_memory_stack and its \ref foonathan::memory::allocator_traits specialization.
+/// \note Only available on a hosted implementation.
+
+#include "config.hpp"
+#if !FOONATHAN_HOSTED_IMPLEMENTATION
+#error "This header is only available for a hosted implementation."
+#endif
+
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <type_traits>
+
+#include "detail/align.hpp"
+#include "detail/assert.hpp"
+#include "detail/debug_helpers.hpp"
+#include "detail/memory_stack.hpp"
+#include "allocator_traits.hpp"
+#include "error.hpp"
+#include "memory_arena.hpp"
+#include "memory_stack.hpp"
+
+namespace foonathan
+{
+    namespace memory
+    {
+        namespace detail
+        {
+            // header at the beginning of each block of a concurrent_memory_stack
+            // offset is bumped atomically and runs past size once the block is exhausted
+            struct alignas(max_alignment) concurrent_stack_block
+            {
+                std::atomic<std::size_t> offset;
+                std::size_t              size;
+
+                explicit concurrent_stack_block(std::size_t s) noexcept : offset(0u), size(s) {}
+
+                char* memory() noexcept
+                {
+                    return reinterpret_cast<char*>(this + 1);
+                }
+
+                const char* end() noexcept
+                {
+                    return memory() + size;
+                }
+
+                std::size_t used() const noexcept
+                {
+                    auto cur = offset.load(std::memory_order_relaxed);
+                    return cur < size ? cur : size;
+                }
+            };
+
+            struct concurrent_memory_stack_leak_handler
+            {
+                void operator()(std::ptrdiff_t amount);
+            };
+        } // namespace detail
+
+        /// A stateful \concept{concept_rawallocator,RawAllocator} that provides stack-like (LIFO) allocations
+        /// from multiple threads at once.
+        /// Like \ref memory_stack it uses a \ref memory_arena with a given \c BlockOrRawAllocator to allocate huge blocks,
+        /// but the top of the current block is an atomic offset:
+        /// allocation is a single `fetch_add` on it and does not take a lock.
+        /// Only if the current block is exhausted, a mutex is locked to replace it by a new one;
+        /// the memory already handed out from the old block stays valid.
+        /// Deallocation is not directly supported, only setting the top to a previously queried position.
+        /// \note \ref top(), \ref unwind(), \ref capacity_left() and \ref shrink_to_fit() are not thread-safe,
+        /// they must only be called at quiescent points where no other thread is using the stack.
+        /// \ingroup allocator
+        template <class BlockOrRawAllocator = default_allocator>
+        class concurrent_memory_stack
+        : FOONATHAN_EBO(
+              detail::default_concurrent_leak_checker<detail::concurrent_memory_stack_leak_handler>)
+        {
+        public:
+            using allocator_type = make_block_allocator_t<BlockOrRawAllocator>;
+
+            /// \returns The minimum block size required for a stack containing the given amount of memory.
+            /// \requires `byte_size` must be a positive number.
+            /// \note Due to debug fences and the rounding of each allocation to the maximum alignment,
+            /// the actual amount of usable memory can be less.
+            static constexpr std::size_t min_block_size(std::size_t byte_size) noexcept
+            {
+                return detail::memory_block_stack::implementation_offset()
+                       + sizeof(detail::concurrent_stack_block) + byte_size;
+            }
+
+            /// \effects Creates it with a given initial block size and and other constructor arguments for the \concept{concept_blockallocator,BlockAllocator}.
+            /// It will allocate the first block and sets the top to its beginning.
+            /// \requires \c block_size must be at least \c min_block_size(1).
+            template <typename... Args>
+            explicit concurrent_memory_stack(std::size_t block_size, Args&&... args)
+            : arena_(block_size, detail::forward<Args>(args)...), cur_(new_block())
+            {
+            }
+
+            /// \effects Allocates a memory block of given size and alignment.
+            /// It atomically moves the top of the current block, which is safe to do from multiple threads concurrently.
+            /// If there is not enough space on the current memory block,
+            /// a lock is taken and a new one will be allocated by the \concept{concept_blockallocator,BlockAllocator} or taken from a cache
+            /// unless another thread already did so.
+            /// \returns A \concept{concept_node,node} with given size and alignment.
+            /// \throws Anything thrown by the \concept{concept_blockallocator,BlockAllocator} on growth
+            /// or \ref bad_allocation_size if \c size is too big.
+            /// \requires \c size and \c alignment must be valid.
+            void* allocate(std::size_t size, std::size_t alignment)
+            {
+                auto needed = allocation_size(size, alignment);
+                while (true)
+                {
+                    auto block = cur_.load(std::memory_order_acquire);
+                    if (needed <= block->size)
+                        if (auto mem = allocate_in(block, needed, size, alignment))
+                            return mem;
+                    grow(block, needed);
+                }
+            }
+
+            /// \effects Allocates a memory block of given size and alignment,
+            /// similar to \ref allocate().
+            /// But it does not attempt a growth if the current block is exhausted.
+            /// \returns A \concept{concept_node,node} with given size and alignment
+            /// or `nullptr` if there wasn't enough memory available.
+            void* try_allocate(std::size_t size, std::size_t alignment) noexcept
+            {
+                auto block  = cur_.load(std::memory_order_acquire);
+                auto needed = allocation_size(size, alignment);
+                if (needed > block->size)
+                    return nullptr;
+                return allocate_in(block, needed, size, alignment);
+            }
+
+            /// The marker type that is used for unwinding,
+            /// it is the same as \ref memory_stack::marker.
+            using marker = FOONATHAN_IMPL_DEFINED(detail::stack_marker);
+
+            /// \returns A marker to the current top of the stack.
+            /// \requires No other thread may allocate concurrently.
+            marker top() const noexcept
+            {
+                auto block = cur_.load(std::memory_order_acquire);
+                return {arena_.size() - 1,
+                        detail::fixed_memory_stack(block->memory() + block->used()),
+                        block->end()};
+            }
+
+            /// \effects Unwinds the stack to a certain marker position.
+            /// This sets the top of the stack to the position described by the marker
+            /// and has the effect of deallocating all memory allocated since the marker was obtained.
+            /// If any memory blocks are unused after the operation,
+            /// they are not deallocated but put in a cache for later use,
+            /// call \ref shrink_to_fit() to actually deallocate them.
+            /// \requires The marker must point to memory that is still in use and was the whole time,
+            /// i.e. it must have been pointed below the top at all time,
+            /// and no other thread may use the stack concurrently.
+            void unwind(marker m) noexcept
+            {
+                FOONATHAN_MEMORY_ASSERT(m <= top());
+                detail::debug_check_pointer([&] { return m.index <= arena_.size() - 1; }, info(),
+                                            m.top);
+
+                auto to_deallocate = (arena_.size() - 1) - m.index;
+                for (std::size_t i = 0u; i != to_deallocate; ++i)
+                    arena_.deallocate_block();
+
+                auto block = static_cast<detail::concurrent_stack_block*>(
+                    arena_.current_block().memory);
+                detail::debug_check_pointer([&] { return m.end == block->end(); }, info(), m.top);
+
+                // mark memory from new top to the old top or end of the block as freed
+                auto old_top = to_deallocate ? block->end() : block->memory() + block->used();
+                detail::debug_fill_free(m.top, std::size_t(old_top - m.top), 0);
+
+                block->offset.store(std::size_t(m.top - block->memory()),
+                                    std::memory_order_relaxed);
+                cur_.store(block, std::memory_order_release);
+            }
+
+            /// \effects \ref unwind() does not actually do any deallocation of blocks on the \concept{concept_blockallocator,BlockAllocator},
+            /// unused memory is stored in a cache for later reuse.
+            /// This function clears that cache.
+            /// \requires No other thread may use the stack concurrently.
+            void shrink_to_fit() noexcept
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                arena_.shrink_to_fit();
+            }
+
+            /// \returns The amount of memory remaining in the current block.
+            /// This is the number of bytes that are available for allocation
+            /// before the cache or \concept{concept_blockallocator,BlockAllocator} needs to be used.
+            /// \requires No other thread may allocate concurrently.
+            std::size_t capacity_left() const noexcept
+            {
+                auto block = cur_.load(std::memory_order_acquire);
+                return block->size - block->used();
+            }
+
+            /// \returns The size of the next memory block after the current block is exhausted and the arena grows.
+            /// This function just forwards to the \ref memory_arena.
+            /// \note Part of it is used for the block header, fences and alignment buffers,
+            /// so this is not the exact amount of memory usable for the user.
+            std::size_t next_capacity() const noexcept
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                return arena_.next_block_size();
+            }
+
+            /// \returns A reference to the \concept{concept_blockallocator,BlockAllocator} used for managing the arena.
+            /// \requires It is undefined behavior to move this allocator out into another object.
+            allocator_type& get_allocator() noexcept
+            {
+                return arena_.get_allocator();
+            }
+
+        private:
+            allocator_info info() const noexcept
+            {
+                return {FOONATHAN_MEMORY_LOG_PREFIX "::concurrent_memory_stack", this};
+            }
+
+            // number of bytes an allocation takes from a block
+            // every allocation starts at a multiple of the maximum alignment,
+            // so over-aligned ones need a buffer
+            static std::size_t allocation_size(std::size_t size, std::size_t alignment) noexcept
+            {
+                auto needed = front_size() + size + detail::debug_fence_size;
+                if (alignment > detail::max_alignment)
+                    needed += alignment - detail::max_alignment;
+                return detail::round_up_to_multiple_of_alignment(needed, detail::max_alignment);
+            }
+
+            static constexpr std::size_t front_size() noexcept
+            {
+                return (detail::debug_fence_size + detail::max_alignment - 1u)
+                       / detail::max_alignment * detail::max_alignment;
+            }
+
+            void* allocate_in(detail::concurrent_stack_block* block, std::size_t needed,
+                              std::size_t size, std::size_t alignment) noexcept
+            {
+                auto offset = block->offset.fetch_add(needed, std::memory_order_relaxed);
+                if (offset > block->size || needed > block->size - offset)
+                    // block exhausted, the offset stays past the end
+                    return nullptr;
+
+                auto memory = block->memory() + offset + front_size();
+                memory += detail::align_offset(memory, alignment);
+                auto fence = detail::debug_fence_size;
+                return detail::debug_fill_new(memory - fence, size, fence);
+            }
+
+            // replaces the block if it is still the current one
+            void grow(detail::concurrent_stack_block* block, std::size_t needed)
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (cur_.load(std::memory_order_relaxed) != block)
+                    // another thread already did it
+                    return;
+
+                auto capacity =
+                    arena_.next_block_size() - sizeof(detail::concurrent_stack_block);
+                detail::check_allocation_size<bad_allocation_size>(needed, capacity, info());
+                cur_.store(new_block(), std::memory_order_release);
+            }
+
+            detail::concurrent_stack_block* new_block()
+            {
+                auto block = arena_.allocate_block();
+                FOONATHAN_MEMORY_ASSERT(block.size > sizeof(detail::concurrent_stack_block));
+                return ::new (block.memory)
+                    detail::concurrent_stack_block(block.size
+                                                   - sizeof(detail::concurrent_stack_block));
+            }
+
+            memory_arena<allocator_type>                 arena_;
+            mutable std::mutex                           mutex_;
+            std::atomic<detail::concurrent_stack_block*> cur_;
+
+            friend allocator_traits<concurrent_memory_stack<BlockOrRawAllocator>>;
+            friend composable_allocator_traits<concurrent_memory_stack<BlockOrRawAllocator>>;
+        };
+
+#if FOONATHAN_MEMORY_EXTERN_TEMPLATE
+        extern template class concurrent_memory_stack<>;
+        extern template class memory_stack_raii_unwind<concurrent_memory_stack<>>;
+#endif
+
+        /// Specialization of the \ref allocator_traits for \ref concurrent_memory_stack classes.
+        /// All functions are safe to call from multiple threads concurrently.
+        /// \note It is not allowed to mix calls through the specialization and through the member functions,
+        /// i.e. \ref concurrent_memory_stack::allocate() and this \c allocate_node().
+        /// \ingroup allocator
+        template <class BlockAllocator>
+        class allocator_traits<concurrent_memory_stack<BlockAllocator>>
+        {
+        public:
+            using allocator_type = concurrent_memory_stack<BlockAllocator>;
+            using is_stateful    = std::true_type;
+
+            /// \returns The result of \ref concurrent_memory_stack::allocate().
+            static void* allocate_node(allocator_type& state, std::size_t size,
+                                       std::size_t alignment)
+            {
+                auto mem = state.allocate(size, alignment);
+                state.on_allocate(size);
+                return mem;
+            }
+
+            /// \returns The result of \ref concurrent_memory_stack::allocate().
+            static void* allocate_array(allocator_type& state, std::size_t count, std::size_t size,
+                                        std::size_t alignment)
+            {
+                return allocate_node(state, count * size, alignment);
+            }
+
+            /// \effects Calls \ref concurrent_memory_stack::allocate() for each node.
+            static void allocate_nodes(allocator_type& state, std::size_t count, std::size_t size,
+                                       std::size_t alignment, void** nodes)
+            {
+                detail::allocate_nodes_each<allocator_traits>(state, count, size, alignment, nodes);
+            }
+
+            /// @{
+            /// \effects Does nothing besides bookmarking for leak checking, if that is enabled.
+            /// Actual deallocation can only be done via \ref concurrent_memory_stack::unwind().
+            static void deallocate_node(allocator_type& state, void*, std::size_t size,
+                                        std::size_t) noexcept
+            {
+                state.on_deallocate(size);
+            }
+
+            static void deallocate_array(allocator_type& state, void* ptr, std::size_t count,
+                                         std::size_t size, std::size_t alignment) noexcept
+            {
+                deallocate_node(state, ptr, count * size, alignment);
+            }
+
+            static void deallocate_nodes(allocator_type& state, void**, std::size_t count,
+                                         std::size_t size, std::size_t) noexcept
+            {
+                state.on_deallocate(count * size);
+            }
+            /// @}
+
+            /// @{
+            /// \returns `false`, the top can be moved by other threads at any time,
+            /// so nodes cannot be resized in place.
+            static bool try_expand_node(allocator_type&, void*, std::size_t, std::size_t,
+                                        std::size_t) noexcept
+            {
+                return false;
+            }
+
+            static bool try_shrink_node(allocator_type&, void*, std::size_t, std::size_t,
+                                        std::size_t) noexcept
+            {
+                return false;
+            }
+            /// @}
+
+            /// \effects Allocates a new array and copies.
+            /// \returns The reallocated array.
+            static void* reallocate_array(allocator_type& state, void* array, std::size_t old_count,
+                                          std::size_t new_count, std::size_t size,
+                                          std::size_t alignment)
+            {
+                return detail::reallocate_array_copy<allocator_traits>(state, array, old_count,
+                                                                       new_count, size, alignment);
+            }
+
+            /// \returns The result of \ref concurrent_memory_stack::allocate() together with the requested size.
+            static memory_block allocate_at_least(allocator_type& state, std::size_t count,
+                                                  std::size_t size, std::size_t alignment)
+            {
+                return {allocate_array(state, count, size, alignment), count * size};
+            }
+
+            /// @{
+            /// \returns The maximum size which is \ref concurrent_memory_stack::next_capacity().
+            static std::size_t max_node_size(const allocator_type& state) noexcept
+            {
+                return state.next_capacity();
+            }
+
+            static std::size_t max_array_size(const allocator_type& state) noexcept
+            {
+                return state.next_capacity();
+            }
+            /// @}
+
+            /// \returns The maximum possible value since there is no alignment restriction
+            /// (except indirectly through \ref concurrent_memory_stack::next_capacity()).
+            static std::size_t max_alignment(const allocator_type&) noexcept
+            {
+                return std::size_t(-1);
+            }
+        };
+
+        /// Specialization of the \ref composable_allocator_traits for \ref concurrent_memory_stack classes.
+        /// All functions are safe to call from multiple threads concurrently.
+        /// \ingroup allocator
+        template <class BlockAllocator>
+        class composable_allocator_traits<concurrent_memory_stack<BlockAllocator>>
+        {
+        public:
+            using allocator_type = concurrent_memory_stack<BlockAllocator>;
+
+            /// \returns The result of \ref concurrent_memory_stack::try_allocate().
+            static void* try_allocate_node(allocator_type& state, std::size_t size,
+                                           std::size_t alignment) noexcept
+            {
+                return state.try_allocate(size, alignment);
+            }
+
+            /// \returns The result of \ref concurrent_memory_stack::try_allocate().
+            static void* try_allocate_array(allocator_type& state, std::size_t count,
+                                            std::size_t size, std::size_t alignment) noexcept
+            {
+                return state.try_allocate(count * size, alignment);
+            }
+
+            /// \effects Calls \ref concurrent_memory_stack::try_allocate() for each node.
+            /// \returns Whether all nodes could be allocated.
+            static bool try_allocate_nodes(allocator_type& state, std::size_t count,
+                                           std::size_t size, std::size_t alignment,
+                                           void** nodes) noexcept
+            {
+                return detail::try_allocate_nodes_each<composable_allocator_traits>(state, count,
+                                                                                    size, alignment,
+                                                                                    nodes);
+            }
+
+            /// @{
+            /// \effects Does nothing.
+            /// \returns Whether the memory will be deallocated by \ref concurrent_memory_stack::unwind().
+            static bool try_deallocate_node(allocator_type& state, void* ptr, std::size_t,
+                                            std::size_t) noexcept
+            {
+                std::lock_guard<std::mutex> lock(state.mutex_);
+                return state.arena_.owns(ptr);
+            }
+
+            static bool try_deallocate_array(allocator_type& state, void* ptr, std::size_t count,
+                                             std::size_t size, std::size_t alignment) noexcept
+            {
+                return try_deallocate_node(state, ptr, count * size, alignment);
+            }
+
+            static bool try_deallocate_nodes(allocator_type& state, void** nodes, std::size_t count,
+                                             std::size_t size, std::size_t alignment) noexcept
+            {
+                return count == 0u || try_deallocate_node(state, nodes[0], size, alignment);
+            }
+            /// @}
+
+            /// @{
+            /// \returns `false`, nodes cannot be resized in place.
+            static bool try_expand_node(allocator_type&, void*, std::size_t, std::size_t,
+                                        std::size_t) noexcept
+            {
+                return false;
+            }
+
+            static bool try_shrink_node(allocator_type&, void*, std::size_t, std::size_t,
+                                        std::size_t) noexcept
+            {
+                return false;
+            }
+            /// @}
+
+            /// \effects Allocates a new array and copies.
+            /// \returns The reallocated array or `nullptr` if it was not allocated by the stack
+            /// or there was not enough memory.
+            static void* try_reallocate_array(allocator_type& state, void* array,
+                                              std::size_t old_count, std::size_t new_count,
+                                              std::size_t size, std::size_t alignment) noexcept
+            {
+                return detail::try_reallocate_array_copy<composable_allocator_traits>(
+                    state, array, old_count, new_count, size, alignment);
+            }
+        };
+
+#if FOONATHAN_MEMORY_EXTERN_TEMPLATE
+        extern template class allocator_traits<concurrent_memory_stack<>>;
+        extern template class composable_allocator_traits<concurrent_memory_stack<>>;
+#endif
+    } // namespace memory
+} // namespace foonathan
+
+#endif // FOONATHAN_MEMORY_CONCURRENT_MEMORY_STACK_HPP_INCLUDED
@@ -0,0 +1,187 @@
+// Copyright (C) 2015-2025 Jonathan Müller and foonathan/memory contributors
+// SPDX-License-Identifier: Zlib
+
+#ifndef FOONATHAN_MEMORY_DETAIL_BITMAP_FREE_LIST_HPP_INCLUDED
+#define FOONATHAN_MEMORY_DETAIL_BITMAP_FREE_LIST_HPP_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+
+#include "align.hpp"
+#include "utility.hpp"
+#include "../config.hpp"
+
+namespace foonathan
+{
+    namespace memory
+    {
+        namespace detail
+        {
+            class memory_block_tally;
+
+            // header at the beginning of every inserted block
+            // followed by the bitmap and the nodes
+            // the blocks are kept in an address ordered treap to find the block of a node,
+            // the ones with free nodes also in a list to find them in constant time
+            struct bitmap_block
+            {
+                bitmap_block *next, *prev;  // neighbours in the list of blocks with free nodes
+                bitmap_block *left, *right; // children in the treap
+                std::size_t   no_nodes;   // total number of nodes in the block
+                std::size_t   capacity;   // number of free nodes in the block
+                std::size_t   first_word; // all words of the bitmap before it are zero
+            };
+
+            // a set bit in the bitmap marks a free node
+            using bitmap_word                        = std::uint64_t;
+            constexpr std::size_t bitmap_word_bits   = 64u;
+            constexpr std::size_t bitmap_header_size = sizeof(bitmap_block);
+
+            constexpr std::size_t bitmap_word_count(std::size_t no_nodes)
+            {
+                return no_nodes / bitmap_word_bits + (no_nodes % bitmap_word_bits == 0u ? 0u : 1u);
+            }
+
+            // offset of the first node in a block
+            constexpr std::size_t bitmap_nodes_offset(std::size_t no_nodes)
+            {
+                return (bitmap_header_size + bitmap_word_count(no_nodes) * sizeof(bitmap_word)
+                        + max_alignment - 1u)
+                       / max_alignment * max_alignment;
+            }
+
+            // stores free nodes for a memory pool in one occupancy bitmap per inserted block
+            // the nodes themselves are never written to, so there is no minimum node size
+            // and freed nodes stay untouched
+            // allocation scans the bitmap a word at a time, deallocation sets a single bit,
+            // so a double deallocation is always detected in debug mode
+            // it does not support arrays
+            class bitmap_free_memory_list
+            {
+            public:
+                // minimum element size
+                static constexpr std::size_t min_element_size = 1;
+                // alignment
+                static constexpr std::size_t min_element_alignment = 1;
+
+                // minimal size of the block that needs to be inserted
+                static constexpr std::size_t min_block_size(std::size_t node_size,
+                                                            std::size_t number_of_nodes)
+                {
+                    return bitmap_nodes_offset(number_of_nodes) + node_size * number_of_nodes;
+                }
+
+                //=== constructor ===//
+                bitmap_free_memory_list(std::size_t node_size) noexcept;
+
+                // calls other constructor plus insert
+                bitmap_free_memory_list(std::size_t node_size, void* mem,
+                                        std::size_t size) noexcept
+                : bitmap_free_memory_list(node_size)
+                {
+                    insert(mem, size);
+                }
+
+                bitmap_free_memory_list(bitmap_free_memory_list&& other) noexcept;
+                ~bitmap_free_memory_list() noexcept = default;
+
+                bitmap_free_memory_list& operator=(bitmap_free_memory_list&& other) noexcept
+                {
+                    bitmap_free_memory_list tmp(detail::move(other));
+                    swap(*this, tmp);
+                    return *this;
+                }
+
+                friend void swap(bitmap_free_memory_list& a, bitmap_free_memory_list& b) noexcept;
+
+                //=== insert/allocation/deallocation ===//
+                // inserts a new memory block, the header and bitmap are put at the beginning
+                // does not own memory!
+                // mem must be aligned for maximum alignment
+                // pre: size != 0
+                void insert(void* mem, std::size_t size) noexcept;
+
+                // returns the usable size
+                // i.e. how many memory will be actually inserted and usable on a call to insert()
+                std::size_t usable_size(std::size_t size) const noexcept;
+
+                // returns a single block from the list
+                // pre: !empty()
+                void* allocate() noexcept;
+
+                // returns a memory block big enough for n bytes
+                // arrays are not supported, so only succeeds if n <= node_size()
+                void* allocate(std::size_t n) noexcept
+                {
+                    return n <= node_size_ ? allocate() : nullptr;
+                }
+
+                // deallocates a single block
+                void deallocate(void* ptr) noexcept;
+
+                // deallocates multiple blocks with n bytes total
+                // arrays are not supported, so n must be <= node_size()
+                void deallocate(void* ptr, std::size_t n) noexcept;
+
+                // removes up to n single blocks and writes them to out
+                // a whole bitmap word is taken at once
+                // returns the number of blocks written, less than n if the list runs empty
+                std::size_t allocate_nodes(std::size_t n, void** out) noexcept;
+
+                // deallocates n single blocks
+                void deallocate_nodes(void** ptrs, std::size_t n) noexcept;
+
+                // number of free nodes in the blocks inside [mem, mem + size)
+                std::size_t free_nodes_in(void* mem, std::size_t size) noexcept;
+
+                // adds the free nodes to the tally of the blocks containing them
+                void count_free_nodes(memory_block_tally& tally) noexcept;
+
+                // removes all blocks inside [mem, mem + size)
+                // pre: all of their nodes are free
+                void remove_nodes_in(void* mem, std::size_t size) noexcept;
+
+                //=== getter ===//
+                std::size_t node_size() const noexcept
+                {
+                    return node_size_;
+                }
+
+                // alignment of all nodes
+                std::size_t alignment() const noexcept;
+
+                // number of nodes remaining
+                std::size_t capacity() const noexcept
+                {
+                    return capacity_;
+                }
+
+                bool empty() const noexcept
+                {
+                    return capacity_ == 0u;
+                }
+
+            private:
+                // returns the block the node belongs to or nullptr
+                // O(log n) lookup in the treap
+                bitmap_block* find_block(char* node) noexcept;
+
+                // returns a block with free nodes
+                // pre: !empty()
+                bitmap_block* find_free_block() noexcept;
+
+                // adds or removes a block from the list of blocks with free nodes
+                // called when its capacity changes from 0 to 1 and back
+                void link_free_block(bitmap_block* block) noexcept;
+                void unlink_free_block(bitmap_block* block) noexcept;
+
+                bitmap_block *free_blocks_, *root_, *alloc_block_, *dealloc_block_;
+                std::size_t   node_size_, capacity_;
+            };
+
+            void swap(bitmap_free_memory_list& a, bitmap_free_memory_list& b) noexcept;
+        } // namespace detail
+    } // namespace memory
+} // namespace foonathan
+
+#endif // FOONATHAN_MEMORY_DETAIL_BITMAP_FREE_LIST_HPP_INCLUDED
@@ -0,0 +1,199 @@
+// Copyright (C) 2015-2025 Jonathan Müller and foonathan/memory contributors
+// SPDX-License-Identifier: Zlib
+
+#ifndef FOONATHAN_MEMORY_DETAIL_CONCURRENT_FREE_LIST_HPP_INCLUDED
+#define FOONATHAN_MEMORY_DETAIL_CONCURRENT_FREE_LIST_HPP_INCLUDED
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include "align.hpp"
+#include "utility.hpp"
+#include "../config.hpp"
+
+namespace foonathan
+{
+    namespace memory
+    {
+        namespace detail
+        {
+            // stores free blocks for a memory pool that is shared between threads
+            // lock-free stack of nodes, ABA-safe by using a generation counter
+            // nodes are addressed by 32bit indices into a table of the inserted blocks,
+            // so the head (generation + index) fits into a single 64bit atomic
+            // allocation and deallocation are lock-free, insertion must be serialized
+            class concurrent_free_memory_list
+            {
+            public:
+                // minimum element size
+                static constexpr auto min_element_size = sizeof(std::uint32_t);
+                // alignment
+                static constexpr auto min_element_alignment = alignof(std::uint32_t);
+
+                // maximum number of blocks that can be inserted
+                static constexpr std::size_t max_blocks = 64u;
+
+                // minimal size of the block that needs to be inserted
+                static constexpr std::size_t min_block_size(std::size_t node_size,
+                                                            std::size_t number_of_nodes)
+                {
+                    return (node_size < min_element_size ? min_element_size : node_size)
+                           * number_of_nodes;
+                }
+
+                //=== constructor ===//
+                concurrent_free_memory_list(std::size_t node_size) noexcept;
+
+                // calls other constructor plus insert
+                concurrent_free_memory_list(std::size_t node_size, void* mem,
+                                            std::size_t size) noexcept
+                : concurrent_free_memory_list(node_size)
+                {
+                    insert(mem, size);
+                }
+
+                // not thread-safe
+                concurrent_free_memory_list(concurrent_free_memory_list&& other) noexcept;
+                ~concurrent_free_memory_list() noexcept = default;
+
+                concurrent_free_memory_list& operator=(concurrent_free_memory_list&& other) noexcept
+                {
+                    concurrent_free_memory_list tmp(detail::move(other));
+                    swap(*this, tmp);
+                    return *this;
+                }
+
+                friend void swap(concurrent_free_memory_list& a,
+                                 concurrent_free_memory_list& b) noexcept;
+
+                //=== insert/allocation/deallocation ===//
+                // inserts a new memory block, by splitting it up and setting the links
+                // does not own memory!
+                // mem must be aligned for alignment()
+                // must not be called concurrently with another insert
+                // pre: size != 0, can_insert(size)
+                void insert(void* mem, std::size_t size) noexcept;
+
+                // returns the usable size
+                // i.e. how many memory will be actually inserted and usable on a call to insert()
+                std::size_t usable_size(std::size_t size) const noexcept
+                {
+                    // Round down to next multiple of node size.
+                    return (size / node_size_) * node_size_;
+                }
+
+                // returns a single block from the list
+                // returns nullptr if the list is empty
+                void* allocate() noexcept;
+
+                // returns a memory block big enough for n bytes
+                // arrays are not supported, so only succeeds if n <= node_size()
+                void* allocate(std::size_t n) noexcept
+                {
+                    return n <= node_size_ ? allocate() : nullptr;
+                }
+
+                // deallocates a single block
+                void deallocate(void* ptr) noexcept;
+
+                // deallocates multiple blocks with n bytes total
+                // arrays are not supported, so n must be <= node_size()
+                void deallocate(void* ptr, std::size_t n) noexcept;
+
+                // removes up to n single blocks as one chain with a single exchange of the head
+                // returns the number of blocks written to out, less than n if the list runs empty
+                std::size_t allocate_nodes(std::size_t n, void** out) noexcept;
+
+                // links n single blocks to a chain and pushes it with a single exchange of the head
+                void deallocate_nodes(void** ptrs, std::size_t n) noexcept;
+
+                //=== growth ===//
+                // only one thread may insert memory at a time
+                // a thread that wants to grow the list must call try_begin_growth()
+                // if it returns false, another thread is growing and it should call wait_for_growth()
+                bool try_begin_growth() noexcept
+                {
+                    return !growing_.exchange(true, std::memory_order_acquire);
+                }
+
+                void end_growth() noexcept
+                {
+                    growing_.store(false, std::memory_order_release);
+                }
+
+                void wait_for_growth() const noexcept;
+
+                //=== getter ===//
+                std::size_t node_size() const noexcept
+                {
+                    return node_size_;
+                }
+
+                // alignment of all nodes
+                std::size_t alignment() const noexcept;
+
+                // number of nodes remaining
+                std::size_t capacity() const noexcept
+                {
+                    return capacity_.load(std::memory_order_relaxed);
+                }
+
+                bool empty() const noexcept
+                {
+                    return (head_.load(std::memory_order_relaxed) & index_mask) == 0u;
+                }
+
+                // whether ptr points into inserted memory
+                // only looks at the published block table, so it can be called during growth
+                bool owns(const void* ptr) const noexcept;
+
+                // whether or not the block table has room for a memory block of given size,
+                // huge blocks need multiple table entries
+                bool can_insert(std::size_t size) const noexcept;
+
+            private:
+                static constexpr std::uint64_t index_mask = 0xFFFFFFFFu;
+
+                struct block
+                {
+                    char*         memory;
+                    std::uint32_t no_nodes;
+                };
+
+                char*         to_node(std::uint32_t index) const noexcept;
+                bool          is_valid(std::uint32_t index) const noexcept;
+                std::uint32_t to_index(const void* node) const noexcept;
+                // returns the number of the table entry containing ptr plus one or 0
+                std::size_t find_block(const void* ptr) const noexcept;
+
+                // pushes the chain first..last with given number of nodes
+                void push(std::uint32_t first, char* last, std::size_t no_nodes) noexcept;
+
+                // lower 32bit: index of first node, upper 32bit: generation
+                std::atomic<std::uint64_t> head_;
+                std::atomic<std::size_t>   capacity_;
+                std::atomic<std::size_t>   no_blocks_;
+                std::atomic<bool>          growing_;
+                std::size_t                node_size_;
+                block                      blocks_[max_blocks];
+            };
+
+            void swap(concurrent_free_memory_list& a, concurrent_free_memory_list& b) noexcept;
+
+            // whether or not FreeList can be used by multiple threads at once
+            template <class FreeList>
+            struct is_concurrent_free_list : std::false_type
+            {
+            };
+
+            template <>
+            struct is_concurrent_free_list<concurrent_free_memory_list> : std::true_type
+            {
+            };
+        } // namespace detail
+    } // namespace memory
+} // namespace foonathan
+
+#endif // FOONATHAN_MEMORY_DETAIL_CONCURRENT_FREE_LIST_HPP_INCLUDED
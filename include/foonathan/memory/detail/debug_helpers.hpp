@@ -39,6 +39,11 @@ namespace foonathan
             void* debug_fill_free(void* memory, std::size_t node_size,
                                   std::size_t fence_size = debug_fence_size) noexcept;
 
+            // checks the fences of a node that changes its size in place,
+            // fills the memory added as new or the memory removed as free and moves the back fence
+            void debug_resize_node(void* memory, std::size_t old_size, std::size_t new_size,
+                                   std::size_t fence_size = debug_fence_size) noexcept;
+
             // fills internal memory
             void debug_fill_internal(void* memory, std::size_t size, bool free) noexcept;
 #else
@@ -59,6 +64,10 @@ namespace foonathan
                 return static_cast<char*>(memory);
             }
 
+            inline void debug_resize_node(void*, std::size_t, std::size_t, std::size_t) noexcept
+            {
+            }
+
             inline void debug_fill_internal(void*, std::size_t, bool) noexcept {}
 #endif
 
@@ -116,27 +125,29 @@ namespace foonathan
 
             // does leak checking per-object
             // leak is detected upon destructor
-            template <class Handler>
+            // Counter is std::atomic<std::ptrdiff_t> for objects shared between threads
+            template <class Handler, typename Counter = std::ptrdiff_t>
             class object_leak_checker : Handler
             {
             public:
                 object_leak_checker() noexcept : allocated_(0) {}
 
                 object_leak_checker(object_leak_checker&& other) noexcept
-                : allocated_(other.allocated_)
+                : allocated_(static_cast<std::ptrdiff_t>(other.allocated_))
                 {
                     other.allocated_ = 0;
                 }
 
                 ~object_leak_checker() noexcept
                 {
-                    if (allocated_ != 0)
-                        this->operator()(allocated_);
+                    std::ptrdiff_t allocated = allocated_;
+                    if (allocated != 0)
+                        this->operator()(allocated);
                 }
 
                 object_leak_checker& operator=(object_leak_checker&& other) noexcept
                 {
-                    allocated_       = other.allocated_;
+                    allocated_       = static_cast<std::ptrdiff_t>(other.allocated_);
                     other.allocated_ = 0;
                     return *this;
                 }
@@ -152,7 +163,7 @@ namespace foonathan
                 }
 
             private:
-                std::ptrdiff_t allocated_;
+                Counter allocated_;
             };
 
             // does leak checking on a global basis
@@ -223,9 +234,16 @@ namespace foonathan
 #if FOONATHAN_MEMORY_DEBUG_LEAK_CHECK
             template <class Handler>
             using default_leak_checker = object_leak_checker<Handler>;
+
+            template <class Handler>
+            using default_concurrent_leak_checker =
+                object_leak_checker<Handler, std::atomic<std::ptrdiff_t>>;
 #else
             template <class Handler>
             using default_leak_checker = no_leak_checker<Handler>;
+
+            template <class Handler>
+            using default_concurrent_leak_checker = no_leak_checker<Handler>;
 #endif
         } // namespace detail
     } // namespace memory
@@ -4,6 +4,7 @@
 #ifndef FOONATHAN_MEMORY_DETAILL_FREE_LIST_HPP_INCLUDED
 #define FOONATHAN_MEMORY_DETAILL_FREE_LIST_HPP_INCLUDED
 
+#include <climits>
 #include <cstddef>
 #include <cstdint>
 
@@ -17,8 +18,12 @@ namespace foonathan
     {
         namespace detail
         {
+            class memory_block_tally;
+
             // stores free blocks for a memory pool
             // memory blocks are fragmented and stored in a list
+            // the newest inserted block isn't linked up front but carved lazily,
+            // so its memory is only touched when the nodes are actually used
             // debug: fills memory and uses a bigger node_size for fence memory
             class free_memory_list
             {
@@ -50,7 +55,9 @@ namespace foonathan
                 friend void swap(free_memory_list& a, free_memory_list& b) noexcept;
 
                 //=== insert/allocation/deallocation ===//
-                // inserts a new memory block, by splitting it up and setting the links
+                // inserts a new memory block
+                // it becomes the bump region, nodes are carved from it once the linked list is empty
+                // the remaining nodes of the previous bump region are linked into the list
                 // does not own memory!
                 // mem must be aligned for alignment()
                 // pre: size != 0
@@ -64,7 +71,7 @@ namespace foonathan
                     return (size / node_size_) * node_size_;
                 }
 
-                // returns a single block from the list
+                // returns a single block from the list or the bump region
                 // pre: !empty()
                 void* allocate() noexcept;
 
@@ -78,6 +85,23 @@ namespace foonathan
                 // deallocates multiple blocks with n bytes total
                 void deallocate(void* ptr, std::size_t n) noexcept;
 
+                // removes up to n single blocks as one chain and writes them to out
+                // returns the number of blocks written, less than n if the list runs empty
+                std::size_t allocate_nodes(std::size_t n, void** out) noexcept;
+
+                // links n single blocks to a chain and splices it into the list
+                void deallocate_nodes(void** ptrs, std::size_t n) noexcept;
+
+                // number of free nodes inside [mem, mem + size), including the ones not carved yet
+                std::size_t free_nodes_in(void* mem, std::size_t size) noexcept;
+
+                // adds the free nodes to the tally of the blocks containing them
+                void count_free_nodes(memory_block_tally& tally) noexcept;
+
+                // removes all free nodes inside [mem, mem + size)
+                // used to give an inserted block back once all of its nodes are free
+                void remove_nodes_in(void* mem, std::size_t size) noexcept;
+
                 //=== getter ===//
                 std::size_t node_size() const noexcept
                 {
@@ -95,35 +119,72 @@ namespace foonathan
 
                 bool empty() const noexcept
                 {
-                    return first_ == nullptr;
+                    return first_ == nullptr && bump_begin_ == bump_end_;
                 }
 
             private:
                 void insert_impl(void* mem, std::size_t size) noexcept;
 
                 char*       first_;
+                char *      bump_begin_, *bump_end_;
                 std::size_t node_size_, capacity_;
             };
 
             void swap(free_memory_list& a, free_memory_list& b) noexcept;
 
+            // a hierarchical bitmap, each level has one bit per word of the level below,
+            // the top level is a single word
+            constexpr std::size_t ordered_bitmap_bits = sizeof(std::uintptr_t) * CHAR_BIT;
+
+            // number of words of a hierarchical bitmap with given number of bits
+            constexpr std::size_t ordered_bitmap_words(std::size_t no_bits)
+            {
+                return no_bits <= ordered_bitmap_bits ?
+                           1u :
+                           (no_bits + ordered_bitmap_bits - 1u) / ordered_bitmap_bits
+                               + ordered_bitmap_words((no_bits + ordered_bitmap_bits - 1u)
+                                                      / ordered_bitmap_bits);
+            }
+
             // same as above but keeps the nodes ordered
             // this allows array allocations, that is, consecutive nodes
+            // the list links maximal runs of consecutive free nodes instead of single nodes,
+            // runs that are big enough are additionally indexed by their size,
+            // so an array allocation does not need to search the list
+            // every inserted block starts with a header containing a bitmap of the runs,
+            // the headers are indexed by address,
+            // so the position of a deallocated node is found in logarithmic time
+            // node sizes smaller than two pointers are rounded up to an even size,
+            // the lowest bit of the link is needed to mark single node runs
             // debug: fills memory and uses a bigger node_size for fence memory
             class ordered_free_memory_list
             {
+                static constexpr std::size_t actual_node_size(std::size_t node_size)
+                {
+                    return node_size < min_element_size ? min_element_size
+                           : node_size < 2u * min_element_size
+                               ? node_size + node_size % 2u
+                               : node_size;
+                }
+
             public:
                 // minimum element size
                 static constexpr auto min_element_size = sizeof(char*);
                 // alignment
                 static constexpr auto min_element_alignment = alignof(char*);
 
+                // size of the block header, without alignment
+                static constexpr std::size_t block_header_size(std::size_t number_of_nodes)
+                {
+                    return (6u + ordered_bitmap_words(number_of_nodes)) * sizeof(std::uintptr_t);
+                }
+
                 // minimal size of the block that needs to be inserted
                 static constexpr std::size_t min_block_size(std::size_t node_size,
                                                             std::size_t number_of_nodes)
                 {
-                    return (node_size < min_element_size ? min_element_size : node_size)
-                           * number_of_nodes;
+                    return block_header_size(number_of_nodes) + max_alignment
+                           + actual_node_size(node_size) * number_of_nodes;
                 }
 
                 //=== constructor ===//
@@ -150,26 +211,23 @@ namespace foonathan
                 friend void swap(ordered_free_memory_list& a, ordered_free_memory_list& b) noexcept;
 
                 //=== insert/allocation/deallocation ===//
-                // inserts a new memory block, by splitting it up and setting the links
+                // inserts a new memory block, puts the header at the beginning
+                // and links the rest as a single run
                 // does not own memory!
                 // mem must be aligned for alignment()
-                // pre: size != 0
+                // memory that is too small for the header and a node is ignored
                 void insert(void* mem, std::size_t size) noexcept;
 
                 // returns the usable size
                 // i.e. how many memory will be actually inserted and usable on a call to insert()
-                std::size_t usable_size(std::size_t size) const noexcept
-                {
-                    // Round down to next multiple of node size.
-                    return (size / node_size_) * node_size_;
-                }
+                std::size_t usable_size(std::size_t size) const noexcept;
 
                 // returns a single block from the list
                 // pre: !empty()
                 void* allocate() noexcept;
 
                 // returns a memory block big enough for n bytes (!, not nodes)
-                // might fail even if capacity is sufficient
+                // takes the smallest run that is big enough, fails if there is none
                 void* allocate(std::size_t n) noexcept;
 
                 // deallocates a single block
@@ -178,6 +236,24 @@ namespace foonathan
                 // deallocates multiple blocks with n bytes total
                 void deallocate(void* ptr, std::size_t n) noexcept;
 
+                // removes up to n single blocks from the front runs and writes them to out
+                // returns the number of blocks written, less than n if the list runs empty
+                std::size_t allocate_nodes(std::size_t n, void** out) noexcept;
+
+                // deallocates n single blocks
+                // they need to be sorted into the list one by one
+                void deallocate_nodes(void** ptrs, std::size_t n) noexcept;
+
+                // number of free nodes inside [mem, mem + size)
+                std::size_t free_nodes_in(void* mem, std::size_t size) noexcept;
+
+                // adds the free nodes to the tally of the blocks containing them
+                void count_free_nodes(memory_block_tally& tally) noexcept;
+
+                // removes all blocks inside [mem, mem + size)
+                // pre: all of their nodes are free
+                void remove_nodes_in(void* mem, std::size_t size) noexcept;
+
                 //=== getter ===//
                 std::size_t node_size() const noexcept
                 {
@@ -199,15 +275,22 @@ namespace foonathan
                 }
 
             private:
-                // returns previous pointer
-                char* insert_impl(void* mem, std::size_t size) noexcept;
+                // inserts no_nodes nodes starting at mem, merges them with the adjacent runs
+                void insert_run(char* mem, std::size_t no_nodes) noexcept;
+
+                // removes the last no_nodes nodes of run and returns them
+                // prev is the run before it, it is only needed if the entire run is removed
+                char* remove_from_run(char* prev, char* run, std::size_t no_nodes) noexcept;
+
+                // returns the block header of the block the node belongs to or nullptr
+                char* find_block(char* node) noexcept;
 
                 char* begin_node() noexcept;
                 char* end_node() noexcept;
 
                 std::uintptr_t begin_proxy_, end_proxy_;
+                char *         index_root_, *block_root_, *run_block_root_, *last_block_;
                 std::size_t    node_size_, capacity_;
-                char *         last_dealloc_, *last_dealloc_prev_;
             };
 
             void swap(ordered_free_memory_list& a, ordered_free_memory_list& b) noexcept;
@@ -4,6 +4,8 @@
 #ifndef FOONATHAN_MEMORY_DETAIL_FREE_LIST_ARRAY_HPP
 #define FOONATHAN_MEMORY_DETAIL_FREE_LIST_ARRAY_HPP
 
+#include <cstdint>
+
 #include "align.hpp"
 #include "assert.hpp"
 #include "memory_stack.hpp"
@@ -73,6 +75,13 @@ namespace foonathan
                     return array_[i - min_size_index];
                 }
 
+                // access free list by index
+                FreeList& operator[](std::size_t i) const noexcept
+                {
+                    FOONATHAN_MEMORY_ASSERT(i < no_elements_);
+                    return array_[i];
+                }
+
                 // number of free lists
                 std::size_t size() const noexcept
                 {
@@ -118,6 +127,240 @@ namespace foonathan
                 static std::size_t index_from_size(std::size_t size) noexcept;
                 static std::size_t size_from_index(std::size_t index) noexcept;
             };
+
+            // geometric size classes with 2^log2_sub classes per power of two
+            // all sizes up to 2^(log2_sub + 1) get their own class,
+            // after that (2^p, 2^(p + 1)] is split into classes with a step of 2^(p - log2_sub)
+            std::size_t geometric_index_from_size(std::size_t size, std::size_t log2_sub) noexcept;
+            std::size_t geometric_size_from_index(std::size_t index, std::size_t log2_sub) noexcept;
+
+            // constexpr versions to compute the lookup table
+            constexpr std::size_t geometric_floor_log2(std::size_t x) noexcept
+            {
+                return x <= 1u ? 0u : 1u + geometric_floor_log2(x >> 1u);
+            }
+
+            constexpr std::size_t geometric_index_impl(std::size_t size, std::size_t log2_sub,
+                                                       std::size_t p) noexcept
+            {
+                return (p - log2_sub + 1u) * (std::size_t(1u) << log2_sub)
+                       + ((size - (std::size_t(1u) << p) + (std::size_t(1u) << (p - log2_sub)) - 1u)
+                          >> (p - log2_sub));
+            }
+
+            constexpr std::size_t geometric_index(std::size_t size, std::size_t log2_sub) noexcept
+            {
+                return size <= (std::size_t(1u) << log2_sub) ?
+                           size :
+                           geometric_index_impl(size, log2_sub, geometric_floor_log2(size - 1u));
+            }
+
+            template <std::size_t... Indices>
+            struct geometric_index_sequence
+            {
+            };
+
+            template <class A, class B>
+            struct geometric_concat_sequence;
+
+            template <std::size_t... A, std::size_t... B>
+            struct geometric_concat_sequence<geometric_index_sequence<A...>,
+                                             geometric_index_sequence<B...>>
+            {
+                using type = geometric_index_sequence<A..., (sizeof...(A) + B)...>;
+            };
+
+            // logarithmic instantiation depth
+            template <std::size_t N>
+            struct geometric_make_sequence
+            : geometric_concat_sequence<typename geometric_make_sequence<N / 2u>::type,
+                                        typename geometric_make_sequence<N - N / 2u>::type>
+            {
+            };
+
+            template <>
+            struct geometric_make_sequence<0u>
+            {
+                using type = geometric_index_sequence<>;
+            };
+
+            template <>
+            struct geometric_make_sequence<1u>
+            {
+                using type = geometric_index_sequence<0u>;
+            };
+
+            // sizes smaller than this are looked up in the table
+            constexpr std::size_t geometric_table_size = 1024u;
+
+            template <std::size_t Log2Sub,
+                      class Sequence =
+                          typename geometric_make_sequence<geometric_table_size>::type>
+            struct geometric_table;
+
+            template <std::size_t Log2Sub, std::size_t... Sizes>
+            struct geometric_table<Log2Sub, geometric_index_sequence<Sizes...>>
+            {
+                static const std::uint16_t indices[sizeof...(Sizes)];
+            };
+
+            // constant initialized, so there are no problems with the initialization order
+            template <std::size_t Log2Sub, std::size_t... Sizes>
+            const std::uint16_t
+                geometric_table<Log2Sub, geometric_index_sequence<Sizes...>>::indices[sizeof...(
+                    Sizes)] = {std::uint16_t(geometric_index(Sizes, Log2Sub))...};
+
+            // AccessPolicy that splits each power of two into SubClasses sizes, like jemalloc
+            // a node never wastes more than 1 / (SubClasses + 1) of its size
+            // small sizes are looked up in a precomputed table
+            template <std::size_t SubClasses>
+            struct geometric_access_policy
+            {
+                static_assert(SubClasses > 0u && (SubClasses & (SubClasses - 1u)) == 0u,
+                              "number of sub classes must be a power of two");
+                static_assert(SubClasses <= 256u, "too many sub classes");
+
+                static constexpr std::size_t log2_sub = geometric_floor_log2(SubClasses);
+
+                static std::size_t index_from_size(std::size_t size) noexcept
+                {
+                    FOONATHAN_MEMORY_ASSERT_MSG(size, "size must not be zero");
+                    return size < geometric_table_size ?
+                               geometric_table<log2_sub>::indices[size] :
+                               geometric_index_from_size(size, log2_sub);
+                }
+
+                static std::size_t size_from_index(std::size_t index) noexcept
+                {
+                    return geometric_size_from_index(index, log2_sub);
+                }
+            };
+
+            template <std::size_t SubClasses>
+            constexpr std::size_t geometric_access_policy<SubClasses>::log2_sub;
+
+            // compile-time helpers for a user-defined list of bucket sizes
+            constexpr bool static_buckets_ascending(std::size_t) noexcept
+            {
+                return true;
+            }
+
+            template <class... Tail>
+            constexpr bool static_buckets_ascending(std::size_t prev, std::size_t next,
+                                                    Tail... tail) noexcept
+            {
+                return prev < next && static_buckets_ascending(next, tail...);
+            }
+
+            constexpr std::size_t static_buckets_gcd(std::size_t a, std::size_t b) noexcept
+            {
+                return b == 0u ? a : static_buckets_gcd(b, a % b);
+            }
+
+            constexpr std::size_t static_buckets_granularity(std::size_t size) noexcept
+            {
+                return size;
+            }
+
+            template <class... Tail>
+            constexpr std::size_t static_buckets_granularity(std::size_t a, std::size_t b,
+                                                             Tail... tail) noexcept
+            {
+                return static_buckets_granularity(static_buckets_gcd(a, b), tail...);
+            }
+
+            constexpr std::size_t static_buckets_max(std::size_t size) noexcept
+            {
+                return size;
+            }
+
+            template <class... Tail>
+            constexpr std::size_t static_buckets_max(std::size_t a, std::size_t b,
+                                                     Tail... tail) noexcept
+            {
+                return static_buckets_max(a < b ? b : a, tail...);
+            }
+
+            // index of the first bucket that is big enough, number of buckets if there is none
+            constexpr std::size_t static_buckets_index(std::size_t) noexcept
+            {
+                return 0u;
+            }
+
+            template <class... Tail>
+            constexpr std::size_t static_buckets_index(std::size_t size, std::size_t head,
+                                                       Tail... tail) noexcept
+            {
+                return size <= head ? 0u : 1u + static_buckets_index(size, tail...);
+            }
+
+            template <class Sequence, std::size_t... Sizes>
+            struct static_buckets_table;
+
+            // indices[i] is the bucket for all sizes in ((i - 1) * granularity, i * granularity]
+            template <std::size_t... Slots, std::size_t... Sizes>
+            struct static_buckets_table<geometric_index_sequence<Slots...>, Sizes...>
+            {
+                static const std::size_t   sizes[sizeof...(Sizes)];
+                static const std::uint16_t indices[sizeof...(Slots)];
+            };
+
+            // constant initialized, so there are no problems with the initialization order
+            template <std::size_t... Slots, std::size_t... Sizes>
+            const std::size_t static_buckets_table<geometric_index_sequence<Slots...>,
+                                                   Sizes...>::sizes[sizeof...(Sizes)] = {Sizes...};
+
+            template <std::size_t... Slots, std::size_t... Sizes>
+            const std::uint16_t
+                static_buckets_table<geometric_index_sequence<Slots...>,
+                                     Sizes...>::indices[sizeof...(Slots)] = {std::uint16_t(
+                    static_buckets_index(Slots * static_buckets_granularity(Sizes...),
+                                         Sizes...))...};
+
+            // AccessPolicy with a fixed, ascending list of bucket sizes
+            // the lookup is a single load from a table generated at compile-time,
+            // so unlike the other policies it can be inlined into the allocation functions
+            // sizes bigger than the last bucket are mapped to the last bucket,
+            // callers have to check against free_list_array::max_node_size()
+            template <std::size_t... Sizes>
+            struct static_access_policy
+            {
+                static_assert(sizeof...(Sizes) > 0u, "at least one bucket size required");
+                static_assert(sizeof...(Sizes) <= 256u, "too many bucket sizes");
+                static_assert(static_buckets_index(1u, Sizes...) == 0u,
+                              "bucket sizes must not be zero");
+                static_assert(static_buckets_ascending(Sizes...),
+                              "bucket sizes must be strictly ascending");
+
+                static constexpr std::size_t granularity = static_buckets_granularity(Sizes...);
+                static constexpr std::size_t no_slots =
+                    static_buckets_max(Sizes...) / granularity + 1u;
+                static_assert(no_slots <= 4096u,
+                              "bucket sizes are too fine-grained for the lookup table");
+
+                using table =
+                    static_buckets_table<typename geometric_make_sequence<no_slots>::type,
+                                         Sizes...>;
+
+                static std::size_t index_from_size(std::size_t size) noexcept
+                {
+                    FOONATHAN_MEMORY_ASSERT_MSG(size, "size must not be zero");
+                    auto slot = (size + granularity - 1u) / granularity;
+                    return slot < no_slots ? table::indices[slot] : sizeof...(Sizes) - 1u;
+                }
+
+                static std::size_t size_from_index(std::size_t index) noexcept
+                {
+                    FOONATHAN_MEMORY_ASSERT(index < sizeof...(Sizes));
+                    return table::sizes[index];
+                }
+            };
+
+            template <std::size_t... Sizes>
+            constexpr std::size_t static_access_policy<Sizes...>::granularity;
+
+            template <std::size_t... Sizes>
+            constexpr std::size_t static_access_policy<Sizes...>::no_slots;
         } // namespace detail
     } // namespace memory
 } // namespace foonathan
@@ -0,0 +1,237 @@
+// Copyright (C) 2015-2025 Jonathan Müller and foonathan/memory contributors
+// SPDX-License-Identifier: Zlib
+
+#ifndef FOONATHAN_MEMORY_DETAIL_FREE_LIST_STACK_HPP_INCLUDED
+#define FOONATHAN_MEMORY_DETAIL_FREE_LIST_STACK_HPP_INCLUDED
+
+#include <cstddef>
+
+#include "align.hpp"
+#include "assert.hpp"
+#include "debug_helpers.hpp"
+#include "memory_stack.hpp"
+#include "utility.hpp"
+#include "../memory_arena.hpp"
+
+namespace foonathan
+{
+    namespace memory
+    {
+        namespace detail
+        {
+            // carves the memory for the free lists of a pool collection from the blocks of an arena
+            // each block starts with the number of nodes put onto the free lists from it,
+            // so a block whose nodes are all free again is found by counting its free nodes,
+            // such a block can be reclaimed and is then carved from before a new block is allocated
+            // the free lists are passed as an array ordered by node size
+            template <class FreeList>
+            class free_list_stack
+            {
+            public:
+                // a reclaimed block has this as its header,
+                // followed by the next block in the list of reclaimed blocks
+                static constexpr std::size_t reclaimed_marker = std::size_t(-1);
+
+                static constexpr std::size_t header_size() noexcept
+                {
+                    return sizeof(std::size_t) % max_alignment == 0u ?
+                               sizeof(std::size_t) :
+                               (sizeof(std::size_t) / max_alignment + 1u) * max_alignment;
+                }
+
+                static std::size_t& inserted_nodes(memory_block block) noexcept
+                {
+                    return *static_cast<std::size_t*>(block.memory);
+                }
+
+                static bool is_reclaimed(memory_block block) noexcept
+                {
+                    return inserted_nodes(block) == reclaimed_marker;
+                }
+
+                explicit free_list_stack(memory_block block) noexcept : reclaimed_()
+                {
+                    use_block(block);
+                }
+
+                free_list_stack(free_list_stack&& other) noexcept
+                : block_(other.block_),
+                  reclaimed_(other.reclaimed_),
+                  stack_(detail::move(other.stack_))
+                {
+                    other.block_ = other.reclaimed_ = memory_block();
+                }
+
+                ~free_list_stack() noexcept = default;
+
+                free_list_stack& operator=(free_list_stack&& other) noexcept
+                {
+                    block_       = other.block_;
+                    reclaimed_   = other.reclaimed_;
+                    stack_       = detail::move(other.stack_);
+                    other.block_ = other.reclaimed_ = memory_block();
+                    return *this;
+                }
+
+                //=== carving ===//
+                // the stack itself, e.g. to carve the free lists from
+                fixed_memory_stack& stack() noexcept
+                {
+                    return stack_;
+                }
+
+                // the block the stack carves from
+                memory_block block() const noexcept
+                {
+                    return block_;
+                }
+
+                const char* end() const noexcept
+                {
+                    return static_cast<const char*>(block_.memory) + block_.size;
+                }
+
+                std::size_t capacity_left() const noexcept
+                {
+                    return std::size_t(end() - stack_.top());
+                }
+
+                // puts capacity bytes onto pool, allocating a new block from the arena if necessary
+                // the remaining memory of the current block is put onto the free lists first
+                template <class Arena>
+                void reserve(Arena& arena, FreeList* pools, FreeList& pool, std::size_t capacity)
+                {
+                    auto mem = stack_.allocate(end(), capacity, max_alignment);
+                    if (!mem)
+                    {
+                        insert_rest(pools, pool);
+                        // get new block, previously reclaimed ones first
+                        if (!use_reclaimed_block(capacity))
+                            use_block(arena.allocate_block());
+
+                        // allocate ensuring alignment
+                        mem = stack_.allocate(end(), capacity, max_alignment);
+                        FOONATHAN_MEMORY_ASSERT(mem);
+                    }
+                    insert(pool, mem, capacity);
+                }
+
+                // same as reserve(), but does not allocate a new block
+                void try_reserve(FreeList* pools, FreeList& pool, std::size_t capacity) noexcept
+                {
+                    auto mem = stack_.allocate(end(), capacity, max_alignment);
+                    if (!mem)
+                    {
+                        insert_rest(pools, pool);
+                        if (use_reclaimed_block(capacity))
+                            mem = stack_.allocate(end(), capacity, max_alignment);
+                    }
+                    if (mem)
+                        insert(pool, mem, capacity);
+                }
+
+                //=== reclaiming ===//
+                // takes a block whose nodes have been removed from the free lists for later growth
+                // pre: block is not the current block
+                void reclaim(memory_block block) noexcept
+                {
+                    FOONATHAN_MEMORY_ASSERT(block.memory != block_.memory);
+                    inserted_nodes(block) = reclaimed_marker;
+                    next_reclaimed(block) = reclaimed_;
+                    reclaimed_            = block;
+                }
+
+                // called after the blocks have been given back to the arena
+                // current is the block on top of the arena, it is used if the current block was released
+                void release_reclaimed(bool block_released, memory_block current) noexcept
+                {
+                    reclaimed_ = memory_block();
+                    if (block_released)
+                    {
+                        // start at the end of the new current block,
+                        // its remaining memory has already been put onto the free lists
+                        block_ = current;
+                        stack_ = fixed_memory_stack(static_cast<char*>(block_.memory) + block_.size);
+                    }
+                }
+
+            private:
+                static memory_block& next_reclaimed(memory_block block) noexcept
+                {
+                    return *static_cast<memory_block*>(
+                        static_cast<void*>(static_cast<char*>(block.memory) + header_size()));
+                }
+
+                void use_block(memory_block block) noexcept
+                {
+                    inserted_nodes(block) = 0u;
+                    block_                = block;
+                    stack_ = fixed_memory_stack(static_cast<char*>(block.memory) + header_size());
+                }
+
+                // continues with the first reclaimed block that is big enough
+                bool use_reclaimed_block(std::size_t capacity) noexcept
+                {
+                    auto min_size =
+                        header_size() + 2u * debug_fence_size + max_alignment + capacity;
+                    for (auto link = &reclaimed_; link->memory; link = &next_reclaimed(*link))
+                        if (link->size >= min_size)
+                        {
+                            auto block = *link;
+                            *link      = next_reclaimed(block);
+                            use_block(block);
+                            return true;
+                        }
+                    return false;
+                }
+
+                void insert(FreeList& pool, void* mem, std::size_t size) noexcept
+                {
+                    auto capacity = pool.capacity();
+                    pool.insert(mem, size);
+                    inserted_nodes(block_) += pool.capacity() - capacity;
+                }
+
+                // puts the remaining memory of the stack onto the free lists before it is abandoned
+                // as many nodes as possible go to pool,
+                // the rest is donated to the pools of smaller nodes instead of being lost
+                void insert_rest(FreeList* pools, FreeList& pool) noexcept
+                {
+                    for (auto i = std::size_t(&pool - pools) + 1u; i-- != 0u;)
+                    {
+                        auto remaining = capacity_left();
+                        auto offset    = align_offset(stack_.top(), max_alignment);
+                        if (offset >= remaining)
+                            break;
+
+                        auto node_size = pools[i].node_size();
+                        auto available = remaining - offset;
+                        auto first     = FreeList::min_block_size(node_size, 1u);
+                        if (available < first)
+                            continue;
+
+                        // the size for additional nodes might grow with the number of nodes
+                        auto per_node = FreeList::min_block_size(node_size, 2u) - first;
+                        auto no_nodes = (available - first) / per_node + 1u;
+                        while (FreeList::min_block_size(node_size, no_nodes) > available)
+                            --no_nodes;
+
+                        auto size = FreeList::min_block_size(node_size, no_nodes);
+                        auto mem  = stack_.allocate(end(), size, max_alignment, 0u);
+                        FOONATHAN_MEMORY_ASSERT(mem);
+                        insert(pools[i], mem, size);
+                    }
+                }
+
+                memory_block       block_;     // the block stack_ carves from
+                memory_block       reclaimed_; // list of reclaimed blocks
+                fixed_memory_stack stack_;
+            };
+
+            template <class FreeList>
+            constexpr std::size_t free_list_stack<FreeList>::reclaimed_marker;
+        } // namespace detail
+    } // namespace memory
+} // namespace foonathan
+
+#endif // FOONATHAN_MEMORY_DETAIL_FREE_LIST_STACK_HPP_INCLUDED
@@ -61,6 +61,19 @@ namespace foonathan
                 // only subtract one if power of two
                 return ilog2_base(x) - std::size_t(is_power_of_two(x));
             }
+
+            // number of trailing zero bits, i.e. index of the lowest set bit
+            // undefined for 0
+            inline std::size_t count_trailing_zeros(std::uint64_t x)
+            {
+#if defined(__GNUC__)
+                unsigned long long value = x;
+                return static_cast<std::size_t>(__builtin_ctzll(value));
+#else
+                // isolate lowest bit
+                return ilog2(x & (~x + 1u));
+#endif
+            }
         } // namespace detail
     } // namespace memory
 } // namespace foonathan
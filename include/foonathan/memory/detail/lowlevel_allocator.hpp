@@ -31,6 +31,8 @@ namespace foonathan
             // static allocator_info info()
             // static void* allocate(std::size_t size, std::size_t alignment);
             // static void deallocate(void *memory, std::size_t size, std::size_t alignment);
+            // static void* reallocate(void* memory, std::size_t old_size, std::size_t new_size,
+            //                         std::size_t alignment); // nullptr on failure
             // static std::size_t max_node_size();
             template <class Functor>
             class lowlevel_allocator : global_leak_checker<lowlevel_allocator_leak_handler<Functor>>
@@ -70,6 +72,38 @@ namespace foonathan
                     this->on_deallocate(actual_size);
                 }
 
+                void* reallocate_array(void* array, std::size_t old_count, std::size_t new_count,
+                                       std::size_t size, std::size_t alignment)
+                {
+                    auto old_size   = old_count * size;
+                    auto new_size   = new_count * size;
+                    auto fence      = debug_fence_size ? max_alignment : 0u;
+                    auto old_actual = old_size + 2 * fence;
+                    auto new_actual = new_size + 2 * fence;
+
+                    // when shrinking, the back fence must be moved before the memory is cut off
+                    auto shrink = new_size < old_size;
+                    if (shrink)
+                        debug_resize_node(array, old_size, new_size, max_alignment);
+
+                    auto memory = Functor::reallocate(static_cast<char*>(array) - fence, old_actual,
+                                                      new_actual, alignment);
+                    if (!memory)
+                    {
+                        if (shrink)
+                            debug_resize_node(array, new_size, old_size, max_alignment);
+                        FOONATHAN_THROW(out_of_memory(Functor::info(), new_actual));
+                    }
+
+                    this->on_allocate(new_actual);
+                    this->on_deallocate(old_actual);
+
+                    auto result = static_cast<char*>(memory) + fence;
+                    if (!shrink)
+                        debug_resize_node(result, old_size, new_size, max_alignment);
+                    return result;
+                }
+
                 std::size_t max_node_size() const noexcept
                 {
                     return Functor::max_node_size();
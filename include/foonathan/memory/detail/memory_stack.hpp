@@ -94,6 +94,24 @@ namespace foonathan
                     return mem;
                 }
 
+                // changes the size of the topmost allocation by moving the top pointer,
+                // returns false if memory isn't the topmost allocation or there is not enough space
+                // debug: moves the fence behind the memory
+                bool resize(const char* end, void* memory, std::size_t old_size,
+                            std::size_t new_size,
+                            std::size_t fence_size = debug_fence_size) noexcept
+                {
+                    auto mem = static_cast<char*>(memory);
+                    if (cur_ == nullptr || mem + old_size + fence_size != cur_)
+                        return false;
+                    else if (new_size > old_size && new_size - old_size > std::size_t(end - cur_))
+                        return false;
+
+                    debug_resize_node(memory, old_size, new_size, fence_size);
+                    cur_ = mem + new_size + fence_size;
+                    return true;
+                }
+
                 // unwindws the stack to a certain older position
                 // debug: marks memory from new top to old top as freed
                 // doesn't check for invalid pointer
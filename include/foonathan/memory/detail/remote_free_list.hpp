@@ -0,0 +1,188 @@
+// Copyright (C) 2015-2025 Jonathan Müller and foonathan/memory contributors
+// SPDX-License-Identifier: Zlib
+
+#ifndef FOONATHAN_MEMORY_DETAIL_REMOTE_FREE_LIST_HPP_INCLUDED
+#define FOONATHAN_MEMORY_DETAIL_REMOTE_FREE_LIST_HPP_INCLUDED
+
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+
+#include "concurrent_free_list.hpp"
+#include "free_list.hpp"
+#include "utility.hpp"
+#include "../config.hpp"
+
+namespace foonathan
+{
+    namespace memory
+    {
+        namespace detail
+        {
+            // identifies the calling thread
+            // the address of a thread local object, so it is cheap to obtain
+            const void* this_thread_tag() noexcept;
+
+            // stores free blocks for a memory pool owned by one thread
+            // where other threads may deallocate nodes
+            // the owner uses an ordinary free list,
+            // deallocations from other threads are pushed onto a lock-free "remote" stack instead
+            // when the owner runs out of nodes, it takes the entire remote stack with a single exchange
+            // and puts the nodes onto its own list
+            // the owner is the thread that created the list until another thread claims it
+            class remote_free_memory_list
+            {
+            public:
+                // minimum element size
+                static constexpr auto min_element_size = node_free_memory_list::min_element_size;
+                // alignment
+                static constexpr auto min_element_alignment =
+                    node_free_memory_list::min_element_alignment;
+
+                // minimal size of the block that needs to be inserted
+                static constexpr std::size_t min_block_size(std::size_t node_size,
+                                                            std::size_t number_of_nodes)
+                {
+                    return node_free_memory_list::min_block_size(node_size, number_of_nodes);
+                }
+
+                //=== constructor ===//
+                remote_free_memory_list(std::size_t node_size) noexcept;
+
+                // calls other constructor plus insert
+                remote_free_memory_list(std::size_t node_size, void* mem,
+                                        std::size_t size) noexcept
+                : remote_free_memory_list(node_size)
+                {
+                    insert(mem, size);
+                }
+
+                // not thread-safe, the new list has the same owner
+                remote_free_memory_list(remote_free_memory_list&& other) noexcept;
+                ~remote_free_memory_list() noexcept = default;
+
+                remote_free_memory_list& operator=(remote_free_memory_list&& other) noexcept
+                {
+                    remote_free_memory_list tmp(detail::move(other));
+                    swap(*this, tmp);
+                    return *this;
+                }
+
+                friend void swap(remote_free_memory_list& a, remote_free_memory_list& b) noexcept;
+
+                //=== insert/allocation/deallocation ===//
+                // only the owner may insert and allocate
+
+                // inserts a new memory block, does not own memory!
+                // mem must be aligned for alignment()
+                // pre: size != 0
+                void insert(void* mem, std::size_t size) noexcept
+                {
+                    local_.insert(mem, size);
+                }
+
+                // returns the usable size
+                // i.e. how many memory will be actually inserted and usable on a call to insert()
+                std::size_t usable_size(std::size_t size) const noexcept
+                {
+                    return local_.usable_size(size);
+                }
+
+                // returns a single block from the list
+                // takes the nodes deallocated by other threads if the owner's list is empty
+                // pre: !empty()
+                void* allocate() noexcept;
+
+                // returns a memory block big enough for n bytes
+                // arrays are not supported, so only succeeds if n <= node_size()
+                void* allocate(std::size_t n) noexcept
+                {
+                    return n <= node_size() ? allocate() : nullptr;
+                }
+
+                // deallocates a single block
+                // can be called from any thread
+                void deallocate(void* ptr) noexcept;
+
+                // deallocates multiple blocks with n bytes total
+                // arrays are not supported, so n must be <= node_size()
+                void deallocate(void* ptr, std::size_t n) noexcept;
+
+                // removes up to n single blocks and writes them to out
+                // takes the nodes deallocated by other threads if there are not enough
+                // returns the number of blocks written, less than n if the list runs empty
+                std::size_t allocate_nodes(std::size_t n, void** out) noexcept;
+
+                // deallocates n single blocks
+                // can be called from any thread, other threads push them as one chain
+                void deallocate_nodes(void** ptrs, std::size_t n) noexcept;
+
+                // same as for the other free lists, must be called by the owner
+                std::size_t free_nodes_in(void* mem, std::size_t size) noexcept;
+                void        count_free_nodes(memory_block_tally& tally) noexcept;
+                void        remove_nodes_in(void* mem, std::size_t size) noexcept;
+
+                //=== getter ===//
+                std::size_t node_size() const noexcept
+                {
+                    return local_.node_size();
+                }
+
+                // alignment of all nodes
+                std::size_t alignment() const noexcept
+                {
+                    return local_.alignment();
+                }
+
+                // number of nodes remaining
+                // nodes deallocated by other threads are only counted once the owner has taken them
+                std::size_t capacity() const noexcept
+                {
+                    return local_.capacity();
+                }
+
+                bool empty() const noexcept
+                {
+                    return local_.empty() && remote_.load(std::memory_order_relaxed) == nullptr;
+                }
+
+                // whether or not the calling thread is the owner of the list
+                bool is_owner() const noexcept
+                {
+                    return owner_.load(std::memory_order_relaxed) == this_thread_tag();
+                }
+
+                // makes the calling thread the owner of the list
+                // other threads may deallocate meanwhile, as they see either owner
+                // pre: the previous owner no longer uses the list and its last use happens before
+                void claim_ownership() noexcept
+                {
+                    owner_.store(this_thread_tag(), std::memory_order_relaxed);
+                }
+
+            private:
+                // moves all nodes from the remote stack onto the owner's list
+                void drain() noexcept;
+
+                node_free_memory_list    local_;
+                std::atomic<char*>       remote_;
+                std::atomic<const void*> owner_;
+            };
+
+            void swap(remote_free_memory_list& a, remote_free_memory_list& b) noexcept;
+
+            // whether or not nodes of FreeList can be deallocated by multiple threads at once
+            template <class FreeList>
+            struct has_concurrent_deallocation : is_concurrent_free_list<FreeList>
+            {
+            };
+
+            template <>
+            struct has_concurrent_deallocation<remote_free_memory_list> : std::true_type
+            {
+            };
+        } // namespace detail
+    } // namespace memory
+} // namespace foonathan
+
+#endif // FOONATHAN_MEMORY_DETAIL_REMOTE_FREE_LIST_HPP_INCLUDED
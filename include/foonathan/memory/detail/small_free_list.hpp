@@ -5,7 +5,8 @@
 #define FOONATHAN_MEMORY_DETAIL_SMALL_FREE_LIST_HPP_INCLUDED
 
 #include <cstddef>
-#include <climits>
+#include <cstdint>
+#include <limits>
 
 #include "../config.hpp"
 #include "utility.hpp"
@@ -17,73 +18,118 @@ namespace foonathan
     {
         namespace detail
         {
+            class memory_block_tally;
+
+            // ChunkIndex is the unsigned integer type of the node indices inside a chunk
+            // it determines the maximum number of nodes in a chunk
+            template <typename ChunkIndex>
             struct chunk_base
             {
                 chunk_base* prev = this;
                 chunk_base* next = this;
 
-                unsigned char first_free = 0; // first free node for the linked list
-                unsigned char capacity   = 0; // total number of free nodes available
-                unsigned char no_nodes   = 0; // total number of nodes in memory
+                ChunkIndex first_free = 0; // first free node for the linked list
+                ChunkIndex capacity   = 0; // total number of free nodes available
+                ChunkIndex no_nodes   = 0; // total number of nodes in memory
 
                 chunk_base() noexcept = default;
 
-                chunk_base(unsigned char no) noexcept : capacity(no), no_nodes(no) {}
+                chunk_base(ChunkIndex no) noexcept : capacity(no), no_nodes(no) {}
+            };
+
+            template <typename ChunkIndex>
+            constexpr std::size_t chunk_memory_offset() noexcept
+            {
+                return sizeof(chunk_base<ChunkIndex>) % detail::max_alignment == 0 ?
+                           sizeof(chunk_base<ChunkIndex>) :
+                           (sizeof(chunk_base<ChunkIndex>) / detail::max_alignment + 1)
+                               * detail::max_alignment;
+            }
+
+            template <typename ChunkIndex>
+            constexpr std::size_t chunk_max_nodes() noexcept
+            {
+                return std::numeric_limits<ChunkIndex>::max();
+            }
+
+            // header at the beginning of every inserted memory block, followed by its chunks
+            // the headers form a treap ordered by address to look up the chunk of a node
+            struct chunk_region
+            {
+                chunk_region* left  = nullptr;
+                chunk_region* right = nullptr;
+                char*         end; // end of the nodes of the last chunk
+
+                chunk_region(char* e) noexcept : end(e) {}
             };
 
-            constexpr std::size_t chunk_memory_offset =
-                sizeof(chunk_base) % detail::max_alignment == 0 ?
-                    sizeof(chunk_base) :
-                    (sizeof(chunk_base) / detail::max_alignment + 1) * detail::max_alignment;
-            constexpr std::size_t chunk_max_nodes = UCHAR_MAX;
+            constexpr std::size_t chunk_region_offset =
+                sizeof(chunk_region) % detail::max_alignment == 0 ?
+                    sizeof(chunk_region) :
+                    (sizeof(chunk_region) / detail::max_alignment + 1) * detail::max_alignment;
 
+            template <typename ChunkIndex>
             struct chunk;
 
             // the same as free_memory_list but optimized for small node sizes
             // it is slower and does not support arrays
             // but has very small overhead
+            // the chunk of a deallocated node is found via the header of its memory block
+            // in logarithmic time in the number of inserted blocks
+            // a node needs to store a ChunkIndex while it is free,
+            // so wider indices allow bigger chunks but require bigger nodes
             // debug: allocate() and deallocate() mark memory as new and freed, respectively
             // node_size is increased via two times fence size and fence is put in front and after
-            class small_free_memory_list
+            template <typename ChunkIndex>
+            class basic_small_free_memory_list
             {
                 static constexpr std::size_t chunk_count(std::size_t number_of_nodes)
                 {
-                    return number_of_nodes / chunk_max_nodes
-                           + (number_of_nodes % chunk_max_nodes == 0 ? 0 : 1);
+                    return number_of_nodes / chunk_max_nodes<ChunkIndex>()
+                           + (number_of_nodes % chunk_max_nodes<ChunkIndex>() == 0 ? 0 : 1);
                 }
 
             public:
                 // minimum element size
-                static constexpr std::size_t min_element_size = 1;
+                static constexpr std::size_t min_element_size = sizeof(ChunkIndex);
                 // alignment
                 static constexpr std::size_t min_element_alignment = 1;
 
                 // minimal size of the block that needs to be inserted
+                // every chunk might need padding to keep the next chunk aligned
                 static constexpr std::size_t min_block_size(std::size_t node_size,
                                                             std::size_t number_of_nodes)
                 {
-                    return chunk_count(number_of_nodes)
-                           * (chunk_memory_offset + chunk_max_nodes * node_size);
+                    return chunk_region_offset
+                           + chunk_count(number_of_nodes)
+                                 * (chunk_memory_offset<ChunkIndex>()
+                                    + alignof(chunk_base<ChunkIndex>))
+                           + (node_size < min_element_size ? min_element_size : node_size)
+                                 * number_of_nodes;
                 }
 
                 //=== constructor ===//
-                small_free_memory_list(std::size_t node_size) noexcept;
+                basic_small_free_memory_list(std::size_t node_size) noexcept;
 
                 // does not own memory!
-                small_free_memory_list(std::size_t node_size, void* mem, std::size_t size) noexcept;
+                basic_small_free_memory_list(std::size_t node_size, void* mem,
+                                             std::size_t size) noexcept;
 
-                small_free_memory_list(small_free_memory_list&& other) noexcept;
+                basic_small_free_memory_list(basic_small_free_memory_list&& other) noexcept;
 
-                ~small_free_memory_list() noexcept = default;
+                ~basic_small_free_memory_list() noexcept = default;
 
-                small_free_memory_list& operator=(small_free_memory_list&& other) noexcept
+                basic_small_free_memory_list& operator=(
+                    basic_small_free_memory_list&& other) noexcept
                 {
-                    small_free_memory_list tmp(detail::move(other));
+                    basic_small_free_memory_list tmp(detail::move(other));
                     swap(*this, tmp);
                     return *this;
                 }
 
-                friend void swap(small_free_memory_list& a, small_free_memory_list& b) noexcept;
+                template <typename T>
+                friend void swap(basic_small_free_memory_list<T>& a,
+                                 basic_small_free_memory_list<T>& b) noexcept;
 
                 //=== insert/alloc/dealloc ===//
                 // inserts new memory of given size into the free list
@@ -113,6 +159,23 @@ namespace foonathan
                     insert(mem, size);
                 }
 
+                // allocates up to n nodes and writes them to out
+                // returns the number of nodes written, less than n if the list runs empty
+                std::size_t allocate_nodes(std::size_t n, void** out) noexcept;
+
+                // deallocates n nodes previously allocated via allocate()
+                void deallocate_nodes(void** ptrs, std::size_t n) noexcept;
+
+                // number of free nodes in the chunks inside [mem, mem + size)
+                std::size_t free_nodes_in(void* mem, std::size_t size) noexcept;
+
+                // adds the free nodes to the tally of the blocks containing them
+                void count_free_nodes(memory_block_tally& tally) noexcept;
+
+                // removes all chunks inside [mem, mem + size)
+                // pre: all of their nodes are free
+                void remove_nodes_in(void* mem, std::size_t size) noexcept;
+
                 // hint for allocate() to be prepared to allocate n nodes
                 // it searches for a chunk that has n nodes free
                 // returns false, if there is none like that
@@ -144,18 +207,34 @@ namespace foonathan
                 }
 
             private:
-                chunk* find_chunk_impl(std::size_t n = 1) noexcept;
-                chunk* find_chunk_impl(unsigned char* node, chunk_base* first,
-                                       chunk_base* last) noexcept;
-                chunk* find_chunk_impl(unsigned char* node) noexcept;
-
-                chunk_base  base_;
-                std::size_t node_size_, capacity_;
-                chunk_base *alloc_chunk_, *dealloc_chunk_;
+                using chunk_type      = chunk<ChunkIndex>;
+                using chunk_base_type = chunk_base<ChunkIndex>;
+
+                chunk_type* find_chunk_impl(std::size_t n = 1) noexcept;
+                chunk_type* find_chunk_impl(unsigned char* node) noexcept;
+
+                // distance between two chunks of a block
+                std::size_t chunk_stride() const noexcept;
+
+                chunk_base_type  base_;
+                chunk_region*    regions_;
+                std::size_t      node_size_, capacity_;
+                chunk_base_type *alloc_chunk_, *dealloc_chunk_;
             };
 
-            // for some reason, this is required in order to define it
-            void swap(small_free_memory_list& a, small_free_memory_list& b) noexcept;
+            template <typename ChunkIndex>
+            void swap(basic_small_free_memory_list<ChunkIndex>& a,
+                      basic_small_free_memory_list<ChunkIndex>& b) noexcept;
+
+            // chunks of at most 255 nodes, there is no minimum node size
+            using small_free_memory_list = basic_small_free_memory_list<unsigned char>;
+
+            // chunks of up to 65535 nodes, so a chunk can span multiple pages of tiny nodes
+            // nodes must be at least two bytes
+            using wide_small_free_memory_list = basic_small_free_memory_list<std::uint16_t>;
+
+            extern template class basic_small_free_memory_list<unsigned char>;
+            extern template class basic_small_free_memory_list<std::uint16_t>;
         } // namespace detail
     } // namespace memory
 } // namespace foonathan
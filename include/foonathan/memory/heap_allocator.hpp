@@ -58,6 +58,9 @@ namespace foonathan
                     heap_dealloc(ptr, size);
                 }
 
+                static void* reallocate(void* ptr, std::size_t old_size, std::size_t new_size,
+                                        std::size_t) noexcept;
+
                 static std::size_t max_node_size() noexcept;
             };
 
@@ -221,6 +221,13 @@ namespace foonathan
                 return allocate_node(state, count * size, alignment);
             }
 
+            /// \effects Calls \ref iteration_allocator::allocate() for each node.
+            static void allocate_nodes(allocator_type& state, std::size_t count, std::size_t size,
+                                       std::size_t alignment, void** nodes)
+            {
+                detail::allocate_nodes_each<allocator_traits>(state, count, size, alignment, nodes);
+            }
+
             /// @{
             /// \effects Does nothing.
             /// Actual deallocation can only be done via \ref memory_stack::unwind().
@@ -232,6 +239,11 @@ namespace foonathan
                                          std::size_t) noexcept
             {
             }
+
+            static void deallocate_nodes(allocator_type&, void**, std::size_t, std::size_t,
+                                         std::size_t) noexcept
+            {
+            }
             /// @}
 
             /// @{
@@ -253,6 +265,40 @@ namespace foonathan
             {
                 return std::size_t(-1);
             }
+
+            /// @{
+            /// \returns `false`, the allocations cannot be resized in place.
+            static bool try_expand_node(allocator_type&, void*, std::size_t, std::size_t,
+                                        std::size_t) noexcept
+            {
+                return false;
+            }
+
+            static bool try_shrink_node(allocator_type&, void*, std::size_t, std::size_t,
+                                        std::size_t) noexcept
+            {
+                return false;
+            }
+            /// @}
+
+            /// \effects Allocates a new array, copies and deallocates the old one.
+            /// \returns The reallocated array.
+            static void* reallocate_array(allocator_type& state, void* array, std::size_t old_count,
+                                          std::size_t new_count, std::size_t size,
+                                          std::size_t alignment)
+            {
+                return detail::reallocate_array_copy<allocator_traits>(state, array, old_count,
+                                                                       new_count, size, alignment);
+            }
+
+            /// \effects Same as \ref allocate_array(), the array cannot be expanded in place.
+            /// \returns The array together with its requested size.
+            static memory_block allocate_at_least(allocator_type& state, std::size_t count,
+                                                  std::size_t size, std::size_t alignment)
+            {
+                return detail::allocate_array_at_least<allocator_traits>(state, count, size,
+                                                                         alignment);
+            }
         };
 
         /// Specialization of the \ref composable_allocator_traits for \ref iteration_allocator classes.
@@ -277,6 +323,17 @@ namespace foonathan
                 return state.try_allocate(count * size, alignment);
             }
 
+            /// \effects Calls \ref iteration_allocator::try_allocate() for each node.
+            /// \returns Whether all nodes could be allocated.
+            static bool try_allocate_nodes(allocator_type& state, std::size_t count,
+                                           std::size_t size, std::size_t alignment,
+                                           void** nodes) noexcept
+            {
+                return detail::try_allocate_nodes_each<composable_allocator_traits>(state, count,
+                                                                                    size, alignment,
+                                                                                    nodes);
+            }
+
             /// @{
             /// \effects Does nothing.
             /// \returns Whether the memory will be deallocated by \ref memory_stack::unwind().
@@ -291,7 +348,39 @@ namespace foonathan
             {
                 return try_deallocate_node(state, ptr, count * size, alignment);
             }
+
+            static bool try_deallocate_nodes(allocator_type& state, void** nodes, std::size_t count,
+                                             std::size_t, std::size_t) noexcept
+            {
+                return count == 0u || state.block_.contains(nodes[0]);
+            }
             /// @}
+
+            /// @{
+            /// \returns `false`, the allocations cannot be resized in place.
+            static bool try_expand_node(allocator_type&, void*, std::size_t, std::size_t,
+                                        std::size_t) noexcept
+            {
+                return false;
+            }
+
+            static bool try_shrink_node(allocator_type&, void*, std::size_t, std::size_t,
+                                        std::size_t) noexcept
+            {
+                return false;
+            }
+            /// @}
+
+            /// \effects Allocates a new array, copies and deallocates the old one.
+            /// \returns The reallocated array or `nullptr` if it was not allocated by the allocator
+            /// or there was not enough memory.
+            static void* try_reallocate_array(allocator_type& state, void* array,
+                                              std::size_t old_count, std::size_t new_count,
+                                              std::size_t size, std::size_t alignment) noexcept
+            {
+                return detail::try_reallocate_array_copy<composable_allocator_traits>(
+                    state, array, old_count, new_count, size, alignment);
+            }
         };
 
 #if FOONATHAN_MEMORY_EXTERN_TEMPLATE
@@ -44,6 +44,12 @@ namespace foonathan
                     std::free(ptr);
                 }
 
+                static void* reallocate(void* ptr, std::size_t, std::size_t new_size,
+                                        std::size_t) noexcept
+                {
+                    return std::realloc(ptr, new_size);
+                }
+
                 static std::size_t max_node_size() noexcept
                 {
                     return std::allocator_traits<std::allocator<char>>::max_size({});
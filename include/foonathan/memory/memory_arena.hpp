@@ -21,36 +21,6 @@ namespace foonathan
 {
     namespace memory
     {
-        /// A memory block.
-        /// It is defined by its starting address and size.
-        /// \ingroup core
-        struct memory_block
-        {
-            void*       memory; ///< The address of the memory block (might be \c nullptr).
-            std::size_t size;   ///< The size of the memory block (might be \c 0).
-
-            /// \effects Creates an invalid memory block with starting address \c nullptr and size \c 0.
-            memory_block() noexcept : memory_block(nullptr, std::size_t(0)) {}
-
-            /// \effects Creates a memory block from a given starting address and size.
-            memory_block(void* mem, std::size_t s) noexcept : memory(mem), size(s) {}
-
-            /// \effects Creates a memory block from a [begin,end) range.
-            memory_block(void* begin, void* end) noexcept
-            : memory_block(begin, static_cast<std::size_t>(static_cast<char*>(end)
-                                                           - static_cast<char*>(begin)))
-            {
-            }
-
-            /// \returns Whether or not a pointer is inside the memory.
-            bool contains(const void* address) const noexcept
-            {
-                auto mem  = static_cast<const char*>(memory);
-                auto addr = static_cast<const char*>(address);
-                return addr >= mem && addr < mem + size;
-            }
-        };
-
         namespace detail
         {
             template <class BlockAllocator>
@@ -90,19 +60,54 @@ namespace foonathan
         constexpr bool uncached_arena = false;
         /// @}
 
+        /// The limits for the cache of a \ref memory_arena.
+        /// Cached blocks exceeding them are scavenged:
+        /// they stay in the cache, so their address range is kept for later reuse,
+        /// but their physical memory is returned to the system using \ref virtual_memory_purge.
+        /// The most recently cached blocks are the last ones to be scavenged.
+        /// \ingroup core
+        struct memory_arena_cache_limits
+        {
+            /// The maximum number of bytes in cached blocks that keep their physical memory.
+            std::size_t max_bytes;
+            /// The maximum number of cached blocks that keep their physical memory.
+            std::size_t max_blocks;
+            /// The time in milliseconds after which all cached blocks are scavenged if the cache was not used,
+            /// it is checked the next time a block is put into the cache.
+            std::size_t max_idle_ms;
+
+            /// \effects Creates limits that never scavenge any blocks,
+            /// this is the default for a \ref memory_arena.
+            memory_arena_cache_limits() noexcept
+            : memory_arena_cache_limits(std::size_t(-1), std::size_t(-1))
+            {
+            }
+
+            /// \effects Creates limits with the given maximum number of bytes, blocks and idle time.
+            memory_arena_cache_limits(std::size_t bytes, std::size_t blocks,
+                                      std::size_t idle_ms = std::size_t(-1)) noexcept
+            : max_bytes(bytes), max_blocks(blocks), max_idle_ms(idle_ms)
+            {
+            }
+        };
+
         namespace detail
         {
-            // stores memory block in an intrusive linked list and allows LIFO access
+            // stores memory block in an intrusive doubly linked list and allows LIFO access,
+            // as well as removing any block in constant time
+            // the blocks are also kept in an address ordered treap, so owns() is logarithmic
             class memory_block_stack
             {
             public:
-                memory_block_stack() noexcept : head_(nullptr) {}
+                memory_block_stack() noexcept : head_(nullptr), root_(nullptr), size_(0u) {}
 
                 ~memory_block_stack() noexcept {}
 
-                memory_block_stack(memory_block_stack&& other) noexcept : head_(other.head_)
+                memory_block_stack(memory_block_stack&& other) noexcept
+                : head_(other.head_), root_(other.root_), size_(other.size_)
                 {
-                    other.head_ = nullptr;
+                    other.head_ = other.root_ = nullptr;
+                    other.size_               = 0u;
                 }
 
                 memory_block_stack& operator=(memory_block_stack&& other) noexcept
@@ -115,6 +120,8 @@ namespace foonathan
                 friend void swap(memory_block_stack& a, memory_block_stack& b) noexcept
                 {
                     detail::adl_swap(a.head_, b.head_);
+                    detail::adl_swap(a.root_, b.root_);
+                    detail::adl_swap(a.size_, b.size_);
                 }
 
                 // the raw allocated block returned from an allocator
@@ -140,6 +147,24 @@ namespace foonathan
                 // steals the top block from another stack
                 void steal_top(memory_block_stack& other) noexcept;
 
+                // removes an inserted block from anywhere in the stack and returns the original block
+                allocated_mb erase(inserted_mb block) noexcept;
+
+                // calls f(block) for each inserted block, starting at the top
+                // f may erase the block it is called with
+                template <typename Func>
+                void for_each(Func f) const
+                {
+                    for (auto cur = head_; cur;)
+                    {
+                        auto prev = cur->prev;
+                        auto mem  = static_cast<void*>(cur);
+                        f(inserted_mb{static_cast<char*>(mem) + implementation_offset(),
+                                      cur->usable_size});
+                        cur = prev;
+                    }
+                }
+
                 // returns the last pushed() inserted memory block
                 inserted_mb top() const noexcept
                 {
@@ -153,30 +178,129 @@ namespace foonathan
                     return head_ == nullptr;
                 }
 
+                // O(log n) lookup in the treap
                 bool owns(const void* ptr) const noexcept;
 
-                // O(n) size
-                std::size_t size() const noexcept;
+                // sets the tally of every block to zero
+                void reset_tally() noexcept;
+
+                // adds n to the tally of the block containing ptr, O(log n) lookup in the treap
+                void add_tally(const void* ptr, std::size_t n) noexcept;
+
+                // returns the tally of an inserted block
+                static std::size_t tally(inserted_mb block) noexcept
+                {
+                    return to_node(block)->tally;
+                }
+
+                std::size_t size() const noexcept
+                {
+                    return size_;
+                }
 
             private:
                 struct node
                 {
-                    node*       prev;
+                    node *      prev, *next; // next is the block pushed after it
                     std::size_t usable_size;
-
-                    node(node* p, std::size_t size) noexcept : prev(p), usable_size(size) {}
+                    node *      left, *right; // children in the treap
+                    std::size_t tally;        // counted by memory_block_tally
+
+                    explicit node(std::size_t size) noexcept
+                    : prev(nullptr),
+                      next(nullptr),
+                      usable_size(size),
+                      left(nullptr),
+                      right(nullptr),
+                      tally(0u)
+                    {
+                    }
                 };
 
-                node* head_;
+                static node* to_node(inserted_mb block) noexcept
+                {
+                    return static_cast<node*>(static_cast<void*>(
+                        static_cast<char*>(block.memory) - implementation_offset()));
+                }
+
+                // inserts a node into the treap and the top of the list
+                void insert(node* n) noexcept;
+
+                // removes a node from the treap and the list
+                void remove(node* n) noexcept;
+
+                // returns the block containing ptr or nullptr
+                node* find(const void* ptr) const noexcept;
+
+                node*       head_;
+                node*       root_;
+                std::size_t size_;
+            };
+
+            // adds up a number for each block of a memory_block_stack,
+            // e.g. the free nodes of a free list with a single pass over it
+            class memory_block_tally
+            {
+            public:
+                explicit memory_block_tally(memory_block_stack& blocks) noexcept : blocks_(&blocks)
+                {
+                    blocks.reset_tally();
+                }
+
+                // adds n to the block containing ptr
+                void add(const void* ptr, std::size_t n) noexcept
+                {
+                    blocks_->add_tally(ptr, n);
+                }
+
+            private:
+                memory_block_stack* blocks_;
             };
 
             template <bool Cached>
             class memory_arena_cache;
 
+            // the cached blocks that keep their physical memory are always on top of the cache,
+            // the scavenged blocks below them
             template <>
             class memory_arena_cache<cached_arena>
             {
             protected:
+                memory_arena_cache() noexcept
+                : no_resident_(0u), no_scavenged_(0u), resident_bytes_(0u), last_use_(0u)
+                {
+                }
+
+                memory_arena_cache(memory_arena_cache&& other) noexcept
+                : cached_(detail::move(other.cached_)),
+                  limits_(other.limits_),
+                  no_resident_(other.no_resident_),
+                  no_scavenged_(other.no_scavenged_),
+                  resident_bytes_(other.resident_bytes_),
+                  last_use_(other.last_use_)
+                {
+                    other.no_resident_ = other.no_scavenged_ = other.resident_bytes_ = 0u;
+                }
+
+                ~memory_arena_cache() noexcept = default;
+
+                memory_arena_cache& operator=(memory_arena_cache&& other) noexcept
+                {
+                    memory_arena_cache tmp(detail::move(other));
+                    swap(*this, tmp);
+                    return *this;
+                }
+
+                friend void swap(memory_arena_cache& a, memory_arena_cache& b) noexcept
+                {
+                    detail::adl_swap(a.cached_, b.cached_);
+                    detail::adl_swap(a.limits_, b.limits_);
+                    detail::adl_swap(a.no_resident_, b.no_resident_);
+                    detail::adl_swap(a.no_scavenged_, b.no_scavenged_);
+                    detail::adl_swap(a.resident_bytes_, b.resident_bytes_);
+                    detail::adl_swap(a.last_use_, b.last_use_);
+                }
+
                 bool cache_empty() const noexcept
                 {
                     return cached_.empty();
@@ -184,7 +308,7 @@ namespace foonathan
 
                 std::size_t cache_size() const noexcept
                 {
-                    return cached_.size();
+                    return no_resident_ + no_scavenged_;
                 }
 
                 std::size_t cached_block_size() const noexcept
@@ -197,6 +321,7 @@ namespace foonathan
                     if (cached_.empty())
                         return false;
                     used.steal_top(cached_);
+                    on_take(used.top().size);
                     return true;
                 }
 
@@ -204,6 +329,15 @@ namespace foonathan
                 void do_deallocate_block(BlockAllocator&, detail::memory_block_stack& used) noexcept
                 {
                     cached_.steal_top(used);
+                    on_cache();
+                }
+
+                template <class BlockAllocator>
+                void do_deallocate_block(BlockAllocator&, detail::memory_block_stack& used,
+                                         memory_block block) noexcept
+                {
+                    cached_.push(used.erase(block));
+                    on_cache();
                 }
 
                 template <class BlockAllocator>
@@ -217,10 +351,43 @@ namespace foonathan
                     // now dealloc everything
                     while (!to_dealloc.empty())
                         alloc.deallocate_block(to_dealloc.pop());
+
+                    no_resident_ = no_scavenged_ = resident_bytes_ = 0u;
+                }
+
+                std::size_t do_scavenge() noexcept
+                {
+                    return scavenge_resident(0u, 0u);
+                }
+
+                const memory_arena_cache_limits& get_cache_limits() const noexcept
+                {
+                    return limits_;
+                }
+
+                void set_cache_limits(const memory_arena_cache_limits& limits) noexcept;
+
+                std::size_t resident_cache_size() const noexcept
+                {
+                    return no_resident_;
                 }
 
             private:
+                // updates the bookkeeping after the top block was taken
+                void on_take(std::size_t size) noexcept;
+
+                // updates the bookkeeping after a block was put on top and scavenges if necessary
+                void on_cache() noexcept;
+
+                // scavenges all resident blocks except for the top ones within the limits
+                // returns the number of bytes returned to the system
+                std::size_t scavenge_resident(std::size_t max_blocks,
+                                              std::size_t max_bytes) noexcept;
+
                 detail::memory_block_stack cached_;
+                memory_arena_cache_limits  limits_;
+                std::size_t                no_resident_, no_scavenged_, resident_bytes_;
+                std::size_t                last_use_; // in milliseconds, only if max_idle_ms is set
             };
 
             template <>
@@ -254,10 +421,34 @@ namespace foonathan
                     alloc.deallocate_block(used.pop());
                 }
 
+                template <class BlockAllocator>
+                void do_deallocate_block(BlockAllocator& alloc, detail::memory_block_stack& used,
+                                         memory_block block) noexcept
+                {
+                    alloc.deallocate_block(used.erase(block));
+                }
+
                 template <class BlockAllocator>
                 void do_shrink_to_fit(BlockAllocator&) noexcept
                 {
                 }
+
+                std::size_t do_scavenge() noexcept
+                {
+                    return 0u;
+                }
+
+                memory_arena_cache_limits get_cache_limits() const noexcept
+                {
+                    return {};
+                }
+
+                void set_cache_limits(const memory_arena_cache_limits&) noexcept {}
+
+                std::size_t resident_cache_size() const noexcept
+                {
+                    return 0u;
+                }
             };
         } // namespace detail
 
@@ -375,6 +566,74 @@ namespace foonathan
                 this->do_deallocate_block(get_allocator(), used_);
             }
 
+            /// \effects Deallocates the given memory block, which need not be the current one.
+            /// Like \ref deallocate_block() it puts the block onto the cache if caching is enabled.
+            /// \requires \c block must have been returned by \ref allocate_block() and not been deallocated yet.
+            /// If caching is disabled, the \concept{concept_blockallocator,BlockAllocator} must support deallocation in any order.
+            /// \note The blocks are kept in a doubly linked list, so this is constant time.
+            void deallocate_block(memory_block block) noexcept
+            {
+                FOONATHAN_MEMORY_ASSERT(used_.owns(block.memory));
+                detail::debug_fill_internal(block.memory, block.size, true);
+                this->do_deallocate_block(get_allocator(), used_, block);
+            }
+
+            /// \effects Calls `pred(block)` for every memory block currently in use, starting with the current one,
+            /// and deallocates each block for which it returns `true` as if by \ref deallocate_block(memory_block).
+            /// \returns The number of deallocated blocks.
+            /// \requires Same as for \ref deallocate_block(memory_block),
+            /// the predicate must not allocate or deallocate blocks itself.
+            template <typename UnaryPredicate>
+            std::size_t deallocate_blocks_if(UnaryPredicate pred) noexcept
+            {
+                std::size_t count = 0u;
+                used_.for_each(
+                    [&](memory_block block)
+                    {
+                        if (pred(block))
+                        {
+                            deallocate_block(block);
+                            ++count;
+                        }
+                    });
+                return count;
+            }
+
+            /// \effects Like \ref deallocate_blocks_if(), but calls `pred(block, n)` with a number `n` for each block.
+            /// It first calls `count(tally)` once, where `tally.add(ptr, n)` adds `n` to the number of the block containing `ptr`,
+            /// so a statistic of all blocks is computed with a single pass over some other data structure.
+            /// Each call to `add()` is logarithmic in the number of blocks.
+            /// \returns The number of deallocated blocks.
+            /// \requires Same as for \ref deallocate_blocks_if(),
+            /// every pointer passed to `add()` must be in memory owned by the arena.
+            template <typename Count, typename BinaryPredicate>
+            std::size_t deallocate_blocks_if(Count count, BinaryPredicate pred) noexcept
+            {
+                detail::memory_block_tally tally(used_);
+                count(tally);
+                return deallocate_blocks_if([&](memory_block block)
+                                            { return pred(block, used_.tally(block)); });
+            }
+
+            /// \effects Calls `f(block)` for every memory block currently in use, starting with the current one.
+            /// \requires The function must not allocate or deallocate blocks itself.
+            template <typename Func>
+            void for_each(Func f) const
+            {
+                used_.for_each([&](memory_block block) { f(block); });
+            }
+
+            /// \effects Like \ref for_each(), but calls `f(block, n)` with a number `n` for each block,
+            /// computed by `count(tally)` as described for \ref deallocate_blocks_if().
+            /// \requires Same as for \ref deallocate_blocks_if().
+            template <typename Count, typename Func>
+            void for_each(Count count, Func f)
+            {
+                detail::memory_block_tally tally(used_);
+                count(tally);
+                used_.for_each([&](memory_block block) { f(block, used_.tally(block)); });
+            }
+
             /// \returns If `ptr` is in memory owned by the arena.
             bool owns(const void* ptr) const noexcept
             {
@@ -389,6 +648,33 @@ namespace foonathan
                 this->do_shrink_to_fit(get_allocator());
             }
 
+            /// \effects Returns the physical memory of all cached memory blocks to the system,
+            /// but keeps the blocks and thus their address ranges in the cache.
+            /// Unlike \ref shrink_to_fit() it does not deallocate them on the \concept{concept_blockallocator,BlockAllocator},
+            /// so a later \ref allocate_block() can reuse them without allocation.
+            /// The first page of each block holds the bookkeeping and is not returned.
+            /// Does nothing if caching is disabled.
+            /// \returns The number of bytes returned to the system.
+            std::size_t scavenge() noexcept
+            {
+                return this->do_scavenge();
+            }
+
+            /// \returns The limits for the cached memory blocks that keep their physical memory.
+            memory_arena_cache_limits cache_limits() const noexcept
+            {
+                return this->get_cache_limits();
+            }
+
+            /// \effects Sets the limits for the cached memory blocks that keep their physical memory,
+            /// the blocks exceeding them are scavenged immediately and whenever a block is put into the cache.
+            /// By default, there are no limits.
+            /// Does nothing if caching is disabled.
+            void set_cache_limits(const memory_arena_cache_limits& limits) noexcept
+            {
+                this->cache::set_cache_limits(limits);
+            }
+
             /// \returns The capacity of the arena, i.e. how many blocks are used and cached.
             std::size_t capacity() const noexcept
             {
@@ -401,6 +687,13 @@ namespace foonathan
                 return cache::cache_size();
             }
 
+            /// \returns The number of cached blocks that have not been scavenged,
+            /// i.e. that still keep their physical memory.
+            std::size_t resident_cache_size() const noexcept
+            {
+                return cache::resident_cache_size();
+            }
+
             /// \returns The size of the arena, i.e. how many blocks are in use.
             /// It is always smaller or equal to the \ref capacity().
             std::size_t size() const noexcept
@@ -436,6 +729,10 @@ namespace foonathan
         extern template class memory_arena<static_block_allocator, false>;
         extern template class memory_arena<virtual_block_allocator, true>;
         extern template class memory_arena<virtual_block_allocator, false>;
+        extern template class memory_arena<reusable_virtual_block_allocator, true>;
+        extern template class memory_arena<reusable_virtual_block_allocator, false>;
+        extern template class memory_arena<huge_page_block_allocator, true>;
+        extern template class memory_arena<huge_page_block_allocator, false>;
 #endif
 
         /// A \concept{concept_blockallocator,BlockAllocator} that uses a given \concept{concept_rawallocator,RawAllocator} for allocating the blocks.
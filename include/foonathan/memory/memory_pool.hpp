@@ -19,6 +19,7 @@
 #include "error.hpp"
 #include "memory_arena.hpp"
 #include "memory_pool_type.hpp"
+#include "threading.hpp"
 
 namespace foonathan
 {
@@ -30,6 +31,13 @@ namespace foonathan
             {
                 void operator()(std::ptrdiff_t amount);
             };
+
+            // pools shared between threads need an atomic leak counter
+            template <class FreeList>
+            using memory_pool_leak_checker = typename std::conditional<
+                has_concurrent_deallocation<FreeList>::value,
+                default_concurrent_leak_checker<memory_pool_leak_handler>,
+                default_leak_checker<memory_pool_leak_handler>>::type;
         } // namespace detail
 
         /// A stateful \concept{concept_rawallocator,RawAllocator} that manages \concept{concept_node,nodes} of fixed size.
@@ -37,18 +45,24 @@ namespace foonathan
         /// subdivides them in small nodes of given size and puts them onto a free list.
         /// Allocation and deallocation simply remove or add nodes from this list and are thus fast.
         /// The way the list is maintained can be controlled via the \c PoolType
-        /// which is either \ref node_pool, \ref array_pool or \ref small_node_pool.<br>
+        /// which is one of the tag types of memory_pool_type.hpp, e.g. \ref node_pool, \ref array_pool or \ref small_node_pool.<br>
         /// This kind of allocator is ideal for fixed size allocations and deallocations in any order,
         /// for example in a node based container like \c std::list.
         /// It is not so good for different allocation sizes and has some drawbacks for arrays
-        /// as described in \ref memory_pool_type.hpp.
+        /// as described in \ref memory_pool_type.hpp.<br>
+        /// With the \ref concurrent_node_pool, node allocation and deallocation can be done by multiple threads at once
+        /// without additional locking.
+        /// With the \ref remote_free_node_pool, only the thread that created the pool allocates,
+        /// but nodes can be deallocated by any thread without additional locking.
+        /// This also holds after moving the pool, another thread has to call \ref claim_ownership() to take it over.
         /// \ingroup allocator
         template <typename PoolType = node_pool, class BlockOrRawAllocator = default_allocator>
         class memory_pool
-        : FOONATHAN_EBO(detail::default_leak_checker<detail::memory_pool_leak_handler>)
+        : FOONATHAN_EBO(detail::memory_pool_leak_checker<typename PoolType::type>)
         {
-            using free_list    = typename PoolType::type;
-            using leak_checker = detail::default_leak_checker<detail::memory_pool_leak_handler>;
+            using free_list     = typename PoolType::type;
+            using leak_checker  = detail::memory_pool_leak_checker<free_list>;
+            using is_concurrent = detail::is_concurrent_free_list<free_list>;
 
         public:
             using allocator_type = make_block_allocator_t<BlockOrRawAllocator>;
@@ -113,13 +127,12 @@ namespace foonathan
             /// The new block size will be \ref next_capacity() big.
             /// \returns A node of size \ref node_size() suitable aligned,
             /// i.e. suitable for any type where <tt>sizeof(T) < node_size()</tt>.
-            /// \throws Anything thrown by the used \concept{concept_blockallocator,BlockAllocator}'s allocation function if a growth is needed.
+            /// \throws Anything thrown by the used \concept{concept_blockallocator,BlockAllocator}'s allocation function if a growth is needed,
+            /// or \ref out_of_memory if the \ref concurrent_node_pool cannot manage another block as its block table is full.
+            /// \note For the \ref concurrent_node_pool, this function can be called from multiple threads at once.
             void* allocate_node()
             {
-                if (free_list_.empty())
-                    allocate_block();
-                FOONATHAN_MEMORY_ASSERT(!free_list_.empty());
-                return free_list_.allocate();
+                return allocate_node(is_concurrent{});
             }
 
             /// \effects Allocates a single \concept{concept_node,node} similar to \ref allocate_node().
@@ -130,6 +143,48 @@ namespace foonathan
                 return free_list_.empty() ? nullptr : free_list_.allocate();
             }
 
+            /// \effects Allocates \c n \concept{concept_node,nodes} at once and writes them to \c nodes.
+            /// Instead of removing them one by one, the free list unlinks whole chains of nodes.
+            /// If the free list does not have enough nodes, new memory blocks will be allocated from the arena.
+            /// \throws Anything thrown by the used \concept{concept_blockallocator,BlockAllocator}'s allocation function if a growth is needed.
+            /// Then no nodes are allocated.
+            /// \requires \c nodes must point to storage for at least \c n pointers.
+            /// \note For the \ref concurrent_node_pool, this function can be called from multiple threads at once.
+            void allocate_nodes(std::size_t n, void** nodes)
+            {
+                auto count = free_list_.allocate_nodes(n, nodes);
+#if FOONATHAN_HAS_EXCEPTION_SUPPORT
+                try
+                {
+#endif
+                    while (count != n)
+                    {
+                        grow(is_concurrent{});
+                        count += free_list_.allocate_nodes(n - count, nodes + count);
+                    }
+#if FOONATHAN_HAS_EXCEPTION_SUPPORT
+                }
+                catch (...)
+                {
+                    free_list_.deallocate_nodes(nodes, count);
+                    throw;
+                }
+#endif
+            }
+
+            /// \effects Allocates \c n \concept{concept_node,nodes} similar to \ref allocate_nodes().
+            /// But if the free list does not have enough nodes, a new block will *not* be allocated.
+            /// \returns \c true if all nodes could be allocated, \c false otherwise.
+            /// Then no nodes are allocated.
+            bool try_allocate_nodes(std::size_t n, void** nodes) noexcept
+            {
+                auto count = free_list_.allocate_nodes(n, nodes);
+                if (count == n)
+                    return true;
+                free_list_.deallocate_nodes(nodes, count);
+                return false;
+            }
+
             /// \effects Allocates an \concept{concept_array,array} of nodes by searching for \c n continuous nodes on the list and removing them.
             /// Depending on the \c PoolType this can be a slow operation or not allowed at all.
             /// This can sometimes lead to a growth, even if technically there is enough continuous memory on the free list.
@@ -157,6 +212,7 @@ namespace foonathan
             /// \effects Deallocates a single \concept{concept_node,node} by putting it back onto the free list.
             /// \requires \c ptr must be a result from a previous call to \ref allocate_node() on the same free list,
             /// i.e. either this allocator object or a new object created by moving this to it.
+            /// \note For the \ref concurrent_node_pool and the \ref remote_free_node_pool, this function can be called from multiple threads at once.
             void deallocate_node(void* ptr) noexcept
             {
                 free_list_.deallocate(ptr);
@@ -168,12 +224,35 @@ namespace foonathan
             /// doesn't matter where it is coming from.
             bool try_deallocate_node(void* ptr) noexcept
             {
-                if (!arena_.owns(ptr))
+                if (!owns(ptr))
                     return false;
                 free_list_.deallocate(ptr);
                 return true;
             }
 
+            /// \effects Deallocates \c n \concept{concept_node,nodes} at once,
+            /// the free list links them and splices the entire chain in.
+            /// \requires Each node must be a result from a previous call to \ref allocate_node() or \ref allocate_nodes() on the same free list,
+            /// i.e. either this allocator object or a new object created by moving this to it.
+            /// \note For the \ref concurrent_node_pool and the \ref remote_free_node_pool, this function can be called from multiple threads at once.
+            void deallocate_nodes(void** nodes, std::size_t n) noexcept
+            {
+                free_list_.deallocate_nodes(nodes, n);
+            }
+
+            /// \effects Deallocates \c n \concept{concept_node,nodes} similar to \ref deallocate_nodes(),
+            /// but they do not need to be a result of a previous call to \ref allocate_nodes().
+            /// \returns `true` if the nodes could be deallocated, `false` otherwise.
+            /// \requires Either all or none of the nodes must have been allocated by this pool,
+            /// only the first one is checked.
+            bool try_deallocate_nodes(void** nodes, std::size_t n) noexcept
+            {
+                if (n != 0u && !owns(nodes[0]))
+                    return false;
+                free_list_.deallocate_nodes(nodes, n);
+                return true;
+            }
+
             /// \effects Deallocates an \concept{concept_array,array} by putting it back onto the free list.
             /// \requires \c ptr must be a result from a previous call to \ref allocate_array() with the same \c n on the same free list,
             /// i.e. either this allocator object or a new object created by moving this to it.
@@ -210,6 +289,7 @@ namespace foonathan
             /// \returns The size of the next memory block after the free list gets empty and the arena grows.
             /// \ref capacity_left() will increase by this amount.
             /// \note Due to fence memory in debug mode this cannot be just divided by the \ref node_size() to get the number of nodes.
+            /// \note For the \ref concurrent_node_pool, this function must not be called while another thread might grow the pool.
             std::size_t next_capacity() const noexcept
             {
                 return free_list_.usable_size(arena_.next_block_size());
@@ -223,9 +303,41 @@ namespace foonathan
             }
 
             /// \returns If `ptr` is in memory owned by the underlying arena.
+            /// \note For the \ref concurrent_node_pool, the free list answers it from its own table of the inserted memory,
+            /// so this function can be called while other threads grow the pool.
+            /// The same holds for the \c try_deallocate_XXX() functions.
             bool owns(const void* ptr) const noexcept
             {
-                return arena_.owns(ptr);
+                return owns(is_concurrent{}, ptr);
+            }
+
+            /// \effects Gives every memory block whose \concept{concept_node,nodes} are all on the free list back to the arena,
+            /// which passes it on to the \concept{concept_blockallocator,BlockAllocator}.
+            /// The nodes of the block are removed from the free list.
+            /// This allows long running programs to return memory after a spike in allocations.
+            /// The occupancy of the blocks is computed by counting the free nodes only when this function is called,
+            /// so there is no overhead on allocation or deallocation.
+            /// It takes a single pass over the free list with a logarithmic lookup of the block of each free node.
+            /// \returns The number of blocks that have been released.
+            /// \requires The \concept{concept_blockallocator,BlockAllocator} must support deallocation in any order.
+            /// \note This does nothing for the \ref concurrent_node_pool,
+            /// as nodes cannot be removed from its list while other threads might access it.
+            std::size_t release_empty_blocks() noexcept
+            {
+                return release_empty_blocks(is_concurrent{});
+            }
+
+            /// \effects Makes the calling thread the owner of a pool using the \ref remote_free_node_pool,
+            /// i.e. the only thread allowed to allocate from it.
+            /// This hands a pool over to another thread, e.g. after it has been moved into an object of that thread.
+            /// Other threads may keep on deallocating nodes meanwhile.
+            /// \requires The previous owner must not use the pool anymore
+            /// and its last use must happen before the call, e.g. by passing the pool through a synchronized queue.
+            /// \note This function is only available for the \ref remote_free_node_pool.
+            template <typename Dummy = void>
+            void claim_ownership() noexcept
+            {
+                free_list_.claim_ownership();
             }
 
         private:
@@ -240,7 +352,101 @@ namespace foonathan
                 free_list_.insert(static_cast<char*>(mem.memory), mem.size);
             }
 
+            // member template, so it is not instantiated for the concurrent free list
+            template <typename Dummy = void>
+            std::size_t release_empty_blocks(std::false_type) noexcept
+            {
+                return arena_.deallocate_blocks_if(
+                    [&](detail::memory_block_tally& tally) { free_list_.count_free_nodes(tally); },
+                    [&](memory_block block, std::size_t free_nodes)
+                    {
+                        if (free_nodes != free_list_.usable_size(block.size) / node_size())
+                            return false;
+                        free_list_.remove_nodes_in(block.memory, block.size);
+                        return true;
+                    });
+            }
+
+            std::size_t release_empty_blocks(std::true_type) noexcept
+            {
+                return 0u;
+            }
+
+            bool owns(std::false_type, const void* ptr) const noexcept
+            {
+                return arena_.owns(ptr);
+            }
+
+            // the arena might be modified by a growing thread
+            // member template, so it is only instantiated for the concurrent free list
+            template <typename Dummy = void>
+            bool owns(std::true_type, const void* ptr) const noexcept
+            {
+                return free_list_.owns(ptr);
+            }
+
+            void grow(std::false_type)
+            {
+                allocate_block();
+            }
+
+            // member template, so it is only instantiated for the concurrent free list
+            template <typename Dummy = void>
+            void grow(std::true_type)
+            {
+                if (free_list_.try_begin_growth())
+                {
+                    // only this thread accesses the arena now
+                    struct growth_guard
+                    {
+                        free_list& list;
+
+                        ~growth_guard() noexcept
+                        {
+                            list.end_growth();
+                        }
+                    } guard{free_list_};
+
+                    // another thread might have grown already
+                    if (free_list_.empty())
+                    {
+                        // check before the block is allocated, so no memory is lost
+                        auto size = arena_.next_block_size();
+                        if (!free_list_.can_insert(size))
+                            FOONATHAN_THROW(out_of_memory(info(), size));
+                        allocate_block();
+                    }
+                }
+                else
+                    free_list_.wait_for_growth();
+            }
+
+            void* allocate_node(std::false_type)
+            {
+                if (free_list_.empty())
+                    allocate_block();
+                FOONATHAN_MEMORY_ASSERT(!free_list_.empty());
+                return free_list_.allocate();
+            }
+
+            template <typename Dummy = void>
+            void* allocate_node(std::true_type)
+            {
+                auto mem = free_list_.allocate();
+                while (!mem)
+                {
+                    grow(std::true_type{});
+                    mem = free_list_.allocate();
+                }
+                return mem;
+            }
+
             void* allocate_array(std::size_t n, std::size_t node_size)
+            {
+                return allocate_array(is_concurrent{}, n, node_size);
+            }
+
+            void* allocate_array(std::false_type, std::size_t n, std::size_t node_size)
             {
                 auto mem = free_list_.empty() ? nullptr : free_list_.allocate(n * node_size);
                 if (!mem)
@@ -253,6 +459,16 @@ namespace foonathan
                 return mem;
             }
 
+            // member template, so it is only instantiated for the concurrent free list
+            // it only hands out single nodes, so growth is serialized like for allocate_node()
+            template <typename Dummy = void>
+            void* allocate_array(std::true_type, std::size_t n, std::size_t node_size)
+            {
+                if (n * node_size > this->node_size())
+                    FOONATHAN_THROW(bad_array_size(info(), n * node_size, this->node_size()));
+                return allocate_node(std::true_type{});
+            }
+
             void* try_allocate_array(std::size_t n, std::size_t node_size) noexcept
             {
                 return !pool_type::value || free_list_.empty() ? nullptr :
@@ -261,7 +477,7 @@ namespace foonathan
 
             bool try_deallocate_array(void* ptr, std::size_t n, std::size_t node_size) noexcept
             {
-                if (!pool_type::value || !arena_.owns(ptr))
+                if (!pool_type::value || !owns(ptr))
                     return false;
                 free_list_.deallocate(ptr, n * node_size);
                 return true;
@@ -278,8 +494,22 @@ namespace foonathan
         extern template class memory_pool<node_pool>;
         extern template class memory_pool<array_pool>;
         extern template class memory_pool<small_node_pool>;
+        extern template class memory_pool<wide_small_node_pool>;
+        extern template class memory_pool<concurrent_node_pool>;
+        extern template class memory_pool<remote_free_node_pool>;
+        extern template class memory_pool<bitmap_node_pool>;
 #endif
 
+        /// Specialization of \ref is_thread_safe_allocator to mark \ref memory_pool with the \ref concurrent_node_pool as thread safe.
+        /// This is an optimization to get rid of the mutex in \ref allocator_storage.
+        /// \note Only the allocation and deallocation functions are thread safe.
+        /// \ingroup allocator
+        template <class BlockOrRawAllocator>
+        struct is_thread_safe_allocator<memory_pool<concurrent_node_pool, BlockOrRawAllocator>>
+        : std::true_type
+        {
+        };
+
         template <class Type, class Alloc>
         constexpr std::size_t memory_pool<Type, Alloc>::min_node_size;
 
@@ -329,6 +559,20 @@ namespace foonathan
                 return mem;
             }
 
+            /// \effects Forwards to \ref memory_pool::allocate_nodes().
+            /// \throws Anything thrown by the pool allocation function
+            /// or a \ref bad_allocation_size exception.
+            static void allocate_nodes(allocator_type& state, std::size_t count, std::size_t size,
+                                       std::size_t alignment, void** nodes)
+            {
+                detail::check_allocation_size<bad_node_size>(size, max_node_size(state),
+                                                             state.info());
+                detail::check_allocation_size<
+                    bad_alignment>(alignment, [&] { return max_alignment(state); }, state.info());
+                state.allocate_nodes(count, nodes);
+                state.on_allocate(count * size);
+            }
+
             /// \effects Just forwards to \ref memory_pool::deallocate_node().
             static void deallocate_node(allocator_type& state, void* node, std::size_t size,
                                         std::size_t) noexcept
@@ -337,6 +581,14 @@ namespace foonathan
                 state.on_deallocate(size);
             }
 
+            /// \effects Just forwards to \ref memory_pool::deallocate_nodes().
+            static void deallocate_nodes(allocator_type& state, void** nodes, std::size_t count,
+                                         std::size_t size, std::size_t) noexcept
+            {
+                state.deallocate_nodes(nodes, count);
+                state.on_deallocate(count * size);
+            }
+
             /// \effects Forwards to \ref memory_pool::deallocate_array() with the same size adjustment.
             static void deallocate_array(allocator_type& state, void* array, std::size_t count,
                                          std::size_t size, std::size_t) noexcept
@@ -352,9 +604,11 @@ namespace foonathan
             }
 
             /// \returns An upper bound on the maximum array size which is \ref memory_pool::next_capacity().
+            /// For the \ref concurrent_node_pool it is \ref memory_pool::node_size(),
+            /// as it only hands out single nodes and the next capacity changes while other threads grow the pool.
             static std::size_t max_array_size(const allocator_type& state) noexcept
             {
-                return state.next_capacity();
+                return max_array_size(typename allocator_type::is_concurrent{}, state);
             }
 
             /// \returns The maximum alignment which is the next bigger power of two if less than \c alignof(std::max_align_t)
@@ -363,6 +617,50 @@ namespace foonathan
             {
                 return state.free_list_.alignment();
             }
+
+            /// @{
+            /// \returns `false`, the nodes of a pool cannot be resized in place.
+            static bool try_expand_node(allocator_type&, void*, std::size_t, std::size_t,
+                                        std::size_t) noexcept
+            {
+                return false;
+            }
+
+            static bool try_shrink_node(allocator_type&, void*, std::size_t, std::size_t,
+                                        std::size_t) noexcept
+            {
+                return false;
+            }
+            /// @}
+
+            /// \effects Allocates a new array, copies and deallocates the old one.
+            /// \returns The reallocated array.
+            static void* reallocate_array(allocator_type& state, void* array, std::size_t old_count,
+                                          std::size_t new_count, std::size_t size,
+                                          std::size_t alignment)
+            {
+                return detail::reallocate_array_copy<allocator_traits>(state, array, old_count,
+                                                                       new_count, size, alignment);
+            }
+
+            /// \effects Same as \ref allocate_array().
+            /// \returns The array together with its requested size, a pool has no size classes to report.
+            static memory_block allocate_at_least(allocator_type& state, std::size_t count,
+                                                  std::size_t size, std::size_t alignment)
+            {
+                return {allocate_array(state, count, size, alignment), count * size};
+            }
+
+        private:
+            static std::size_t max_array_size(std::false_type, const allocator_type& state) noexcept
+            {
+                return state.next_capacity();
+            }
+
+            static std::size_t max_array_size(std::true_type, const allocator_type& state) noexcept
+            {
+                return state.node_size();
+            }
         };
 
         /// Specialization of the \ref composable_allocator_traits for \ref memory_pool classes.
@@ -385,6 +683,17 @@ namespace foonathan
                 return state.try_allocate_node();
             }
 
+            /// \effects Forwards to \ref memory_pool::try_allocate_nodes().
+            /// \returns Whether the allocation was successful.
+            static bool try_allocate_nodes(allocator_type& state, std::size_t count,
+                                           std::size_t size, std::size_t alignment,
+                                           void** nodes) noexcept
+            {
+                if (size > traits::max_node_size(state) || alignment > traits::max_alignment(state))
+                    return false;
+                return state.try_allocate_nodes(count, nodes);
+            }
+
             /// \effects Forwards to \ref memory_pool::try_allocate_array()
             /// with the number of nodes adjusted to be the minimum,
             /// if the \c size is less than the \ref memory_pool::node_size().
@@ -410,6 +719,16 @@ namespace foonathan
                 return state.try_deallocate_node(node);
             }
 
+            /// \effects Just forwards to \ref memory_pool::try_deallocate_nodes().
+            /// \returns Whether the deallocation was successful.
+            static bool try_deallocate_nodes(allocator_type& state, void** nodes, std::size_t count,
+                                             std::size_t size, std::size_t alignment) noexcept
+            {
+                if (size > traits::max_node_size(state) || alignment > traits::max_alignment(state))
+                    return false;
+                return state.try_deallocate_nodes(nodes, count);
+            }
+
             /// \effects Forwards to \ref memory_pool::deallocate_array() with the same size adjustment.
             /// \returns Whether the deallocation was successful.
             static bool try_deallocate_array(allocator_type& state, void* array, std::size_t count,
@@ -421,16 +740,50 @@ namespace foonathan
                     return false;
                 return state.try_deallocate_array(array, count, size);
             }
+
+            /// @{
+            /// \returns `false`, the nodes of a pool cannot be resized in place.
+            static bool try_expand_node(allocator_type&, void*, std::size_t, std::size_t,
+                                        std::size_t) noexcept
+            {
+                return false;
+            }
+
+            static bool try_shrink_node(allocator_type&, void*, std::size_t, std::size_t,
+                                        std::size_t) noexcept
+            {
+                return false;
+            }
+            /// @}
+
+            /// \effects Allocates a new array, copies and deallocates the old one.
+            /// \returns The reallocated array or `nullptr` if it was not allocated by the pool
+            /// or there was not enough memory.
+            static void* try_reallocate_array(allocator_type& state, void* array,
+                                              std::size_t old_count, std::size_t new_count,
+                                              std::size_t size, std::size_t alignment) noexcept
+            {
+                return detail::try_reallocate_array_copy<composable_allocator_traits>(
+                    state, array, old_count, new_count, size, alignment);
+            }
         };
 
 #if FOONATHAN_MEMORY_EXTERN_TEMPLATE
         extern template class allocator_traits<memory_pool<node_pool>>;
         extern template class allocator_traits<memory_pool<array_pool>>;
         extern template class allocator_traits<memory_pool<small_node_pool>>;
+        extern template class allocator_traits<memory_pool<wide_small_node_pool>>;
+        extern template class allocator_traits<memory_pool<concurrent_node_pool>>;
+        extern template class allocator_traits<memory_pool<remote_free_node_pool>>;
+        extern template class allocator_traits<memory_pool<bitmap_node_pool>>;
 
         extern template class composable_allocator_traits<memory_pool<node_pool>>;
         extern template class composable_allocator_traits<memory_pool<array_pool>>;
         extern template class composable_allocator_traits<memory_pool<small_node_pool>>;
+        extern template class composable_allocator_traits<memory_pool<wide_small_node_pool>>;
+        extern template class composable_allocator_traits<memory_pool<concurrent_node_pool>>;
+        extern template class composable_allocator_traits<memory_pool<remote_free_node_pool>>;
+        extern template class composable_allocator_traits<memory_pool<bitmap_node_pool>>;
 #endif
     } // namespace memory
 } // namespace foonathan
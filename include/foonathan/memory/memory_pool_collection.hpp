@@ -11,8 +11,8 @@
 
 #include "detail/align.hpp"
 #include "detail/assert.hpp"
-#include "detail/memory_stack.hpp"
 #include "detail/free_list_array.hpp"
+#include "detail/free_list_stack.hpp"
 #include "config.hpp"
 #include "debugging.hpp"
 #include "error.hpp"
@@ -23,12 +23,74 @@ namespace foonathan
 {
     namespace memory
     {
+        /// Statistics about the allocations of a \ref memory_pool_collection that are bigger than its \ref memory_pool_collection::max_node_size().
+        /// \ingroup allocator
+        struct large_allocation_stats
+        {
+            std::size_t count;      ///< The number of large allocations currently alive.
+            std::size_t bytes;      ///< The number of bytes requested by them.
+            std::size_t mapped;     ///< The number of bytes of virtual memory committed for them.
+            std::size_t peak_bytes; ///< The highest value of \c bytes so far.
+            std::size_t total;      ///< The number of large allocations made so far.
+        };
+
         namespace detail
         {
             struct memory_pool_collection_leak_handler
             {
                 void operator()(std::ptrdiff_t amount);
             };
+
+            // serves the allocations that are too big for the free lists of memory_pool_collection
+            // each one gets its own virtual memory mapping that starts with a header,
+            // the headers are indexed by address, so ownership is checked without looking
+            // at foreign memory and all allocations can be released on destruction
+            class large_object_list
+            {
+            public:
+                large_object_list() noexcept;
+
+                large_object_list(large_object_list&& other) noexcept;
+
+                ~large_object_list() noexcept;
+
+                large_object_list& operator=(large_object_list&& other) noexcept;
+
+                // throws out_of_memory on failure
+                void* allocate(const allocator_info& info, std::size_t size);
+
+                void* try_allocate(std::size_t size) noexcept;
+
+                // ptr must be owned
+                void deallocate(void* ptr) noexcept;
+
+                // logarithmic in the number of large allocations
+                bool owns(const void* ptr) const noexcept;
+
+                bool enabled() const noexcept
+                {
+                    return enabled_;
+                }
+
+                void set_enabled(bool enabled) noexcept
+                {
+                    enabled_ = enabled;
+                }
+
+                large_allocation_stats stats() const noexcept
+                {
+                    return stats_;
+                }
+
+            private:
+                struct header;
+
+                void release_all() noexcept;
+
+                header*                root_;
+                large_allocation_stats stats_;
+                bool                   enabled_;
+            };
         } // namespace detail
 
         /// A \c BucketDistribution for \ref memory_pool_collection defining that there is a bucket, i.e. pool, for each size.
@@ -49,9 +111,35 @@ namespace foonathan
             using type = detail::log2_access_policy;
         };
 
+        /// A \c BucketDistribution for \ref memory_pool_collection defining that each power of two is split into \c SubClasses buckets,
+        /// like the size classes of jemalloc or tcmalloc.
+        /// Each size up to <tt>2 * SubClasses</tt> has its own bucket,
+        /// after that the sizes of the buckets grow geometrically, e.g. 64, 80, 96, 112, 128 for the default of \c 4.
+        /// Allocating a node will only waste a fraction of <tt>1 / (SubClasses + 1)</tt> of the memory.
+        /// \requires \c SubClasses must be a power of two.
+        /// \ingroup allocator
+        template <std::size_t SubClasses = 4>
+        struct geometric_buckets
+        {
+            using type = detail::geometric_access_policy<SubClasses>;
+        };
+
+        /// A \c BucketDistribution for \ref memory_pool_collection with a fixed list of bucket sizes, e.g. <tt>static_buckets<8, 16, 24, 32, 48, 64></tt>.
+        /// A node is allocated from the smallest bucket it fits into.
+        /// The mapping from size to bucket is a table generated at compile-time,
+        /// so the lookup can be inlined and is cheaper than for the other distributions.
+        /// \requires The sizes must be non-zero and strictly ascending,
+        /// and the largest size divided by the greatest common divisor of all sizes must not exceed \c 4095.
+        /// \ingroup allocator
+        template <std::size_t... Sizes>
+        struct static_buckets
+        {
+            using type = detail::static_access_policy<Sizes...>;
+        };
+
         /// A stateful \concept{concept_rawallocator,RawAllocator} that behaves as a collection of multiple \ref memory_pool objects.
         /// It maintains a list of multiple free lists, whose types are controlled via the \c PoolType tags defined in \ref memory_pool_type.hpp,
-        /// each of a different size as defined in the \c BucketDistribution (\ref identity_buckets or \ref log2_buckets).
+        /// each of a different size as defined in the \c BucketDistribution (\ref identity_buckets, \ref log2_buckets, \ref geometric_buckets or \ref static_buckets).
         /// Allocating a node of given size will use the appropriate free list.<br>
         /// This allocator is ideal for \concept{concept_node,node} allocations in any order but with a predefined set of sizes,
         /// not only one size like \ref memory_pool.
@@ -63,6 +151,7 @@ namespace foonathan
         {
             using free_list_array =
                 detail::free_list_array<typename PoolType::type, typename BucketDistribution::type>;
+            using stack_type = detail::free_list_stack<typename PoolType::type>;
             using leak_checker =
                 detail::default_leak_checker<detail::memory_pool_collection_leak_handler>;
 
@@ -80,8 +169,8 @@ namespace foonathan
             memory_pool_collection(std::size_t max_node_size, std::size_t block_size,
                                    Args&&... args)
             : arena_(block_size, detail::forward<Args>(args)...),
-              stack_(allocate_block()),
-              pools_(stack_, block_end(), max_node_size)
+              stack_(arena_.allocate_block()),
+              pools_(stack_.stack(), stack_.end(), max_node_size)
             {
                 detail::check_allocation_size<bad_node_size>(max_node_size, def_capacity(), info());
             }
@@ -99,7 +188,8 @@ namespace foonathan
             : leak_checker(detail::move(other)),
               arena_(detail::move(other.arena_)),
               stack_(detail::move(other.stack_)),
-              pools_(detail::move(other.pools_))
+              pools_(detail::move(other.pools_)),
+              large_(detail::move(other.large_))
             {
             }
 
@@ -109,6 +199,7 @@ namespace foonathan
                 arena_ = detail::move(other.arena_);
                 stack_ = detail::move(other.stack_);
                 pools_ = detail::move(other.pools_);
+                large_ = detail::move(other.large_);
                 return *this;
             }
             /// @}
@@ -122,17 +213,18 @@ namespace foonathan
             /// Then it removes a node from it.
             /// \returns A \concept{concept_node,node} of given size suitable aligned,
             /// i.e. suitable for any type where <tt>sizeof(T) < node_size</tt>.
-            /// \throws Anything thrown by the \concept{concept_blockallocator,BlockAllocator} if a growth is needed or a \ref bad_node_size exception if the node size is too big.
+            /// If large allocations are enabled, a node bigger than \ref max_node_size() is allocated as described in \ref set_large_allocations().
+            /// \throws Anything thrown by the \concept{concept_blockallocator,BlockAllocator} if a growth is needed or a \ref bad_node_size exception if the node size is too big,
+            /// or an \ref out_of_memory exception if a large allocation fails.
             void* allocate_node(std::size_t node_size)
             {
+                if (node_size > max_node_size() && large_.enabled())
+                    return large_.allocate(info(), node_size);
                 detail::check_allocation_size<
                     bad_node_size>(node_size, [&] { return max_node_size(); }, info());
                 auto& pool = pools_.get(node_size);
                 if (pool.empty())
-                {
-                    auto block = reserve_memory(pool, def_capacity());
-                    pool.insert(block.memory, block.size);
-                }
+                    reserve_memory(pool, def_capacity());
 
                 auto mem = pool.allocate();
                 FOONATHAN_MEMORY_ASSERT(mem);
@@ -147,7 +239,7 @@ namespace foonathan
             void* try_allocate_node(std::size_t node_size) noexcept
             {
                 if (node_size > max_node_size())
-                    return nullptr;
+                    return large_.enabled() ? large_.try_allocate(node_size) : nullptr;
                 auto& pool = pools_.get(node_size);
                 if (pool.empty())
                 {
@@ -158,6 +250,61 @@ namespace foonathan
                     return pool.allocate();
             }
 
+            /// \effects Allocates \c count \concept{concept_node,nodes} of given size at once and writes them to \c nodes.
+            /// Instead of removing them one by one, the free list unlinks whole chains of nodes.
+            /// If it does not have enough nodes, more memory is inserted as in \ref allocate_node().
+            /// \throws Anything thrown by the \concept{concept_blockallocator,BlockAllocator} if a growth is needed or a \ref bad_node_size exception if the node size is too big.
+            /// Then no nodes are allocated.
+            /// \requires \c nodes must point to storage for at least \c count pointers.
+            void allocate_nodes(std::size_t count, std::size_t node_size, void** nodes)
+            {
+                if (node_size > max_node_size() && large_.enabled())
+                {
+                    allocate_large_nodes(count, node_size, nodes);
+                    return;
+                }
+                detail::check_allocation_size<
+                    bad_node_size>(node_size, [&] { return max_node_size(); }, info());
+                auto& pool      = pools_.get(node_size);
+                auto  allocated = pool.allocate_nodes(count, nodes);
+#if FOONATHAN_HAS_EXCEPTION_SUPPORT
+                try
+                {
+#endif
+                    while (allocated != count)
+                    {
+                        reserve_memory(pool, def_capacity());
+                        allocated += pool.allocate_nodes(count - allocated, nodes + allocated);
+                    }
+#if FOONATHAN_HAS_EXCEPTION_SUPPORT
+                }
+                catch (...)
+                {
+                    pool.deallocate_nodes(nodes, allocated);
+                    throw;
+                }
+#endif
+            }
+
+            /// \effects Allocates \c count \concept{concept_node,nodes} similar to \ref allocate_nodes().
+            /// But it will not grow the arena and possibly throw.
+            /// \returns \c true if all nodes could be allocated, \c false otherwise.
+            /// Then no nodes are allocated.
+            bool try_allocate_nodes(std::size_t count, std::size_t node_size, void** nodes) noexcept
+            {
+                if (node_size > max_node_size())
+                    return large_.enabled() && try_allocate_large_nodes(count, node_size, nodes);
+                auto& pool = pools_.get(node_size);
+                if (pool.capacity() < count)
+                    try_reserve_memory(pool, def_capacity());
+
+                auto allocated = pool.allocate_nodes(count, nodes);
+                if (allocated == count)
+                    return true;
+                pool.deallocate_nodes(nodes, allocated);
+                return false;
+            }
+
             /// \effects Allocates an \concept{concept_array,array} of nodes by searching for \c n continuous nodes on the appropriate free list and removing them.
             /// Depending on the \c PoolType this can be a slow operation or not allowed at all.
             /// This can sometimes lead to a growth on the free list, even if technically there is enough continuous memory on the free list.
@@ -167,8 +314,11 @@ namespace foonathan
             /// or a \ref bad_allocation_size exception.
             /// \requires \c count must be valid \concept{concept_array,array count} and
             /// \c node_size must be valid \concept{concept_node,node size}.
+            /// \note If large allocations are enabled, an array of nodes bigger than \ref max_node_size() is a large allocation.
             void* allocate_array(std::size_t count, std::size_t node_size)
             {
+                if (node_size > max_node_size() && large_.enabled())
+                    return large_.allocate(info(), count * node_size);
                 detail::check_allocation_size<
                     bad_node_size>(node_size, [&] { return max_node_size(); }, info());
 
@@ -180,8 +330,7 @@ namespace foonathan
                 if (!mem)
                 {
                     // reserve more memory
-                    auto block = reserve_memory(pool, def_capacity());
-                    pool.insert(block.memory, block.size);
+                    reserve_memory(pool, def_capacity());
 
                     mem = pool.allocate(count * node_size);
                     if (!mem)
@@ -191,8 +340,8 @@ namespace foonathan
                             count * node_size,
                             [&] { return next_capacity() - pool.alignment() + 1; }, info());
 
-                        block = reserve_memory(pool, count * node_size);
-                        pool.insert(block.memory, block.size);
+                        reserve_memory(pool,
+                                       pool_type::type::min_block_size(pool.node_size(), count));
 
                         mem = pool.allocate(count * node_size);
                         FOONATHAN_MEMORY_ASSERT(mem);
@@ -209,7 +358,9 @@ namespace foonathan
             /// or `nullptr` in case of failure.
             void* try_allocate_array(std::size_t count, std::size_t node_size) noexcept
             {
-                if (!pool_type::value || node_size > max_node_size())
+                if (node_size > max_node_size())
+                    return large_.enabled() ? large_.try_allocate(count * node_size) : nullptr;
+                else if (!pool_type::value)
                     return nullptr;
                 auto& pool = pools_.get(node_size);
                 if (pool.empty())
@@ -226,7 +377,25 @@ namespace foonathan
             /// i.e. either this allocator object or a new object created by moving this to it.
             void deallocate_node(void* ptr, std::size_t node_size) noexcept
             {
-                pools_.get(node_size).deallocate(ptr);
+                if (node_size > max_node_size())
+                    large_.deallocate(ptr);
+                else
+                    pools_.get(node_size).deallocate(ptr);
+            }
+
+            /// \effects Deallocates \c count \concept{concept_node,nodes} of given size at once,
+            /// the free list links them and splices the entire chain in.
+            /// \requires Each node must be a result from a previous call to \ref allocate_node() or \ref allocate_nodes() with the same size on the same free list,
+            /// i.e. either this allocator object or a new object created by moving this to it.
+            void deallocate_nodes(void** nodes, std::size_t count, std::size_t node_size) noexcept
+            {
+                if (node_size > max_node_size())
+                {
+                    for (std::size_t i = 0u; i != count; ++i)
+                        large_.deallocate(nodes[i]);
+                }
+                else
+                    pools_.get(node_size).deallocate_nodes(nodes, count);
             }
 
             /// \effects Deallocates a \concept{concept_node,node} similar to \ref deallocate_node().
@@ -235,9 +404,25 @@ namespace foonathan
             /// `false` otherwise.
             bool try_deallocate_node(void* ptr, std::size_t node_size) noexcept
             {
-                if (node_size > max_node_size() || !arena_.owns(ptr))
+                if (node_size > max_node_size() ? !large_.owns(ptr) : !arena_.owns(ptr))
+                    return false;
+                deallocate_node(ptr, node_size);
+                return true;
+            }
+
+            /// \effects Deallocates \c count \concept{concept_node,nodes} similar to \ref deallocate_nodes().
+            /// But it checks if it can deallocate this memory.
+            /// \returns `true` if the nodes could be deallocated,
+            /// `false` otherwise.
+            /// \requires Either all or none of the nodes must have been allocated by this allocator,
+            /// only the first one is checked.
+            bool try_deallocate_nodes(void** nodes, std::size_t count, std::size_t node_size) noexcept
+            {
+                if (count != 0u
+                    && (node_size > max_node_size() ? !large_.owns(nodes[0])
+                                                    : !arena_.owns(nodes[0])))
                     return false;
-                pools_.get(node_size).deallocate(ptr);
+                deallocate_nodes(nodes, count, node_size);
                 return true;
             }
 
@@ -246,7 +431,10 @@ namespace foonathan
             /// i.e. either this allocator object or a new object created by moving this to it.
             void deallocate_array(void* ptr, std::size_t count, std::size_t node_size) noexcept
             {
-                pools_.get(node_size).deallocate(ptr, count * node_size);
+                if (node_size > max_node_size())
+                    large_.deallocate(ptr);
+                else
+                    pools_.get(node_size).deallocate(ptr, count * node_size);
             }
 
             /// \effects Deallocates a \concept{concept_array,array} similar to \ref deallocate_array().
@@ -255,9 +443,14 @@ namespace foonathan
             /// `false` otherwise.
             bool try_deallocate_array(void* ptr, std::size_t count, std::size_t node_size) noexcept
             {
-                if (!pool_type::value || node_size > max_node_size() || !arena_.owns(ptr))
+                if (node_size > max_node_size())
+                {
+                    if (!large_.owns(ptr))
+                        return false;
+                }
+                else if (!pool_type::value || !arena_.owns(ptr))
                     return false;
-                pools_.get(node_size).deallocate(ptr, count * node_size);
+                deallocate_array(ptr, count, node_size);
                 return true;
             }
 
@@ -282,6 +475,21 @@ namespace foonathan
                 return pools_.max_node_size();
             }
 
+            /// \returns The usable size of an \concept{concept_array,array} of \c count nodes of given size,
+            /// i.e. the size of all the nodes it occupies on the free list as defined over the \c BucketDistribution,
+            /// rounded down to a multiple of \c node_size.
+            /// It is just <tt>count * node_size</tt> if the \c PoolType does not support arrays
+            /// or if it is a large allocation.
+            std::size_t usable_size(std::size_t count, std::size_t node_size) const noexcept
+            {
+                auto size = count * node_size;
+                if (!pool_type::value || node_size > max_node_size())
+                    return size;
+                auto actual_node_size = pools_.get(node_size).node_size();
+                auto no_nodes         = (size + actual_node_size - 1u) / actual_node_size;
+                return no_nodes * actual_node_size / node_size * node_size;
+            }
+
             /// \returns The amount of nodes available in the free list for nodes of given size
             /// as defined over the \c BucketDistribution.
             /// This is the number of nodes that can be allocated without the free list requesting more memory from the arena.
@@ -298,7 +506,7 @@ namespace foonathan
             /// \note Array allocations may lead to a growth even if the capacity is big enough.
             std::size_t capacity_left() const noexcept
             {
-                return std::size_t(block_end() - stack_.top());
+                return stack_.capacity_left();
             }
 
             /// \returns The size of the next memory block after \ref capacity_left() arena grows.
@@ -309,6 +517,66 @@ namespace foonathan
                 return arena_.next_block_size();
             }
 
+            /// \effects Gives every memory block whose \concept{concept_node,nodes} are all on the free lists back to the arena,
+            /// which passes it on to the \concept{concept_blockallocator,BlockAllocator}.
+            /// The nodes of the block are removed from the free lists.
+            /// This allows long running programs to return memory after a spike in allocations.
+            /// Each block keeps track of how many nodes were put onto the free lists from it,
+            /// the free nodes are only counted when this function is called,
+            /// so there is no overhead on allocation or deallocation.
+            /// It takes a single pass over the free lists with a logarithmic lookup of the block of each free node.
+            /// If the block currently used for growth is released, the next growth will request a new one.
+            /// Blocks kept by \ref reclaim_empty_blocks() are released as well.
+            /// \returns The number of blocks that have been released.
+            /// \requires The \concept{concept_blockallocator,BlockAllocator} must support deallocation in any order.
+            /// \note The first memory block is never released as it also stores the free lists themselves.
+            std::size_t release_empty_blocks() noexcept
+            {
+                auto stack_released = false;
+                auto count          = arena_.deallocate_blocks_if(
+                    [&](detail::memory_block_tally& tally) { count_free_nodes(tally); },
+                    [&](memory_block block, std::size_t free_nodes)
+                    {
+                        if (stack_type::is_reclaimed(block))
+                            return true;
+                        else if (!is_empty_block(block, free_nodes))
+                            return false;
+
+                        remove_nodes_in(block);
+                        stack_released = stack_released || block.memory == stack_.block().memory;
+                        return true;
+                    });
+                stack_.release_reclaimed(stack_released, arena_.current_block());
+                return count;
+            }
+
+            /// \effects Takes every memory block whose \concept{concept_node,nodes} are all on the free lists away from its free lists,
+            /// like \ref release_empty_blocks(), but keeps the block instead of giving it back to the arena.
+            /// The next time any free list needs to grow, it will carve its memory from such a block
+            /// before requesting a new one from the \concept{concept_blockallocator,BlockAllocator}.
+            /// This moves memory from size classes that are no longer used to the ones that are,
+            /// which is useful if the mix of allocated sizes changes over time.
+            /// \returns The number of blocks that have been reclaimed.
+            /// \note The first memory block and the block currently used for growth are never reclaimed.
+            std::size_t reclaim_empty_blocks() noexcept
+            {
+                std::size_t count = 0u;
+                arena_.for_each(
+                    [&](detail::memory_block_tally& tally) { count_free_nodes(tally); },
+                    [&](memory_block block, std::size_t free_nodes)
+                    {
+                        if (block.memory == stack_.block().memory
+                            || stack_type::is_reclaimed(block)
+                            || !is_empty_block(block, free_nodes))
+                            return;
+
+                        remove_nodes_in(block);
+                        stack_.reclaim(block);
+                        ++count;
+                    });
+                return count;
+            }
+
             /// \returns A reference to the \concept{concept_blockallocator,BlockAllocator} used for managing the arena.
             /// \requires It is undefined behavior to move this allocator out into another object.
             allocator_type& get_allocator() noexcept
@@ -316,72 +584,109 @@ namespace foonathan
                 return arena_.get_allocator();
             }
 
-        private:
-            allocator_info info() const noexcept
+            /// \effects Enables or disables large allocations, they are disabled by default.
+            /// If they are enabled, a \concept{concept_node,node} or an \concept{concept_array,array} of nodes bigger than \ref max_node_size()
+            /// does not lead to a \ref bad_node_size exception.
+            /// Instead, it gets its own mapping of virtual memory pages, bypassing the arena and the free lists.
+            /// This saves wrapping the collection into a \ref binary_segregator for the rare big allocations.
+            /// As the size passed to the deallocation functions decides which kind of allocation it is,
+            /// deallocation does not need to search for it.
+            /// \note Large allocations that are still alive can be deallocated after disabling them again.
+            void set_large_allocations(bool enabled) noexcept
             {
-                return {FOONATHAN_MEMORY_LOG_PREFIX "::memory_pool_collection", this};
+                large_.set_enabled(enabled);
             }
 
-            std::size_t def_capacity() const noexcept
+            /// \returns Whether or not large allocations are enabled.
+            bool large_allocations() const noexcept
             {
-                return arena_.current_block().size / pools_.size();
+                return large_.enabled();
             }
 
-            detail::fixed_memory_stack allocate_block()
+            /// \returns The statistics about the large allocations.
+            large_allocation_stats large_stats() const noexcept
             {
-                return detail::fixed_memory_stack(arena_.allocate_block().memory);
+                return large_.stats();
             }
 
-            const char* block_end() const noexcept
+        private:
+            allocator_info info() const noexcept
             {
-                auto block = arena_.current_block();
-                return static_cast<const char*>(block.memory) + block.size;
+                return {FOONATHAN_MEMORY_LOG_PREFIX "::memory_pool_collection", this};
             }
 
-            bool insert_rest(typename pool_type::type& pool) noexcept
+            void allocate_large_nodes(std::size_t count, std::size_t node_size, void** nodes)
             {
-                if (auto remaining = std::size_t(block_end() - stack_.top()))
+                std::size_t allocated = 0u;
+#if FOONATHAN_HAS_EXCEPTION_SUPPORT
+                try
                 {
-                    auto offset = detail::align_offset(stack_.top(), detail::max_alignment);
-                    if (offset < remaining)
+#endif
+                    for (; allocated != count; ++allocated)
+                        nodes[allocated] = large_.allocate(info(), node_size);
+#if FOONATHAN_HAS_EXCEPTION_SUPPORT
+                }
+                catch (...)
+                {
+                    deallocate_nodes(nodes, allocated, node_size);
+                    throw;
+                }
+#endif
+            }
+
+            bool try_allocate_large_nodes(std::size_t count, std::size_t node_size,
+                                          void** nodes) noexcept
+            {
+                for (std::size_t i = 0u; i != count; ++i)
+                {
+                    nodes[i] = large_.try_allocate(node_size);
+                    if (!nodes[i])
                     {
-                        detail::debug_fill(stack_.top(), offset, debug_magic::alignment_memory);
-                        pool.insert(stack_.top() + offset, remaining - offset);
-                        return true;
+                        deallocate_nodes(nodes, i, node_size);
+                        return false;
                     }
                 }
+                return true;
+            }
 
-                return false;
+            std::size_t def_capacity() const noexcept
+            {
+                return stack_.block().size / pools_.size();
             }
 
-            void try_reserve_memory(typename pool_type::type& pool, std::size_t capacity) noexcept
+            void count_free_nodes(detail::memory_block_tally& tally) noexcept
             {
-                auto mem = stack_.allocate(block_end(), capacity, detail::max_alignment);
-                if (!mem)
-                    insert_rest(pool);
-                else
-                    pool.insert(mem, capacity);
+                for (std::size_t i = 0u; i != pools_.size(); ++i)
+                    pools_[i].count_free_nodes(tally);
             }
 
-            memory_block reserve_memory(typename pool_type::type& pool, std::size_t capacity)
+            // free_nodes is the number of nodes of the block on the free lists
+            bool is_empty_block(memory_block block, std::size_t free_nodes) const noexcept
             {
-                auto mem = stack_.allocate(block_end(), capacity, detail::max_alignment);
-                if (!mem)
-                {
-                    insert_rest(pool);
-                    // get new block
-                    stack_ = allocate_block();
+                return !block.contains(&pools_.get(max_node_size()))
+                       && free_nodes == stack_type::inserted_nodes(block);
+            }
 
-                    // allocate ensuring alignment
-                    mem = stack_.allocate(block_end(), capacity, detail::max_alignment);
-                    FOONATHAN_MEMORY_ASSERT(mem);
-                }
-                return {mem, capacity};
+            void remove_nodes_in(memory_block block) noexcept
+            {
+                for (std::size_t i = 0u; i != pools_.size(); ++i)
+                    pools_[i].remove_nodes_in(block.memory, block.size);
+            }
+
+            void try_reserve_memory(typename pool_type::type& pool, std::size_t capacity) noexcept
+            {
+                stack_.try_reserve(&pools_[0], pool, capacity);
+            }
+
+            void reserve_memory(typename pool_type::type& pool, std::size_t capacity)
+            {
+                stack_.reserve(arena_, &pools_[0], pool, capacity);
             }
 
             memory_arena<allocator_type, false> arena_;
-            detail::fixed_memory_stack          stack_;
+            stack_type                          stack_;
             free_list_array                     pools_;
+            detail::large_object_list           large_;
 
             friend allocator_traits<memory_pool_collection>;
         };
@@ -394,6 +699,10 @@ namespace foonathan
         extern template class memory_pool_collection<node_pool, log2_buckets>;
         extern template class memory_pool_collection<array_pool, log2_buckets>;
         extern template class memory_pool_collection<small_node_pool, log2_buckets>;
+
+        extern template class memory_pool_collection<node_pool, geometric_buckets<>>;
+        extern template class memory_pool_collection<array_pool, geometric_buckets<>>;
+        extern template class memory_pool_collection<small_node_pool, geometric_buckets<>>;
 #endif
 
         /// An alias for \ref memory_pool_collection using the \ref identity_buckets policy
@@ -446,6 +755,20 @@ namespace foonathan
                 return mem;
             }
 
+            /// \effects Calls \ref memory_pool_collection::allocate_nodes().
+            /// \throws Anything thrown by the pool allocation function
+            /// or a \ref bad_allocation_size exception if \c size / \c alignment exceeds \ref max_node_size() / the suitable alignment value,
+            /// i.e. the nodes are over-aligned.
+            static void allocate_nodes(allocator_type& state, std::size_t count, std::size_t size,
+                                       std::size_t alignment, void** nodes)
+            {
+                // node already checked
+                detail::check_allocation_size<bad_alignment>(
+                    alignment, [&] { return detail::alignment_for(size); }, state.info());
+                state.allocate_nodes(count, size, nodes);
+                state.on_allocate(count * size);
+            }
+
             /// \effects Calls \ref memory_pool_collection::deallocate_node().
             static void deallocate_node(allocator_type& state, void* node, std::size_t size,
                                         std::size_t) noexcept
@@ -454,6 +777,14 @@ namespace foonathan
                 state.on_deallocate(size);
             }
 
+            /// \effects Calls \ref memory_pool_collection::deallocate_nodes().
+            static void deallocate_nodes(allocator_type& state, void** nodes, std::size_t count,
+                                         std::size_t size, std::size_t) noexcept
+            {
+                state.deallocate_nodes(nodes, count, size);
+                state.on_deallocate(count * size);
+            }
+
             /// \effects Calls \ref memory_pool_collection::deallocate_array().
             /// \requires The \ref memory_pool_collection has to support array allocations.
             static void deallocate_array(allocator_type& state, void* array, std::size_t count,
@@ -463,10 +794,11 @@ namespace foonathan
                 state.on_deallocate(count * size);
             }
 
-            /// \returns The maximum size of each node which is \ref memory_pool_collection::max_node_size().
+            /// \returns The maximum size of each node which is \ref memory_pool_collection::max_node_size(),
+            /// or unlimited if large allocations are enabled.
             static std::size_t max_node_size(const allocator_type& state) noexcept
             {
-                return state.max_node_size();
+                return state.large_allocations() ? std::size_t(-1) : state.max_node_size();
             }
 
             /// \returns An upper bound on the maximum array size which is \ref memory_pool::next_capacity().
@@ -481,6 +813,45 @@ namespace foonathan
             {
                 return detail::max_alignment;
             }
+
+            /// @{
+            /// \returns `false`, the nodes of a pool cannot be resized in place.
+            static bool try_expand_node(allocator_type&, void*, std::size_t, std::size_t,
+                                        std::size_t) noexcept
+            {
+                return false;
+            }
+
+            static bool try_shrink_node(allocator_type&, void*, std::size_t, std::size_t,
+                                        std::size_t) noexcept
+            {
+                return false;
+            }
+            /// @}
+
+            /// \effects Allocates a new array, copies and deallocates the old one.
+            /// \returns The reallocated array.
+            static void* reallocate_array(allocator_type& state, void* array, std::size_t old_count,
+                                          std::size_t new_count, std::size_t size,
+                                          std::size_t alignment)
+            {
+                return detail::reallocate_array_copy<allocator_traits>(state, array, old_count,
+                                                                       new_count, size, alignment);
+            }
+
+            /// \effects Allocates an array like \ref allocate_array(), or a single node if \c count is \c 1.
+            /// \returns The array together with the size of all the nodes it occupies,
+            /// rounded down to a multiple of \c size.
+            /// This can only be more than requested if the \c PoolType supports arrays.
+            static memory_block allocate_at_least(allocator_type& state, std::size_t count,
+                                                  std::size_t size, std::size_t alignment)
+            {
+                auto mem = count == 1u ? allocate_node(state, size, alignment)
+                                       : allocate_array(state, count, size, alignment);
+                auto actual = state.usable_size(count, size);
+                state.on_allocate(actual - count * size);
+                return {mem, actual};
+            }
         };
 
         /// Specialization of the \ref composable_allocator_traits for \ref memory_pool_collection classes.
@@ -503,12 +874,24 @@ namespace foonathan
                 return state.try_allocate_node(size);
             }
 
+            /// \returns The result of \ref memory_pool_collection::try_allocate_nodes()
+            /// or `false` if the alignment was too big.
+            static bool try_allocate_nodes(allocator_type& state, std::size_t count,
+                                           std::size_t size, std::size_t alignment,
+                                           void** nodes) noexcept
+            {
+                if (alignment > traits::max_alignment(state))
+                    return false;
+                return state.try_allocate_nodes(count, size, nodes);
+            }
+
             /// \returns The result of \ref memory_pool_collection::try_allocate_array()
             /// or `nullptr` if the allocation size was too big.
             static void* try_allocate_array(allocator_type& state, std::size_t count,
                                             std::size_t size, std::size_t alignment) noexcept
             {
-                if (count * size > traits::max_array_size(state)
+                // arrays of large nodes are not limited by the arena
+                if ((size <= state.max_node_size() && count * size > traits::max_array_size(state))
                     || alignment > traits::max_alignment(state))
                     return nullptr;
                 return state.try_allocate_array(count, size);
@@ -524,16 +907,53 @@ namespace foonathan
                 return state.try_deallocate_node(node, size);
             }
 
+            /// \effects Just forwards to \ref memory_pool_collection::try_deallocate_nodes().
+            /// \returns Whether the deallocation was successful.
+            static bool try_deallocate_nodes(allocator_type& state, void** nodes, std::size_t count,
+                                             std::size_t size, std::size_t alignment) noexcept
+            {
+                if (alignment > traits::max_alignment(state))
+                    return false;
+                return state.try_deallocate_nodes(nodes, count, size);
+            }
+
             /// \effects Forwards to \ref memory_pool_collection::deallocate_array().
             /// \returns Whether the deallocation was successful.
             static bool try_deallocate_array(allocator_type& state, void* array, std::size_t count,
                                              std::size_t size, std::size_t alignment) noexcept
             {
-                if (count * size > traits::max_array_size(state)
+                // arrays of large nodes are not limited by the arena
+                if ((size <= state.max_node_size() && count * size > traits::max_array_size(state))
                     || alignment > traits::max_alignment(state))
                     return false;
                 return state.try_deallocate_array(array, count, size);
             }
+
+            /// @{
+            /// \returns `false`, the nodes of a pool cannot be resized in place.
+            static bool try_expand_node(allocator_type&, void*, std::size_t, std::size_t,
+                                        std::size_t) noexcept
+            {
+                return false;
+            }
+
+            static bool try_shrink_node(allocator_type&, void*, std::size_t, std::size_t,
+                                        std::size_t) noexcept
+            {
+                return false;
+            }
+            /// @}
+
+            /// \effects Allocates a new array, copies and deallocates the old one.
+            /// \returns The reallocated array or `nullptr` if it was not allocated by the pools
+            /// or there was not enough memory.
+            static void* try_reallocate_array(allocator_type& state, void* array,
+                                              std::size_t old_count, std::size_t new_count,
+                                              std::size_t size, std::size_t alignment) noexcept
+            {
+                return detail::try_reallocate_array_copy<composable_allocator_traits>(
+                    state, array, old_count, new_count, size, alignment);
+            }
         };
 
 #if FOONATHAN_MEMORY_EXTERN_TEMPLATE
@@ -548,6 +968,13 @@ namespace foonathan
         extern template class allocator_traits<
             memory_pool_collection<small_node_pool, log2_buckets>>;
 
+        extern template class allocator_traits<
+            memory_pool_collection<node_pool, geometric_buckets<>>>;
+        extern template class allocator_traits<
+            memory_pool_collection<array_pool, geometric_buckets<>>>;
+        extern template class allocator_traits<
+            memory_pool_collection<small_node_pool, geometric_buckets<>>>;
+
         extern template class composable_allocator_traits<
             memory_pool_collection<node_pool, identity_buckets>>;
         extern template class composable_allocator_traits<
@@ -561,6 +988,13 @@ namespace foonathan
             memory_pool_collection<array_pool, log2_buckets>>;
         extern template class composable_allocator_traits<
             memory_pool_collection<small_node_pool, log2_buckets>>;
+
+        extern template class composable_allocator_traits<
+            memory_pool_collection<node_pool, geometric_buckets<>>>;
+        extern template class composable_allocator_traits<
+            memory_pool_collection<array_pool, geometric_buckets<>>>;
+        extern template class composable_allocator_traits<
+            memory_pool_collection<small_node_pool, geometric_buckets<>>>;
 #endif
     } // namespace memory
 } // namespace foonathan
@@ -9,7 +9,10 @@
 
 #include <type_traits>
 
+#include "detail/bitmap_free_list.hpp"
+#include "detail/concurrent_free_list.hpp"
 #include "detail/free_list.hpp"
+#include "detail/remote_free_list.hpp"
 #include "detail/small_free_list.hpp"
 #include "config.hpp"
 
@@ -27,9 +30,11 @@ namespace foonathan
         };
 
         /// Tag type defining a memory pool optimized for arrays.
-        /// It keeps the nodes ordered inside the free list and searches the list for an appropriate memory block.
-        /// Array allocations are still pretty slow, if the array gets big enough it can get slower than \c new.
-        /// Node allocations are still fast, unless there is deallocation in random order.
+        /// It keeps the nodes ordered inside the free list and merges consecutive free nodes to runs.
+        /// Runs are indexed by their size, so an array allocation takes the smallest run that is big enough
+        /// in logarithmic time instead of searching the list.
+        /// Node allocations are still fast, but deallocations need to find their position in the list,
+        /// which is slow if there are many runs and deallocation happens in random order.
         /// \note Use this tag type only if you really need to have a memory pool!
         /// \ingroup allocator
         struct array_pool : FOONATHAN_EBO(std::true_type)
@@ -46,6 +51,56 @@ namespace foonathan
         {
             using type = detail::small_free_memory_list;
         };
+
+        /// Tag type defining a memory pool optimized for small nodes with bigger chunks than \ref small_node_pool.
+        /// A chunk of \ref small_node_pool holds at most 255 nodes, this one up to 65535,
+        /// so a chunk of tiny nodes can span multiple pages.
+        /// This means fewer chunk headers and fewer chunks to search when many tiny objects are allocated at once.
+        /// In return, each node must have at least the size of two bytes.
+        /// It does not support arrays.
+        /// \ingroup allocator
+        struct wide_small_node_pool : FOONATHAN_EBO(std::false_type)
+        {
+            using type = detail::wide_small_free_memory_list;
+        };
+
+        /// Tag type defining a memory pool that can be shared between threads without locking.
+        /// Allocation and deallocation of nodes are lock-free,
+        /// only growing the pool is synchronized so that just one thread allocates a new memory block.
+        /// The nodes are kept in an ABA-safe lock-free stack indexed by a table of the memory blocks,
+        /// so a pool of this type can only grow up to 64 times.
+        /// Further growth throws \ref out_of_memory before a new memory block is allocated.
+        /// It does not support arrays and is slower than \ref node_pool when used by a single thread.
+        /// \ingroup allocator
+        struct concurrent_node_pool : FOONATHAN_EBO(std::false_type)
+        {
+            using type = detail::concurrent_free_memory_list;
+        };
+
+        /// Tag type defining a memory pool owned by one thread where other threads may deallocate nodes.
+        /// Only the thread that created the pool may allocate from it, until another thread takes it over with \ref memory_pool::claim_ownership(),
+        /// but deallocation of nodes is allowed from any thread without locking.
+        /// Nodes deallocated by other threads are pushed onto a lock-free stack,
+        /// the owner takes all of them at once when its own free list runs empty.
+        /// This is ideal for a producer/consumer setup, where one thread allocates and other threads free.
+        /// It does not support arrays and deallocation from other threads is slightly slower than with \ref node_pool.
+        /// \ingroup allocator
+        struct remote_free_node_pool : FOONATHAN_EBO(std::false_type)
+        {
+            using type = detail::remote_free_memory_list;
+        };
+
+        /// Tag type defining a memory pool for tiny nodes that keeps an occupancy bitmap for each memory block.
+        /// Allocation scans the bitmap a word at a time, deallocation sets a single bit,
+        /// so like \ref small_node_pool there is no minimum node size,
+        /// but no per-node overhead either and freed nodes are never written to.
+        /// A double deallocation is detected in constant time.
+        /// It does not support arrays.
+        /// \ingroup allocator
+        struct bitmap_node_pool : FOONATHAN_EBO(std::false_type)
+        {
+            using type = detail::bitmap_free_memory_list;
+        };
     } // namespace memory
 } // namespace foonathan
 
@@ -26,6 +26,8 @@ namespace foonathan
 #if !defined(DOXYGEN)
         template <class Impl>
         class memory_stack;
+        template <class Impl>
+        class concurrent_memory_stack;
 #endif
 
         namespace detail
@@ -84,6 +86,8 @@ namespace foonathan
 
                 template <class Impl>
                 friend class memory::memory_stack;
+                template <class Impl>
+                friend class memory::concurrent_memory_stack;
             };
 
             struct memory_stack_leak_handler
@@ -167,6 +171,17 @@ namespace foonathan
                 return stack_.allocate(block_end(), size, alignment);
             }
 
+            /// \effects Changes the size of the memory block at the top of the stack in place,
+            /// by moving the top marker.
+            /// \returns Whether or not the size could be changed,
+            /// this is only possible if \c memory was the last allocation and the current memory block has enough space left.
+            /// \requires \c memory and \c old_size must describe a previous allocation
+            /// and no marker must have been obtained since that allocation.
+            bool try_resize(void* memory, std::size_t old_size, std::size_t new_size) noexcept
+            {
+                return stack_.resize(block_end(), memory, old_size, new_size);
+            }
+
             /// The marker type that is used for unwinding.
             /// The exact type is implementation defined,
             /// it is only required that it is efficiently copyable
@@ -229,6 +244,23 @@ namespace foonathan
                 arena_.shrink_to_fit();
             }
 
+            /// \effects Returns the physical memory of the cached memory blocks to the system,
+            /// but keeps the blocks in the cache, so their address space can be reused without allocation.
+            /// This function just forwards to the \ref memory_arena.
+            /// \returns The number of bytes returned to the system.
+            std::size_t scavenge() noexcept
+            {
+                return arena_.scavenge();
+            }
+
+            /// \effects Sets the limits for the cached memory blocks that keep their physical memory after an \ref unwind(),
+            /// the others are scavenged.
+            /// This function just forwards to the \ref memory_arena.
+            void set_cache_limits(const memory_arena_cache_limits& limits) noexcept
+            {
+                arena_.set_cache_limits(limits);
+            }
+
             /// \returns The amount of memory remaining in the current block.
             /// This is the number of bytes that are available for allocation
             /// before the cache or \concept{concept_blockallocator,BlockAllocator} needs to be used.
@@ -403,6 +435,13 @@ namespace foonathan
                 return allocate_node(state, count * size, alignment);
             }
 
+            /// \effects Calls \ref memory_stack::allocate() for each node.
+            static void allocate_nodes(allocator_type& state, std::size_t count, std::size_t size,
+                                       std::size_t alignment, void** nodes)
+            {
+                detail::allocate_nodes_each<allocator_traits>(state, count, size, alignment, nodes);
+            }
+
             /// @{
             /// \effects Does nothing besides bookmarking for leak checking, if that is enabled.
             /// Actual deallocation can only be done via \ref memory_stack::unwind().
@@ -417,8 +456,57 @@ namespace foonathan
             {
                 deallocate_node(state, ptr, count * size, alignment);
             }
+
+            static void deallocate_nodes(allocator_type& state, void**, std::size_t count,
+                                         std::size_t size, std::size_t) noexcept
+            {
+                state.on_deallocate(count * size);
+            }
+            /// @}
+
+            /// @{
+            /// \effects Calls \ref memory_stack::try_resize().
+            /// \returns Whether the node could be resized in place,
+            /// which is only possible for the topmost allocation.
+            static bool try_expand_node(allocator_type& state, void* node, std::size_t old_size,
+                                        std::size_t new_size, std::size_t) noexcept
+            {
+                if (!state.try_resize(node, old_size, new_size))
+                    return false;
+                state.on_allocate(new_size - old_size);
+                return true;
+            }
+
+            static bool try_shrink_node(allocator_type& state, void* node, std::size_t old_size,
+                                        std::size_t new_size, std::size_t) noexcept
+            {
+                if (!state.try_resize(node, old_size, new_size))
+                    return false;
+                state.on_deallocate(old_size - new_size);
+                return true;
+            }
             /// @}
 
+            /// \effects Resizes the topmost array in place, otherwise allocates a new one and copies.
+            /// \returns The reallocated array.
+            static void* reallocate_array(allocator_type& state, void* array, std::size_t old_count,
+                                          std::size_t new_count, std::size_t size,
+                                          std::size_t alignment)
+            {
+                return detail::reallocate_array_copy<allocator_traits>(state, array, old_count,
+                                                                       new_count, size, alignment);
+            }
+
+            /// \effects Allocates an array and expands it in place up to the next multiple of the maximum alignment if possible,
+            /// that memory would be lost to the alignment of the next allocation anyway.
+            /// \returns The array together with its actual size, a multiple of \c size.
+            static memory_block allocate_at_least(allocator_type& state, std::size_t count,
+                                                  std::size_t size, std::size_t alignment)
+            {
+                return detail::allocate_array_at_least<allocator_traits>(state, count, size,
+                                                                         alignment);
+            }
+
             /// @{
             /// \returns The maximum size which is \ref memory_stack::next_capacity().
             static std::size_t max_node_size(const allocator_type& state) noexcept
@@ -462,6 +550,17 @@ namespace foonathan
                 return state.try_allocate(count * size, alignment);
             }
 
+            /// \effects Calls \ref memory_stack::try_allocate() for each node.
+            /// \returns Whether all nodes could be allocated.
+            static bool try_allocate_nodes(allocator_type& state, std::size_t count,
+                                           std::size_t size, std::size_t alignment,
+                                           void** nodes) noexcept
+            {
+                return detail::try_allocate_nodes_each<composable_allocator_traits>(state, count,
+                                                                                    size, alignment,
+                                                                                    nodes);
+            }
+
             /// @{
             /// \effects Does nothing.
             /// \returns Whether the memory will be deallocated by \ref memory_stack::unwind().
@@ -476,7 +575,41 @@ namespace foonathan
             {
                 return try_deallocate_node(state, ptr, count * size, alignment);
             }
+
+            static bool try_deallocate_nodes(allocator_type& state, void** nodes, std::size_t count,
+                                             std::size_t, std::size_t) noexcept
+            {
+                return count == 0u || state.arena_.owns(nodes[0]);
+            }
+            /// @}
+
+            /// @{
+            /// \effects Calls \ref memory_stack::try_resize().
+            /// \returns Whether the node could be resized in place,
+            /// which is only possible for the topmost allocation.
+            static bool try_expand_node(allocator_type& state, void* node, std::size_t old_size,
+                                        std::size_t new_size, std::size_t) noexcept
+            {
+                return state.try_resize(node, old_size, new_size);
+            }
+
+            static bool try_shrink_node(allocator_type& state, void* node, std::size_t old_size,
+                                        std::size_t new_size, std::size_t) noexcept
+            {
+                return state.try_resize(node, old_size, new_size);
+            }
             /// @}
+
+            /// \effects Resizes the topmost array in place, otherwise allocates a new one and copies.
+            /// \returns The reallocated array or `nullptr` if it was not allocated by the stack
+            /// or there was not enough memory.
+            static void* try_reallocate_array(allocator_type& state, void* array,
+                                              std::size_t old_count, std::size_t new_count,
+                                              std::size_t size, std::size_t alignment) noexcept
+            {
+                return detail::try_reallocate_array_copy<composable_allocator_traits>(
+                    state, array, old_count, new_count, size, alignment);
+            }
         };
 
 #if FOONATHAN_MEMORY_EXTERN_TEMPLATE
@@ -30,6 +30,9 @@ namespace foonathan
 
                 static void deallocate(void* ptr, std::size_t size, std::size_t) noexcept;
 
+                static void* reallocate(void* ptr, std::size_t old_size, std::size_t new_size,
+                                        std::size_t) noexcept;
+
                 static std::size_t max_node_size() noexcept;
             };
 
@@ -0,0 +1,110 @@
+// Copyright (C) 2015-2025 Jonathan Müller and foonathan/memory contributors
+// SPDX-License-Identifier: Zlib
+
+#ifndef FOONATHAN_MEMORY_NUMA_BLOCK_ALLOCATOR_HPP_INCLUDED
+#define FOONATHAN_MEMORY_NUMA_BLOCK_ALLOCATOR_HPP_INCLUDED
+
+/// \file
+/// Class \ref foonathan::memory::numa_block_allocator and NUMA query functions.
+
+#include <cstddef>
+
+#include "config.hpp"
+#include "memory_arena.hpp"
+
+namespace foonathan
+{
+    namespace memory
+    {
+        /// \returns The number of NUMA nodes memory can be allocated on,
+        /// i.e. one more than the highest node the calling thread may use.
+        /// It is \c 1 if the system does not support NUMA.
+        /// \ingroup allocator
+        std::size_t get_numa_node_count() noexcept;
+
+        /// \returns The NUMA node of the CPU the calling thread is currently running on,
+        /// or \c 0 if the system does not support NUMA.
+        /// \ingroup allocator
+        std::size_t get_current_numa_node() noexcept;
+
+        /// \returns The NUMA node the page containing \c memory is located on,
+        /// or <tt>std::size_t(-1)</tt> if it is unknown.
+        /// \requires The page must have been accessed before.
+        /// \ingroup allocator
+        std::size_t get_numa_node_of(void* memory) noexcept;
+
+        /// Specifies on which NUMA nodes the memory blocks of a \ref numa_block_allocator are placed.
+        /// \ingroup allocator
+        enum class numa_policy
+        {
+            /// The memory is bound to the node given in the constructor.
+            bind,
+
+            /// The memory is bound to the node of the thread that allocates the block.
+            local,
+
+            /// The pages of the memory are interleaved over all nodes.
+            /// This is useful for memory shared by threads on different nodes that is mostly read.
+            interleave,
+        };
+
+        /// A \concept{concept_blockallocator,BlockAllocator} that places its memory blocks on given NUMA nodes.
+        /// It allocates the blocks as virtual memory and sets the memory policy via the \c mbind() system call,
+        /// without depending on \c libnuma.
+        /// If the system does not support NUMA or the policy cannot be set, the blocks are allocated normally.
+        /// The block size is rounded up to a multiple of the \ref get_virtual_memory_page_size and grows by a factor of \c 2 after each allocation.
+        /// \ingroup allocator
+        class numa_block_allocator
+        {
+        public:
+            /// \effects Creates it by giving it the initial block size, the policy and the node for \ref numa_policy::bind.
+            /// \requires \c block_size must be greater than 0 and \c node must be less than \ref get_numa_node_count().
+            explicit numa_block_allocator(std::size_t block_size,
+                                          numa_policy policy = numa_policy::local,
+                                          std::size_t node   = 0u) noexcept;
+
+            /// \effects Allocates a new memory block on the node(s) specified by the policy,
+            /// and increases the block size for the next allocation.
+            /// \returns The new \ref memory_block.
+            /// \throws \ref out_of_memory if the memory could not be allocated.
+            memory_block allocate_block();
+
+            /// \effects Deallocates a previously allocated memory block.
+            /// This does not decrease the block size.
+            /// \requires \c block must be previously returned by a call to \ref allocate_block().
+            void deallocate_block(memory_block block) noexcept;
+
+            /// \returns The size of the memory block returned by the next call to \ref allocate_block().
+            std::size_t next_block_size() const noexcept
+            {
+                return block_size_;
+            }
+
+            /// \returns The policy.
+            numa_policy policy() const noexcept
+            {
+                return policy_;
+            }
+
+            /// \returns The node for \ref numa_policy::bind.
+            std::size_t node() const noexcept
+            {
+                return node_;
+            }
+
+        private:
+            allocator_info info() noexcept;
+
+            std::size_t block_size_;
+            numa_policy policy_;
+            std::size_t node_;
+        };
+
+#if FOONATHAN_MEMORY_EXTERN_TEMPLATE
+        extern template class memory_arena<numa_block_allocator, true>;
+        extern template class memory_arena<numa_block_allocator, false>;
+#endif
+    } // namespace memory
+} // namespace foonathan
+
+#endif // FOONATHAN_MEMORY_NUMA_BLOCK_ALLOCATOR_HPP_INCLUDED
@@ -0,0 +1,547 @@
+// Copyright (C) 2015-2025 Jonathan Müller and foonathan/memory contributors
+// SPDX-License-Identifier: Zlib
+
+#ifndef FOONATHAN_MEMORY_STATIC_POOL_COLLECTION_HPP_INCLUDED
+#define FOONATHAN_MEMORY_STATIC_POOL_COLLECTION_HPP_INCLUDED
+
+/// \file
+/// Class \ref foonathan::memory::static_pool_collection and related classes.
+
+#include <type_traits>
+
+#include "detail/align.hpp"
+#include "detail/assert.hpp"
+#include "detail/free_list_array.hpp"
+#include "detail/free_list_stack.hpp"
+#include "config.hpp"
+#include "debugging.hpp"
+#include "error.hpp"
+#include "memory_arena.hpp"
+#include "memory_pool_type.hpp"
+
+namespace foonathan
+{
+    namespace memory
+    {
+        namespace detail
+        {
+            struct static_pool_collection_leak_handler
+            {
+                void operator()(std::ptrdiff_t amount);
+            };
+        } // namespace detail
+
+        /// A stateful \concept{concept_rawallocator,RawAllocator} that behaves as a collection of multiple \ref memory_pool objects,
+        /// one for each of the node sizes given as template parameters, e.g. <tt>static_pool_collection<node_pool, default_allocator, 16, 32, 64, 96, 128></tt>.
+        /// It is similar to a \ref memory_pool_collection using \ref static_buckets,
+        /// but as the number of free lists is known at compile-time, they are stored directly in the object and not in the first memory block.
+        /// Allocating a node of given size will use the free list of the smallest size it fits into,
+        /// finding it is a single load from a table generated at compile-time.
+        /// The member functions taking the size as template argument like \ref allocate_node() select the free list at compile-time.
+        /// \requires The sizes must be non-zero and strictly ascending, see \ref static_buckets.
+        /// \ingroup allocator
+        template <class PoolType, class BlockOrRawAllocator, std::size_t... Sizes>
+        class static_pool_collection
+        : FOONATHAN_EBO(detail::default_leak_checker<detail::static_pool_collection_leak_handler>)
+        {
+            using access_policy = detail::static_access_policy<Sizes...>;
+            using free_list     = typename PoolType::type;
+            using stack_type    = detail::free_list_stack<free_list>;
+            using leak_checker =
+                detail::default_leak_checker<detail::static_pool_collection_leak_handler>;
+
+            static constexpr std::size_t no_pools      = sizeof...(Sizes);
+            static constexpr std::size_t max_node_size_ = detail::static_buckets_max(Sizes...);
+
+            template <std::size_t Size>
+            struct pool_index
+            : std::integral_constant<std::size_t, detail::static_buckets_index(Size, Sizes...)>
+            {
+                static_assert(Size != 0u, "node size must not be zero");
+                static_assert(Size <= max_node_size_, "node size too big");
+            };
+
+        public:
+            using allocator_type = make_block_allocator_t<BlockOrRawAllocator>;
+            using pool_type      = PoolType;
+
+            /// \effects Creates it by giving it the size of the initial memory block
+            /// and other constructor arguments for the \concept{concept_blockallocator,BlockAllocator}.
+            /// All free lists are initially empty.
+            /// \requires \c block_size must be non-zero and bigger than the number of pools times the largest node size.
+            template <typename... Args>
+            explicit static_pool_collection(std::size_t block_size, Args&&... args)
+            : arena_(block_size, detail::forward<Args>(args)...),
+              stack_(arena_.allocate_block()),
+              pools_{{Sizes}...}
+            {
+                detail::check_allocation_size<bad_node_size>(max_node_size_, def_capacity(),
+                                                             info());
+            }
+
+            /// \effects Destroys the \ref static_pool_collection by returning all memory blocks,
+            /// regardless of properly deallocated back to the \concept{concept_blockallocator,BlockAllocator}.
+            ~static_pool_collection() noexcept = default;
+
+            /// @{
+            /// \effects Moving a \ref static_pool_collection object transfers ownership over the free lists,
+            /// i.e. the moved from pool is completely empty and the new one has all its memory.
+            /// That means that it is not allowed to call \ref deallocate_node() on a moved-from allocator
+            /// even when passing it memory that was previously allocated by this object.
+            static_pool_collection(static_pool_collection&& other) noexcept
+            : leak_checker(detail::move(other)),
+              arena_(detail::move(other.arena_)),
+              stack_(detail::move(other.stack_)),
+              pools_{{Sizes}...}
+            {
+                for (std::size_t i = 0u; i != no_pools; ++i)
+                    pools_[i] = detail::move(other.pools_[i]);
+            }
+
+            static_pool_collection& operator=(static_pool_collection&& other) noexcept
+            {
+                leak_checker::operator=(detail::move(other));
+                arena_ = detail::move(other.arena_);
+                stack_ = detail::move(other.stack_);
+                for (std::size_t i = 0u; i != no_pools; ++i)
+                    pools_[i] = detail::move(other.pools_[i]);
+                return *this;
+            }
+            /// @}
+
+            /// \effects Allocates a \concept{concept_node,node} of given size.
+            /// It uses the free list of the smallest size the node fits into.
+            /// If it is empty, it will use an implementation defined amount of memory from the arena
+            /// and inserts it in it.
+            /// If the arena is empty too, it will request a new memory block from the \concept{concept_blockallocator,BlockAllocator}
+            /// of size \ref next_capacity() and puts part of it onto this free list.
+            /// Then it removes a node from it.
+            /// \returns A \concept{concept_node,node} of given size suitable aligned,
+            /// i.e. suitable for any type where <tt>sizeof(T) < node_size</tt>.
+            /// \throws Anything thrown by the \concept{concept_blockallocator,BlockAllocator} if a growth is needed or a \ref bad_node_size exception if the node size is too big.
+            void* allocate_node(std::size_t node_size)
+            {
+                detail::check_allocation_size<
+                    bad_node_size>(node_size, [&] { return max_node_size(); }, info());
+                return allocate_from(pools_[access_policy::index_from_size(node_size)]);
+            }
+
+            /// \effects Same as \ref allocate_node(std::size_t) with \c Size as node size,
+            /// but the free list is selected at compile-time.
+            /// \returns A \concept{concept_node,node} of size \c Size suitable aligned.
+            /// \throws Anything thrown by the \concept{concept_blockallocator,BlockAllocator} if a growth is needed.
+            /// \requires \c Size must not be bigger than \ref max_node_size(), this is checked at compile-time.
+            template <std::size_t Size>
+            void* allocate_node()
+            {
+                return allocate_from(pools_[pool_index<Size>::value]);
+            }
+
+            /// \effects Allocates a \concept{concept_node,node} of given size.
+            /// It is similar to \ref allocate_node() but will return `nullptr` on any failure,
+            /// instead of growing the arena and possibly throwing.
+            /// \returns A \concept{concept_node,node} of given size suitable aligned
+            /// or `nullptr` in case of failure.
+            void* try_allocate_node(std::size_t node_size) noexcept
+            {
+                if (node_size > max_node_size())
+                    return nullptr;
+                auto& pool = pools_[access_policy::index_from_size(node_size)];
+                if (pool.empty())
+                    try_reserve_memory(pool, def_capacity());
+                return pool.empty() ? nullptr : pool.allocate();
+            }
+
+            /// \effects Allocates an \concept{concept_array,array} of nodes by searching for \c n continuous nodes on the appropriate free list and removing them.
+            /// Depending on the \c PoolType this can be a slow operation or not allowed at all.
+            /// This can sometimes lead to a growth on the free list, even if technically there is enough continuous memory on the free list.
+            /// Otherwise has the same behavior as \ref allocate_node().
+            /// \returns An array of \c n nodes of size \c node_size suitable aligned.
+            /// \throws Anything thrown by the used \concept{concept_blockallocator,BlockAllocator}'s allocation function if a growth is needed,
+            /// or a \ref bad_allocation_size exception.
+            /// \requires \c count must be valid \concept{concept_array,array count} and
+            /// \c node_size must be valid \concept{concept_node,node size}.
+            void* allocate_array(std::size_t count, std::size_t node_size)
+            {
+                detail::check_allocation_size<
+                    bad_node_size>(node_size, [&] { return max_node_size(); }, info());
+
+                auto& pool = pools_[access_policy::index_from_size(node_size)];
+
+                // for pools without array allocation support, allocate() will always return nullptr
+                auto mem = pool.empty() ? nullptr : pool.allocate(count * node_size);
+                if (!mem)
+                {
+                    reserve_memory(pool, def_capacity());
+                    mem = pool.allocate(count * node_size);
+                    if (!mem)
+                    {
+                        // reserve more then the default capacity if that didn't work either
+                        detail::check_allocation_size<bad_array_size>(
+                            count * node_size,
+                            [&] { return next_capacity() - pool.alignment() + 1; }, info());
+
+                        reserve_memory(pool, free_list::min_block_size(pool.node_size(), count));
+                        mem = pool.allocate(count * node_size);
+                        FOONATHAN_MEMORY_ASSERT(mem);
+                    }
+                }
+
+                return mem;
+            }
+
+            /// \effects Allocates a \concept{concept_array,array} of given size.
+            /// It is similar to \ref allocate_array() but will return `nullptr` on any failure,
+            /// instead of growing the arena and possibly throwing.
+            /// \returns A \concept{concept_array,array} of given size suitable aligned
+            /// or `nullptr` in case of failure.
+            void* try_allocate_array(std::size_t count, std::size_t node_size) noexcept
+            {
+                if (!pool_type::value || node_size > max_node_size())
+                    return nullptr;
+                auto& pool = pools_[access_policy::index_from_size(node_size)];
+                if (pool.empty())
+                    try_reserve_memory(pool, def_capacity());
+                return pool.empty() ? nullptr : pool.allocate(count * node_size);
+            }
+
+            /// \effects Deallocates a \concept{concept_node,node} by putting it back onto the appropriate free list.
+            /// \requires \c ptr must be a result from a previous call to \ref allocate_node() with the same size on the same free list,
+            /// i.e. either this allocator object or a new object created by moving this to it.
+            void deallocate_node(void* ptr, std::size_t node_size) noexcept
+            {
+                pools_[access_policy::index_from_size(node_size)].deallocate(ptr);
+            }
+
+            /// \effects Same as \ref deallocate_node(void*, std::size_t) with \c Size as node size,
+            /// but the free list is selected at compile-time.
+            template <std::size_t Size>
+            void deallocate_node(void* ptr) noexcept
+            {
+                pools_[pool_index<Size>::value].deallocate(ptr);
+            }
+
+            /// \effects Deallocates a \concept{concept_node,node} similar to \ref deallocate_node().
+            /// But it checks if it can deallocate this memory.
+            /// \returns \c true if the node could be deallocated,
+            /// \c false otherwise.
+            bool try_deallocate_node(void* ptr, std::size_t node_size) noexcept
+            {
+                if (node_size > max_node_size() || !arena_.owns(ptr))
+                    return false;
+                deallocate_node(ptr, node_size);
+                return true;
+            }
+
+            /// \effects Deallocates an \concept{concept_array,array} by putting it back onto the free list.
+            /// \requires \c ptr must be a result from a previous call to \ref allocate_array() with the same sizes on the same free list,
+            /// i.e. either this allocator object or a new object created by moving this to it.
+            void deallocate_array(void* ptr, std::size_t count, std::size_t node_size) noexcept
+            {
+                pools_[access_policy::index_from_size(node_size)].deallocate(ptr,
+                                                                             count * node_size);
+            }
+
+            /// \effects Deallocates a \concept{concept_array,array} similar to \ref deallocate_array().
+            /// But it checks if it can deallocate this memory.
+            /// \returns \c true if the array could be deallocated,
+            /// \c false otherwise.
+            bool try_deallocate_array(void* ptr, std::size_t count, std::size_t node_size) noexcept
+            {
+                if (!pool_type::value || node_size > max_node_size() || !arena_.owns(ptr))
+                    return false;
+                deallocate_array(ptr, count, node_size);
+                return true;
+            }
+
+            /// \effects Inserts more memory on the free list for nodes of given size.
+            /// It will try to put \c capacity bytes from the arena onto the free list of the node size,
+            /// if the arena is empty, a new memory block is requested from the \concept{concept_blockallocator,BlockAllocator}
+            /// and it will be used.
+            /// \throws Anything thrown by the \concept{concept_blockallocator,BlockAllocator} if a growth is needed.
+            /// \requires \c node_size must be valid \concept{concept_node,node size} less than or equal to \ref max_node_size(),
+            /// \c capacity must be less than \ref next_capacity().
+            void reserve(std::size_t node_size, std::size_t capacity)
+            {
+                FOONATHAN_MEMORY_ASSERT_MSG(node_size <= max_node_size(), "node_size too big");
+                auto& pool = pools_[access_policy::index_from_size(node_size)];
+                reserve_memory(pool, capacity);
+            }
+
+            /// \returns The maximum node size for which is a free list,
+            /// i.e. the last of the \c Sizes.
+            std::size_t max_node_size() const noexcept
+            {
+                return max_node_size_;
+            }
+
+            /// \returns The amount of nodes available in the free list for nodes of given size.
+            /// This is the number of nodes that can be allocated without the free list requesting more memory from the arena.
+            /// \note Array allocations may lead to a growth even if the capacity_left is big enough.
+            std::size_t pool_capacity_left(std::size_t node_size) const noexcept
+            {
+                FOONATHAN_MEMORY_ASSERT_MSG(node_size <= max_node_size(), "node_size too big");
+                return pools_[access_policy::index_from_size(node_size)].capacity();
+            }
+
+            /// \returns The amount of memory available in the arena not inside the free lists.
+            /// This is the number of bytes that can be inserted into the free lists
+            /// without requesting more memory from the \concept{concept_blockallocator,BlockAllocator}.
+            /// \note Array allocations may lead to a growth even if the capacity is big enough.
+            std::size_t capacity_left() const noexcept
+            {
+                return stack_.capacity_left();
+            }
+
+            /// \returns The size of the next memory block after \ref capacity_left() arena grows.
+            /// This is the amount of memory that can be distributed in the pools.
+            std::size_t next_capacity() const noexcept
+            {
+                return arena_.next_block_size();
+            }
+
+            /// \returns A reference to the \concept{concept_blockallocator,BlockAllocator} used for managing the arena.
+            /// \requires It is undefined behavior to move this allocator out into another object.
+            allocator_type& get_allocator() noexcept
+            {
+                return arena_.get_allocator();
+            }
+
+        private:
+            allocator_info info() const noexcept
+            {
+                return {FOONATHAN_MEMORY_LOG_PREFIX "::static_pool_collection", this};
+            }
+
+            std::size_t def_capacity() const noexcept
+            {
+                return arena_.current_block().size / no_pools;
+            }
+
+            void* allocate_from(free_list& pool)
+            {
+                if (pool.empty())
+                    reserve_memory(pool, def_capacity());
+
+                auto mem = pool.allocate();
+                FOONATHAN_MEMORY_ASSERT(mem);
+                return mem;
+            }
+
+            void try_reserve_memory(free_list& pool, std::size_t capacity) noexcept
+            {
+                stack_.try_reserve(pools_, pool, capacity);
+            }
+
+            void reserve_memory(free_list& pool, std::size_t capacity)
+            {
+                stack_.reserve(arena_, pools_, pool, capacity);
+            }
+
+            memory_arena<allocator_type, false> arena_;
+            stack_type                          stack_;
+            free_list                           pools_[sizeof...(Sizes)];
+
+            friend allocator_traits<static_pool_collection>;
+        };
+
+        template <class PoolType, class BlockOrRawAllocator, std::size_t... Sizes>
+        constexpr std::size_t
+            static_pool_collection<PoolType, BlockOrRawAllocator, Sizes...>::no_pools;
+
+        template <class PoolType, class BlockOrRawAllocator, std::size_t... Sizes>
+        constexpr std::size_t
+            static_pool_collection<PoolType, BlockOrRawAllocator, Sizes...>::max_node_size_;
+
+        /// Specialization of the \ref allocator_traits for \ref static_pool_collection classes.
+        /// \note It is not allowed to mix calls through the specialization and through the member functions,
+        /// i.e. \ref static_pool_collection::allocate_node() and this \c allocate_node().
+        /// \ingroup allocator
+        template <class Pool, class RawAllocator, std::size_t... Sizes>
+        class allocator_traits<static_pool_collection<Pool, RawAllocator, Sizes...>>
+        {
+        public:
+            using allocator_type = static_pool_collection<Pool, RawAllocator, Sizes...>;
+            using is_stateful    = std::true_type;
+
+            /// \returns The result of \ref static_pool_collection::allocate_node().
+            /// \throws Anything thrown by the pool allocation function
+            /// or a \ref bad_allocation_size exception if \c size / \c alignment exceeds \ref max_node_size() / the suitable alignment value,
+            /// i.e. the node is over-aligned.
+            static void* allocate_node(allocator_type& state, std::size_t size,
+                                       std::size_t alignment)
+            {
+                // node already checked
+                detail::check_allocation_size<bad_alignment>(
+                    alignment, [&] { return detail::alignment_for(size); }, state.info());
+                auto mem = state.allocate_node(size);
+                state.on_allocate(size);
+                return mem;
+            }
+
+            /// \returns The result of \ref static_pool_collection::allocate_array().
+            /// \throws Anything thrown by the pool allocation function or a \ref bad_allocation_size exception.
+            /// \requires The \ref static_pool_collection has to support array allocations.
+            static void* allocate_array(allocator_type& state, std::size_t count, std::size_t size,
+                                        std::size_t alignment)
+            {
+                // node and array already checked
+                detail::check_allocation_size<bad_alignment>(
+                    alignment, [&] { return detail::alignment_for(size); }, state.info());
+                auto mem = state.allocate_array(count, size);
+                state.on_allocate(count * size);
+                return mem;
+            }
+
+            /// \effects Calls \ref static_pool_collection::deallocate_node().
+            static void deallocate_node(allocator_type& state, void* node, std::size_t size,
+                                        std::size_t) noexcept
+            {
+                state.deallocate_node(node, size);
+                state.on_deallocate(size);
+            }
+
+            /// \effects Calls \ref static_pool_collection::deallocate_array().
+            /// \requires The \ref static_pool_collection has to support array allocations.
+            static void deallocate_array(allocator_type& state, void* array, std::size_t count,
+                                         std::size_t size, std::size_t) noexcept
+            {
+                state.deallocate_array(array, count, size);
+                state.on_deallocate(count * size);
+            }
+
+            /// \returns The maximum size of each node which is \ref static_pool_collection::max_node_size().
+            static std::size_t max_node_size(const allocator_type& state) noexcept
+            {
+                return state.max_node_size();
+            }
+
+            /// \returns An upper bound on the maximum array size which is \ref static_pool_collection::next_capacity().
+            static std::size_t max_array_size(const allocator_type& state) noexcept
+            {
+                return state.next_capacity();
+            }
+
+            /// \returns Just \c alignof(std::max_align_t) since the actual maximum alignment depends on the node size,
+            /// the nodes must not be over-aligned.
+            static std::size_t max_alignment(const allocator_type&) noexcept
+            {
+                return detail::max_alignment;
+            }
+
+            /// @{
+            /// \returns `false`, the nodes of a pool cannot be resized in place.
+            static bool try_expand_node(allocator_type&, void*, std::size_t, std::size_t,
+                                        std::size_t) noexcept
+            {
+                return false;
+            }
+
+            static bool try_shrink_node(allocator_type&, void*, std::size_t, std::size_t,
+                                        std::size_t) noexcept
+            {
+                return false;
+            }
+            /// @}
+
+            /// \effects Allocates a new array, copies and deallocates the old one.
+            /// \returns The reallocated array.
+            static void* reallocate_array(allocator_type& state, void* array, std::size_t old_count,
+                                          std::size_t new_count, std::size_t size,
+                                          std::size_t alignment)
+            {
+                return detail::reallocate_array_copy<allocator_traits>(state, array, old_count,
+                                                                       new_count, size, alignment);
+            }
+
+            /// \effects Same as \ref allocate_array().
+            /// \returns The array together with its requested size.
+            static memory_block allocate_at_least(allocator_type& state, std::size_t count,
+                                                  std::size_t size, std::size_t alignment)
+            {
+                return {allocate_array(state, count, size, alignment), count * size};
+            }
+        };
+
+        /// Specialization of the \ref composable_allocator_traits for \ref static_pool_collection classes.
+        /// \ingroup allocator
+        template <class Pool, class RawAllocator, std::size_t... Sizes>
+        class composable_allocator_traits<static_pool_collection<Pool, RawAllocator, Sizes...>>
+        {
+            using traits = allocator_traits<static_pool_collection<Pool, RawAllocator, Sizes...>>;
+
+        public:
+            using allocator_type = static_pool_collection<Pool, RawAllocator, Sizes...>;
+
+            /// \returns The result of \ref static_pool_collection::try_allocate_node()
+            /// or `nullptr` if the allocation size was too big.
+            static void* try_allocate_node(allocator_type& state, std::size_t size,
+                                           std::size_t alignment) noexcept
+            {
+                if (alignment > traits::max_alignment(state))
+                    return nullptr;
+                return state.try_allocate_node(size);
+            }
+
+            /// \returns The result of \ref static_pool_collection::try_allocate_array()
+            /// or `nullptr` if the allocation size was too big.
+            static void* try_allocate_array(allocator_type& state, std::size_t count,
+                                            std::size_t size, std::size_t alignment) noexcept
+            {
+                if (count * size > traits::max_array_size(state)
+                    || alignment > traits::max_alignment(state))
+                    return nullptr;
+                return state.try_allocate_array(count, size);
+            }
+
+            /// \effects Just forwards to \ref static_pool_collection::try_deallocate_node().
+            /// \returns Whether the deallocation was successful.
+            static bool try_deallocate_node(allocator_type& state, void* node, std::size_t size,
+                                            std::size_t alignment) noexcept
+            {
+                if (alignment > traits::max_alignment(state))
+                    return false;
+                return state.try_deallocate_node(node, size);
+            }
+
+            /// \effects Forwards to \ref static_pool_collection::deallocate_array().
+            /// \returns Whether the deallocation was successful.
+            static bool try_deallocate_array(allocator_type& state, void* array, std::size_t count,
+                                             std::size_t size, std::size_t alignment) noexcept
+            {
+                if (count * size > traits::max_array_size(state)
+                    || alignment > traits::max_alignment(state))
+                    return false;
+                return state.try_deallocate_array(array, count, size);
+            }
+
+            /// @{
+            /// \returns `false`, the nodes of a pool cannot be resized in place.
+            static bool try_expand_node(allocator_type&, void*, std::size_t, std::size_t,
+                                        std::size_t) noexcept
+            {
+                return false;
+            }
+
+            static bool try_shrink_node(allocator_type&, void*, std::size_t, std::size_t,
+                                        std::size_t) noexcept
+            {
+                return false;
+            }
+            /// @}
+
+            /// \effects Allocates a new array, copies and deallocates the old one.
+            /// \returns The reallocated array or `nullptr` if it was not allocated by the pools
+            /// or there was not enough memory.
+            static void* try_reallocate_array(allocator_type& state, void* array,
+                                              std::size_t old_count, std::size_t new_count,
+                                              std::size_t size, std::size_t alignment) noexcept
+            {
+                return detail::try_reallocate_array_copy<composable_allocator_traits>(
+                    state, array, old_count, new_count, size, alignment);
+            }
+        };
+    } // namespace memory
+} // namespace foonathan
+
+#endif // FOONATHAN_MEMORY_STATIC_POOL_COLLECTION_HPP_INCLUDED
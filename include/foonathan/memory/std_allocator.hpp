@@ -108,6 +108,18 @@ namespace foonathan
 
             using allocator_type = typename alloc_reference::allocator_type;
 
+#if defined(__cpp_lib_allocate_at_least)
+            using allocation_result = std::allocation_result<pointer, size_type>;
+#else
+            /// The result of \ref allocate_at_least(),
+            /// it is \c std::allocation_result if the standard library provides it.
+            struct allocation_result
+            {
+                pointer   ptr;
+                size_type count;
+            };
+#endif
+
             //=== constructor ===//
             /// \effects Default constructs it by storing a default constructed, stateless \c RawAllocator inside the reference.
             /// \requires The \c RawAllocator type is stateless, otherwise the body of this function will not compile.
@@ -196,6 +208,20 @@ namespace foonathan
                 return static_cast<pointer>(allocate_impl(is_any{}, n));
             }
 
+            /// \effects Allocates memory like \ref allocate(),
+            /// but arrays are allocated via <tt>allocator_traits::allocate_at_least(n, sizeof(T), alignof(T))</tt>,
+            /// so the memory the \c RawAllocator would hand out anyway can be used.
+            /// \returns A pointer to a memory block suitable for \c count objects of type \c T,
+            /// where \c count is at least \c n.
+            /// \throws Anything thrown by the \c RawAllocator.
+            /// \requires The memory must be deallocated with the returned \c count.
+            allocation_result allocate_at_least(size_type n)
+            {
+                if (n == 1)
+                    return {allocate(n), n};
+                return allocate_at_least_impl(is_any{}, n);
+            }
+
             /// \effects Deallcoates memory using the underlying \concept{concept_rawallocator,RawAllocator}.
             /// It will forward to the deallocation function in the same way as in \ref allocate().
             /// \requires The pointer must come from a previous call to \ref allocate() with the same \c n on this object or any copy of it.
@@ -259,6 +285,17 @@ namespace foonathan
                 get_allocator().deallocate_impl(ptr, n, sizeof(T), alignof(T));
             }
 
+            allocation_result allocate_at_least_impl(std::true_type, size_type n)
+            {
+                return {allocate(n), n};
+            }
+
+            allocation_result allocate_at_least_impl(std::false_type, size_type n)
+            {
+                auto block = alloc_reference::allocate_at_least(n, sizeof(T), alignof(T));
+                return {static_cast<pointer>(block.memory), block.size / sizeof(T)};
+            }
+
             // alloc_reference: decide between node/array
             void* allocate_impl(std::false_type, size_type n)
             {
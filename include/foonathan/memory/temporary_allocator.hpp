@@ -236,6 +236,12 @@ namespace foonathan
             /// \requires `is_active()` must return `true`.
             void* allocate(std::size_t size, std::size_t alignment);
 
+            /// \effects Changes the size of the last allocation in place by forwarding to the internal \ref memory_stack.
+            /// \returns Whether or not the size could be changed,
+            /// this is only possible for the last allocation of this allocator object.
+            /// \requires `is_active()` must return `true`.
+            bool try_resize(void* memory, std::size_t old_size, std::size_t new_size) noexcept;
+
             /// \returns Whether or not the allocator object is active.
             /// \note The active allocator object is the last object created for one stack.
             /// Moving changes the active allocator.
@@ -294,6 +300,13 @@ namespace foonathan
                 return allocate_node(state, count * size, alignment);
             }
 
+            /// \effects Calls \ref temporary_allocator::allocate() for each node.
+            static void allocate_nodes(allocator_type& state, std::size_t count, std::size_t size,
+                                       std::size_t alignment, void** nodes)
+            {
+                detail::allocate_nodes_each<allocator_traits>(state, count, size, alignment, nodes);
+            }
+
             /// @{
             /// \effects Does nothing besides bookmarking for leak checking, if that is enabled.
             /// Actual deallocation will be done automatically if the allocator object goes out of scope.
@@ -306,8 +319,49 @@ namespace foonathan
                                          std::size_t) noexcept
             {
             }
+
+            static void deallocate_nodes(const allocator_type&, void**, std::size_t, std::size_t,
+                                         std::size_t) noexcept
+            {
+            }
             /// @}
 
+            /// @{
+            /// \effects Calls \ref temporary_allocator::try_resize().
+            /// \returns Whether the node could be resized in place,
+            /// which is only possible for the last allocation.
+            static bool try_expand_node(allocator_type& state, void* node, std::size_t old_size,
+                                        std::size_t new_size, std::size_t) noexcept
+            {
+                return state.try_resize(node, old_size, new_size);
+            }
+
+            static bool try_shrink_node(allocator_type& state, void* node, std::size_t old_size,
+                                        std::size_t new_size, std::size_t) noexcept
+            {
+                return state.try_resize(node, old_size, new_size);
+            }
+            /// @}
+
+            /// \effects Resizes the last array in place, otherwise allocates a new one and copies.
+            /// \returns The reallocated array.
+            static void* reallocate_array(allocator_type& state, void* array, std::size_t old_count,
+                                          std::size_t new_count, std::size_t size,
+                                          std::size_t alignment)
+            {
+                return detail::reallocate_array_copy<allocator_traits>(state, array, old_count,
+                                                                       new_count, size, alignment);
+            }
+
+            /// \effects Allocates an array and expands it in place up to the next multiple of the maximum alignment if possible.
+            /// \returns The array together with its actual size, a multiple of \c size.
+            static memory_block allocate_at_least(allocator_type& state, std::size_t count,
+                                                  std::size_t size, std::size_t alignment)
+            {
+                return detail::allocate_array_at_least<allocator_traits>(state, count, size,
+                                                                         alignment);
+            }
+
             /// @{
             /// \returns The maximum size which is \ref memory_stack::next_capacity() of the internal stack.
             static std::size_t max_node_size(const allocator_type& state) noexcept
@@ -0,0 +1,533 @@
+// Copyright (C) 2015-2025 Jonathan Müller and foonathan/memory contributors
+// SPDX-License-Identifier: Zlib
+
+#ifndef FOONATHAN_MEMORY_THREAD_CACHED_POOL_HPP_INCLUDED
+#define FOONATHAN_MEMORY_THREAD_CACHED_POOL_HPP_INCLUDED
+
+/// \file
+/// Class \ref foonathan::memory::thread_cached_pool.
+/// \note Only available on a hosted implementation.
+
+#include "config.hpp"
+#if !FOONATHAN_HOSTED_IMPLEMENTATION
+#error "This header is only available for a hosted implementation."
+#endif
+
+#include <atomic>
+#include <mutex>
+#include <new>
+
+#include "detail/align.hpp"
+#include "detail/assert.hpp"
+#include "detail/utility.hpp"
+#include "allocator_traits.hpp"
+#include "default_allocator.hpp"
+#include "error.hpp"
+#include "memory_pool.hpp"
+#include "memory_pool_collection.hpp"
+#include "threading.hpp"
+
+namespace foonathan
+{
+    namespace memory
+    {
+        namespace detail
+        {
+            class thread_cache_owner;
+
+            // cached nodes of one size class
+            // nodes is allocated lazily and has room for bin_capacity pointers
+            struct thread_cache_bin
+            {
+                void**      nodes;
+                std::size_t size;
+            };
+
+            // the cache of a single thread for a single thread_cache_owner
+            // it is linked into a list of the thread and a list of the owner
+            struct thread_cache
+            {
+                std::atomic<thread_cache_owner*> owner; // nullptr if owner was destroyed
+                thread_cache*                    next_in_thread;
+                thread_cache *                   prev_in_owner, *next_in_owner;
+                thread_cache_bin*                bins;
+                std::size_t                      no_bins, bin_capacity;
+            };
+
+            // shared state of a thread_cached_pool
+            // manages the caches of all threads using it
+            class thread_cache_owner
+            {
+            public:
+                thread_cache_owner(const thread_cache_owner&) = delete;
+                thread_cache_owner& operator=(const thread_cache_owner&) = delete;
+
+                // returns the cache of the calling thread or nullptr if there is none
+                thread_cache* get_thread_cache() noexcept;
+
+                // creates the cache of the calling thread
+                // returns nullptr on failure, the caller must fallback to uncached operations
+                thread_cache* create_thread_cache(std::size_t no_bins,
+                                                  std::size_t bin_capacity) noexcept;
+
+                // allocates the storage for the nodes of a bin, returns false on failure
+                static bool reserve_bin(const thread_cache& cache, thread_cache_bin& bin) noexcept;
+
+            protected:
+                thread_cache_owner() noexcept : caches_(nullptr) {}
+                ~thread_cache_owner() noexcept;
+
+                // detaches all caches, nodes still cached by other threads are lost
+                // must be called before the pool is destroyed
+                void orphan_caches() noexcept;
+
+                // must return all nodes in the cache to the pool, called on thread exit
+                virtual void release(thread_cache& cache) noexcept = 0;
+
+            private:
+                thread_cache* caches_;
+
+                friend struct thread_cache_list;
+            };
+
+            // maps node requests of a pool to the bins of a thread_cache
+            // all functions except the index/check ones are called with the lock held
+            template <class Pool>
+            struct thread_cache_pool_traits;
+
+            template <typename PoolType, class BlockOrRawAllocator>
+            struct thread_cache_pool_traits<memory_pool<PoolType, BlockOrRawAllocator>>
+            {
+                using pool = memory_pool<PoolType, BlockOrRawAllocator>;
+
+                static std::size_t no_bins(const pool&) noexcept
+                {
+                    return 1u;
+                }
+
+                static std::size_t bin_index(const pool&, std::size_t) noexcept
+                {
+                    return 0u;
+                }
+
+                static std::size_t checked_bin_index(const pool& p, std::size_t size,
+                                                     std::size_t          alignment,
+                                                     const allocator_info& info)
+                {
+                    check_allocation_size<bad_node_size>(size, p.node_size(), info);
+                    check_allocation_size<bad_alignment>(
+                        alignment, [&] { return allocator_traits<pool>::max_alignment(p); },
+                        info);
+                    return 0u;
+                }
+
+                static void* allocate(pool& p, std::size_t)
+                {
+                    return p.allocate_node();
+                }
+
+                static void* try_allocate(pool& p, std::size_t) noexcept
+                {
+                    return p.try_allocate_node();
+                }
+
+                static void deallocate(pool& p, std::size_t, void* node) noexcept
+                {
+                    p.deallocate_node(node);
+                }
+
+                static bool try_allocate_nodes(pool& p, std::size_t, std::size_t count,
+                                               void** nodes) noexcept
+                {
+                    return p.try_allocate_nodes(count, nodes);
+                }
+
+                static void deallocate_nodes(pool& p, std::size_t, void** nodes,
+                                             std::size_t count) noexcept
+                {
+                    p.deallocate_nodes(nodes, count);
+                }
+            };
+
+            template <class PoolType, class BucketDistribution, class BlockOrRawAllocator>
+            struct thread_cache_pool_traits<
+                memory_pool_collection<PoolType, BucketDistribution, BlockOrRawAllocator>>
+            {
+                using pool = memory_pool_collection<PoolType, BucketDistribution, BlockOrRawAllocator>;
+                using access_policy = typename BucketDistribution::type;
+
+                static std::size_t no_bins(const pool& p) noexcept
+                {
+                    return access_policy::index_from_size(p.max_node_size()) + 1u;
+                }
+
+                static std::size_t bin_index(const pool&, std::size_t size) noexcept
+                {
+                    return access_policy::index_from_size(size);
+                }
+
+                static std::size_t checked_bin_index(const pool& p, std::size_t size,
+                                                     std::size_t          alignment,
+                                                     const allocator_info& info)
+                {
+                    check_allocation_size<bad_node_size>(size, p.max_node_size(), info);
+                    check_allocation_size<bad_alignment>(
+                        alignment, [&] { return alignment_for(size); }, info);
+                    return bin_index(p, size);
+                }
+
+                static void* allocate(pool& p, std::size_t index)
+                {
+                    return p.allocate_node(access_policy::size_from_index(index));
+                }
+
+                static void* try_allocate(pool& p, std::size_t index) noexcept
+                {
+                    return p.try_allocate_node(access_policy::size_from_index(index));
+                }
+
+                static void deallocate(pool& p, std::size_t index, void* node) noexcept
+                {
+                    p.deallocate_node(node, access_policy::size_from_index(index));
+                }
+
+                static bool try_allocate_nodes(pool& p, std::size_t index, std::size_t count,
+                                               void** nodes) noexcept
+                {
+                    return p.try_allocate_nodes(count, access_policy::size_from_index(index),
+                                                nodes);
+                }
+
+                static void deallocate_nodes(pool& p, std::size_t index, void** nodes,
+                                             std::size_t count) noexcept
+                {
+                    p.deallocate_nodes(nodes, count, access_policy::size_from_index(index));
+                }
+            };
+        } // namespace detail
+
+        /// A thread safe \concept{concept_rawallocator,RawAllocator} that puts a per-thread cache in front of a \ref memory_pool
+        /// or \ref memory_pool_collection.
+        /// Each thread keeps a bounded stack of free \concept{concept_node,nodes} for every node size of the pool.
+        /// Allocation and deallocation only work on that stack and do not need to lock the \c Mutex.
+        /// Only if the stack of the calling thread is empty or full,
+        /// nodes are moved between it and the shared pool in a batch while holding the lock once.
+        /// The caches of a thread are given back to the pool when the thread exits.<br>
+        /// An empty cache is refilled by up to \ref low_watermark() nodes,
+        /// a cache holding \ref high_watermark() nodes flushes all but \ref low_watermark() nodes on the next deallocation.
+        /// Nodes can be deallocated by a different thread than the one that allocated them,
+        /// they are then cached by the deallocating thread.
+        /// \note Nodes are only returned to the pool when the cache is flushed,
+        /// so the debug checks of the pool for invalid or double deallocations are delayed until then.
+        /// \ingroup allocator
+        template <class Pool, class Mutex = std::mutex>
+        class thread_cached_pool
+        {
+            using pool_traits = detail::thread_cache_pool_traits<Pool>;
+
+            class state : public detail::thread_cache_owner
+            {
+            public:
+                state(Pool&& p, std::size_t high, std::size_t low)
+                : pool(detail::move(p)), high_watermark(high), low_watermark(low)
+                {
+                }
+
+                ~state() noexcept
+                {
+                    orphan_caches();
+                }
+
+                void flush(detail::thread_cache_bin& bin, std::size_t index,
+                           std::size_t keep) noexcept
+                {
+                    FOONATHAN_MEMORY_ASSERT(keep <= bin.size);
+                    auto no_flushed = bin.size - keep;
+                    {
+                        std::lock_guard<Mutex> lock(mutex);
+                        // flush the oldest nodes, keep the recently used ones
+                        pool_traits::deallocate_nodes(pool, index, bin.nodes, no_flushed);
+                    }
+                    for (std::size_t i = 0u; i != keep; ++i)
+                        bin.nodes[i] = bin.nodes[no_flushed + i];
+                    bin.size = keep;
+                }
+
+                void release(detail::thread_cache& cache) noexcept override
+                {
+                    for (std::size_t i = 0u; i != cache.no_bins; ++i)
+                        if (cache.bins[i].size != 0u)
+                            flush(cache.bins[i], i, 0u);
+                }
+
+                Pool          pool;
+                mutable Mutex mutex;
+                std::size_t   high_watermark, low_watermark;
+            };
+
+        public:
+            using allocator_type = Pool;
+            using mutex          = Mutex;
+            using is_stateful    = std::true_type;
+
+            /// The default value for \ref high_watermark().
+            static constexpr std::size_t default_high_watermark = 64u;
+
+            /// The default value for \ref low_watermark().
+            static constexpr std::size_t default_low_watermark = 16u;
+
+            /// \effects Creates it by taking ownership of the given pool and setting the watermarks of the per-thread caches.
+            /// \requires <tt>0 < low_watermark < high_watermark</tt>.
+            /// \throws Anything thrown by the \ref default_allocator when allocating the shared state.
+            explicit thread_cached_pool(Pool&&      pool,
+                                        std::size_t high_watermark = default_high_watermark,
+                                        std::size_t low_watermark  = default_low_watermark)
+            : state_(nullptr)
+            {
+                FOONATHAN_MEMORY_ASSERT_MSG(0u < low_watermark && low_watermark < high_watermark,
+                                            "invalid watermarks");
+                auto alloc = default_allocator();
+                auto mem   = allocator_traits<default_allocator>::allocate_node(alloc, sizeof(state),
+                                                                              alignof(state));
+                state_     = ::new (mem) state(detail::move(pool), high_watermark, low_watermark);
+            }
+
+            /// \effects Destroys the pool and with it all memory it has allocated,
+            /// regardless of whether or not nodes are still cached by some thread.
+            /// \requires No other thread may use the allocator anymore.
+            ~thread_cached_pool() noexcept
+            {
+                if (state_)
+                {
+                    state_->~state();
+                    auto alloc = default_allocator();
+                    allocator_traits<default_allocator>::deallocate_node(alloc, state_,
+                                                                         sizeof(state),
+                                                                         alignof(state));
+                }
+            }
+
+            /// @{
+            /// \effects Moving transfers ownership over the pool and all the caches,
+            /// the moved-from object must not be used for allocations anymore.
+            thread_cached_pool(thread_cached_pool&& other) noexcept : state_(other.state_)
+            {
+                other.state_ = nullptr;
+            }
+
+            thread_cached_pool& operator=(thread_cached_pool&& other) noexcept
+            {
+                thread_cached_pool tmp(detail::move(other));
+                detail::adl_swap(state_, tmp.state_);
+                return *this;
+            }
+            /// @}
+
+            /// \effects Allocates a \concept{concept_node,node} from the cache of the calling thread.
+            /// If it is empty, it is refilled from the pool first which requires locking the \c Mutex.
+            /// \returns A node of the given size and alignment.
+            /// \throws Anything thrown by the allocation function of the pool if it needs to grow,
+            /// or \ref bad_allocation_size if \c size or \c alignment are not supported by the pool.
+            void* allocate_node(std::size_t size, std::size_t alignment)
+            {
+                FOONATHAN_MEMORY_ASSERT(state_);
+                auto index = pool_traits::checked_bin_index(state_->pool, size, alignment, info());
+                auto cache = get_cache();
+                if (!cache)
+                    return allocate_uncached(index);
+
+                auto& bin = cache->bins[index];
+                if (bin.size != 0u)
+                    return bin.nodes[--bin.size];
+                return refill(*cache, bin, index);
+            }
+
+            /// \effects Deallocates a \concept{concept_node,node} by putting it into the cache of the calling thread.
+            /// If the cache is full, all but \ref low_watermark() nodes are returned to the pool first
+            /// which requires locking the \c Mutex.
+            /// \requires \c node must come from a previous call to \ref allocate_node() with the same size and alignment.
+            void deallocate_node(void* node, std::size_t size, std::size_t) noexcept
+            {
+                FOONATHAN_MEMORY_ASSERT(state_);
+                auto index = pool_traits::bin_index(state_->pool, size);
+                auto cache = get_cache();
+                if (!cache)
+                {
+                    deallocate_uncached(index, node);
+                    return;
+                }
+
+                auto& bin = cache->bins[index];
+                if (bin.size == cache->bin_capacity)
+                    state_->flush(bin, index, state_->low_watermark);
+                else if (!bin.nodes && !detail::thread_cache_owner::reserve_bin(*cache, bin))
+                {
+                    deallocate_uncached(index, node);
+                    return;
+                }
+                bin.nodes[bin.size++] = node;
+            }
+
+            /// \effects Allocates an \concept{concept_array,array} directly from the pool while holding the lock,
+            /// arrays are not cached.
+            /// \returns The result of \c allocator_traits<Pool>::allocate_array().
+            /// \throws Anything thrown by the pool.
+            void* allocate_array(std::size_t count, std::size_t size, std::size_t alignment)
+            {
+                std::lock_guard<Mutex> lock(state_->mutex);
+                return allocator_traits<Pool>::allocate_array(state_->pool, count, size, alignment);
+            }
+
+            /// \effects Deallocates an \concept{concept_array,array} directly to the pool while holding the lock.
+            /// \requires \c array must come from a previous call to \ref allocate_array() with the same parameters.
+            void deallocate_array(void* array, std::size_t count, std::size_t size,
+                                  std::size_t alignment) noexcept
+            {
+                std::lock_guard<Mutex> lock(state_->mutex);
+                allocator_traits<Pool>::deallocate_array(state_->pool, array, count, size,
+                                                         alignment);
+            }
+
+            /// @{
+            /// \returns The corresponding value of the pool.
+            std::size_t max_node_size() const
+            {
+                std::lock_guard<Mutex> lock(state_->mutex);
+                return allocator_traits<Pool>::max_node_size(state_->pool);
+            }
+
+            std::size_t max_array_size() const
+            {
+                std::lock_guard<Mutex> lock(state_->mutex);
+                return allocator_traits<Pool>::max_array_size(state_->pool);
+            }
+
+            std::size_t max_alignment() const
+            {
+                std::lock_guard<Mutex> lock(state_->mutex);
+                return allocator_traits<Pool>::max_alignment(state_->pool);
+            }
+            /// @}
+
+            /// \effects Returns all nodes in the cache of the calling thread back to the pool.
+            void flush() noexcept
+            {
+                FOONATHAN_MEMORY_ASSERT(state_);
+                if (auto cache = state_->get_thread_cache())
+                    state_->release(*cache);
+            }
+
+            /// \returns The number of nodes currently in the cache of the calling thread.
+            std::size_t cached_nodes() const noexcept
+            {
+                FOONATHAN_MEMORY_ASSERT(state_);
+                auto        cache = state_->get_thread_cache();
+                std::size_t res   = 0u;
+                for (std::size_t i = 0u; cache && i != cache->no_bins; ++i)
+                    res += cache->bins[i].size;
+                return res;
+            }
+
+            /// \returns The maximum number of nodes of one size a thread caches.
+            std::size_t high_watermark() const noexcept
+            {
+                return state_->high_watermark;
+            }
+
+            /// \returns The number of nodes of one size a thread keeps after flushing
+            /// and the number of nodes it obtains when refilling an empty cache.
+            std::size_t low_watermark() const noexcept
+            {
+                return state_->low_watermark;
+            }
+
+            /// @{
+            /// \returns A proxy object that acts like a pointer to the pool.
+            /// As long as the proxy object lives and is not moved from, the \c Mutex will be kept locked.
+            /// \note Nodes in the caches of the threads are counted as allocated by the pool.
+            auto lock() noexcept -> FOONATHAN_IMPL_DEFINED(
+                decltype(detail::lock_allocator(std::declval<Pool&>(), std::declval<Mutex&>())))
+            {
+                return detail::lock_allocator(state_->pool, state_->mutex);
+            }
+
+            auto lock() const noexcept -> FOONATHAN_IMPL_DEFINED(decltype(
+                detail::lock_allocator(std::declval<const Pool&>(), std::declval<Mutex&>())))
+            {
+                return detail::lock_allocator(static_cast<const Pool&>(state_->pool),
+                                              state_->mutex);
+            }
+            /// @}
+
+        private:
+            allocator_info info() const noexcept
+            {
+                return {FOONATHAN_MEMORY_LOG_PREFIX "::thread_cached_pool", this};
+            }
+
+            detail::thread_cache* get_cache() const noexcept
+            {
+                auto cache = state_->get_thread_cache();
+                if (!cache)
+                {
+                    std::size_t no_bins;
+                    {
+                        std::lock_guard<Mutex> lock(state_->mutex);
+                        no_bins = pool_traits::no_bins(state_->pool);
+                    }
+                    cache = state_->create_thread_cache(no_bins, state_->high_watermark);
+                }
+                return cache;
+            }
+
+            void* refill(detail::thread_cache& cache, detail::thread_cache_bin& bin,
+                         std::size_t index)
+            {
+                FOONATHAN_MEMORY_ASSERT(bin.size == 0u);
+                if (!bin.nodes && !detail::thread_cache_owner::reserve_bin(cache, bin))
+                    return allocate_uncached(index);
+
+                std::lock_guard<Mutex> lock(state_->mutex);
+                if (pool_traits::try_allocate_nodes(state_->pool, index, state_->low_watermark,
+                                                    bin.nodes))
+                    bin.size = state_->low_watermark;
+                else
+                {
+                    // only the first allocation is allowed to grow the pool
+                    bin.nodes[bin.size++] = pool_traits::allocate(state_->pool, index);
+                    while (bin.size < state_->low_watermark)
+                    {
+                        auto cached = pool_traits::try_allocate(state_->pool, index);
+                        if (!cached)
+                            break;
+                        bin.nodes[bin.size++] = cached;
+                    }
+                }
+                return bin.nodes[--bin.size];
+            }
+
+            void* allocate_uncached(std::size_t index)
+            {
+                std::lock_guard<Mutex> lock(state_->mutex);
+                return pool_traits::allocate(state_->pool, index);
+            }
+
+            void deallocate_uncached(std::size_t index, void* node) noexcept
+            {
+                std::lock_guard<Mutex> lock(state_->mutex);
+                pool_traits::deallocate(state_->pool, index, node);
+            }
+
+            state* state_;
+        };
+
+        /// Specialization of \ref is_thread_safe_allocator to mark \ref thread_cached_pool as thread safe.
+        /// \ingroup allocator
+        template <class Pool, class Mutex>
+        struct is_thread_safe_allocator<thread_cached_pool<Pool, Mutex>> : std::true_type
+        {
+        };
+    } // namespace memory
+} // namespace foonathan
+
+#endif // FOONATHAN_MEMORY_THREAD_CACHED_POOL_HPP_INCLUDED
@@ -8,6 +8,7 @@
 /// Virtual memory api and (low-level) allocator classes.
 
 #include <cstddef>
+#include <cstdint>
 #include <type_traits>
 
 #include "detail/debug_helpers.hpp"
@@ -76,6 +77,61 @@ namespace foonathan
         /// \ingroup allocator
         void virtual_memory_decommit(void* memory, std::size_t no_pages) noexcept;
 
+        /// Returns the physical memory of commited pages to the system.
+        /// \effects Tells the system that the contents of the pages are no longer needed,
+        /// so it can reclaim the physical memory backing them.
+        /// Unlike \ref virtual_memory_decommit the pages stay usable,
+        /// but their contents are unspecified until they are written to again.
+        /// \requires \c memory must be aligned to the \ref virtual_memory_page_size
+        /// and the pages must be readable and writable.
+        /// \ingroup allocator
+        void virtual_memory_purge(void* memory, std::size_t no_pages) noexcept;
+
+        /// \returns The size of a huge page that is used by \ref virtual_memory_allocate_huge_pages.
+        /// It is usually 2MiB, or \c 0 if the system does not support huge pages.
+        /// \ingroup allocator
+        std::size_t get_virtual_memory_huge_page_size() noexcept;
+
+        /// Queries the page sizes supported by the system.
+        /// \effects Writes up to \c max_sizes different page sizes in ascending order into \c sizes,
+        /// the first one is always the \ref get_virtual_memory_page_size.
+        /// \returns The number of page sizes that were written.
+        /// \ingroup allocator
+        std::size_t get_virtual_memory_page_sizes(std::size_t* sizes,
+                                                  std::size_t  max_sizes) noexcept;
+
+        /// Specifies how memory backed by huge pages is requested from the system.
+        /// \ingroup allocator
+        enum class huge_page_mode
+        {
+            /// The memory is aligned to the huge page size and the system is advised to back it with huge pages,
+            /// i.e. it uses transparent huge pages via \c MADV_HUGEPAGE on Linux.
+            /// Windows has no transparent huge pages, so there the memory is only aligned.
+            /// Whether or not huge pages are actually used is up to the system.
+            transparent,
+
+            /// The memory is taken from the explicitly reserved huge pages of the system,
+            /// i.e. via \c MAP_HUGETLB on Linux or \c MEM_LARGE_PAGES on Windows.
+            /// If there are none left, it falls back to \c transparent.
+            explicit_pages,
+        };
+
+        /// Allocates memory backed by huge pages.
+        /// \effects Reserves and commits \c size bytes aligned to the \ref get_virtual_memory_huge_page_size.
+        /// If the system does not support huge pages, it uses normal pages instead.
+        /// \returns The address of the memory, or \c nullptr in case of error.
+        /// \requires \c size must be a non-zero multiple of the \ref get_virtual_memory_huge_page_size,
+        /// or of the \ref get_virtual_memory_page_size if there are no huge pages.
+        /// \ingroup allocator
+        void* virtual_memory_allocate_huge_pages(std::size_t size, huge_page_mode mode) noexcept;
+
+        /// Deallocates memory backed by huge pages.
+        /// \effects Returns the memory to the system.
+        /// \requires \c memory must come from a previous call to \ref virtual_memory_allocate_huge_pages with the same \c size,
+        /// it must not be \c nullptr.
+        /// \ingroup allocator
+        void virtual_memory_deallocate_huge_pages(void* memory, std::size_t size) noexcept;
+
         /// A stateless \concept{concept_rawallocator,RawAllocator} that allocates memory using the virtual memory allocation functions.
         /// It does not prereserve any memory and will always reserve and commit combined.
         /// \ingroup allocator
@@ -108,6 +164,18 @@ namespace foonathan
             /// It calls \ref virtual_memory_decommit followed by \ref virtual_memory_release for the deallocation.
             void deallocate_node(void* node, std::size_t size, std::size_t alignment) noexcept;
 
+            /// @{
+            /// \effects Changes the size of a \concept{concept_node,node} in place.
+            /// \returns Whether or not the size could be changed,
+            /// this is only possible if the node still needs the same number of pages,
+            /// as no pages can be added to or removed from an existing allocation.
+            bool try_expand_node(void* node, std::size_t old_size, std::size_t new_size,
+                                 std::size_t alignment) noexcept;
+
+            bool try_shrink_node(void* node, std::size_t old_size, std::size_t new_size,
+                                 std::size_t alignment) noexcept;
+            /// @}
+
             /// \returns The maximum node size by returning the maximum value.
             std::size_t max_node_size() const noexcept;
 
@@ -197,6 +265,148 @@ namespace foonathan
             char *      cur_, *end_;
             std::size_t block_size_;
         };
+
+        /// A \concept{concept_blockallocator,BlockAllocator} that reserves virtual memory and commits it block by block,
+        /// where blocks can be deallocated in any order.
+        /// Unlike \ref virtual_block_allocator, it keeps a bitmap of the free blocks at the beginning of the reserved memory,
+        /// so a deallocated block is decommitted and can be reused by the next allocation.
+        /// This allows pools that release their empty blocks to live in a single contiguous range,
+        /// which is checked by \ref owns().
+        /// \ingroup allocator
+        class reusable_virtual_block_allocator
+        {
+        public:
+            /// \effects Creates it giving it the block size and the total number of blocks it can allocate.
+            /// It reserves enough virtual memory for <tt>block_size * no_blocks</tt> plus the bitmap.
+            /// \requires \c block_size must be non-zero and a multiple of the \ref virtual_memory_page_size.
+            /// \c no_blocks must be bigger than \c 0.
+            /// \throws \ref out_of_memory if it cannot reserve the virtual memory.
+            explicit reusable_virtual_block_allocator(std::size_t block_size,
+                                                      std::size_t no_blocks);
+
+            /// \effects Releases the reserved virtual memory.
+            /// \requires All previously \ref allocate_block() committed blocks must be deallocated via
+            /// \ref deallocate_block(), otherwise the blocks that have not been deallocated are leaked.
+            ~reusable_virtual_block_allocator() noexcept;
+
+            /// @{
+            /// \effects Moves the block allocator, it transfers ownership over the reserved area.
+            /// This does not invalidate any memory blocks.
+            reusable_virtual_block_allocator(reusable_virtual_block_allocator&& other) noexcept
+            : bitmap_(other.bitmap_),
+              blocks_(other.blocks_),
+              block_size_(other.block_size_),
+              no_blocks_(other.no_blocks_),
+              no_free_(other.no_free_),
+              first_word_(other.first_word_)
+            {
+                other.bitmap_     = nullptr;
+                other.blocks_     = nullptr;
+                other.block_size_ = other.no_blocks_ = other.no_free_ = other.first_word_ = 0u;
+            }
+
+            reusable_virtual_block_allocator& operator=(
+                reusable_virtual_block_allocator&& other) noexcept
+            {
+                reusable_virtual_block_allocator tmp(detail::move(other));
+                swap(*this, tmp);
+                return *this;
+            }
+            /// @}
+
+            /// \effects Swaps the ownership over the reserved memory.
+            /// This does not invalidate any memory blocks.
+            friend void swap(reusable_virtual_block_allocator& a,
+                             reusable_virtual_block_allocator& b) noexcept
+            {
+                detail::adl_swap(a.bitmap_, b.bitmap_);
+                detail::adl_swap(a.blocks_, b.blocks_);
+                detail::adl_swap(a.block_size_, b.block_size_);
+                detail::adl_swap(a.no_blocks_, b.no_blocks_);
+                detail::adl_swap(a.no_free_, b.no_free_);
+                detail::adl_swap(a.first_word_, b.first_word_);
+            }
+
+            /// \effects Allocates a new memory block by committing the first free block of the reserved memory.
+            /// \returns The \ref memory_block committed.
+            /// \throws \ref out_of_fixed_memory if it cannot commit the memory or the \ref capacity_left() is exhausted.
+            memory_block allocate_block();
+
+            /// \effects Deallocates a memory block by decommitting it.
+            /// The block will be reused by a later call to \ref allocate_block().
+            /// \requires \c block must be previously returned by a call to \ref allocate_block(),
+            /// but blocks can be deallocated in any order.
+            void deallocate_block(memory_block block) noexcept;
+
+            /// \returns The next block size, this is the block size of the constructor.
+            std::size_t next_block_size() const noexcept
+            {
+                return block_size_;
+            }
+
+            /// \returns The number of blocks that can be committed until it runs out of memory.
+            std::size_t capacity_left() const noexcept
+            {
+                return no_free_;
+            }
+
+            /// \returns Whether or not \c ptr points into one of the blocks of the reserved memory.
+            bool owns(const void* ptr) const noexcept;
+
+        private:
+            allocator_info info() noexcept;
+
+            std::uint64_t* bitmap_; // a set bit marks a free block
+            char*          blocks_;
+            std::size_t    block_size_, no_blocks_, no_free_;
+            std::size_t    first_word_; // all words of the bitmap before it are zero
+        };
+
+        /// A \concept{concept_blockallocator,BlockAllocator} that allocates memory blocks backed by huge pages.
+        /// Huge pages reduce the number of TLB misses when accessing big memory pools or stacks.
+        /// It uses \ref virtual_memory_allocate_huge_pages, so it falls back to normal pages if necessary.
+        /// The block size is rounded up to a multiple of the page size and grows by a factor of \c 2 after each allocation.
+        /// \ingroup allocator
+        class huge_page_block_allocator
+        {
+        public:
+            /// \effects Creates it by giving it the initial block size and the way huge pages are requested.
+            /// \requires \c block_size must be greater than 0.
+            explicit huge_page_block_allocator(
+                std::size_t block_size, huge_page_mode mode = huge_page_mode::transparent) noexcept;
+
+            /// \effects Allocates a new memory block and increases the block size for the next allocation.
+            /// \returns The new \ref memory_block, it is aligned to the \ref page_size().
+            /// \throws \ref out_of_memory if the memory could not be allocated.
+            memory_block allocate_block();
+
+            /// \effects Deallocates a previously allocated memory block.
+            /// This does not decrease the block size.
+            /// \requires \c block must be previously returned by a call to \ref allocate_block().
+            void deallocate_block(memory_block block) noexcept;
+
+            /// \returns The size of the memory block returned by the next call to \ref allocate_block().
+            std::size_t next_block_size() const noexcept
+            {
+                return block_size_;
+            }
+
+            /// \returns The size of the pages backing the memory blocks,
+            /// this is the \ref get_virtual_memory_huge_page_size if the system supports huge pages.
+            std::size_t page_size() const noexcept;
+
+            /// \returns The way huge pages are requested.
+            huge_page_mode mode() const noexcept
+            {
+                return mode_;
+            }
+
+        private:
+            allocator_info info() noexcept;
+
+            std::size_t    block_size_;
+            huge_page_mode mode_;
+        };
     } // namespace memory
 } // namespace foonathan
 
@@ -0,0 +1,500 @@
+// Copyright (C) 2015-2025 Jonathan Müller and foonathan/memory contributors
+// SPDX-License-Identifier: Zlib
+
+#ifndef FOONATHAN_MEMORY_VIRTUAL_MEMORY_STACK_HPP_INCLUDED
+#define FOONATHAN_MEMORY_VIRTUAL_MEMORY_STACK_HPP_INCLUDED
+
+/// \file
+/// Class \ref foonathan::memory::virtual_memory_stack and its \ref foonathan::memory::allocator_traits specialization.
+
+#include <cstdint>
+#include <type_traits>
+
+#include "detail/assert.hpp"
+#include "detail/memory_stack.hpp"
+#include "detail/utility.hpp"
+#include "allocator_traits.hpp"
+#include "config.hpp"
+#include "error.hpp"
+#include "memory_stack.hpp"
+
+namespace foonathan
+{
+    namespace memory
+    {
+        class virtual_memory_stack;
+
+        namespace detail
+        {
+            class virtual_stack_marker
+            {
+                char*       top;
+                const char* begin;
+
+                virtual_stack_marker(char* t, const char* b) noexcept : top(t), begin(b) {}
+
+                friend bool operator==(const virtual_stack_marker& lhs,
+                                       const virtual_stack_marker& rhs) noexcept
+                {
+                    FOONATHAN_MEMORY_ASSERT_MSG(lhs.begin == rhs.begin,
+                                                "you must not compare two stack markers from "
+                                                "different stacks");
+                    return lhs.top == rhs.top;
+                }
+
+                friend bool operator!=(const virtual_stack_marker& lhs,
+                                       const virtual_stack_marker& rhs) noexcept
+                {
+                    return !(rhs == lhs);
+                }
+
+                friend bool operator<(const virtual_stack_marker& lhs,
+                                      const virtual_stack_marker& rhs) noexcept
+                {
+                    FOONATHAN_MEMORY_ASSERT_MSG(lhs.begin == rhs.begin,
+                                                "you must not compare two stack markers from "
+                                                "different stacks");
+                    return lhs.top < rhs.top;
+                }
+
+                friend bool operator>(const virtual_stack_marker& lhs,
+                                      const virtual_stack_marker& rhs) noexcept
+                {
+                    return rhs < lhs;
+                }
+
+                friend bool operator<=(const virtual_stack_marker& lhs,
+                                       const virtual_stack_marker& rhs) noexcept
+                {
+                    return !(rhs < lhs);
+                }
+
+                friend bool operator>=(const virtual_stack_marker& lhs,
+                                       const virtual_stack_marker& rhs) noexcept
+                {
+                    return !(lhs < rhs);
+                }
+
+                friend memory::virtual_memory_stack;
+            };
+
+            struct virtual_memory_stack_leak_handler
+            {
+                void operator()(std::ptrdiff_t amount);
+            };
+        } // namespace detail
+
+        /// A stateful \concept{concept_rawallocator,RawAllocator} that provides stack-like (LIFO) allocations
+        /// in a single contiguous range of virtual memory.
+        /// Unlike \ref memory_stack it does not chain multiple memory blocks:
+        /// it reserves the maximum size up front and commits the pages as the top grows,
+        /// so no memory is wasted at the end of a block and allocations of any size up to the reserved size are possible.
+        /// When unwinding, pages that are more than the retained size above the new top are decommitted again.
+        /// It can be used with \ref memory_stack_raii_unwind.
+        /// \ingroup allocator
+        class virtual_memory_stack
+        : FOONATHAN_EBO(detail::default_leak_checker<detail::virtual_memory_stack_leak_handler>)
+        {
+        public:
+            /// \effects Creates it by reserving \c max_size bytes, rounded up to a multiple of the \ref virtual_memory_page_size.
+            /// No memory is committed until the first allocation.
+            /// \c retained_size is the number of committed bytes above the top that are kept by \ref unwind(),
+            /// the remaining pages are decommitted.
+            /// The default value never decommits on \ref unwind(), only on \ref shrink_to_fit().
+            /// \requires \c max_size must be greater than \c 0.
+            /// \throws \ref out_of_memory if it cannot reserve the virtual memory.
+            explicit virtual_memory_stack(std::size_t max_size,
+                                          std::size_t retained_size = std::size_t(-1));
+
+            /// \effects Releases the reserved virtual memory,
+            /// this deallocates all memory allocated by the stack.
+            ~virtual_memory_stack() noexcept;
+
+            /// @{
+            /// \effects Moves the stack, it transfers ownership over the reserved memory.
+            /// This does not invalidate any memory allocated from it or any markers.
+            virtual_memory_stack(virtual_memory_stack&& other) noexcept
+            : leak_checker(detail::move(other)),
+              begin_(other.begin_),
+              committed_(other.committed_),
+              end_(other.end_),
+              stack_(detail::move(other.stack_)),
+              retained_size_(other.retained_size_)
+            {
+                other.begin_ = other.committed_ = other.end_ = nullptr;
+            }
+
+            virtual_memory_stack& operator=(virtual_memory_stack&& other) noexcept
+            {
+                virtual_memory_stack tmp(detail::move(other));
+                swap(*this, tmp);
+                return *this;
+            }
+            /// @}
+
+            /// \effects Swaps the ownership over the reserved memory.
+            /// This does not invalidate any memory allocated from it or any markers.
+            friend void swap(virtual_memory_stack& a, virtual_memory_stack& b) noexcept
+            {
+                detail::adl_swap(static_cast<leak_checker&>(a), static_cast<leak_checker&>(b));
+                detail::adl_swap(a.begin_, b.begin_);
+                detail::adl_swap(a.committed_, b.committed_);
+                detail::adl_swap(a.end_, b.end_);
+                detail::adl_swap(a.stack_, b.stack_);
+                detail::adl_swap(a.retained_size_, b.retained_size_);
+            }
+
+            /// \effects Allocates a memory block of given size and alignment.
+            /// It simply moves the top marker.
+            /// If the committed memory is not big enough, more pages are committed,
+            /// at least as many as are already committed so that the number of commits stays logarithmic.
+            /// \returns A \concept{concept_node,node} with given size and alignment.
+            /// \throws \ref out_of_fixed_memory if the reserved memory is exhausted
+            /// or \ref out_of_memory if the pages cannot be committed.
+            /// \requires \c size and \c alignment must be valid.
+            void* allocate(std::size_t size, std::size_t alignment)
+            {
+                auto fence  = detail::debug_fence_size;
+                auto offset = detail::align_offset(stack_.top() + fence, alignment);
+                auto needed = fence + offset + size + fence;
+
+                if (needed > std::size_t(committed_ - stack_.top()))
+                    commit(needed);
+
+                return stack_.allocate_unchecked(size, offset);
+            }
+
+            /// \effects Allocates a memory block of given size and alignment,
+            /// similar to \ref allocate().
+            /// But it does not commit any more pages.
+            /// \returns A \concept{concept_node,node} with given size and alignment
+            /// or `nullptr` if there wasn't enough committed memory available.
+            void* try_allocate(std::size_t size, std::size_t alignment) noexcept
+            {
+                return stack_.allocate(committed_, size, alignment);
+            }
+
+            /// \effects Changes the size of the memory block at the top of the stack in place,
+            /// by moving the top marker.
+            /// It does not commit any more pages.
+            /// \returns Whether or not the size could be changed,
+            /// this is only possible if \c memory was the last allocation and enough committed memory is left.
+            /// \requires \c memory and \c old_size must describe a previous allocation
+            /// and no marker must have been obtained since that allocation.
+            bool try_resize(void* memory, std::size_t old_size, std::size_t new_size) noexcept
+            {
+                return stack_.resize(committed_, memory, old_size, new_size);
+            }
+
+            /// The marker type that is used for unwinding.
+            /// The exact type is implementation defined,
+            /// it is only required that it is efficiently copyable
+            /// and has all the comparision operators defined for two markers on the same stack.
+            /// Two markers are equal, if they are copies or created from two `top()` calls without a call to `unwind()` or `allocate()`.
+            /// A marker `a` is less than marker `b`, if after `a` was obtained, there was one or more call to `allocate()` and no call to `unwind()`.
+            using marker = FOONATHAN_IMPL_DEFINED(detail::virtual_stack_marker);
+
+            /// \returns A marker to the current top of the stack.
+            marker top() const noexcept
+            {
+                return {stack_.top(), begin_};
+            }
+
+            /// \effects Unwinds the stack to a certain marker position.
+            /// This sets the top pointer of the stack to the position described by the marker
+            /// and has the effect of deallocating all memory allocated since the marker was obtained.
+            /// Committed pages that begin more than the retained size above the new top are decommitted.
+            /// \requires The marker must point to memory that is still in use and was the whole time,
+            /// i.e. it must have been pointed below the top at all time.
+            void unwind(marker m) noexcept
+            {
+                FOONATHAN_MEMORY_ASSERT(m <= top());
+                detail::debug_check_pointer([&] { return m.begin == begin_; }, info(), m.top);
+                stack_.unwind(m.top);
+
+                if (std::size_t(committed_ - m.top) > retained_size_)
+                    decommit(m.top + retained_size_);
+            }
+
+            /// \effects Decommits all pages above the current top,
+            /// regardless of the retained size.
+            void shrink_to_fit() noexcept
+            {
+                decommit(stack_.top());
+            }
+
+            /// \returns The amount of memory remaining in the reserved range.
+            /// This is the number of bytes that are available for allocation,
+            /// some of them may need to be committed first.
+            std::size_t capacity_left() const noexcept
+            {
+                return std::size_t(end_ - stack_.top());
+            }
+
+            /// \returns The amount of committed memory,
+            /// including the memory that is currently allocated.
+            std::size_t committed_size() const noexcept
+            {
+                return std::size_t(committed_ - begin_);
+            }
+
+            /// \returns The total amount of reserved memory,
+            /// this is the maximum size of the stack.
+            std::size_t reserved_size() const noexcept
+            {
+                return std::size_t(end_ - begin_);
+            }
+
+            /// \returns The number of committed bytes above the top that are kept by \ref unwind().
+            std::size_t retained_size() const noexcept
+            {
+                return retained_size_;
+            }
+
+            /// \effects Sets the number of committed bytes above the top that are kept by \ref unwind().
+            /// This does not decommit any pages by itself.
+            void set_retained_size(std::size_t size) noexcept
+            {
+                retained_size_ = size;
+            }
+
+            /// \returns Whether or not \c ptr points into the reserved memory of the stack.
+            bool owns(const void* ptr) const noexcept
+            {
+                auto address = reinterpret_cast<std::uintptr_t>(ptr);
+                return reinterpret_cast<std::uintptr_t>(begin_) <= address
+                       && address < reinterpret_cast<std::uintptr_t>(end_);
+            }
+
+        private:
+            using leak_checker =
+                detail::default_leak_checker<detail::virtual_memory_stack_leak_handler>;
+
+            allocator_info info() const noexcept
+            {
+                return {FOONATHAN_MEMORY_LOG_PREFIX "::virtual_memory_stack", this};
+            }
+
+            // commits enough pages so that needed bytes are available above the top
+            void commit(std::size_t needed);
+
+            // decommits all pages starting at or after new_end
+            void decommit(const char* new_end) noexcept;
+
+            char *                     begin_, *committed_, *end_;
+            detail::fixed_memory_stack stack_;
+            std::size_t                retained_size_;
+
+            friend allocator_traits<virtual_memory_stack>;
+        };
+
+#if FOONATHAN_MEMORY_EXTERN_TEMPLATE
+        extern template class memory_stack_raii_unwind<virtual_memory_stack>;
+#endif
+
+        /// Specialization of the \ref allocator_traits for \ref virtual_memory_stack.
+        /// \note It is not allowed to mix calls through the specialization and through the member functions,
+        /// i.e. \ref virtual_memory_stack::allocate() and this \c allocate_node().
+        /// \ingroup allocator
+        template <>
+        class allocator_traits<virtual_memory_stack>
+        {
+        public:
+            using allocator_type = virtual_memory_stack;
+            using is_stateful    = std::true_type;
+
+            /// \returns The result of \ref virtual_memory_stack::allocate().
+            static void* allocate_node(allocator_type& state, std::size_t size,
+                                       std::size_t alignment)
+            {
+                auto mem = state.allocate(size, alignment);
+                state.on_allocate(size);
+                return mem;
+            }
+
+            /// \returns The result of \ref virtual_memory_stack::allocate().
+            static void* allocate_array(allocator_type& state, std::size_t count, std::size_t size,
+                                        std::size_t alignment)
+            {
+                return allocate_node(state, count * size, alignment);
+            }
+
+            /// \effects Calls \ref virtual_memory_stack::allocate() for each node.
+            static void allocate_nodes(allocator_type& state, std::size_t count, std::size_t size,
+                                       std::size_t alignment, void** nodes)
+            {
+                detail::allocate_nodes_each<allocator_traits>(state, count, size, alignment, nodes);
+            }
+
+            /// @{
+            /// \effects Does nothing besides bookmarking for leak checking, if that is enabled.
+            /// Actual deallocation can only be done via \ref virtual_memory_stack::unwind().
+            static void deallocate_node(allocator_type& state, void*, std::size_t size,
+                                        std::size_t) noexcept
+            {
+                state.on_deallocate(size);
+            }
+
+            static void deallocate_array(allocator_type& state, void* ptr, std::size_t count,
+                                         std::size_t size, std::size_t alignment) noexcept
+            {
+                deallocate_node(state, ptr, count * size, alignment);
+            }
+
+            static void deallocate_nodes(allocator_type& state, void**, std::size_t count,
+                                         std::size_t size, std::size_t) noexcept
+            {
+                state.on_deallocate(count * size);
+            }
+            /// @}
+
+            /// @{
+            /// \effects Calls \ref virtual_memory_stack::try_resize().
+            /// \returns Whether the node could be resized in place,
+            /// which is only possible for the topmost allocation.
+            static bool try_expand_node(allocator_type& state, void* node, std::size_t old_size,
+                                        std::size_t new_size, std::size_t) noexcept
+            {
+                if (!state.try_resize(node, old_size, new_size))
+                    return false;
+                state.on_allocate(new_size - old_size);
+                return true;
+            }
+
+            static bool try_shrink_node(allocator_type& state, void* node, std::size_t old_size,
+                                        std::size_t new_size, std::size_t) noexcept
+            {
+                if (!state.try_resize(node, old_size, new_size))
+                    return false;
+                state.on_deallocate(old_size - new_size);
+                return true;
+            }
+            /// @}
+
+            /// \effects Resizes the topmost array in place, otherwise allocates a new one and copies.
+            /// \returns The reallocated array.
+            static void* reallocate_array(allocator_type& state, void* array, std::size_t old_count,
+                                          std::size_t new_count, std::size_t size,
+                                          std::size_t alignment)
+            {
+                return detail::reallocate_array_copy<allocator_traits>(state, array, old_count,
+                                                                       new_count, size, alignment);
+            }
+
+            /// \effects Allocates an array and expands it in place up to the next multiple of the maximum alignment if possible.
+            /// \returns The array together with its actual size, a multiple of \c size.
+            static memory_block allocate_at_least(allocator_type& state, std::size_t count,
+                                                  std::size_t size, std::size_t alignment)
+            {
+                return detail::allocate_array_at_least<allocator_traits>(state, count, size,
+                                                                         alignment);
+            }
+
+            /// @{
+            /// \returns The maximum size which is \ref virtual_memory_stack::reserved_size().
+            static std::size_t max_node_size(const allocator_type& state) noexcept
+            {
+                return state.reserved_size();
+            }
+
+            static std::size_t max_array_size(const allocator_type& state) noexcept
+            {
+                return state.reserved_size();
+            }
+            /// @}
+
+            /// \returns The maximum possible value since there is no alignment restriction
+            /// (except indirectly through \ref virtual_memory_stack::reserved_size()).
+            static std::size_t max_alignment(const allocator_type&) noexcept
+            {
+                return std::size_t(-1);
+            }
+        };
+
+        /// Specialization of the \ref composable_allocator_traits for \ref virtual_memory_stack.
+        /// \ingroup allocator
+        template <>
+        class composable_allocator_traits<virtual_memory_stack>
+        {
+        public:
+            using allocator_type = virtual_memory_stack;
+
+            /// \returns The result of \ref virtual_memory_stack::try_allocate().
+            static void* try_allocate_node(allocator_type& state, std::size_t size,
+                                           std::size_t alignment) noexcept
+            {
+                return state.try_allocate(size, alignment);
+            }
+
+            /// \returns The result of \ref virtual_memory_stack::try_allocate().
+            static void* try_allocate_array(allocator_type& state, std::size_t count,
+                                            std::size_t size, std::size_t alignment) noexcept
+            {
+                return state.try_allocate(count * size, alignment);
+            }
+
+            /// \effects Calls \ref virtual_memory_stack::try_allocate() for each node.
+            /// \returns Whether all nodes could be allocated.
+            static bool try_allocate_nodes(allocator_type& state, std::size_t count,
+                                           std::size_t size, std::size_t alignment,
+                                           void** nodes) noexcept
+            {
+                return detail::try_allocate_nodes_each<composable_allocator_traits>(state, count,
+                                                                                    size, alignment,
+                                                                                    nodes);
+            }
+
+            /// @{
+            /// \effects Does nothing.
+            /// \returns Whether the memory will be deallocated by \ref virtual_memory_stack::unwind().
+            static bool try_deallocate_node(allocator_type& state, void* ptr, std::size_t,
+                                            std::size_t) noexcept
+            {
+                return state.owns(ptr);
+            }
+
+            static bool try_deallocate_array(allocator_type& state, void* ptr, std::size_t count,
+                                             std::size_t size, std::size_t alignment) noexcept
+            {
+                return try_deallocate_node(state, ptr, count * size, alignment);
+            }
+
+            static bool try_deallocate_nodes(allocator_type& state, void** nodes, std::size_t count,
+                                             std::size_t, std::size_t) noexcept
+            {
+                return count == 0u || state.owns(nodes[0]);
+            }
+            /// @}
+
+            /// @{
+            /// \effects Calls \ref virtual_memory_stack::try_resize().
+            /// \returns Whether the node could be resized in place,
+            /// which is only possible for the topmost allocation.
+            static bool try_expand_node(allocator_type& state, void* node, std::size_t old_size,
+                                        std::size_t new_size, std::size_t) noexcept
+            {
+                return state.try_resize(node, old_size, new_size);
+            }
+
+            static bool try_shrink_node(allocator_type& state, void* node, std::size_t old_size,
+                                        std::size_t new_size, std::size_t) noexcept
+            {
+                return state.try_resize(node, old_size, new_size);
+            }
+            /// @}
+
+            /// \effects Resizes the topmost array in place, otherwise allocates a new one and copies.
+            /// \returns The reallocated array or `nullptr` if it was not allocated by the stack
+            /// or there was not enough committed memory.
+            static void* try_reallocate_array(allocator_type& state, void* array,
+                                              std::size_t old_count, std::size_t new_count,
+                                              std::size_t size, std::size_t alignment) noexcept
+            {
+                return detail::try_reallocate_array_copy<composable_allocator_traits>(
+                    state, array, old_count, new_count, size, alignment);
+            }
+        };
+    } // namespace memory
+} // namespace foonathan
+
+#endif // FOONATHAN_MEMORY_VIRTUAL_MEMORY_STACK_HPP_INCLUDED
@@ -0,0 +1,25 @@
+// Copyright (C) 2015-2025 Jonathan Müller and foonathan/memory contributors
+// SPDX-License-Identifier: Zlib
+
+#include "config.hpp"
+#if FOONATHAN_HOSTED_IMPLEMENTATION
+
+#include "concurrent_memory_stack.hpp"
+
+#include "debugging.hpp"
+
+using namespace foonathan::memory;
+
+void detail::concurrent_memory_stack_leak_handler::operator()(std::ptrdiff_t amount)
+{
+    get_leak_handler()({FOONATHAN_MEMORY_LOG_PREFIX "::concurrent_memory_stack", this}, amount);
+}
+
+#if FOONATHAN_MEMORY_EXTERN_TEMPLATE
+template class foonathan::memory::concurrent_memory_stack<>;
+template class foonathan::memory::memory_stack_raii_unwind<concurrent_memory_stack<>>;
+template class foonathan::memory::allocator_traits<concurrent_memory_stack<>>;
+template class foonathan::memory::composable_allocator_traits<concurrent_memory_stack<>>;
+#endif
+
+#endif // FOONATHAN_HOSTED_IMPLEMENTATION
@@ -0,0 +1,356 @@
+// Copyright (C) 2015-2025 Jonathan Müller and foonathan/memory contributors
+// SPDX-License-Identifier: Zlib
+
+#include "detail/bitmap_free_list.hpp"
+
+#include <climits>
+#include <new>
+
+#include "detail/align.hpp"
+#include "detail/debug_helpers.hpp"
+#include "detail/assert.hpp"
+#include "detail/ilog2.hpp"
+#include "debugging.hpp"
+#include "error.hpp"
+#include "memory_arena.hpp"
+
+#include "free_list_utils.hpp"
+#include "treap.hpp"
+
+using namespace foonathan::memory;
+using namespace detail;
+
+namespace
+{
+    static_assert(bitmap_header_size % alignof(bitmap_word) == 0u,
+                  "bitmap must be aligned after the header");
+
+    bitmap_word* get_bitmap(bitmap_block* block) noexcept
+    {
+        auto mem = static_cast<void*>(static_cast<char*>(static_cast<void*>(block))
+                                      + bitmap_header_size);
+        return static_cast<bitmap_word*>(mem);
+    }
+
+    char* get_nodes(bitmap_block* block) noexcept
+    {
+        return static_cast<char*>(static_cast<void*>(block))
+               + bitmap_nodes_offset(block->no_nodes);
+    }
+
+    // maximum number of nodes that fit into a block of given size
+    std::size_t nodes_in_block(std::size_t size, std::size_t node_size) noexcept
+    {
+        if (size <= bitmap_nodes_offset(1u))
+            return 0u;
+
+        // every node needs one additional bit, start with that estimate and adjust downwards
+        auto no_nodes =
+            (size - bitmap_header_size) * CHAR_BIT / (node_size * CHAR_BIT + 1u);
+        while (no_nodes > 0u && bitmap_nodes_offset(no_nodes) + no_nodes * node_size > size)
+            --no_nodes;
+        return no_nodes;
+    }
+
+    // the blocks are ordered by address
+    struct block_access
+    {
+        using node = bitmap_block;
+
+        static bitmap_block* child(bitmap_block* block, bool right) noexcept
+        {
+            return right ? block->right : block->left;
+        }
+
+        static void set_child(bitmap_block* block, bool right, bitmap_block* child) noexcept
+        {
+            (right ? block->right : block->left) = child;
+        }
+    };
+
+    using block_treap = treap<block_access>;
+
+    // allocates the first free node of a block
+    // pre: block->capacity > 0
+    char* allocate_from(bitmap_block* block, std::size_t node_size) noexcept
+    {
+        FOONATHAN_MEMORY_ASSERT(block->capacity > 0u);
+        auto bitmap = get_bitmap(block);
+
+        auto i = block->first_word;
+        while (bitmap[i] == 0u)
+            ++i;
+        auto bit = count_trailing_zeros(bitmap[i]);
+        bitmap[i] &= bitmap[i] - 1u; // clear lowest set bit
+
+        block->first_word = i;
+        --block->capacity;
+        return get_nodes(block) + (i * bitmap_word_bits + bit) * node_size;
+    }
+} // namespace
+
+constexpr std::size_t bitmap_free_memory_list::min_element_size;
+constexpr std::size_t bitmap_free_memory_list::min_element_alignment;
+
+bitmap_free_memory_list::bitmap_free_memory_list(std::size_t node_size) noexcept
+: free_blocks_(nullptr),
+  root_(nullptr),
+  alloc_block_(nullptr),
+  dealloc_block_(nullptr),
+  node_size_(node_size > min_element_size ? node_size : min_element_size),
+  capacity_(0u)
+{
+}
+
+bitmap_free_memory_list::bitmap_free_memory_list(bitmap_free_memory_list&& other) noexcept
+: free_blocks_(other.free_blocks_),
+  root_(other.root_),
+  alloc_block_(other.alloc_block_),
+  dealloc_block_(other.dealloc_block_),
+  node_size_(other.node_size_),
+  capacity_(other.capacity_)
+{
+    other.free_blocks_   = nullptr;
+    other.root_          = nullptr;
+    other.alloc_block_   = nullptr;
+    other.dealloc_block_ = nullptr;
+    other.capacity_      = 0u;
+}
+
+void foonathan::memory::detail::swap(bitmap_free_memory_list& a,
+                                     bitmap_free_memory_list& b) noexcept
+{
+    detail::adl_swap(a.free_blocks_, b.free_blocks_);
+    detail::adl_swap(a.root_, b.root_);
+    detail::adl_swap(a.alloc_block_, b.alloc_block_);
+    detail::adl_swap(a.dealloc_block_, b.dealloc_block_);
+    detail::adl_swap(a.node_size_, b.node_size_);
+    detail::adl_swap(a.capacity_, b.capacity_);
+}
+
+void bitmap_free_memory_list::insert(void* mem, std::size_t size) noexcept
+{
+    FOONATHAN_MEMORY_ASSERT(mem);
+    FOONATHAN_MEMORY_ASSERT(is_aligned(mem, max_alignment));
+    debug_fill_internal(mem, size, false);
+
+    // too small blocks are ignored, usable_size() is zero for them
+    auto no_nodes = nodes_in_block(size, node_size_);
+    if (no_nodes == 0u)
+        return;
+
+    auto block = ::new (mem)
+        bitmap_block{nullptr, nullptr, nullptr, nullptr, no_nodes, no_nodes, 0u};
+    link_free_block(block);
+    block_treap::insert(root_, block, [&](bitmap_block* cur) { return less(block, cur); });
+
+    // all nodes are free
+    auto bitmap   = get_bitmap(block);
+    auto no_words = bitmap_word_count(no_nodes);
+    for (std::size_t i = 0u; i != no_words - 1u; ++i)
+        bitmap[i] = ~bitmap_word(0u);
+    auto remaining       = no_nodes - (no_words - 1u) * bitmap_word_bits;
+    bitmap[no_words - 1] = remaining == bitmap_word_bits ? ~bitmap_word(0u) :
+                                                           (bitmap_word(1u) << remaining) - 1u;
+
+    alloc_block_ = block;
+    capacity_ += no_nodes;
+}
+
+std::size_t bitmap_free_memory_list::usable_size(std::size_t size) const noexcept
+{
+    return nodes_in_block(size, node_size_) * node_size_;
+}
+
+void* bitmap_free_memory_list::allocate() noexcept
+{
+    FOONATHAN_MEMORY_ASSERT(!empty());
+    if (alloc_block_->capacity == 0u)
+        alloc_block_ = find_free_block();
+
+    auto node = allocate_from(alloc_block_, node_size_);
+    if (alloc_block_->capacity == 0u)
+        unlink_free_block(alloc_block_);
+    --capacity_;
+    return debug_fill_new(node, node_size_, 0);
+}
+
+void bitmap_free_memory_list::deallocate(void* ptr) noexcept
+{
+    auto info =
+        allocator_info(FOONATHAN_MEMORY_LOG_PREFIX "::detail::bitmap_free_memory_list", this);
+
+    auto node  = static_cast<char*>(ptr);
+    auto block = find_block(node);
+    debug_check_pointer(
+        [&]
+        {
+            return block
+                   && static_cast<std::size_t>(node - get_nodes(block)) % node_size_ == 0u;
+        },
+        info, ptr);
+
+    auto index = static_cast<std::size_t>(node - get_nodes(block)) / node_size_;
+    auto word  = index / bitmap_word_bits;
+    auto mask  = bitmap_word(1u) << (index % bitmap_word_bits);
+
+    auto bitmap = get_bitmap(block);
+    debug_check_double_dealloc([&] { return (bitmap[word] & mask) == 0u; }, info, ptr);
+    debug_fill_free(ptr, node_size_, 0);
+
+    bitmap[word] |= mask;
+    if (word < block->first_word)
+        block->first_word = word;
+    if (block->capacity++ == 0u)
+        link_free_block(block);
+    ++capacity_;
+
+    dealloc_block_ = block;
+    if (!alloc_block_ || alloc_block_->capacity == 0u)
+        alloc_block_ = block;
+}
+
+void bitmap_free_memory_list::deallocate(void* ptr, std::size_t n) noexcept
+{
+    FOONATHAN_MEMORY_ASSERT_MSG(n <= node_size_, "does not support array allocations");
+    (void)n;
+    deallocate(ptr);
+}
+
+std::size_t bitmap_free_memory_list::allocate_nodes(std::size_t n, void** out) noexcept
+{
+    std::size_t no_nodes = 0u;
+    while (no_nodes != n && !empty())
+    {
+        if (alloc_block_->capacity == 0u)
+            alloc_block_ = find_free_block();
+
+        auto block  = alloc_block_;
+        auto bitmap = get_bitmap(block);
+        auto nodes  = get_nodes(block);
+
+        auto i = block->first_word;
+        while (bitmap[i] == 0u)
+            ++i;
+        block->first_word = i;
+
+        // take as many nodes of the word as needed
+        auto bits  = bitmap[i];
+        auto count = std::size_t(0u);
+        for (; bits != 0u && no_nodes != n; ++count)
+        {
+            auto bit = count_trailing_zeros(bits);
+            bits &= bits - 1u;
+            out[no_nodes++] =
+                debug_fill_new(nodes + (i * bitmap_word_bits + bit) * node_size_, node_size_, 0);
+        }
+        bitmap[i] = bits;
+
+        block->capacity -= count;
+        if (block->capacity == 0u)
+            unlink_free_block(block);
+        capacity_ -= count;
+    }
+    return no_nodes;
+}
+
+void bitmap_free_memory_list::deallocate_nodes(void** ptrs, std::size_t n) noexcept
+{
+    for (std::size_t i = 0u; i != n; ++i)
+        deallocate(ptrs[i]);
+}
+
+std::size_t bitmap_free_memory_list::free_nodes_in(void* mem, std::size_t size) noexcept
+{
+    // split the blocks inside the memory out of the treap and merge them back afterwards
+    auto          begin = static_cast<char*>(mem);
+    bitmap_block *l, *m, *r;
+    block_treap::split(root_, [&](bitmap_block* cur) { return less_equal(begin, cur); }, l, m);
+    block_treap::split(m, [&](bitmap_block* cur) { return less_equal(begin + size, cur); }, m,
+                       r);
+
+    std::size_t no_nodes = 0u;
+    block_treap::for_each(m, [&](bitmap_block* block) { no_nodes += block->capacity; });
+
+    root_ = block_treap::merge(l, block_treap::merge(m, r));
+    return no_nodes;
+}
+
+void bitmap_free_memory_list::count_free_nodes(memory_block_tally& tally) noexcept
+{
+    for (auto cur = free_blocks_; cur; cur = cur->next)
+        tally.add(cur, cur->capacity);
+}
+
+void bitmap_free_memory_list::remove_nodes_in(void* mem, std::size_t size) noexcept
+{
+    // split the blocks inside the memory out of the treap and drop them
+    auto          begin = static_cast<char*>(mem);
+    bitmap_block *l, *m, *r;
+    block_treap::split(root_, [&](bitmap_block* cur) { return less_equal(begin, cur); }, l, m);
+    block_treap::split(m, [&](bitmap_block* cur) { return less_equal(begin + size, cur); }, m,
+                       r);
+    root_ = block_treap::merge(l, r);
+
+    block_treap::for_each(m,
+                          [&](bitmap_block* block)
+                          {
+                              FOONATHAN_MEMORY_ASSERT_MSG(block->capacity == block->no_nodes,
+                                                          "block still has allocated nodes");
+                              capacity_ -= block->capacity;
+                              unlink_free_block(block);
+                          });
+
+    // the markers might have been removed
+    alloc_block_   = free_blocks_;
+    dealloc_block_ = nullptr;
+}
+
+std::size_t bitmap_free_memory_list::alignment() const noexcept
+{
+    return alignment_for(node_size_);
+}
+
+bitmap_block* bitmap_free_memory_list::find_block(char* node) noexcept
+{
+    auto contains = [&](bitmap_block* block)
+    {
+        auto begin = get_nodes(block);
+        return !less(node, begin) && less(node, begin + block->no_nodes * node_size_);
+    };
+
+    // deallocations are often in the same block as the previous one
+    if (dealloc_block_ && contains(dealloc_block_))
+        return dealloc_block_;
+
+    // the last block starting before node, node might still be in its header
+    auto block =
+        block_treap::last_before(root_, [&](bitmap_block* cur) { return less(node, cur); });
+    return block && contains(block) ? block : nullptr;
+}
+
+bitmap_block* bitmap_free_memory_list::find_free_block() noexcept
+{
+    FOONATHAN_MEMORY_ASSERT(!empty());
+    FOONATHAN_MEMORY_ASSERT(free_blocks_ && free_blocks_->capacity != 0u);
+    return free_blocks_;
+}
+
+void bitmap_free_memory_list::link_free_block(bitmap_block* block) noexcept
+{
+    block->prev = nullptr;
+    block->next = free_blocks_;
+    if (free_blocks_)
+        free_blocks_->prev = block;
+    free_blocks_ = block;
+}
+
+void bitmap_free_memory_list::unlink_free_block(bitmap_block* block) noexcept
+{
+    if (block->prev)
+        block->prev->next = block->next;
+    else
+        free_blocks_ = block->next;
+    if (block->next)
+        block->next->prev = block->prev;
+}
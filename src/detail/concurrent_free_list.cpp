@@ -0,0 +1,321 @@
+// Copyright (C) 2015-2025 Jonathan Müller and foonathan/memory contributors
+// SPDX-License-Identifier: Zlib
+
+#include "detail/concurrent_free_list.hpp"
+
+#include "detail/align.hpp"
+#include "detail/debug_helpers.hpp"
+#include "detail/assert.hpp"
+#include "debugging.hpp"
+#include "error.hpp"
+
+#if FOONATHAN_HOSTED_IMPLEMENTATION
+#include <cstring>
+#include <thread>
+#endif
+
+using namespace foonathan::memory;
+using namespace detail;
+
+namespace
+{
+    // index: upper bits block, lower bits node in block + 1, 0 is null
+    constexpr std::uint32_t node_bits      = 26u;
+    constexpr std::uint32_t node_mask      = (std::uint32_t(1) << node_bits) - 1u;
+    constexpr std::uint32_t max_block_size = node_mask; // in nodes
+
+    static_assert(concurrent_free_memory_list::max_blocks == (std::size_t(1) << (32u - node_bits)),
+                  "index bits don't match number of blocks");
+
+    std::uint32_t get_next(void* node) noexcept
+    {
+        std::uint32_t res;
+#if FOONATHAN_HOSTED_IMPLEMENTATION
+        std::memcpy(&res, node, sizeof(res));
+#else
+        auto mem = static_cast<char*>(static_cast<void*>(&res));
+        for (auto i = 0u; i != sizeof(res); ++i)
+            mem[i] = static_cast<char*>(node)[i];
+#endif
+        return res;
+    }
+
+    void set_next(void* node, std::uint32_t index) noexcept
+    {
+#if FOONATHAN_HOSTED_IMPLEMENTATION
+        std::memcpy(node, &index, sizeof(index));
+#else
+        auto mem = static_cast<char*>(static_cast<void*>(&index));
+        for (auto i = 0u; i != sizeof(index); ++i)
+            static_cast<char*>(node)[i] = mem[i];
+#endif
+    }
+
+    std::uint64_t make_head(std::uint64_t old_head, std::uint32_t index) noexcept
+    {
+        // increment generation on every change to prevent ABA
+        auto generation = (old_head >> 32u) + 1u;
+        return (generation << 32u) | index;
+    }
+} // namespace
+
+constexpr std::size_t concurrent_free_memory_list::min_element_size;
+constexpr std::size_t concurrent_free_memory_list::min_element_alignment;
+constexpr std::size_t concurrent_free_memory_list::max_blocks;
+
+concurrent_free_memory_list::concurrent_free_memory_list(std::size_t node_size) noexcept
+: head_(0u),
+  capacity_(0u),
+  no_blocks_(0u),
+  growing_(false),
+  node_size_(node_size > min_element_size ? node_size : min_element_size)
+{
+}
+
+concurrent_free_memory_list::concurrent_free_memory_list(
+    concurrent_free_memory_list&& other) noexcept
+: head_(other.head_.load()),
+  capacity_(other.capacity_.load()),
+  no_blocks_(other.no_blocks_.load()),
+  growing_(false),
+  node_size_(other.node_size_)
+{
+    for (std::size_t i = 0u; i != no_blocks_; ++i)
+        blocks_[i] = other.blocks_[i];
+
+    other.head_      = 0u;
+    other.capacity_  = 0u;
+    other.no_blocks_ = 0u;
+}
+
+void foonathan::memory::detail::swap(concurrent_free_memory_list& a,
+                                     concurrent_free_memory_list& b) noexcept
+{
+    auto swap_atomic = [](std::atomic<std::uint64_t>& lhs, std::atomic<std::uint64_t>& rhs)
+    { lhs = rhs.exchange(lhs.load()); };
+    auto swap_size = [](std::atomic<std::size_t>& lhs, std::atomic<std::size_t>& rhs)
+    { lhs = rhs.exchange(lhs.load()); };
+
+    swap_atomic(a.head_, b.head_);
+    swap_size(a.capacity_, b.capacity_);
+    swap_size(a.no_blocks_, b.no_blocks_);
+    detail::adl_swap(a.node_size_, b.node_size_);
+    for (std::size_t i = 0u; i != concurrent_free_memory_list::max_blocks; ++i)
+        detail::adl_swap(a.blocks_[i], b.blocks_[i]);
+}
+
+void concurrent_free_memory_list::insert(void* mem, std::size_t size) noexcept
+{
+    FOONATHAN_MEMORY_ASSERT(mem);
+    FOONATHAN_MEMORY_ASSERT(is_aligned(mem, alignment()));
+    detail::debug_fill_internal(mem, size, false);
+
+    auto cur      = static_cast<char*>(mem);
+    auto no_nodes = size / node_size_;
+    FOONATHAN_MEMORY_ASSERT(no_nodes > 0);
+    FOONATHAN_MEMORY_ASSERT_MSG(can_insert(size), "too many blocks inserted");
+    while (no_nodes > 0u)
+    {
+        auto no_blocks = no_blocks_.load(std::memory_order_relaxed);
+
+        // huge blocks are split into multiple table entries
+        auto block_nodes =
+            no_nodes > max_block_size ? max_block_size : static_cast<std::uint32_t>(no_nodes);
+        blocks_[no_blocks] = {cur, block_nodes};
+        // publish the table entry before any node of it
+        no_blocks_.store(no_blocks + 1u, std::memory_order_release);
+
+        auto first = static_cast<std::uint32_t>(no_blocks << node_bits) + 1u;
+        for (std::uint32_t i = 0u; i != block_nodes - 1u; ++i)
+            set_next(cur + i * node_size_, first + i + 1u);
+        auto last = cur + (block_nodes - 1u) * node_size_;
+        push(first, last, block_nodes);
+
+        cur += block_nodes * node_size_;
+        no_nodes -= block_nodes;
+    }
+}
+
+void* concurrent_free_memory_list::allocate() noexcept
+{
+    auto head = head_.load(std::memory_order_acquire);
+    while (auto index = static_cast<std::uint32_t>(head & index_mask))
+    {
+        auto node = to_node(index);
+        // node might already be allocated by another thread and the next index garbage,
+        // but then the generation has changed and the exchange fails
+        auto next = get_next(node);
+        if (head_.compare_exchange_weak(head, make_head(head, next), std::memory_order_acquire,
+                                        std::memory_order_acquire))
+        {
+            capacity_.fetch_sub(1u, std::memory_order_relaxed);
+            return detail::debug_fill_new(node, node_size_, 0);
+        }
+    }
+    return nullptr;
+}
+
+void concurrent_free_memory_list::deallocate(void* ptr) noexcept
+{
+    auto index = to_index(ptr);
+    detail::debug_check_pointer([&] { return index != 0u; },
+                                allocator_info(FOONATHAN_MEMORY_LOG_PREFIX
+                                               "::detail::concurrent_free_memory_list",
+                                               this),
+                                ptr);
+
+    auto node = static_cast<char*>(detail::debug_fill_free(ptr, node_size_, 0));
+    push(index, node, 1u);
+}
+
+void concurrent_free_memory_list::deallocate(void* ptr, std::size_t n) noexcept
+{
+    FOONATHAN_MEMORY_ASSERT_MSG(n <= node_size_, "does not support array allocations");
+    (void)n;
+    deallocate(ptr);
+}
+
+std::size_t concurrent_free_memory_list::allocate_nodes(std::size_t n, void** out) noexcept
+{
+    if (n == 0u)
+        return 0u;
+
+    auto head = head_.load(std::memory_order_acquire);
+    while (true)
+    {
+        // collect the chain, the links might be garbage if another thread modified the list,
+        // but then the generation has changed and the exchange fails
+        std::size_t no_nodes = 0u;
+        auto        next     = static_cast<std::uint32_t>(head & index_mask);
+        while (no_nodes != n && next != 0u && is_valid(next))
+        {
+            auto node       = to_node(next);
+            out[no_nodes++] = node;
+            next            = get_next(node);
+        }
+
+        if (next != 0u && !is_valid(next))
+            // read a garbage link, the list has been modified in the meantime
+            head = head_.load(std::memory_order_acquire);
+        else if (no_nodes == 0u)
+            return 0u;
+        else if (head_.compare_exchange_weak(head, make_head(head, next),
+                                             std::memory_order_acquire,
+                                             std::memory_order_acquire))
+        {
+            capacity_.fetch_sub(no_nodes, std::memory_order_relaxed);
+            for (std::size_t i = 0u; i != no_nodes; ++i)
+                out[i] = detail::debug_fill_new(out[i], node_size_, 0);
+            return no_nodes;
+        }
+    }
+}
+
+void concurrent_free_memory_list::deallocate_nodes(void** ptrs, std::size_t n) noexcept
+{
+    if (n == 0u)
+        return;
+
+    auto info = allocator_info(FOONATHAN_MEMORY_LOG_PREFIX "::detail::concurrent_free_memory_list",
+                               this);
+    auto checked_index = [&](void* ptr)
+    {
+        auto index = to_index(ptr);
+        detail::debug_check_pointer([&] { return index != 0u; }, info, ptr);
+        return index;
+    };
+
+    // link the chain privately, then push it at once
+    auto first = checked_index(ptrs[0]);
+    auto last  = static_cast<char*>(detail::debug_fill_free(ptrs[0], node_size_, 0));
+    for (std::size_t i = 1u; i != n; ++i)
+    {
+        set_next(last, checked_index(ptrs[i]));
+        last = static_cast<char*>(detail::debug_fill_free(ptrs[i], node_size_, 0));
+    }
+    push(first, last, n);
+}
+
+void concurrent_free_memory_list::wait_for_growth() const noexcept
+{
+    while (growing_.load(std::memory_order_acquire))
+    {
+#if FOONATHAN_HOSTED_IMPLEMENTATION
+        std::this_thread::yield();
+#endif
+    }
+}
+
+bool concurrent_free_memory_list::can_insert(std::size_t size) const noexcept
+{
+    auto no_nodes   = size / node_size_;
+    auto no_entries = no_nodes / max_block_size + (no_nodes % max_block_size == 0u ? 0u : 1u);
+    return no_entries <= max_blocks - no_blocks_.load(std::memory_order_relaxed);
+}
+
+std::size_t concurrent_free_memory_list::alignment() const noexcept
+{
+    return alignment_for(node_size_);
+}
+
+char* concurrent_free_memory_list::to_node(std::uint32_t index) const noexcept
+{
+    FOONATHAN_MEMORY_ASSERT(index != 0u);
+    auto& block = blocks_[index >> node_bits];
+    return block.memory + ((index & node_mask) - 1u) * node_size_;
+}
+
+bool concurrent_free_memory_list::is_valid(std::uint32_t index) const noexcept
+{
+    auto block = std::size_t(index >> node_bits);
+    auto node  = index & node_mask;
+    return block < no_blocks_.load(std::memory_order_acquire) && node != 0u
+           && node <= blocks_[block].no_nodes;
+}
+
+std::uint32_t concurrent_free_memory_list::to_index(const void* node) const noexcept
+{
+    auto i = find_block(node);
+    if (i == 0u)
+        return 0u;
+
+    auto offset = static_cast<std::size_t>(static_cast<const char*>(node) - blocks_[i - 1u].memory);
+    if (offset % node_size_ != 0u)
+        return 0u;
+    return static_cast<std::uint32_t>(((i - 1u) << node_bits) + offset / node_size_ + 1u);
+}
+
+bool concurrent_free_memory_list::owns(const void* ptr) const noexcept
+{
+    return find_block(ptr) != 0u;
+}
+
+std::size_t concurrent_free_memory_list::find_block(const void* ptr) const noexcept
+{
+    // compare addresses, ptr might point anywhere
+    auto address = reinterpret_cast<std::uintptr_t>(ptr);
+    // search newest blocks first, they are the biggest ones
+    for (auto i = no_blocks_.load(std::memory_order_acquire); i != 0u; --i)
+    {
+        auto& block = blocks_[i - 1u];
+        auto  begin = reinterpret_cast<std::uintptr_t>(block.memory);
+        if (begin <= address && address - begin < block.no_nodes * node_size_)
+            return i;
+    }
+    return 0u;
+}
+
+void concurrent_free_memory_list::push(std::uint32_t first, char* last,
+                                       std::size_t no_nodes) noexcept
+{
+    // increment first, so the capacity never underflows when the nodes are allocated right away
+    capacity_.fetch_add(no_nodes, std::memory_order_relaxed);
+
+    auto head = head_.load(std::memory_order_relaxed);
+    do
+    {
+        set_next(last, static_cast<std::uint32_t>(head & index_mask));
+    } while (!head_.compare_exchange_weak(head, make_head(head, first),
+                                          std::memory_order_release,
+                                          std::memory_order_relaxed));
+}
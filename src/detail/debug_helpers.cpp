@@ -68,6 +68,28 @@ void* detail::debug_fill_free(void* memory, std::size_t node_size, std::size_t f
     return pre_fence;
 }
 
+void detail::debug_resize_node(void* memory, std::size_t old_size, std::size_t new_size,
+                               std::size_t fence_size) noexcept
+{
+    if (!debug_fence_size)
+        fence_size = 0u; // force override of fence_size
+
+    auto pre_fence = static_cast<unsigned char*>(memory) - fence_size;
+    if (auto pre_dirty = debug_is_filled(pre_fence, fence_size, debug_magic::fence_memory))
+        get_buffer_overflow_handler()(memory, old_size, pre_dirty);
+
+    auto post_mem = static_cast<unsigned char*>(memory) + old_size;
+    if (auto post_dirty = debug_is_filled(post_mem, fence_size, debug_magic::fence_memory))
+        get_buffer_overflow_handler()(memory, old_size, post_dirty);
+
+    auto mem = static_cast<char*>(memory);
+    if (new_size > old_size)
+        debug_fill(mem + old_size, new_size - old_size, debug_magic::new_memory);
+    else
+        debug_fill(mem + new_size, old_size - new_size + fence_size, debug_magic::freed_memory);
+    debug_fill(mem + new_size, fence_size, debug_magic::fence_memory);
+}
+
 void detail::debug_fill_internal(void* memory, std::size_t size, bool free) noexcept
 {
     debug_fill(memory, size,
@@ -5,11 +5,14 @@
 
 #include "detail/align.hpp"
 #include "detail/debug_helpers.hpp"
+#include "detail/ilog2.hpp"
 #include "detail/assert.hpp"
 #include "debugging.hpp"
 #include "error.hpp"
+#include "memory_arena.hpp"
 
 #include "free_list_utils.hpp"
+#include "treap.hpp"
 
 using namespace foonathan::memory;
 using namespace detail;
@@ -77,47 +80,6 @@ namespace
         // not enough continuous space
         return {nullptr, nullptr, nullptr, nullptr};
     }
-
-    // similar to list_search_array()
-    // begin/end are proxy nodes
-    interval xor_list_search_array(char* begin, char* end, std::size_t bytes_needed,
-                                   std::size_t node_size) noexcept
-    {
-        interval i;
-        i.prev  = begin;
-        i.first = xor_list_get_other(begin, nullptr);
-        // i.last/next are used as iterator for the end of the interval
-        i.last = i.first;
-        i.next = xor_list_get_other(i.last, i.prev);
-
-        auto bytes_so_far = node_size;
-        while (i.next != end)
-        {
-            if (i.last + node_size != i.next) // not continous
-            {
-                // restart at i.next
-                i.prev  = i.last;
-                i.first = i.next;
-                i.last  = i.next;
-                i.next  = xor_list_get_other(i.first, i.prev);
-
-                bytes_so_far = node_size;
-            }
-            else
-            {
-                // extend interval
-                auto new_next = xor_list_get_other(i.next, i.last);
-                i.last        = i.next;
-                i.next        = new_next;
-
-                bytes_so_far += node_size;
-                if (bytes_so_far >= bytes_needed)
-                    return i;
-            }
-        }
-        // not enough continuous space
-        return {nullptr, nullptr, nullptr, nullptr};
-    }
 } // namespace
 
 constexpr std::size_t free_memory_list::min_element_size;
@@ -125,6 +87,8 @@ constexpr std::size_t free_memory_list::min_element_alignment;
 
 free_memory_list::free_memory_list(std::size_t node_size) noexcept
 : first_(nullptr),
+  bump_begin_(nullptr),
+  bump_end_(nullptr),
   node_size_(node_size > min_element_size ? node_size : min_element_size),
   capacity_(0u)
 {
@@ -137,10 +101,16 @@ free_memory_list::free_memory_list(std::size_t node_size, void* mem, std::size_t
 }
 
 free_memory_list::free_memory_list(free_memory_list&& other) noexcept
-: first_(other.first_), node_size_(other.node_size_), capacity_(other.capacity_)
+: first_(other.first_),
+  bump_begin_(other.bump_begin_),
+  bump_end_(other.bump_end_),
+  node_size_(other.node_size_),
+  capacity_(other.capacity_)
 {
-    other.first_    = nullptr;
-    other.capacity_ = 0u;
+    other.first_      = nullptr;
+    other.bump_begin_ = nullptr;
+    other.bump_end_   = nullptr;
+    other.capacity_   = 0u;
 }
 
 free_memory_list& free_memory_list::operator=(free_memory_list&& other) noexcept
@@ -153,6 +123,8 @@ free_memory_list& free_memory_list::operator=(free_memory_list&& other) noexcept
 void foonathan::memory::detail::swap(free_memory_list& a, free_memory_list& b) noexcept
 {
     detail::adl_swap(a.first_, b.first_);
+    detail::adl_swap(a.bump_begin_, b.bump_begin_);
+    detail::adl_swap(a.bump_end_, b.bump_end_);
     detail::adl_swap(a.node_size_, b.node_size_);
     detail::adl_swap(a.capacity_, b.capacity_);
 }
@@ -163,7 +135,20 @@ void free_memory_list::insert(void* mem, std::size_t size) noexcept
     FOONATHAN_MEMORY_ASSERT(is_aligned(mem, alignment()));
     detail::debug_fill_internal(mem, size, false);
 
-    insert_impl(mem, size);
+    auto no_nodes = size / node_size_;
+    FOONATHAN_MEMORY_ASSERT(no_nodes > 0);
+
+    // only one region can be carved lazily, so link the rest of the previous one
+    if (bump_begin_ != bump_end_)
+    {
+        auto remaining = static_cast<std::size_t>(bump_end_ - bump_begin_);
+        capacity_ -= remaining / node_size_;
+        insert_impl(bump_begin_, remaining);
+    }
+
+    bump_begin_ = static_cast<char*>(mem);
+    bump_end_   = bump_begin_ + no_nodes * node_size_;
+    capacity_ += no_nodes;
 }
 
 void* free_memory_list::allocate() noexcept
@@ -172,7 +157,14 @@ void* free_memory_list::allocate() noexcept
     --capacity_;
 
     auto mem = first_;
-    first_   = list_get_next(first_);
+    if (mem)
+        first_ = list_get_next(first_);
+    else
+    {
+        // linked nodes are exhausted, carve the next one
+        mem = bump_begin_;
+        bump_begin_ += node_size_;
+    }
     return detail::debug_fill_new(mem, node_size_, 0);
 }
 
@@ -182,17 +174,30 @@ void* free_memory_list::allocate(std::size_t n) noexcept
     if (n <= node_size_)
         return allocate();
 
-    auto i = list_search_array(first_, n, node_size_);
-    if (i.first == nullptr)
-        return nullptr;
+    if (first_)
+    {
+        auto i = list_search_array(first_, n, node_size_);
+        if (i.first != nullptr)
+        {
+            if (i.prev)
+                list_set_next(i.prev, i.next); // change next from previous to first after
+            else
+                first_ = i.next;
+            capacity_ -= i.size(node_size_);
 
-    if (i.prev)
-        list_set_next(i.prev, i.next); // change next from previous to first after
-    else
-        first_ = i.next;
-    capacity_ -= i.size(node_size_);
+            return detail::debug_fill_new(i.first, n, 0);
+        }
+    }
 
-    return detail::debug_fill_new(i.first, n, 0);
+    // the bump region is continuous
+    auto no_nodes = n / node_size_ + (n % node_size_ == 0u ? 0u : 1u);
+    if (static_cast<std::size_t>(bump_end_ - bump_begin_) < no_nodes * node_size_)
+        return nullptr;
+
+    auto mem = bump_begin_;
+    bump_begin_ += no_nodes * node_size_;
+    capacity_ -= no_nodes;
+    return detail::debug_fill_new(mem, n, 0);
 }
 
 void free_memory_list::deallocate(void* ptr) noexcept
@@ -215,6 +220,98 @@ void free_memory_list::deallocate(void* ptr, std::size_t n) noexcept
     }
 }
 
+std::size_t free_memory_list::allocate_nodes(std::size_t n, void** out) noexcept
+{
+    // walk the chain and unlink it as a whole
+    auto        cur      = first_;
+    std::size_t no_nodes = 0u;
+    for (; no_nodes != n && cur; ++no_nodes)
+    {
+        out[no_nodes] = cur;
+        cur           = list_get_next(cur);
+    }
+    first_ = cur;
+
+    // carve the rest
+    for (; no_nodes != n && bump_begin_ != bump_end_; ++no_nodes)
+    {
+        out[no_nodes] = bump_begin_;
+        bump_begin_ += node_size_;
+    }
+    capacity_ -= no_nodes;
+
+    for (std::size_t i = 0u; i != no_nodes; ++i)
+        out[i] = detail::debug_fill_new(out[i], node_size_, 0);
+    return no_nodes;
+}
+
+void free_memory_list::deallocate_nodes(void** ptrs, std::size_t n) noexcept
+{
+    if (n == 0u)
+        return;
+
+    auto first = static_cast<char*>(detail::debug_fill_free(ptrs[0], node_size_, 0));
+    auto last  = first;
+    for (std::size_t i = 1u; i != n; ++i)
+    {
+        auto node = static_cast<char*>(detail::debug_fill_free(ptrs[i], node_size_, 0));
+        list_set_next(last, node);
+        last = node;
+    }
+    list_set_next(last, first_);
+    first_ = first;
+
+    capacity_ += n;
+}
+
+std::size_t free_memory_list::free_nodes_in(void* mem, std::size_t size) noexcept
+{
+    auto        begin    = static_cast<char*>(mem);
+    std::size_t no_nodes = 0u;
+    for (auto cur = first_; cur; cur = list_get_next(cur))
+        if (in_range(cur, begin, size))
+            ++no_nodes;
+
+    if (bump_begin_ != bump_end_ && in_range(bump_begin_, begin, size))
+        no_nodes += static_cast<std::size_t>(bump_end_ - bump_begin_) / node_size_;
+    return no_nodes;
+}
+
+void free_memory_list::count_free_nodes(memory_block_tally& tally) noexcept
+{
+    for (auto cur = first_; cur; cur = list_get_next(cur))
+        tally.add(cur, 1u);
+
+    if (bump_begin_ != bump_end_)
+        tally.add(bump_begin_, static_cast<std::size_t>(bump_end_ - bump_begin_) / node_size_);
+}
+
+void free_memory_list::remove_nodes_in(void* mem, std::size_t size) noexcept
+{
+    auto begin = static_cast<char*>(mem);
+
+    char* prev = nullptr;
+    for (auto cur = first_; cur; cur = list_get_next(cur))
+    {
+        if (!in_range(cur, begin, size))
+            prev = cur;
+        else
+        {
+            if (prev)
+                list_set_next(prev, list_get_next(cur));
+            else
+                first_ = list_get_next(cur);
+            --capacity_;
+        }
+    }
+
+    if (bump_begin_ != bump_end_ && in_range(bump_begin_, begin, size))
+    {
+        capacity_ -= static_cast<std::size_t>(bump_end_ - bump_begin_) / node_size_;
+        bump_begin_ = bump_end_ = nullptr;
+    }
+}
+
 std::size_t free_memory_list::alignment() const noexcept
 {
     return alignment_for(node_size_);
@@ -239,92 +336,400 @@ void free_memory_list::insert_impl(void* mem, std::size_t size) noexcept
 
 namespace
 {
-    // converts a block into a linked list
-    void xor_link_block(void* memory, std::size_t node_size, std::size_t no_nodes, char* prev,
-                        char* next) noexcept
+    //=== runs ===//
+    // a run starts with its xor link to the neighboring runs,
+    // followed by the number of nodes if the run is at least two pointers big
+    // if nodes are smaller, the lowest bit of the link marks whether or not the length is stored,
+    // otherwise it is always stored
+    constexpr std::size_t word_size = sizeof(std::uintptr_t);
+
+    bool has_length_flag(std::size_t node_size) noexcept
     {
-        auto cur = static_cast<char*>(memory);
-        xor_list_change(prev, next, cur); // change next pointer of prev
+        return node_size < 2u * word_size;
+    }
 
-        auto last_cur = prev;
-        for (std::size_t i = 0u; i != no_nodes - 1; ++i)
+    std::size_t round_node_size(std::size_t node_size) noexcept
+    {
+        if (node_size < ordered_free_memory_list::min_element_size)
+            return ordered_free_memory_list::min_element_size;
+        // the nodes must be aligned for the flag
+        else if (has_length_flag(node_size))
+            return node_size + node_size % 2u;
+        return node_size;
+    }
+
+    // returns the other run given one run
+    // also works on the proxy nodes
+    char* run_get_other(char* run, char* prev_or_next, std::size_t node_size) noexcept
+    {
+        auto link = get_int(run);
+        if (has_length_flag(node_size))
+            link &= ~std::uintptr_t(1u);
+        return from_int(link ^ to_int(prev_or_next));
+    }
+
+    // advances a run pair forward/backward
+    void run_iter_next(char*& cur, char*& prev, std::size_t node_size) noexcept
+    {
+        auto next = run_get_other(cur, prev, node_size);
+        prev      = cur;
+        cur       = next;
+    }
+
+    // sets the link, length must be set afterwards
+    void run_set(char* run, char* prev, char* next) noexcept
+    {
+        xor_list_set(run, prev, next);
+    }
+
+    // changes other run given one run, keeps the flag
+    void run_change(char* run, char* old_ptr, char* new_ptr) noexcept
+    {
+        set_int(run, get_int(run) ^ to_int(old_ptr) ^ to_int(new_ptr));
+    }
+
+    std::size_t run_length(char* run, std::size_t node_size) noexcept
+    {
+        if (!has_length_flag(node_size) || (get_int(run) & 1u) != 0u)
+            return static_cast<std::size_t>(get_int(run + word_size));
+        return 1u;
+    }
+
+    void run_set_length(char* run, std::size_t length, std::size_t node_size) noexcept
+    {
+        if (length * node_size >= 2u * word_size)
         {
-            xor_list_set(cur, last_cur,
-                         cur + node_size); // cur gets last_cur and next node in continous memory
-            last_cur = cur;
-            cur += node_size;
+            set_int(run + word_size, length);
+            if (has_length_flag(node_size))
+                set_int(run, get_int(run) | 1u);
+        }
+        else
+        {
+            FOONATHAN_MEMORY_ASSERT(length == 1u);
+            set_int(run, get_int(run) & ~std::uintptr_t(1u));
         }
-        xor_list_set(cur, last_cur, next); // last memory node gets next as next
-        xor_list_change(next, prev, cur);  // change prev pointer of next
     }
 
-    struct pos
+    char* run_end(char* run, std::size_t node_size) noexcept
     {
-        char *prev, *next;
+        return run + run_length(run, node_size) * node_size;
+    }
+
+    //=== index ===//
+    // runs that are at least four pointers big are also stored in a treap ordered by their size,
+    // the links to the children follow the length
+    bool is_indexed(std::size_t length, std::size_t node_size) noexcept
+    {
+        return length * node_size >= 4u * word_size;
+    }
+
+    void* index_child_link(char* run, bool right) noexcept
+    {
+        return run + (right ? 3u : 2u) * word_size;
+    }
+
+    char* index_child(char* run, bool right) noexcept
+    {
+        return from_int(get_int(index_child_link(run, right)));
+    }
+
+    struct index_access
+    {
+        using node = char;
+
+        static char* child(char* run, bool right) noexcept
+        {
+            return index_child(run, right);
+        }
+
+        static void set_child(char* run, bool right, char* child) noexcept
+        {
+            set_int(index_child_link(run, right), to_int(child));
+        }
     };
 
-    // finds position to insert memory to keep list ordered
-    // first_prev -> first -> ... (memory somewhere here) ... -> last -> last_next
-    pos find_pos_interval(const allocator_info& info, char* memory, char* first_prev, char* first,
-                          char* last, char* last_next) noexcept
+    using run_index = treap<index_access>;
+
+    // orders by length first, then by address
+    bool index_less(char* a, std::size_t a_length, char* b, std::size_t b_length) noexcept
+    {
+        return a_length < b_length || (a_length == b_length && less(a, b));
+    }
+
+    void index_insert(char*& root, char* run, std::size_t length, std::size_t node_size) noexcept
     {
-        // note: first_prev/last_next can be the proxy nodes, then first_prev isn't necessarily less than first!
-        FOONATHAN_MEMORY_ASSERT(less(first, memory) && less(memory, last));
+        if (!is_indexed(length, node_size))
+            return;
+        run_index::insert(root, run, [&](char* cur)
+                          { return index_less(run, length, cur, run_length(cur, node_size)); });
+    }
+
+    // length must be the length the run was inserted with
+    void index_erase(char*& root, char* run, std::size_t length, std::size_t node_size) noexcept
+    {
+        if (!is_indexed(length, node_size))
+            return;
+        run_index::erase(root, run, [&](char* cur)
+                         { return index_less(run, length, cur, run_length(cur, node_size)); });
+    }
 
-        // need to insert somewhere in the middle
-        // search through the entire list
-        // search from both ends at once
-        auto cur_forward  = first;
-        auto prev_forward = first_prev;
+    // returns the smallest run with at least no_nodes nodes or nullptr
+    char* index_find(char* root, std::size_t no_nodes, std::size_t node_size) noexcept
+    {
+        return run_index::lower_bound(root, [&](char* cur)
+                                      { return run_length(cur, node_size) >= no_nodes; });
+    }
+
+    //=== blocks ===//
+    // every inserted block starts with a header:
+    // the children in the treap of all blocks, the first node, the number of nodes,
+    // the children in the treap of the blocks that contain a run,
+    // followed by a hierarchical bitmap where a set bit marks the first node of a run
+    // both treaps are ordered by address
+    // the header need not be aligned, so it is accessed through get_int()/set_int()
+    template <std::size_t LeftWord>
+    struct block_access
+    {
+        using node = char;
 
-        auto cur_backward  = last;
-        auto prev_backward = last_next;
+        static char* child(char* block, bool right) noexcept
+        {
+            return from_int(get_int(block + (right ? LeftWord + 1u : LeftWord) * word_size));
+        }
 
-        do
+        static void set_child(char* block, bool right, char* child) noexcept
         {
-            if (greater(cur_forward, memory))
-                return {prev_forward, cur_forward};
-            else if (less(cur_backward, memory))
-                // the next position is the previous backwards pointer
-                return {cur_backward, prev_backward};
-            debug_check_double_dealloc([&]
-                                       { return cur_forward != memory && cur_backward != memory; },
-                                       info, memory);
-            xor_list_iter_next(cur_forward, prev_forward);
-            xor_list_iter_next(cur_backward, prev_backward);
-        } while (less(prev_forward, prev_backward));
-
-        // ran outside of list
-        debug_check_double_dealloc([] { return false; }, info, memory);
-        return {nullptr, nullptr};
-    }
-
-    // finds the position in the entire list
-    pos find_pos(const allocator_info& info, char* memory, char* begin_node, char* end_node,
-                 char* last_dealloc, char* last_dealloc_prev) noexcept
-    {
-        auto first = xor_list_get_other(begin_node, nullptr);
-        auto last  = xor_list_get_other(end_node, nullptr);
-
-        if (greater(first, memory))
-            // insert at front
-            return {begin_node, first};
-        else if (less(last, memory))
-            // insert at the end
-            return {last, end_node};
-        else if (less(last_dealloc_prev, memory) && less(memory, last_dealloc))
-            // insert before last_dealloc
-            return {last_dealloc_prev, last_dealloc};
-        else if (less(memory, last_dealloc))
-            // insert into [first, last_dealloc_prev]
-            return find_pos_interval(info, memory, begin_node, first, last_dealloc_prev,
-                                     last_dealloc);
-        else if (greater(memory, last_dealloc))
-            // insert into (last_dealloc, last]
-            return find_pos_interval(info, memory, last_dealloc_prev, last_dealloc, last, end_node);
-
-        FOONATHAN_MEMORY_UNREACHABLE("memory must be in some half or outside");
-        return {nullptr, nullptr};
+            set_int(block + (right ? LeftWord + 1u : LeftWord) * word_size, to_int(child));
+        }
+    };
+
+    using block_treap     = treap<block_access<0u>>;
+    using run_block_treap = treap<block_access<4u>>;
+
+    char* block_nodes(char* block) noexcept
+    {
+        return from_int(get_int(block + 2u * word_size));
+    }
+
+    std::size_t block_no_nodes(char* block) noexcept
+    {
+        return static_cast<std::size_t>(get_int(block + 3u * word_size));
+    }
+
+    // offset of the first node
+    std::size_t block_nodes_offset(std::size_t no_nodes, std::size_t alignment) noexcept
+    {
+        auto size = ordered_free_memory_list::block_header_size(no_nodes);
+        return size + align_offset(size, alignment);
+    }
+
+    // maximum number of nodes that fit into a block of given size
+    std::size_t nodes_in_block(std::size_t size, std::size_t node_size,
+                               std::size_t alignment) noexcept
+    {
+        auto fixed_size = ordered_free_memory_list::block_header_size(0u);
+        if (size <= fixed_size)
+            return 0u;
+
+        // every node needs one additional bit, start with that estimate and adjust downwards
+        auto no_nodes =
+            (size - fixed_size) * ordered_bitmap_bits / (node_size * ordered_bitmap_bits + 1u);
+        while (no_nodes > 0u
+               && block_nodes_offset(no_nodes, alignment) + no_nodes * node_size > size)
+            --no_nodes;
+        return no_nodes;
+    }
+
+    class run_bitmap
+    {
+    public:
+        static constexpr std::size_t npos = std::size_t(-1);
+
+        explicit run_bitmap(char* block) noexcept
+        : words_(block + 6u * word_size), no_bits_(block_no_nodes(block)), no_levels_(0u)
+        {
+            std::size_t offset = 0u, no_bits = no_bits_;
+            do
+            {
+                auto no_words = (no_bits + ordered_bitmap_bits - 1u) / ordered_bitmap_bits;
+                FOONATHAN_MEMORY_ASSERT(no_levels_ < max_levels);
+                offset_[no_levels_]   = offset;
+                no_words_[no_levels_] = no_words;
+                ++no_levels_;
+
+                offset += no_words;
+                no_bits = no_words;
+            } while (no_bits > 1u);
+        }
+
+        // zeroes all words
+        void clear_all() noexcept
+        {
+            auto total = offset_[no_levels_ - 1u] + 1u;
+            for (std::size_t i = 0u; i != total; ++i)
+                set_int(words_ + i * word_size, 0u);
+        }
+
+        // whether no bit is set, only needs the single top level word
+        bool empty() const noexcept
+        {
+            return get(no_levels_ - 1u, 0u) == 0u;
+        }
+
+        void set(std::size_t i) noexcept
+        {
+            for (std::size_t level = 0u; level != no_levels_; ++level)
+            {
+                auto word = get(level, i / ordered_bitmap_bits);
+                put(level, i / ordered_bitmap_bits, word | bit(i % ordered_bitmap_bits));
+                if (word != 0u)
+                    // the upper levels are already set
+                    break;
+                i /= ordered_bitmap_bits;
+            }
+        }
+
+        void clear(std::size_t i) noexcept
+        {
+            for (std::size_t level = 0u; level != no_levels_; ++level)
+            {
+                auto word = get(level, i / ordered_bitmap_bits) & ~bit(i % ordered_bitmap_bits);
+                put(level, i / ordered_bitmap_bits, word);
+                if (word != 0u)
+                    // the upper levels must stay set
+                    break;
+                i /= ordered_bitmap_bits;
+            }
+        }
+
+        // returns the greatest set index less than or equal to i, or npos
+        std::size_t find_prev(std::size_t i) const noexcept
+        {
+            for (std::size_t level = 0u; level != no_levels_; ++level)
+            {
+                auto index = i / ordered_bitmap_bits;
+                auto word  = get(level, index) & up_to(i % ordered_bitmap_bits);
+                if (word != 0u)
+                {
+                    // descend to the last set bit
+                    auto result = index * ordered_bitmap_bits + ilog2(word);
+                    while (level-- != 0u)
+                        result = result * ordered_bitmap_bits + ilog2(get(level, result));
+                    return result;
+                }
+                else if (index == 0u)
+                    break;
+                i = index - 1u;
+            }
+            return npos;
+        }
+
+        // returns the smallest set index greater than or equal to i, or npos
+        std::size_t find_next(std::size_t i) const noexcept
+        {
+            if (i >= no_bits_)
+                return npos;
+            for (std::size_t level = 0u; level != no_levels_; ++level)
+            {
+                auto index = i / ordered_bitmap_bits;
+                if (index == no_words_[level])
+                    break;
+                auto word = get(level, index) & ~(bit(i % ordered_bitmap_bits) - 1u);
+                if (word != 0u)
+                {
+                    // descend to the first set bit
+                    auto result = index * ordered_bitmap_bits + count_trailing_zeros(word);
+                    while (level-- != 0u)
+                        result =
+                            result * ordered_bitmap_bits + count_trailing_zeros(get(level, result));
+                    return result;
+                }
+                i = index + 1u;
+            }
+            return npos;
+        }
+
+        std::size_t find_first() const noexcept
+        {
+            return find_next(0u);
+        }
+
+        std::size_t find_last() const noexcept
+        {
+            return find_prev(no_bits_ - 1u);
+        }
+
+    private:
+        static constexpr std::size_t max_levels = 16u;
+
+        static std::uintptr_t bit(std::size_t i) noexcept
+        {
+            return std::uintptr_t(1u) << i;
+        }
+
+        // all bits up to and including i
+        static std::uintptr_t up_to(std::size_t i) noexcept
+        {
+            return i + 1u == ordered_bitmap_bits ? ~std::uintptr_t(0u) : bit(i + 1u) - 1u;
+        }
+
+        std::uintptr_t get(std::size_t level, std::size_t index) const noexcept
+        {
+            return get_int(words_ + (offset_[level] + index) * word_size);
+        }
+
+        void put(std::size_t level, std::size_t index, std::uintptr_t word) noexcept
+        {
+            set_int(words_ + (offset_[level] + index) * word_size, word);
+        }
+
+        char*       words_;
+        std::size_t no_bits_, no_levels_;
+        std::size_t offset_[max_levels], no_words_[max_levels];
+    };
+
+    constexpr std::size_t run_bitmap::npos;
+
+    // returns the last run of the blocks before block or the begin proxy
+    char* last_run_before(char* run_blocks, char* block, char* begin_node,
+                          std::size_t node_size) noexcept
+    {
+        auto prev = run_block_treap::last_before(run_blocks,
+                                                 [&](char* cur) { return !less(cur, block); });
+        return prev ? block_nodes(prev) + run_bitmap(prev).find_last() * node_size : begin_node;
+    }
+
+    // returns the first run of the blocks after block or the end proxy
+    char* first_run_after(char* run_blocks, char* block, char* end_node,
+                          std::size_t node_size) noexcept
+    {
+        auto next = run_block_treap::lower_bound(run_blocks,
+                                                 [&](char* cur) { return greater(cur, block); });
+        return next ? block_nodes(next) + run_bitmap(next).find_first() * node_size : end_node;
+    }
+
+    //=== position ===//
+    // prev is the last run starting at or before the memory, next the first run after it
+    struct pos
+    {
+        char *prev, *next;
+    };
+
+    // finds the position of memory inside the given block
+    pos find_pos(char* memory, char* block, char* run_blocks, char* begin_node, char* end_node,
+                 std::size_t node_size) noexcept
+    {
+        run_bitmap bitmap(block);
+        auto       nodes = block_nodes(block);
+        auto       index = static_cast<std::size_t>(memory - nodes) / node_size;
+
+        auto prev = bitmap.find_prev(index);
+        auto next = bitmap.find_next(index + 1u);
+        return {prev == run_bitmap::npos ?
+                    last_run_before(run_blocks, block, begin_node, node_size) :
+                    nodes + prev * node_size,
+                next == run_bitmap::npos ? first_run_after(run_blocks, block, end_node, node_size) :
+                                           nodes + next * node_size};
     }
 } // namespace
 
@@ -332,29 +737,35 @@ constexpr std::size_t ordered_free_memory_list::min_element_size;
 constexpr std::size_t ordered_free_memory_list::min_element_alignment;
 
 ordered_free_memory_list::ordered_free_memory_list(std::size_t node_size) noexcept
-: node_size_(node_size > min_element_size ? node_size : min_element_size),
-  capacity_(0u),
-  last_dealloc_(end_node()),
-  last_dealloc_prev_(begin_node())
+: index_root_(nullptr),
+  block_root_(nullptr),
+  run_block_root_(nullptr),
+  last_block_(nullptr),
+  node_size_(round_node_size(node_size)),
+  capacity_(0u)
 {
     xor_list_set(begin_node(), nullptr, end_node());
     xor_list_set(end_node(), begin_node(), nullptr);
 }
 
 ordered_free_memory_list::ordered_free_memory_list(ordered_free_memory_list&& other) noexcept
-: node_size_(other.node_size_), capacity_(other.capacity_)
+: index_root_(other.index_root_),
+  block_root_(other.block_root_),
+  run_block_root_(other.run_block_root_),
+  last_block_(other.last_block_),
+  node_size_(other.node_size_),
+  capacity_(other.capacity_)
 {
     if (!other.empty())
     {
-        auto first = xor_list_get_other(other.begin_node(), nullptr);
-        auto last  = xor_list_get_other(other.end_node(), nullptr);
+        auto first = run_get_other(other.begin_node(), nullptr, node_size_);
+        auto last  = run_get_other(other.end_node(), nullptr, node_size_);
 
         xor_list_set(begin_node(), nullptr, first);
-        xor_list_change(first, other.begin_node(), begin_node());
-        xor_list_change(last, other.end_node(), end_node());
+        run_change(first, other.begin_node(), begin_node());
+        run_change(last, other.end_node(), end_node());
         xor_list_set(end_node(), last, nullptr);
 
-        other.capacity_ = 0u;
         xor_list_set(other.begin_node(), nullptr, other.end_node());
         xor_list_set(other.end_node(), other.begin_node(), nullptr);
     }
@@ -364,25 +775,27 @@ ordered_free_memory_list::ordered_free_memory_list(ordered_free_memory_list&& ot
         xor_list_set(end_node(), begin_node(), nullptr);
     }
 
-    // for programming convenience, last_dealloc is reset
-    last_dealloc_prev_ = begin_node();
-    last_dealloc_      = xor_list_get_other(last_dealloc_prev_, nullptr);
+    other.index_root_     = nullptr;
+    other.block_root_     = nullptr;
+    other.run_block_root_ = nullptr;
+    other.last_block_     = nullptr;
+    other.capacity_       = 0u;
 }
 
 void foonathan::memory::detail::swap(ordered_free_memory_list& a,
                                      ordered_free_memory_list& b) noexcept
 {
-    auto a_first = xor_list_get_other(a.begin_node(), nullptr);
-    auto a_last  = xor_list_get_other(a.end_node(), nullptr);
+    auto a_first = run_get_other(a.begin_node(), nullptr, a.node_size_);
+    auto a_last  = run_get_other(a.end_node(), nullptr, a.node_size_);
 
-    auto b_first = xor_list_get_other(b.begin_node(), nullptr);
-    auto b_last  = xor_list_get_other(b.end_node(), nullptr);
+    auto b_first = run_get_other(b.begin_node(), nullptr, b.node_size_);
+    auto b_last  = run_get_other(b.end_node(), nullptr, b.node_size_);
 
     if (!a.empty())
     {
         xor_list_set(b.begin_node(), nullptr, a_first);
-        xor_list_change(a_first, a.begin_node(), b.begin_node());
-        xor_list_change(a_last, a.end_node(), b.end_node());
+        run_change(a_first, a.begin_node(), b.begin_node());
+        run_change(a_last, a.end_node(), b.end_node());
         xor_list_set(b.end_node(), a_last, nullptr);
     }
     else
@@ -394,8 +807,8 @@ void foonathan::memory::detail::swap(ordered_free_memory_list& a,
     if (!b.empty())
     {
         xor_list_set(a.begin_node(), nullptr, b_first);
-        xor_list_change(b_first, b.begin_node(), a.begin_node());
-        xor_list_change(b_last, b.end_node(), a.end_node());
+        run_change(b_first, b.begin_node(), a.begin_node());
+        run_change(b_last, b.end_node(), a.end_node());
         xor_list_set(a.end_node(), b_last, nullptr);
     }
     else
@@ -404,15 +817,12 @@ void foonathan::memory::detail::swap(ordered_free_memory_list& a,
         xor_list_set(a.end_node(), a.begin_node(), nullptr);
     }
 
+    detail::adl_swap(a.index_root_, b.index_root_);
+    detail::adl_swap(a.block_root_, b.block_root_);
+    detail::adl_swap(a.run_block_root_, b.run_block_root_);
+    detail::adl_swap(a.last_block_, b.last_block_);
     detail::adl_swap(a.node_size_, b.node_size_);
     detail::adl_swap(a.capacity_, b.capacity_);
-
-    // for programming convenience, last_dealloc is reset
-    a.last_dealloc_prev_ = a.begin_node();
-    a.last_dealloc_      = xor_list_get_other(a.last_dealloc_prev_, nullptr);
-
-    b.last_dealloc_prev_ = b.begin_node();
-    b.last_dealloc_      = xor_list_get_other(b.last_dealloc_prev_, nullptr);
 }
 
 void ordered_free_memory_list::insert(void* mem, std::size_t size) noexcept
@@ -421,34 +831,32 @@ void ordered_free_memory_list::insert(void* mem, std::size_t size) noexcept
     FOONATHAN_MEMORY_ASSERT(is_aligned(mem, alignment()));
     detail::debug_fill_internal(mem, size, false);
 
-    insert_impl(mem, size);
+    auto no_nodes = nodes_in_block(size, node_size_, alignment());
+    if (no_nodes == 0u)
+        return;
+
+    auto block = static_cast<char*>(mem);
+    set_int(block + 2u * word_size, to_int(block + block_nodes_offset(no_nodes, alignment())));
+    set_int(block + 3u * word_size, no_nodes);
+    run_bitmap(block).clear_all();
+    block_treap::insert(block_root_, block, [&](char* cur) { return less(block, cur); });
+
+    insert_run(block_nodes(block), no_nodes);
+}
+
+std::size_t ordered_free_memory_list::usable_size(std::size_t size) const noexcept
+{
+    return nodes_in_block(size, node_size_, alignment()) * node_size_;
 }
 
 void* ordered_free_memory_list::allocate() noexcept
 {
     FOONATHAN_MEMORY_ASSERT(!empty());
 
-    // remove first node
+    // take the last node of the first run, so it stays in place
     auto prev = begin_node();
-    auto node = xor_list_get_other(prev, nullptr);
-    auto next = xor_list_get_other(node, prev);
-
-    xor_list_set(prev, nullptr, next); // link prev to next
-    xor_list_change(next, node, prev); // change prev of next
-    --capacity_;
-
-    if (node == last_dealloc_)
-    {
-        // move last_dealloc_ one further in
-        last_dealloc_ = next;
-        FOONATHAN_MEMORY_ASSERT(last_dealloc_prev_ == prev);
-    }
-    else if (node == last_dealloc_prev_)
-    {
-        // now the previous node is the node before ours
-        last_dealloc_prev_ = prev;
-        FOONATHAN_MEMORY_ASSERT(last_dealloc_ == next);
-    }
+    auto run  = run_get_other(prev, nullptr, node_size_);
+    auto node = remove_from_run(prev, run, 1u);
 
     return detail::debug_fill_new(node, node_size_, 0);
 }
@@ -460,46 +868,38 @@ void* ordered_free_memory_list::allocate(std::size_t n) noexcept
     if (n <= node_size_)
         return allocate();
 
-    auto i = xor_list_search_array(begin_node(), end_node(), n, node_size_);
-    if (i.first == nullptr)
-        return nullptr;
-
-    xor_list_change(i.prev, i.first, i.next); // change next pointer from i.prev to i.next
-    xor_list_change(i.next, i.last, i.prev);  // change prev pointer from i.next to i.prev
-    capacity_ -= i.size(node_size_);
-
-    // if last_dealloc_ points into the array being removed
-    if ((less_equal(i.first, last_dealloc_) && less_equal(last_dealloc_, i.last)))
+    auto  no_nodes = (n + node_size_ - 1u) / node_size_;
+    char* prev     = nullptr;
+    auto  run      = index_find(index_root_, no_nodes, node_size_);
+    if (run && run_length(run, node_size_) == no_nodes)
     {
-        // move last_dealloc just outside range
-        last_dealloc_      = i.next;
-        last_dealloc_prev_ = i.prev;
+        // the entire run is removed, so its neighbor is needed
+        auto p = find_pos(run, find_block(run), run_block_root_, begin_node(), end_node(),
+                          node_size_);
+        FOONATHAN_MEMORY_ASSERT(p.prev == run);
+        prev = run_get_other(run, p.next, node_size_);
     }
-    // if the previous deallocation is the last element of the array
-    else if (last_dealloc_prev_ == i.last)
+    else if (!run && !is_indexed(no_nodes, node_size_))
     {
-        // it is now the last element before the array
-        FOONATHAN_MEMORY_ASSERT(last_dealloc_ == i.next);
-        last_dealloc_prev_ = i.prev;
+        // small runs aren't indexed, search the list for them
+        prev = begin_node();
+        run  = run_get_other(prev, nullptr, node_size_);
+        while (run != end_node() && run_length(run, node_size_) < no_nodes)
+            run_iter_next(run, prev, node_size_);
+        if (run == end_node())
+            run = nullptr;
     }
 
-    return detail::debug_fill_new(i.first, n, 0);
+    if (run == nullptr)
+        return nullptr;
+    auto mem = remove_from_run(prev, run, no_nodes);
+    return detail::debug_fill_new(mem, n, 0);
 }
 
 void ordered_free_memory_list::deallocate(void* ptr) noexcept
 {
     auto node = static_cast<char*>(debug_fill_free(ptr, node_size_, 0));
-
-    auto p =
-        find_pos(allocator_info(FOONATHAN_MEMORY_LOG_PREFIX "::detail::ordered_free_memory_list",
-                                this),
-                 node, begin_node(), end_node(), last_dealloc_, last_dealloc_prev_);
-
-    xor_list_insert(node, p.prev, p.next);
-    ++capacity_;
-
-    last_dealloc_      = node;
-    last_dealloc_prev_ = p.prev;
+    insert_run(node, 1u);
 }
 
 void ordered_free_memory_list::deallocate(void* ptr, std::size_t n) noexcept
@@ -508,12 +908,113 @@ void ordered_free_memory_list::deallocate(void* ptr, std::size_t n) noexcept
         deallocate(ptr);
     else
     {
-        auto mem  = detail::debug_fill_free(ptr, n, 0);
-        auto prev = insert_impl(mem, n);
+        auto mem = static_cast<char*>(detail::debug_fill_free(ptr, n, 0));
+        insert_run(mem, (n + node_size_ - 1u) / node_size_);
+    }
+}
 
-        last_dealloc_      = static_cast<char*>(mem);
-        last_dealloc_prev_ = prev;
+std::size_t ordered_free_memory_list::allocate_nodes(std::size_t n, void** out) noexcept
+{
+    std::size_t no_nodes = 0u;
+    while (no_nodes != n && !empty())
+    {
+        auto run   = run_get_other(begin_node(), nullptr, node_size_);
+        auto count = run_length(run, node_size_);
+        if (count > n - no_nodes)
+            count = n - no_nodes;
+
+        auto mem = remove_from_run(begin_node(), run, count);
+        for (std::size_t i = 0u; i != count; ++i)
+            out[no_nodes++] = detail::debug_fill_new(mem + i * node_size_, node_size_, 0);
     }
+    return no_nodes;
+}
+
+void ordered_free_memory_list::deallocate_nodes(void** ptrs, std::size_t n) noexcept
+{
+    for (std::size_t i = 0u; i != n; ++i)
+        deallocate(ptrs[i]);
+}
+
+std::size_t ordered_free_memory_list::free_nodes_in(void* mem, std::size_t size) noexcept
+{
+    // split the blocks inside the memory out of the treap and merge them back afterwards
+    auto  begin = static_cast<char*>(mem);
+    char *l, *m, *r;
+    block_treap::split(block_root_, [&](char* cur) { return !less(cur, begin); }, l, m);
+    block_treap::split(m, [&](char* cur) { return !less(cur, begin + size); }, m, r);
+
+    std::size_t no_nodes = 0u;
+    block_treap::for_each(m,
+                          [&](char* block)
+                          {
+                              run_bitmap bitmap(block);
+                              auto       nodes = block_nodes(block);
+                              for (auto i = bitmap.find_first(); i != run_bitmap::npos;)
+                              {
+                                  auto length = run_length(nodes + i * node_size_, node_size_);
+                                  no_nodes += length;
+                                  i = bitmap.find_next(i + length);
+                              }
+                          });
+
+    block_root_ = block_treap::merge(l, block_treap::merge(m, r));
+    return no_nodes;
+}
+
+void ordered_free_memory_list::count_free_nodes(memory_block_tally& tally) noexcept
+{
+    // a run never spans multiple inserted blocks
+    block_treap::for_each(block_root_,
+                          [&](char* block)
+                          {
+                              run_bitmap bitmap(block);
+                              auto       nodes = block_nodes(block);
+                              for (auto i = bitmap.find_first(); i != run_bitmap::npos;)
+                              {
+                                  auto run    = nodes + i * node_size_;
+                                  auto length = run_length(run, node_size_);
+                                  tally.add(run, length);
+                                  i = bitmap.find_next(i + length);
+                              }
+                          });
+}
+
+void ordered_free_memory_list::remove_nodes_in(void* mem, std::size_t size) noexcept
+{
+    // split the blocks inside the memory out of the treap and drop them
+    auto  begin = static_cast<char*>(mem);
+    char *l, *m, *r;
+    block_treap::split(block_root_, [&](char* cur) { return !less(cur, begin); }, l, m);
+    block_treap::split(m, [&](char* cur) { return !less(cur, begin + size); }, m, r);
+    block_root_ = block_treap::merge(l, r);
+
+    block_treap::for_each(m,
+                          [&](char* block)
+                          {
+                              if (last_block_ == block)
+                                  last_block_ = nullptr;
+
+                              // all nodes are free, so the block is a single run
+                              auto i = run_bitmap(block).find_first();
+                              if (i == run_bitmap::npos)
+                                  return;
+                              auto run    = block_nodes(block) + i * node_size_;
+                              auto length = run_length(run, node_size_);
+                              FOONATHAN_MEMORY_ASSERT_MSG(length == block_no_nodes(block),
+                                                          "block still has allocated nodes");
+                              index_erase(index_root_, run, length, node_size_);
+                              capacity_ -= length;
+
+                              auto prev = last_run_before(run_block_root_, block, begin_node(),
+                                                          node_size_);
+                              auto next = run_get_other(run, prev, node_size_);
+                              run_change(prev, run, next);
+                              run_change(next, run, prev);
+
+                              run_block_treap::erase(run_block_root_, block, [&](char* cur)
+                                                     { return less(block, cur); });
+                          });
 }
 
 std::size_t ordered_free_memory_list::alignment() const noexcept
@@ -521,26 +1022,124 @@ std::size_t ordered_free_memory_list::alignment() const noexcept
     return alignment_for(node_size_);
 }
 
-char* ordered_free_memory_list::insert_impl(void* mem, std::size_t size) noexcept
+void ordered_free_memory_list::insert_run(char* mem, std::size_t no_nodes) noexcept
 {
-    auto no_nodes = size / node_size_;
-    FOONATHAN_MEMORY_ASSERT(no_nodes > 0);
-
-    auto p =
-        find_pos(allocator_info(FOONATHAN_MEMORY_LOG_PREFIX "::detail::ordered_free_memory_list",
-                                this),
-                 static_cast<char*>(mem), begin_node(), end_node(), last_dealloc_,
-                 last_dealloc_prev_);
+    auto info =
+        allocator_info(FOONATHAN_MEMORY_LOG_PREFIX "::detail::ordered_free_memory_list", this);
 
-    xor_link_block(mem, node_size_, no_nodes, p.prev, p.next);
+    auto block = find_block(mem);
+    debug_check_pointer(
+        [&]
+        {
+            return block
+                   && static_cast<std::size_t>(mem - block_nodes(block)) % node_size_ == 0u;
+        },
+        info, mem);
+
+    auto p = find_pos(mem, block, run_block_root_, begin_node(), end_node(), node_size_);
+    auto mem_end = mem + no_nodes * node_size_;
+    debug_check_double_dealloc(
+        [&]
+        {
+            return (p.prev == begin_node() || !greater(run_end(p.prev, node_size_), mem))
+                   && (p.next == end_node() || !greater(mem_end, p.next));
+        },
+        info, mem);
     capacity_ += no_nodes;
 
-    if (p.prev == last_dealloc_prev_)
+    run_bitmap bitmap(block);
+    auto       index_of = [&](char* run)
+    { return static_cast<std::size_t>(run - block_nodes(block)) / node_size_; };
+    if (bitmap.empty())
+        // the block gets a run
+        run_block_treap::insert(run_block_root_, block,
+                                [&](char* cur) { return less(block, cur); });
+
+    if (p.next != end_node() && mem_end == p.next)
+    {
+        // merge with next, it is removed from the list
+        auto length = run_length(p.next, node_size_);
+        index_erase(index_root_, p.next, length, node_size_);
+        bitmap.clear(index_of(p.next));
+
+        auto next = run_get_other(p.next, p.prev, node_size_);
+        run_change(p.prev, p.next, next);
+        run_change(next, p.next, p.prev);
+
+        no_nodes += length;
+        p.next = next;
+    }
+
+    if (p.prev != begin_node() && run_end(p.prev, node_size_) == mem)
+    {
+        // merge with prev
+        auto length = run_length(p.prev, node_size_);
+        index_erase(index_root_, p.prev, length, node_size_);
+        run_set_length(p.prev, length + no_nodes, node_size_);
+        index_insert(index_root_, p.prev, length + no_nodes, node_size_);
+    }
+    else
+    {
+        // new run
+        run_set(mem, p.prev, p.next);
+        run_change(p.prev, p.next, mem);
+        run_change(p.next, p.prev, mem);
+        run_set_length(mem, no_nodes, node_size_);
+        index_insert(index_root_, mem, no_nodes, node_size_);
+        bitmap.set(index_of(mem));
+    }
+}
+
+char* ordered_free_memory_list::remove_from_run(char* prev, char* run,
+                                                std::size_t no_nodes) noexcept
+{
+    auto length = run_length(run, node_size_);
+    FOONATHAN_MEMORY_ASSERT(no_nodes <= length);
+    index_erase(index_root_, run, length, node_size_);
+    capacity_ -= no_nodes;
+
+    if (length == no_nodes)
+    {
+        auto next = run_get_other(run, prev, node_size_);
+        run_change(prev, run, next);
+        run_change(next, run, prev);
+
+        auto       block = find_block(run);
+        run_bitmap bitmap(block);
+        bitmap.clear(static_cast<std::size_t>(run - block_nodes(block)) / node_size_);
+        if (bitmap.empty())
+            // the block has no runs anymore
+            run_block_treap::erase(run_block_root_, block,
+                                   [&](char* cur) { return less(block, cur); });
+    }
+    else
     {
-        last_dealloc_ = static_cast<char*>(mem);
+        run_set_length(run, length - no_nodes, node_size_);
+        index_insert(index_root_, run, length - no_nodes, node_size_);
     }
 
-    return p.prev;
+    return run + (length - no_nodes) * node_size_;
+}
+
+char* ordered_free_memory_list::find_block(char* node) noexcept
+{
+    auto contains = [&](char* block)
+    {
+        auto nodes = block_nodes(block);
+        return !less(node, nodes) && less(node, nodes + block_no_nodes(block) * node_size_);
+    };
+
+    // consecutive operations are often in the same block
+    if (last_block_ && contains(last_block_))
+        return last_block_;
+
+    auto block = block_treap::last_before(block_root_, [&](char* cur) { return less(node, cur); });
+    if (block && contains(block))
+    {
+        last_block_ = block;
+        return block;
+    }
+    return nullptr;
 }
 
 char* ordered_free_memory_list::begin_node() noexcept
@@ -19,3 +19,30 @@ std::size_t log2_access_policy::size_from_index(std::size_t index) noexcept
 {
     return std::size_t(1) << index;
 }
+
+std::size_t foonathan::memory::detail::geometric_index_from_size(std::size_t size,
+                                                                 std::size_t log2_sub) noexcept
+{
+    auto sub_classes = std::size_t(1u) << log2_sub;
+    if (size <= sub_classes)
+        return size;
+
+    // size is in (2^p, 2^(p + 1)]
+    auto p     = ilog2(size - 1u);
+    auto shift = p - log2_sub;
+    auto step  = std::size_t(1u) << shift;
+    return (shift + 1u) * sub_classes + ((size - (std::size_t(1u) << p) + step - 1u) >> shift);
+}
+
+std::size_t foonathan::memory::detail::geometric_size_from_index(std::size_t index,
+                                                                 std::size_t log2_sub) noexcept
+{
+    auto sub_classes = std::size_t(1u) << log2_sub;
+    if (index <= sub_classes)
+        return index;
+
+    auto i     = index - sub_classes - 1u;
+    auto shift = i >> log2_sub;
+    auto j     = (i & (sub_classes - 1u)) + 1u;
+    return (std::size_t(1u) << (shift + log2_sub)) + (j << shift);
+}
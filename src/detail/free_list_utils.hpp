@@ -141,6 +141,12 @@ namespace foonathan
             {
                 return a == b || greater(a, b);
             }
+
+            // whether address is inside [begin, begin + size)
+            inline bool in_range(void* address, char* begin, std::size_t size) noexcept
+            {
+                return less_equal(begin, address) && less(address, begin + size);
+            }
         } // namespace detail
     } // namespace memory
 } // namespace foonathan
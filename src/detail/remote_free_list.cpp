@@ -0,0 +1,148 @@
+// Copyright (C) 2015-2025 Jonathan Müller and foonathan/memory contributors
+// SPDX-License-Identifier: Zlib
+
+#include "detail/remote_free_list.hpp"
+
+#include "detail/assert.hpp"
+#include "memory_arena.hpp"
+
+#include "free_list_utils.hpp"
+
+using namespace foonathan::memory;
+using namespace detail;
+
+namespace
+{
+    thread_local char thread_tag;
+} // namespace
+
+const void* foonathan::memory::detail::this_thread_tag() noexcept
+{
+    return &thread_tag;
+}
+
+constexpr std::size_t remote_free_memory_list::min_element_size;
+constexpr std::size_t remote_free_memory_list::min_element_alignment;
+
+remote_free_memory_list::remote_free_memory_list(std::size_t node_size) noexcept
+: local_(node_size), remote_(nullptr), owner_(this_thread_tag())
+{
+}
+
+remote_free_memory_list::remote_free_memory_list(remote_free_memory_list&& other) noexcept
+: local_(detail::move(other.local_)),
+  remote_(other.remote_.exchange(nullptr)),
+  owner_(other.owner_.load(std::memory_order_relaxed))
+{
+}
+
+void foonathan::memory::detail::swap(remote_free_memory_list& a,
+                                     remote_free_memory_list& b) noexcept
+{
+    swap(a.local_, b.local_);
+    a.remote_ = b.remote_.exchange(a.remote_.load());
+    a.owner_ = b.owner_.exchange(a.owner_.load());
+}
+
+void* remote_free_memory_list::allocate() noexcept
+{
+    if (local_.empty())
+        drain();
+    return local_.allocate();
+}
+
+void remote_free_memory_list::deallocate(void* ptr) noexcept
+{
+    if (is_owner())
+        local_.deallocate(ptr);
+    else
+    {
+        auto node = static_cast<char*>(ptr);
+        auto head = remote_.load(std::memory_order_relaxed);
+        do
+        {
+            list_set_next(node, head);
+        } while (!remote_.compare_exchange_weak(head, node, std::memory_order_release,
+                                                std::memory_order_relaxed));
+    }
+}
+
+void remote_free_memory_list::deallocate(void* ptr, std::size_t n) noexcept
+{
+    FOONATHAN_MEMORY_ASSERT_MSG(n <= node_size(), "does not support array allocations");
+    (void)n;
+    deallocate(ptr);
+}
+
+std::size_t remote_free_memory_list::allocate_nodes(std::size_t n, void** out) noexcept
+{
+    if (local_.capacity() < n)
+        drain();
+    return local_.allocate_nodes(n, out);
+}
+
+void remote_free_memory_list::deallocate_nodes(void** ptrs, std::size_t n) noexcept
+{
+    if (n == 0u)
+        return;
+    else if (is_owner())
+    {
+        local_.deallocate_nodes(ptrs, n);
+        return;
+    }
+
+    // link the chain privately, then push it at once
+    auto first = static_cast<char*>(ptrs[0]);
+    auto last  = first;
+    for (std::size_t i = 1u; i != n; ++i)
+    {
+        auto node = static_cast<char*>(ptrs[i]);
+        list_set_next(last, node);
+        last = node;
+    }
+
+    auto head = remote_.load(std::memory_order_relaxed);
+    do
+    {
+        list_set_next(last, head);
+    } while (!remote_.compare_exchange_weak(head, first, std::memory_order_release,
+                                            std::memory_order_relaxed));
+}
+
+std::size_t remote_free_memory_list::free_nodes_in(void* mem, std::size_t size) noexcept
+{
+    FOONATHAN_MEMORY_ASSERT(is_owner());
+    drain();
+    return local_.free_nodes_in(mem, size);
+}
+
+void remote_free_memory_list::count_free_nodes(memory_block_tally& tally) noexcept
+{
+    FOONATHAN_MEMORY_ASSERT(is_owner());
+    drain();
+    local_.count_free_nodes(tally);
+}
+
+void remote_free_memory_list::remove_nodes_in(void* mem, std::size_t size) noexcept
+{
+    FOONATHAN_MEMORY_ASSERT(is_owner());
+    drain();
+    local_.remove_nodes_in(mem, size);
+}
+
+void remote_free_memory_list::drain() noexcept
+{
+    FOONATHAN_MEMORY_ASSERT_MSG(is_owner(), "only the owner may allocate");
+    // the owner is the only consumer and takes everything, so there is no ABA problem
+    // other threads do not touch the debug fill, the nodes are marked as freed here:
+    // local_.deallocate_nodes() fills each of them just like a local deallocation
+    auto cur = remote_.exchange(nullptr, std::memory_order_acquire);
+    while (cur)
+    {
+        void*       batch[64];
+        std::size_t no_nodes = 0u;
+        for (; cur && no_nodes != sizeof(batch) / sizeof(batch[0]); cur = list_get_next(cur))
+            batch[no_nodes++] = cur;
+        local_.deallocate_nodes(batch, no_nodes);
+    }
+}
@@ -3,41 +3,70 @@
 
 #include "detail/small_free_list.hpp"
 
+#include <cstdint>
+#include <cstring>
 #include <new>
 
 #include "detail/debug_helpers.hpp"
 #include "detail/assert.hpp"
 #include "error.hpp"
+#include "memory_arena.hpp"
 
 #include "free_list_utils.hpp"
+#include "treap.hpp"
 
 using namespace foonathan::memory;
 using namespace detail;
 
-struct foonathan::memory::detail::chunk : chunk_base
+namespace
 {
+    // the index of the next free node is stored in the node, which need not be aligned
+    template <typename ChunkIndex>
+    ChunkIndex get_index(unsigned char* node) noexcept
+    {
+        ChunkIndex index;
+        std::memcpy(&index, node, sizeof(index));
+        return index;
+    }
+
+    template <typename ChunkIndex>
+    void set_index(unsigned char* node, ChunkIndex index) noexcept
+    {
+        std::memcpy(node, &index, sizeof(index));
+    }
+} // namespace
+
+template <typename ChunkIndex>
+struct foonathan::memory::detail::chunk : chunk_base<ChunkIndex>
+{
+    using chunk_base<ChunkIndex>::first_free;
+    using chunk_base<ChunkIndex>::capacity;
+    using chunk_base<ChunkIndex>::no_nodes;
+
     // gives it the size of the memory block it is created in and the size of a node
     chunk(std::size_t total_memory, std::size_t node_size) noexcept
-    : chunk_base(static_cast<unsigned char>((total_memory - chunk_memory_offset) / node_size))
+    : chunk_base<ChunkIndex>(static_cast<ChunkIndex>(
+        (total_memory - chunk_memory_offset<ChunkIndex>()) / node_size))
     {
-        static_assert(sizeof(chunk) == sizeof(chunk_base), "chunk must not have members");
-        FOONATHAN_MEMORY_ASSERT((total_memory - chunk_memory_offset) / node_size
-                                <= chunk_max_nodes);
+        static_assert(sizeof(chunk) == sizeof(chunk_base<ChunkIndex>),
+                      "chunk must not have members");
+        FOONATHAN_MEMORY_ASSERT((total_memory - chunk_memory_offset<ChunkIndex>()) / node_size
+                                <= chunk_max_nodes<ChunkIndex>());
         FOONATHAN_MEMORY_ASSERT(capacity > 0);
         auto p = list_memory();
-        for (unsigned char i = 0u; i != no_nodes; p += node_size)
-            *p = ++i;
+        for (ChunkIndex i = 0u; i != no_nodes; p += node_size)
+            set_index(p, ++i);
     }
 
     // returns memory of the free list
     unsigned char* list_memory() noexcept
     {
         auto mem = static_cast<void*>(this);
-        return static_cast<unsigned char*>(mem) + chunk_memory_offset;
+        return static_cast<unsigned char*>(mem) + chunk_memory_offset<ChunkIndex>();
     }
 
     // returns the nth node
-    unsigned char* node_memory(unsigned char i, std::size_t node_size) noexcept
+    unsigned char* node_memory(ChunkIndex i, std::size_t node_size) noexcept
     {
         FOONATHAN_MEMORY_ASSERT(i < no_nodes);
         return list_memory() + i * node_size;
@@ -60,7 +89,7 @@ struct foonathan::memory::detail::chunk : chunk_base
             auto cur_mem = node_memory(cur_index, node_size);
             if (cur_mem == node)
                 return true;
-            cur_index = *cur_mem;
+            cur_index = get_index<ChunkIndex>(cur_mem);
         }
         return false;
     }
@@ -72,17 +101,17 @@ struct foonathan::memory::detail::chunk : chunk_base
         --capacity;
 
         auto node  = node_memory(first_free, node_size);
-        first_free = *node;
+        first_free = get_index<ChunkIndex>(node);
         return node;
     }
 
     // deallocates a single node given its address and index
     // it must be from this chunk
-    void deallocate(unsigned char* node, unsigned char node_index) noexcept
+    void deallocate(unsigned char* node, ChunkIndex node_index) noexcept
     {
         ++capacity;
 
-        *node      = first_free;
+        set_index(node, first_free);
         first_free = node_index;
     }
 };
@@ -90,20 +119,24 @@ struct foonathan::memory::detail::chunk : chunk_base
 namespace
 {
     // converts a chunk_base to a chunk (if it is one)
-    chunk* make_chunk(chunk_base* c) noexcept
+    template <typename ChunkIndex>
+    chunk<ChunkIndex>* make_chunk(chunk_base<ChunkIndex>* c) noexcept
     {
-        return static_cast<chunk*>(c);
+        return static_cast<chunk<ChunkIndex>*>(c);
     }
 
     // same as above but also requires a certain size
-    chunk* make_chunk(chunk_base* c, std::size_t size_needed) noexcept
+    template <typename ChunkIndex>
+    chunk<ChunkIndex>* make_chunk(chunk_base<ChunkIndex>* c, std::size_t size_needed) noexcept
     {
-        FOONATHAN_MEMORY_ASSERT(size_needed <= chunk_max_nodes);
+        FOONATHAN_MEMORY_ASSERT(size_needed <= chunk_max_nodes<ChunkIndex>());
         return c->capacity >= size_needed ? make_chunk(c) : nullptr;
     }
 
     // checks if memory was from a chunk, assumes chunk isn't proxy
-    chunk* from_chunk(chunk_base* c, unsigned char* node, std::size_t node_size) noexcept
+    template <typename ChunkIndex>
+    chunk<ChunkIndex>* from_chunk(chunk_base<ChunkIndex>* c, unsigned char* node,
+                                  std::size_t node_size) noexcept
     {
         auto res = make_chunk(c);
         return res->from(node, node_size) ? res : nullptr;
@@ -111,7 +144,9 @@ namespace
 
     // inserts already interconnected chunks into the list
     // list will be kept ordered
-    void insert_chunks(chunk_base* list, chunk_base* begin, chunk_base* end) noexcept
+    template <typename ChunkIndex>
+    void insert_chunks(chunk_base<ChunkIndex>* list, chunk_base<ChunkIndex>* begin,
+                       chunk_base<ChunkIndex>* end) noexcept
     {
         FOONATHAN_MEMORY_ASSERT(begin && end);
 
@@ -146,25 +181,86 @@ namespace
             cur->prev   = end;
         }
     }
-} // namespace
 
-constexpr std::size_t small_free_memory_list::min_element_size;
-constexpr std::size_t small_free_memory_list::min_element_alignment;
+    //=== region treap ===//
+    // the regions are ordered by address
+    struct region_access
+    {
+        using node = chunk_region;
+
+        static chunk_region* child(chunk_region* r, bool right) noexcept
+        {
+            return right ? r->right : r->left;
+        }
+
+        static void set_child(chunk_region* r, bool right, chunk_region* child) noexcept
+        {
+            (right ? r->right : r->left) = child;
+        }
+    };
 
-small_free_memory_list::small_free_memory_list(std::size_t node_size) noexcept
-: node_size_(node_size), capacity_(0u), alloc_chunk_(&base_), dealloc_chunk_(&base_)
+    using region_treap = treap<region_access>;
+
+    void region_insert(chunk_region*& root, chunk_region* region) noexcept
+    {
+        region_treap::insert(root, region, [&](chunk_region* cur) { return less(region, cur); });
+    }
+
+    // erases all regions inside [begin, begin + size)
+    void region_erase_in(chunk_region*& root, char* begin, std::size_t size) noexcept
+    {
+        chunk_region *l, *m, *r;
+        region_treap::split(root, [&](chunk_region* cur) { return less_equal(begin, cur); }, l,
+                            m);
+        region_treap::split(m, [&](chunk_region* cur) { return less_equal(begin + size, cur); },
+                            m, r);
+        root = region_treap::merge(l, r);
+    }
+
+    // returns the region containing node or nullptr
+    chunk_region* region_find(chunk_region* root, unsigned char* node) noexcept
+    {
+        auto region =
+            region_treap::last_before(root, [&](chunk_region* cur) { return less(node, cur); });
+        return region && less(node, region->end) ? region : nullptr;
+    }
+
+    char* region_chunks(chunk_region* region) noexcept
+    {
+        return static_cast<char*>(static_cast<void*>(region)) + chunk_region_offset;
+    }
+} // namespace
+
+template <typename ChunkIndex>
+constexpr std::size_t basic_small_free_memory_list<ChunkIndex>::min_element_size;
+template <typename ChunkIndex>
+constexpr std::size_t basic_small_free_memory_list<ChunkIndex>::min_element_alignment;
+
+template <typename ChunkIndex>
+basic_small_free_memory_list<ChunkIndex>::basic_small_free_memory_list(
+    std::size_t node_size) noexcept
+: regions_(nullptr),
+  node_size_(node_size > min_element_size ? node_size : min_element_size),
+  capacity_(0u),
+  alloc_chunk_(&base_),
+  dealloc_chunk_(&base_)
 {
 }
 
-small_free_memory_list::small_free_memory_list(std::size_t node_size, void* mem,
-                                               std::size_t size) noexcept
-: small_free_memory_list(node_size)
+template <typename ChunkIndex>
+basic_small_free_memory_list<ChunkIndex>::basic_small_free_memory_list(std::size_t node_size,
+                                                                       void*       mem,
+                                                                       std::size_t size) noexcept
+: basic_small_free_memory_list(node_size)
 {
     insert(mem, size);
 }
 
-small_free_memory_list::small_free_memory_list(small_free_memory_list&& other) noexcept
-: node_size_(other.node_size_),
+template <typename ChunkIndex>
+basic_small_free_memory_list<ChunkIndex>::basic_small_free_memory_list(
+    basic_small_free_memory_list&& other) noexcept
+: regions_(other.regions_),
+  node_size_(other.node_size_),
   capacity_(other.capacity_),
   // reset markers for simplicity
   alloc_chunk_(&base_),
@@ -179,6 +275,7 @@ small_free_memory_list::small_free_memory_list(small_free_memory_list&& other) n
 
         other.base_.next = &other.base_;
         other.base_.prev = &other.base_;
+        other.regions_   = nullptr;
         other.capacity_  = 0u;
     }
     else
@@ -188,7 +285,9 @@ small_free_memory_list::small_free_memory_list(small_free_memory_list&& other) n
     }
 }
 
-void foonathan::memory::detail::swap(small_free_memory_list& a, small_free_memory_list& b) noexcept
+template <typename ChunkIndex>
+void foonathan::memory::detail::swap(basic_small_free_memory_list<ChunkIndex>& a,
+                                     basic_small_free_memory_list<ChunkIndex>& b) noexcept
 {
     auto b_next = b.base_.next;
     auto b_prev = b.base_.prev;
@@ -219,6 +318,7 @@ void foonathan::memory::detail::swap(small_free_memory_list& a, small_free_memor
         a.base_.prev = &a.base_;
     }
 
+    detail::adl_swap(a.regions_, b.regions_);
     detail::adl_swap(a.node_size_, b.node_size_);
     detail::adl_swap(a.capacity_, b.capacity_);
 
@@ -227,26 +327,34 @@ void foonathan::memory::detail::swap(small_free_memory_list& a, small_free_memor
     b.alloc_chunk_ = b.dealloc_chunk_ = &b.base_;
 }
 
-void small_free_memory_list::insert(void* mem, std::size_t size) noexcept
+template <typename ChunkIndex>
+void basic_small_free_memory_list<ChunkIndex>::insert(void* mem, std::size_t size) noexcept
 {
     FOONATHAN_MEMORY_ASSERT(mem);
     FOONATHAN_MEMORY_ASSERT(is_aligned(mem, max_alignment));
     debug_fill_internal(mem, size, false);
 
-    auto total_chunk_size = chunk_memory_offset + node_size_ * chunk_max_nodes;
-    auto align_buffer     = align_offset(total_chunk_size, alignof(chunk));
+    FOONATHAN_MEMORY_ASSERT_MSG(size > chunk_region_offset, "memory block too small");
+    if (size <= chunk_region_offset)
+        return;
+    auto region = ::new (mem) chunk_region(nullptr);
+    size -= chunk_region_offset;
+
+    auto total_chunk_size =
+        chunk_memory_offset<ChunkIndex>() + node_size_ * chunk_max_nodes<ChunkIndex>();
+    auto align_buffer     = align_offset(total_chunk_size, alignof(chunk_type));
 
     auto no_chunks = size / (total_chunk_size + align_buffer);
     auto remainder = size % (total_chunk_size + align_buffer);
 
-    auto memory          = static_cast<char*>(mem);
+    auto memory          = region_chunks(region);
     auto construct_chunk = [&](std::size_t total_memory, std::size_t node_size)
     {
-        FOONATHAN_MEMORY_ASSERT(align_offset(memory, alignof(chunk)) == 0);
-        return ::new (static_cast<void*>(memory)) chunk(total_memory, node_size);
+        FOONATHAN_MEMORY_ASSERT(align_offset(memory, alignof(chunk_type)) == 0);
+        return ::new (static_cast<void*>(memory)) chunk_type(total_memory, node_size);
     };
 
-    auto prev = static_cast<chunk_base*>(nullptr);
+    auto prev = static_cast<chunk_type*>(nullptr);
     for (auto i = std::size_t(0); i != no_chunks; ++i)
     {
         auto c = construct_chunk(total_chunk_size, node_size_);
@@ -260,8 +368,8 @@ void small_free_memory_list::insert(void* mem, std::size_t size) noexcept
         memory += align_buffer;
     }
 
-    auto new_nodes = no_chunks * chunk_max_nodes;
-    if (remainder >= chunk_memory_offset + node_size_) // at least one node
+    auto new_nodes = no_chunks * chunk_max_nodes<ChunkIndex>();
+    if (remainder >= chunk_memory_offset<ChunkIndex>() + node_size_) // at least one node
     {
         auto c = construct_chunk(remainder, node_size_);
 
@@ -274,21 +382,38 @@ void small_free_memory_list::insert(void* mem, std::size_t size) noexcept
     }
 
     FOONATHAN_MEMORY_ASSERT_MSG(new_nodes > 0, "memory block too small");
-    insert_chunks(&base_, static_cast<chunk_base*>(mem), prev);
+    if (new_nodes == 0u)
+        return;
+    region->end = reinterpret_cast<char*>(prev->list_memory() + prev->no_nodes * node_size_);
+    region_insert(regions_, region);
+
+    insert_chunks(&base_, static_cast<chunk_base_type*>(static_cast<void*>(region_chunks(region))),
+                  prev);
     capacity_ += new_nodes;
 }
 
-std::size_t small_free_memory_list::usable_size(std::size_t size) const noexcept
+template <typename ChunkIndex>
+std::size_t basic_small_free_memory_list<ChunkIndex>::usable_size(std::size_t size) const noexcept
 {
-    auto total_chunk_size = chunk_memory_offset + node_size_ * chunk_max_nodes;
-    auto no_chunks        = size / total_chunk_size;
-    auto remainder        = size % total_chunk_size;
-
-    return no_chunks * chunk_max_nodes * node_size_
-           + (remainder > chunk_memory_offset ? remainder - chunk_memory_offset : 0u);
+    // same layout as in insert()
+    if (size <= chunk_region_offset)
+        return 0u;
+    size -= chunk_region_offset;
+
+    auto total_chunk_size =
+        chunk_memory_offset<ChunkIndex>() + node_size_ * chunk_max_nodes<ChunkIndex>();
+    auto align_buffer     = align_offset(total_chunk_size, alignof(chunk_type));
+    auto no_chunks        = size / (total_chunk_size + align_buffer);
+    auto remainder        = size % (total_chunk_size + align_buffer);
+
+    return no_chunks * chunk_max_nodes<ChunkIndex>() * node_size_
+           + (remainder > chunk_memory_offset<ChunkIndex>() ?
+                  remainder - chunk_memory_offset<ChunkIndex>() :
+                  0u);
 }
 
-void* small_free_memory_list::allocate() noexcept
+template <typename ChunkIndex>
+void* basic_small_free_memory_list<ChunkIndex>::allocate() noexcept
 {
     auto chunk   = find_chunk_impl(1);
     alloc_chunk_ = chunk;
@@ -301,7 +426,8 @@ void* small_free_memory_list::allocate() noexcept
     return detail::debug_fill_new(mem, node_size_, 0);
 }
 
-void small_free_memory_list::deallocate(void* mem) noexcept
+template <typename ChunkIndex>
+void basic_small_free_memory_list<ChunkIndex>::deallocate(void* mem) noexcept
 {
     auto info =
         allocator_info(FOONATHAN_MEMORY_LOG_PREFIX "::detail::small_free_memory_list", this);
@@ -321,17 +447,87 @@ void small_free_memory_list::deallocate(void* mem) noexcept
 
     auto index = offset / node_size_;
     FOONATHAN_MEMORY_ASSERT(index < chunk->no_nodes);
-    chunk->deallocate(node, static_cast<unsigned char>(index));
+    chunk->deallocate(node, static_cast<ChunkIndex>(index));
 
     ++capacity_;
 }
 
-std::size_t small_free_memory_list::alignment() const noexcept
+template <typename ChunkIndex>
+std::size_t basic_small_free_memory_list<ChunkIndex>::allocate_nodes(std::size_t n,
+                                                                    void**      out) noexcept
+{
+    // nodes are spread over the chunks, so allocate them one by one
+    auto no_nodes = n < capacity_ ? n : capacity_;
+    for (std::size_t i = 0u; i != no_nodes; ++i)
+        out[i] = allocate();
+    return no_nodes;
+}
+
+template <typename ChunkIndex>
+void basic_small_free_memory_list<ChunkIndex>::deallocate_nodes(void** ptrs, std::size_t n) noexcept
+{
+    for (std::size_t i = 0u; i != n; ++i)
+        deallocate(ptrs[i]);
+}
+
+template <typename ChunkIndex>
+std::size_t basic_small_free_memory_list<ChunkIndex>::free_nodes_in(void*       mem,
+                                                                   std::size_t size) noexcept
+{
+    auto        begin    = static_cast<char*>(mem);
+    std::size_t no_nodes = 0u;
+    for (auto cur = base_.next; cur != &base_; cur = cur->next)
+        if (in_range(cur, begin, size))
+            no_nodes += cur->capacity;
+    return no_nodes;
+}
+
+template <typename ChunkIndex>
+void basic_small_free_memory_list<ChunkIndex>::count_free_nodes(memory_block_tally& tally) noexcept
+{
+    for (auto cur = base_.next; cur != &base_; cur = cur->next)
+        if (cur->capacity != 0u)
+            tally.add(cur, cur->capacity);
+}
+
+template <typename ChunkIndex>
+void basic_small_free_memory_list<ChunkIndex>::remove_nodes_in(void* mem, std::size_t size) noexcept
+{
+    auto begin = static_cast<char*>(mem);
+
+    // the list is ordered, so the chunks of the block are adjacent
+    auto first = base_.next;
+    while (first != &base_ && !in_range(first, begin, size))
+        first = first->next;
+    if (first == &base_)
+        return;
+
+    auto last = first;
+    FOONATHAN_MEMORY_ASSERT(last->capacity == last->no_nodes);
+    capacity_ -= last->capacity;
+    while (last->next != &base_ && in_range(last->next, begin, size))
+    {
+        last = last->next;
+        FOONATHAN_MEMORY_ASSERT(last->capacity == last->no_nodes);
+        capacity_ -= last->capacity;
+    }
+
+    first->prev->next = last->next;
+    last->next->prev  = first->prev;
+    region_erase_in(regions_, begin, size);
+
+    // markers might point to removed chunks
+    alloc_chunk_ = dealloc_chunk_ = &base_;
+}
+
+template <typename ChunkIndex>
+std::size_t basic_small_free_memory_list<ChunkIndex>::alignment() const noexcept
 {
     return alignment_for(node_size_);
 }
 
-chunk* small_free_memory_list::find_chunk_impl(std::size_t n) noexcept
+template <typename ChunkIndex>
+chunk<ChunkIndex>* basic_small_free_memory_list<ChunkIndex>::find_chunk_impl(std::size_t n) noexcept
 {
     if (auto c = make_chunk(alloc_chunk_, n))
         return c;
@@ -357,38 +553,39 @@ chunk* small_free_memory_list::find_chunk_impl(std::size_t n) noexcept
     return nullptr;
 }
 
-chunk* small_free_memory_list::find_chunk_impl(unsigned char* node, chunk_base* first,
-                                               chunk_base* last) noexcept
-{
-    do
-    {
-        if (auto c = from_chunk(first, node, node_size_))
-            return c;
-        else if ((c = from_chunk(last, node, node_size_)) != nullptr)
-            return c;
-
-        first = first->next;
-        last  = last->prev;
-    } while (!greater(first, last));
-    return nullptr;
-}
-
-chunk* small_free_memory_list::find_chunk_impl(unsigned char* node) noexcept
+template <typename ChunkIndex>
+chunk<ChunkIndex>* basic_small_free_memory_list<ChunkIndex>::find_chunk_impl(
+    unsigned char* node) noexcept
 {
     if (auto c = from_chunk(dealloc_chunk_, node, node_size_))
         return c;
     else if ((c = from_chunk(alloc_chunk_, node, node_size_)) != nullptr)
         return c;
-    else if (less(dealloc_chunk_, node))
-    {
-        // node is in (dealloc_chunk_, base_.prev]
-        return find_chunk_impl(node, dealloc_chunk_->next, base_.prev);
-    }
-    else if (greater(dealloc_chunk_, node))
-    {
-        // node is in [base.next, dealloc_chunk_)
-        return find_chunk_impl(node, base_.next, dealloc_chunk_->prev);
-    }
-    FOONATHAN_MEMORY_UNREACHABLE("must be in one half");
-    return nullptr;
+
+    // all chunks of a region have the same distance, so the index can be computed
+    auto region = region_find(regions_, node);
+    if (!region)
+        return nullptr;
+    auto chunks = region_chunks(region);
+    if (less(node, chunks))
+        return nullptr;
+    auto index = static_cast<std::size_t>(reinterpret_cast<char*>(node) - chunks) / chunk_stride();
+    auto c     = static_cast<chunk_base_type*>(static_cast<void*>(chunks + index * chunk_stride()));
+    return from_chunk(c, node, node_size_);
 }
+
+template <typename ChunkIndex>
+std::size_t basic_small_free_memory_list<ChunkIndex>::chunk_stride() const noexcept
+{
+    auto total_chunk_size =
+        chunk_memory_offset<ChunkIndex>() + node_size_ * chunk_max_nodes<ChunkIndex>();
+    return total_chunk_size + align_offset(total_chunk_size, alignof(chunk_type));
+}
+
+template class foonathan::memory::detail::basic_small_free_memory_list<unsigned char>;
+template class foonathan::memory::detail::basic_small_free_memory_list<std::uint16_t>;
+
+template void foonathan::memory::detail::swap(small_free_memory_list& a,
+                                              small_free_memory_list& b) noexcept;
+template void foonathan::memory::detail::swap(wide_small_free_memory_list& a,
+                                              wide_small_free_memory_list& b) noexcept;
@@ -0,0 +1,173 @@
+// Copyright (C) 2015-2025 Jonathan Müller and foonathan/memory contributors
+// SPDX-License-Identifier: Zlib
+
+#ifndef FOONATHAN_MEMORY_SRC_DETAIL_TREAP_HPP_INCLUDED
+#define FOONATHAN_MEMORY_SRC_DETAIL_TREAP_HPP_INCLUDED
+
+#include <cstdint>
+
+#include "detail/assert.hpp"
+
+namespace foonathan
+{
+    namespace memory
+    {
+        namespace detail
+        {
+            // intrusive treap used to index blocks, regions and runs
+            // the priority is a hash of the node address, so it does not need to be stored
+            // and the treap is balanced in expectation
+            // Access provides the node type and the links to the children:
+            //   using node = ...;
+            //   static node* child(node* n, bool right) noexcept;
+            //   static void set_child(node* n, bool right, node* child) noexcept;
+            // the order is given by a predicate before(cur) passed to the operations,
+            // it returns whether the key that is inserted, erased or split at is before cur
+            template <class Access>
+            struct treap
+            {
+                using node = typename Access::node;
+
+                static std::uintptr_t priority(const node* n) noexcept
+                {
+                    auto hash = reinterpret_cast<std::uintptr_t>(n)
+                                * static_cast<std::uintptr_t>(0x9E3779B97F4A7C15ull);
+                    return hash ^ (hash >> (sizeof(std::uintptr_t) * 4u));
+                }
+
+                // splits t into the nodes before the key (l) and the ones after (r)
+                template <class Before>
+                static void split(node* t, Before before, node*& l, node*& r) noexcept
+                {
+                    if (!t)
+                        l = r = nullptr;
+                    else if (before(t))
+                    {
+                        node* rest;
+                        split(Access::child(t, false), before, l, rest);
+                        Access::set_child(t, false, rest);
+                        r = t;
+                    }
+                    else
+                    {
+                        node* rest;
+                        split(Access::child(t, true), before, rest, r);
+                        Access::set_child(t, true, rest);
+                        l = t;
+                    }
+                }
+
+                // merges l and r, all nodes of l are before the ones of r
+                static node* merge(node* l, node* r) noexcept
+                {
+                    if (!l)
+                        return r;
+                    else if (!r)
+                        return l;
+                    else if (priority(l) > priority(r))
+                    {
+                        Access::set_child(l, true, merge(Access::child(l, true), r));
+                        return l;
+                    }
+                    Access::set_child(r, false, merge(l, Access::child(r, false)));
+                    return r;
+                }
+
+                // before must order n
+                template <class Before>
+                static void insert(node*& root, node* n, Before before) noexcept
+                {
+                    root = insert_impl(root, n, before);
+                }
+
+                // before must order n the same way as on insertion
+                template <class Before>
+                static void erase(node*& root, node* n, Before before) noexcept
+                {
+                    root = erase_impl(root, n, before);
+                }
+
+                // returns the first node for which pred is true or nullptr
+                // pred must be false for a prefix of the nodes and true for the rest
+                template <class Pred>
+                static node* lower_bound(node* t, Pred pred) noexcept
+                {
+                    node* result = nullptr;
+                    while (t)
+                    {
+                        if (pred(t))
+                        {
+                            result = t;
+                            t      = Access::child(t, false);
+                        }
+                        else
+                            t = Access::child(t, true);
+                    }
+                    return result;
+                }
+
+                // returns the last node for which pred is false or nullptr
+                // pred must be false for a prefix of the nodes and true for the rest
+                template <class Pred>
+                static node* last_before(node* t, Pred pred) noexcept
+                {
+                    node* result = nullptr;
+                    while (t)
+                    {
+                        if (pred(t))
+                            t = Access::child(t, false);
+                        else
+                        {
+                            result = t;
+                            t      = Access::child(t, true);
+                        }
+                    }
+                    return result;
+                }
+
+                // calls f with every node in order
+                template <class Func>
+                static void for_each(node* t, Func&& f)
+                {
+                    if (!t)
+                        return;
+                    for_each(Access::child(t, false), f);
+                    f(t);
+                    for_each(Access::child(t, true), f);
+                }
+
+            private:
+                template <class Before>
+                static node* insert_impl(node* t, node* n, Before before) noexcept
+                {
+                    if (!t || priority(n) > priority(t))
+                    {
+                        node *l, *r;
+                        split(t, before, l, r);
+                        Access::set_child(n, false, l);
+                        Access::set_child(n, true, r);
+                        return n;
+                    }
+
+                    auto right = !before(t);
+                    Access::set_child(t, right, insert_impl(Access::child(t, right), n, before));
+                    return t;
+                }
+
+                template <class Before>
+                static node* erase_impl(node* t, node* n, Before before) noexcept
+                {
+                    FOONATHAN_MEMORY_ASSERT_MSG(t, "node not in treap");
+                    if (t == n)
+                        return merge(Access::child(t, false), Access::child(t, true));
+
+                    auto right = !before(t);
+                    Access::set_child(t, right, erase_impl(Access::child(t, right), n, before));
+                    return t;
+                }
+            };
+        } // namespace detail
+    } // namespace memory
+} // namespace foonathan
+
+#endif // FOONATHAN_MEMORY_SRC_DETAIL_TREAP_HPP_INCLUDED
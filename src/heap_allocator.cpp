@@ -3,6 +3,7 @@
 
 #include "heap_allocator.hpp"
 
+#include "allocator_traits.hpp"
 #include "error.hpp"
 
 using namespace foonathan::memory;
@@ -35,6 +36,12 @@ void foonathan::memory::heap_dealloc(void* ptr, std::size_t) noexcept
     HeapFree(get_process_heap(), 0, ptr);
 }
 
+void* detail::heap_allocator_impl::reallocate(void* ptr, std::size_t, std::size_t new_size,
+                                              std::size_t) noexcept
+{
+    return HeapReAlloc(get_process_heap(), 0, ptr, new_size);
+}
+
 #elif FOONATHAN_HOSTED_IMPLEMENTATION
 #include <cstdlib>
 #include <memory>
@@ -49,6 +56,12 @@ void foonathan::memory::heap_dealloc(void* ptr, std::size_t) noexcept
     std::free(ptr);
 }
 
+void* detail::heap_allocator_impl::reallocate(void* ptr, std::size_t, std::size_t new_size,
+                                              std::size_t) noexcept
+{
+    return std::realloc(ptr, new_size);
+}
+
 namespace
 {
     std::size_t max_size() noexcept
@@ -59,6 +72,19 @@ namespace
 #else
 // no implementation for heap_alloc/heap_dealloc
 
+// heap_alloc() has no reallocation counterpart
+void* detail::heap_allocator_impl::reallocate(void* ptr, std::size_t old_size, std::size_t new_size,
+                                              std::size_t) noexcept
+{
+    auto memory = heap_alloc(new_size);
+    if (memory)
+    {
+        copy_memory(memory, ptr, old_size < new_size ? old_size : new_size);
+        heap_dealloc(ptr, old_size);
+    }
+    return memory;
+}
+
 namespace
 {
     std::size_t max_size() noexcept
@@ -3,26 +3,85 @@
 
 #include "memory_arena.hpp"
 
+#include <cstdint>
 #include <new>
 
+#if FOONATHAN_HOSTED_IMPLEMENTATION
+#include <chrono>
+#endif
+
 #include "detail/align.hpp"
+#include "detail/treap.hpp"
+#include "virtual_memory.hpp"
 
 using namespace foonathan::memory;
 using namespace detail;
 
+namespace
+{
+    template <typename Node>
+    std::uintptr_t address(const Node* n) noexcept
+    {
+        return reinterpret_cast<std::uintptr_t>(n);
+    }
+
+    // the blocks are ordered by address
+    template <typename Node>
+    struct block_access
+    {
+        using node = Node;
+
+        static node* child(node* n, bool right) noexcept
+        {
+            return right ? n->right : n->left;
+        }
+
+        static void set_child(node* n, bool right, node* child) noexcept
+        {
+            (right ? n->right : n->left) = child;
+        }
+    };
+} // namespace
+
+void memory_block_stack::insert(node* n) noexcept
+{
+    n->prev = head_;
+    n->next = nullptr;
+    if (head_)
+        head_->next = n;
+    head_ = n;
+
+    treap<block_access<node>>::insert(root_, n,
+                                      [&](node* cur) { return address(n) < address(cur); });
+    ++size_;
+}
+
+void memory_block_stack::remove(node* n) noexcept
+{
+    if (n->next)
+        n->next->prev = n->prev;
+    else
+        head_ = n->prev;
+    if (n->prev)
+        n->prev->next = n->next;
+
+    treap<block_access<node>>::erase(root_, n,
+                                     [&](node* cur) { return address(n) < address(cur); });
+    --size_;
+}
+
 void memory_block_stack::push(allocated_mb block) noexcept
 {
     FOONATHAN_MEMORY_ASSERT(block.size >= sizeof(node));
     FOONATHAN_MEMORY_ASSERT(is_aligned(block.memory, max_alignment));
-    auto next = ::new (block.memory) node(head_, block.size - implementation_offset());
-    head_     = next;
+    insert(::new (block.memory) node(block.size - implementation_offset()));
 }
 
 memory_block_stack::allocated_mb memory_block_stack::pop() noexcept
 {
     FOONATHAN_MEMORY_ASSERT(head_);
     auto to_pop = head_;
-    head_       = head_->prev;
+    remove(to_pop);
     return {to_pop, to_pop->usable_size + implementation_offset()};
 }
 
@@ -30,30 +89,152 @@ void memory_block_stack::steal_top(memory_block_stack& other) noexcept
 {
     FOONATHAN_MEMORY_ASSERT(other.head_);
     auto to_steal = other.head_;
-    other.head_   = other.head_->prev;
+    other.remove(to_steal);
+
+    insert(to_steal);
+}
+
+memory_block_stack::allocated_mb memory_block_stack::erase(inserted_mb block) noexcept
+{
+    auto to_erase = to_node(block);
+    FOONATHAN_MEMORY_ASSERT_MSG(find(block.memory) == to_erase, "block not in stack");
+    remove(to_erase);
+
+    return {to_erase, to_erase->usable_size + implementation_offset()};
+}
 
-    to_steal->prev = head_;
-    head_          = to_steal;
+memory_block_stack::node* memory_block_stack::find(const void* ptr) const noexcept
+{
+    // the last block that starts before ptr, ptr might still be in its header
+    auto addr  = reinterpret_cast<std::uintptr_t>(ptr);
+    auto block = treap<block_access<node>>::last_before(root_, [&](node* cur) {
+        return addr < address(cur) + implementation_offset();
+    });
+    return block && addr < address(block) + implementation_offset() + block->usable_size ?
+               block :
+               nullptr;
 }
 
 bool memory_block_stack::owns(const void* ptr) const noexcept
 {
-    auto address = static_cast<const char*>(ptr);
+    return find(ptr) != nullptr;
+}
+
+void memory_block_stack::reset_tally() noexcept
+{
     for (auto cur = head_; cur; cur = cur->prev)
+        cur->tally = 0u;
+}
+
+void memory_block_stack::add_tally(const void* ptr, std::size_t n) noexcept
+{
+    auto block = find(ptr);
+    FOONATHAN_MEMORY_ASSERT_MSG(block, "pointer not in any block");
+    block->tally += n;
+}
+
+namespace
+{
+    std::size_t now_ms() noexcept
+    {
+#if FOONATHAN_HOSTED_IMPLEMENTATION
+        using namespace std::chrono;
+        return static_cast<std::size_t>(
+            duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count());
+#else
+        return 0u;
+#endif
+    }
+
+    // returns the physical memory of all pages completely inside the block
+    // the header in front of the block is never touched
+    std::size_t purge_block(memory_block block) noexcept
     {
-        auto mem = static_cast<char*>(static_cast<void*>(cur)) + implementation_offset();
-        if (address >= mem && address < mem + cur->usable_size)
-            return true;
+        auto page_size = get_virtual_memory_page_size();
+        auto begin     = static_cast<char*>(block.memory);
+        auto first     = begin + align_offset(begin, page_size);
+        auto end       = begin + block.size;
+        auto last      = end - reinterpret_cast<std::uintptr_t>(end) % page_size;
+        if (last <= first)
+            return 0u;
+
+        auto size = static_cast<std::size_t>(last - first);
+        virtual_memory_purge(first, size / page_size);
+        return size;
     }
-    return false;
+} // namespace
+
+void memory_arena_cache<cached_arena>::set_cache_limits(
+    const memory_arena_cache_limits& limits) noexcept
+{
+    limits_ = limits;
+    if (limits_.max_idle_ms != std::size_t(-1))
+        last_use_ = now_ms();
+    if (no_resident_ > limits_.max_blocks || resident_bytes_ > limits_.max_bytes)
+        scavenge_resident(limits_.max_blocks, limits_.max_bytes);
 }
 
-std::size_t memory_block_stack::size() const noexcept
+void memory_arena_cache<cached_arena>::on_take(std::size_t size) noexcept
 {
-    std::size_t res = 0u;
-    for (auto cur = head_; cur; cur = cur->prev)
-        ++res;
-    return res;
+    if (no_resident_ != 0u)
+    {
+        --no_resident_;
+        resident_bytes_ -= size;
+    }
+    else
+        --no_scavenged_;
+
+    if (limits_.max_idle_ms != std::size_t(-1))
+        last_use_ = now_ms();
+}
+
+void memory_arena_cache<cached_arena>::on_cache() noexcept
+{
+    ++no_resident_;
+    resident_bytes_ += cached_.top().size;
+
+    auto idle = false;
+    if (limits_.max_idle_ms != std::size_t(-1))
+    {
+        auto now  = now_ms();
+        idle      = now - last_use_ > limits_.max_idle_ms;
+        last_use_ = now;
+    }
+
+    if (idle)
+        // only the new block has been used recently
+        scavenge_resident(limits_.max_blocks < 1u ? limits_.max_blocks : 1u, limits_.max_bytes);
+    else if (no_resident_ > limits_.max_blocks || resident_bytes_ > limits_.max_bytes)
+        scavenge_resident(limits_.max_blocks, limits_.max_bytes);
+}
+
+std::size_t memory_arena_cache<cached_arena>::scavenge_resident(std::size_t max_blocks,
+                                                                std::size_t max_bytes) noexcept
+{
+    std::size_t index = 0u, no_kept = 0u, kept_bytes = 0u, purged_bytes = 0u;
+    auto        keep  = true;
+    cached_.for_each(
+        [&](memory_block block)
+        {
+            if (index++ >= no_resident_)
+                return;
+            else if (keep && no_kept < max_blocks && block.size <= max_bytes - kept_bytes)
+            {
+                ++no_kept;
+                kept_bytes += block.size;
+            }
+            else
+            {
+                // all blocks below were cached earlier
+                keep = false;
+                purged_bytes += purge_block(block);
+            }
+        });
+
+    no_scavenged_ += no_resident_ - no_kept;
+    no_resident_    = no_kept;
+    resident_bytes_ = kept_bytes;
+    return purged_bytes;
 }
 
 #if FOONATHAN_MEMORY_EXTERN_TEMPLATE
@@ -61,6 +242,10 @@ template class foonathan::memory::memory_arena<static_block_allocator, true>;
 template class foonathan::memory::memory_arena<static_block_allocator, false>;
 template class foonathan::memory::memory_arena<virtual_block_allocator, true>;
 template class foonathan::memory::memory_arena<virtual_block_allocator, false>;
+template class foonathan::memory::memory_arena<reusable_virtual_block_allocator, true>;
+template class foonathan::memory::memory_arena<reusable_virtual_block_allocator, false>;
+template class foonathan::memory::memory_arena<huge_page_block_allocator, true>;
+template class foonathan::memory::memory_arena<huge_page_block_allocator, false>;
 
 template class foonathan::memory::growing_block_allocator<>;
 template class foonathan::memory::memory_arena<growing_block_allocator<>, true>;
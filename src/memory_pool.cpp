@@ -16,12 +16,28 @@ void detail::memory_pool_leak_handler::operator()(std::ptrdiff_t amount)
 template class foonathan::memory::memory_pool<node_pool>;
 template class foonathan::memory::memory_pool<array_pool>;
 template class foonathan::memory::memory_pool<small_node_pool>;
+template class foonathan::memory::memory_pool<wide_small_node_pool>;
+template class foonathan::memory::memory_pool<concurrent_node_pool>;
+template class foonathan::memory::memory_pool<remote_free_node_pool>;
+template class foonathan::memory::memory_pool<bitmap_node_pool>;
 
 template class foonathan::memory::allocator_traits<memory_pool<node_pool>>;
 template class foonathan::memory::allocator_traits<memory_pool<array_pool>>;
 template class foonathan::memory::allocator_traits<memory_pool<small_node_pool>>;
+template class foonathan::memory::allocator_traits<memory_pool<wide_small_node_pool>>;
+template class foonathan::memory::allocator_traits<memory_pool<concurrent_node_pool>>;
+template class foonathan::memory::allocator_traits<memory_pool<remote_free_node_pool>>;
+template class foonathan::memory::allocator_traits<memory_pool<bitmap_node_pool>>;
 
 template class foonathan::memory::composable_allocator_traits<memory_pool<node_pool>>;
 template class foonathan::memory::composable_allocator_traits<memory_pool<array_pool>>;
 template class foonathan::memory::composable_allocator_traits<memory_pool<small_node_pool>>;
+template class foonathan::memory::composable_allocator_traits<
+    memory_pool<wide_small_node_pool>>;
+template class foonathan::memory::composable_allocator_traits<
+    memory_pool<concurrent_node_pool>>;
+template class foonathan::memory::composable_allocator_traits<
+    memory_pool<remote_free_node_pool>>;
+template class foonathan::memory::composable_allocator_traits<
+    memory_pool<bitmap_node_pool>>;
 #endif
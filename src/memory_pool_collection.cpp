@@ -3,7 +3,11 @@
 
 #include "memory_pool_collection.hpp"
 
+#include <cstdint>
+
 #include "debugging.hpp"
+#include "virtual_memory.hpp"
+#include "detail/treap.hpp"
 
 using namespace foonathan::memory;
 
@@ -12,6 +16,145 @@ void detail::memory_pool_collection_leak_handler::operator()(std::ptrdiff_t amou
     get_leak_handler()({FOONATHAN_MEMORY_LOG_PREFIX "::memory_pool_collection", this}, amount);
 }
 
+// aligned so that the memory after it is suitable for any node
+// the headers form a treap ordered by address
+struct alignas(detail::max_alignment) detail::large_object_list::header
+{
+    header*     left;
+    header*     right;
+    std::size_t size;
+    std::size_t no_pages;
+};
+
+namespace
+{
+    template <typename Header>
+    struct header_access
+    {
+        using node = Header;
+
+        static Header* child(Header* hdr, bool right) noexcept
+        {
+            return right ? hdr->right : hdr->left;
+        }
+
+        static void set_child(Header* hdr, bool right, Header* child) noexcept
+        {
+            (right ? hdr->right : hdr->left) = child;
+        }
+    };
+
+    std::uintptr_t address(const void* ptr) noexcept
+    {
+        return reinterpret_cast<std::uintptr_t>(ptr);
+    }
+} // namespace
+
+detail::large_object_list::large_object_list() noexcept
+: root_(nullptr), stats_{0u, 0u, 0u, 0u, 0u}, enabled_(false)
+{
+}
+
+detail::large_object_list::large_object_list(large_object_list&& other) noexcept
+: root_(other.root_), stats_(other.stats_), enabled_(other.enabled_)
+{
+    other.root_  = nullptr;
+    other.stats_ = {0u, 0u, 0u, 0u, 0u};
+}
+
+detail::large_object_list::~large_object_list() noexcept
+{
+    release_all();
+}
+
+detail::large_object_list& detail::large_object_list::operator=(
+    large_object_list&& other) noexcept
+{
+    release_all();
+    root_        = other.root_;
+    stats_       = other.stats_;
+    enabled_     = other.enabled_;
+    other.root_  = nullptr;
+    other.stats_ = {0u, 0u, 0u, 0u, 0u};
+    return *this;
+}
+
+void* detail::large_object_list::allocate(const allocator_info& info, std::size_t size)
+{
+    auto mem = try_allocate(size);
+    if (!mem)
+        FOONATHAN_THROW(out_of_memory(info, size + sizeof(header)));
+    return mem;
+}
+
+void* detail::large_object_list::try_allocate(std::size_t size) noexcept
+{
+    auto page_size = get_virtual_memory_page_size();
+    if (size > std::size_t(-1) - sizeof(header) - page_size)
+        return nullptr;
+    auto no_pages = (size + sizeof(header) + page_size - 1u) / page_size;
+
+    auto pages = virtual_memory_reserve(no_pages);
+    if (!pages)
+        return nullptr;
+    else if (!virtual_memory_commit(pages, no_pages))
+    {
+        virtual_memory_release(pages, no_pages);
+        return nullptr;
+    }
+
+    auto hdr      = static_cast<header*>(pages);
+    hdr->size     = size;
+    hdr->no_pages = no_pages;
+    treap<header_access<header>>::insert(root_, hdr, [&](header* cur)
+                                         { return address(hdr) < address(cur); });
+
+    ++stats_.count;
+    ++stats_.total;
+    stats_.bytes += size;
+    stats_.mapped += no_pages * page_size;
+    if (stats_.bytes > stats_.peak_bytes)
+        stats_.peak_bytes = stats_.bytes;
+
+    return static_cast<char*>(pages) + sizeof(header);
+}
+
+void detail::large_object_list::deallocate(void* ptr) noexcept
+{
+    FOONATHAN_MEMORY_ASSERT_MSG(owns(ptr), "pointer not from the large allocations");
+    auto hdr = reinterpret_cast<header*>(static_cast<char*>(ptr) - sizeof(header));
+    treap<header_access<header>>::erase(root_, hdr, [&](header* cur)
+                                        { return address(hdr) < address(cur); });
+
+    --stats_.count;
+    stats_.bytes -= hdr->size;
+    stats_.mapped -= hdr->no_pages * get_virtual_memory_page_size();
+
+    auto no_pages = hdr->no_pages;
+    virtual_memory_decommit(hdr, no_pages);
+    virtual_memory_release(hdr, no_pages);
+}
+
+bool detail::large_object_list::owns(const void* ptr) const noexcept
+{
+    // the last header before ptr, the memory itself is never dereferenced
+    auto hdr = treap<header_access<header>>::last_before(root_, [&](header* cur)
+                                                         { return address(ptr) < address(cur); });
+    return hdr && address(ptr) == address(hdr) + sizeof(header);
+}
+
+void detail::large_object_list::release_all() noexcept
+{
+    while (root_)
+    {
+        auto hdr      = root_;
+        auto no_pages = hdr->no_pages;
+        root_         = treap<header_access<header>>::merge(hdr->left, hdr->right);
+        virtual_memory_decommit(hdr, no_pages);
+        virtual_memory_release(hdr, no_pages);
+    }
+}
+
 #if FOONATHAN_MEMORY_EXTERN_TEMPLATE
 template class foonathan::memory::memory_pool_collection<node_pool, identity_buckets>;
 template class foonathan::memory::memory_pool_collection<array_pool, identity_buckets>;
@@ -21,6 +164,10 @@ template class foonathan::memory::memory_pool_collection<node_pool, log2_buckets
 template class foonathan::memory::memory_pool_collection<array_pool, log2_buckets>;
 template class foonathan::memory::memory_pool_collection<small_node_pool, log2_buckets>;
 
+template class foonathan::memory::memory_pool_collection<node_pool, geometric_buckets<>>;
+template class foonathan::memory::memory_pool_collection<array_pool, geometric_buckets<>>;
+template class foonathan::memory::memory_pool_collection<small_node_pool, geometric_buckets<>>;
+
 template class foonathan::memory::allocator_traits<
     memory_pool_collection<node_pool, identity_buckets>>;
 template class foonathan::memory::allocator_traits<
@@ -34,6 +181,13 @@ template class foonathan::memory::allocator_traits<
 template class foonathan::memory::allocator_traits<
     memory_pool_collection<small_node_pool, log2_buckets>>;
 
+template class foonathan::memory::allocator_traits<
+    memory_pool_collection<node_pool, geometric_buckets<>>>;
+template class foonathan::memory::allocator_traits<
+    memory_pool_collection<array_pool, geometric_buckets<>>>;
+template class foonathan::memory::allocator_traits<
+    memory_pool_collection<small_node_pool, geometric_buckets<>>>;
+
 template class foonathan::memory::composable_allocator_traits<
     memory_pool_collection<node_pool, identity_buckets>>;
 template class foonathan::memory::composable_allocator_traits<
@@ -47,4 +201,11 @@ template class foonathan::memory::composable_allocator_traits<
     memory_pool_collection<array_pool, log2_buckets>>;
 template class foonathan::memory::composable_allocator_traits<
     memory_pool_collection<small_node_pool, log2_buckets>>;
+
+template class foonathan::memory::composable_allocator_traits<
+    memory_pool_collection<node_pool, geometric_buckets<>>>;
+template class foonathan::memory::composable_allocator_traits<
+    memory_pool_collection<array_pool, geometric_buckets<>>>;
+template class foonathan::memory::composable_allocator_traits<
+    memory_pool_collection<small_node_pool, geometric_buckets<>>>;
 #endif
@@ -9,6 +9,7 @@
 
 #include <new>
 
+#include "allocator_traits.hpp"
 #include "error.hpp"
 
 using namespace foonathan::memory;
@@ -56,6 +57,19 @@ void detail::new_allocator_impl::deallocate(void* ptr, std::size_t, size_t) noex
     ::operator delete(ptr);
 }
 
+void* detail::new_allocator_impl::reallocate(void* ptr, std::size_t old_size, std::size_t new_size,
+                                             std::size_t alignment) noexcept
+{
+    // operator new has no reallocation
+    auto memory = allocate(new_size, alignment);
+    if (memory)
+    {
+        copy_memory(memory, ptr, old_size < new_size ? old_size : new_size);
+        deallocate(ptr, old_size, alignment);
+    }
+    return memory;
+}
+
 std::size_t detail::new_allocator_impl::max_node_size() noexcept
 {
 #if FOONATHAN_HOSTED_IMPLEMENTATION
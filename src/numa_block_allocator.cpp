@@ -0,0 +1,187 @@
+// Copyright (C) 2015-2025 Jonathan Müller and foonathan/memory contributors
+// SPDX-License-Identifier: Zlib
+
+#include "numa_block_allocator.hpp"
+
+#include <climits>
+
+#include "detail/assert.hpp"
+#include "error.hpp"
+#include "virtual_memory.hpp"
+
+using namespace foonathan::memory;
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__) && defined(SYS_mbind) && defined(SYS_get_mempolicy)
+namespace
+{
+    // from <linux/mempolicy.h>
+    constexpr int mpol_bind           = 2;
+    constexpr int mpol_interleave     = 3;
+    constexpr int mpol_f_node         = 1 << 0;
+    constexpr int mpol_f_addr         = 1 << 1;
+    constexpr int mpol_f_mems_allowed = 1 << 2;
+
+    constexpr std::size_t max_nodes = 1024u;
+    constexpr std::size_t word_bits = sizeof(unsigned long) * CHAR_BIT;
+
+    struct node_mask
+    {
+        unsigned long words[max_nodes / word_bits] = {};
+
+        void set(std::size_t node) noexcept
+        {
+            words[node / word_bits] |= 1ul << (node % word_bits);
+        }
+
+        bool is_set(std::size_t node) const noexcept
+        {
+            return (words[node / word_bits] >> (node % word_bits)) & 1ul;
+        }
+    };
+
+    // the kernel ignores the last bit of the mask
+    constexpr unsigned long mask_bits = max_nodes + 1u;
+
+    bool get_allowed_nodes(node_mask& mask) noexcept
+    {
+        return syscall(SYS_get_mempolicy, nullptr, mask.words, mask_bits, nullptr,
+                       mpol_f_mems_allowed)
+               == 0;
+    }
+
+    void set_policy(void* memory, std::size_t size, int mode, const node_mask& mask) noexcept
+    {
+        // if it fails, the memory is placed by the default policy
+        auto result = syscall(SYS_mbind, memory, size, mode, mask.words, mask_bits, 0u);
+        (void)result;
+    }
+} // namespace
+
+std::size_t foonathan::memory::get_numa_node_count() noexcept
+{
+    node_mask mask;
+    if (!get_allowed_nodes(mask))
+        return 1u;
+
+    auto count = std::size_t(1u);
+    for (auto node = std::size_t(0u); node != max_nodes; ++node)
+        if (mask.is_set(node))
+            count = node + 1u;
+    return count;
+}
+
+std::size_t foonathan::memory::get_current_numa_node() noexcept
+{
+#if defined(SYS_getcpu)
+    unsigned cpu = 0u, node = 0u;
+    if (syscall(SYS_getcpu, &cpu, &node, nullptr) == 0)
+        return node;
+#endif
+    return 0u;
+}
+
+std::size_t foonathan::memory::get_numa_node_of(void* memory) noexcept
+{
+    int node = -1;
+    if (syscall(SYS_get_mempolicy, &node, nullptr, 0ul, memory, mpol_f_node | mpol_f_addr) != 0
+        || node < 0)
+        return std::size_t(-1);
+    return static_cast<std::size_t>(node);
+}
+
+namespace
+{
+    void bind_memory(void* memory, std::size_t size, numa_policy policy,
+                     std::size_t node) noexcept
+    {
+        node_mask mask;
+        switch (policy)
+        {
+        case numa_policy::bind:
+            mask.set(node);
+            set_policy(memory, size, mpol_bind, mask);
+            break;
+        case numa_policy::local:
+            mask.set(get_current_numa_node());
+            set_policy(memory, size, mpol_bind, mask);
+            break;
+        case numa_policy::interleave:
+            if (get_allowed_nodes(mask))
+                set_policy(memory, size, mpol_interleave, mask);
+            break;
+        }
+    }
+} // namespace
+#else
+std::size_t foonathan::memory::get_numa_node_count() noexcept
+{
+    return 1u;
+}
+
+std::size_t foonathan::memory::get_current_numa_node() noexcept
+{
+    return 0u;
+}
+
+std::size_t foonathan::memory::get_numa_node_of(void*) noexcept
+{
+    return std::size_t(-1);
+}
+
+namespace
+{
+    void bind_memory(void*, std::size_t, numa_policy, std::size_t) noexcept {}
+} // namespace
+#endif
+
+numa_block_allocator::numa_block_allocator(std::size_t block_size, numa_policy policy,
+                                           std::size_t node) noexcept
+: block_size_(0u), policy_(policy), node_(node)
+{
+    FOONATHAN_MEMORY_ASSERT(block_size > 0u);
+    FOONATHAN_MEMORY_ASSERT(node < get_numa_node_count());
+    auto page_size = get_virtual_memory_page_size();
+    block_size_    = (block_size + page_size - 1u) / page_size * page_size;
+}
+
+memory_block numa_block_allocator::allocate_block()
+{
+    auto no_pages = block_size_ / get_virtual_memory_page_size();
+    auto memory   = virtual_memory_reserve(no_pages);
+    if (!memory)
+        FOONATHAN_THROW(out_of_memory(info(), block_size_));
+
+    // the policy must be set before the memory is touched for the first time
+    bind_memory(memory, block_size_, policy_, node_);
+    if (!virtual_memory_commit(memory, no_pages))
+    {
+        virtual_memory_release(memory, no_pages);
+        FOONATHAN_THROW(out_of_memory(info(), block_size_));
+    }
+
+    memory_block block(memory, block_size_);
+    block_size_ *= 2u;
+    return block;
+}
+
+void numa_block_allocator::deallocate_block(memory_block block) noexcept
+{
+    auto no_pages = block.size / get_virtual_memory_page_size();
+    virtual_memory_decommit(block.memory, no_pages);
+    virtual_memory_release(block.memory, no_pages);
+}
+
+allocator_info numa_block_allocator::info() noexcept
+{
+    return {FOONATHAN_MEMORY_LOG_PREFIX "::numa_block_allocator", this};
+}
+
+#if FOONATHAN_MEMORY_EXTERN_TEMPLATE
+template class foonathan::memory::memory_arena<numa_block_allocator, true>;
+template class foonathan::memory::memory_arena<numa_block_allocator, false>;
+#endif
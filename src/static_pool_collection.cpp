@@ -0,0 +1,13 @@
+// Copyright (C) 2015-2025 Jonathan Müller and foonathan/memory contributors
+// SPDX-License-Identifier: Zlib
+
+#include "static_pool_collection.hpp"
+
+#include "debugging.hpp"
+
+using namespace foonathan::memory;
+
+void detail::static_pool_collection_leak_handler::operator()(std::ptrdiff_t amount)
+{
+    get_leak_handler()({FOONATHAN_MEMORY_LOG_PREFIX "::static_pool_collection", this}, amount);
+}
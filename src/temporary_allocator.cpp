@@ -280,6 +280,18 @@ void* temporary_allocator::allocate(std::size_t size, std::size_t alignment)
     return unwind_.get_stack().stack_.allocate(size, alignment);
 }
 
+bool temporary_allocator::try_resize(void* memory, std::size_t old_size,
+                                     std::size_t new_size) noexcept
+{
+    FOONATHAN_MEMORY_ASSERT_MSG(is_active(), "object isn't the active allocator");
+    auto& stack = unwind_.get_stack().stack_;
+    // the last allocation must have been done after this object was created,
+    // otherwise shrinking would move the top below its marker
+    if (!(unwind_.get_marker() < stack.top()))
+        return false;
+    return stack.try_resize(memory, old_size, new_size);
+}
+
 void temporary_allocator::shrink_to_fit() noexcept
 {
     shrink_to_fit_ = true;
@@ -0,0 +1,178 @@
+// Copyright (C) 2015-2025 Jonathan Müller and foonathan/memory contributors
+// SPDX-License-Identifier: Zlib
+
+#include "config.hpp"
+#if FOONATHAN_HOSTED_IMPLEMENTATION
+
+#include "thread_cached_pool.hpp"
+
+#include "heap_allocator.hpp"
+
+using namespace foonathan::memory;
+using namespace detail;
+
+namespace
+{
+    // protects the links between caches and owners
+    // only locked when creating caches, on thread exit and on owner destruction
+    std::mutex registry_mutex;
+
+    void destroy_cache(thread_cache* cache) noexcept
+    {
+        for (std::size_t i = 0u; i != cache->no_bins; ++i)
+            if (cache->bins[i].nodes)
+                heap_dealloc(cache->bins[i].nodes, cache->bin_capacity * sizeof(void*));
+        auto size = sizeof(thread_cache) + cache->no_bins * sizeof(thread_cache_bin);
+        cache->~thread_cache();
+        heap_dealloc(cache, size);
+    }
+} // namespace
+
+namespace foonathan
+{
+    namespace memory
+    {
+        namespace detail
+        {
+            // list of all caches of a thread, returns them on thread exit
+            struct thread_cache_list
+            {
+                thread_cache* first = nullptr;
+                bool          alive = true;
+
+                ~thread_cache_list() noexcept
+                {
+                    std::lock_guard<std::mutex> lock(registry_mutex);
+                    while (first)
+                    {
+                        auto cache = first;
+                        first      = cache->next_in_thread;
+
+                        if (auto owner = cache->owner.load(std::memory_order_relaxed))
+                        {
+                            owner->release(*cache);
+                            unlink(*owner, cache);
+                        }
+                        destroy_cache(cache);
+                    }
+                    alive = false;
+                }
+
+                static void unlink(thread_cache_owner& owner, thread_cache* cache) noexcept
+                {
+                    if (cache->prev_in_owner)
+                        cache->prev_in_owner->next_in_owner = cache->next_in_owner;
+                    else
+                        owner.caches_ = cache->next_in_owner;
+                    if (cache->next_in_owner)
+                        cache->next_in_owner->prev_in_owner = cache->prev_in_owner;
+                }
+
+                // destroys all caches whose owner is gone
+                // requires: registry_mutex locked
+                void purge_orphans() noexcept
+                {
+                    for (auto cur = &first; *cur;)
+                    {
+                        auto cache = *cur;
+                        if (cache->owner.load(std::memory_order_relaxed))
+                            cur = &cache->next_in_thread;
+                        else
+                        {
+                            *cur = cache->next_in_thread;
+                            destroy_cache(cache);
+                        }
+                    }
+                }
+            };
+        } // namespace detail
+    } // namespace memory
+} // namespace foonathan
+
+namespace
+{
+    thread_local thread_cache_list thread_caches;
+} // namespace
+
+thread_cache* thread_cache_owner::get_thread_cache() noexcept
+{
+    auto& list = thread_caches;
+    if (list.first && list.first->owner.load(std::memory_order_acquire) == this)
+        return list.first;
+
+    // move the cache to the front, a thread typically works with one pool at a time
+    for (auto prev = list.first; prev && prev->next_in_thread; prev = prev->next_in_thread)
+    {
+        auto cache = prev->next_in_thread;
+        if (cache->owner.load(std::memory_order_acquire) == this)
+        {
+            prev->next_in_thread  = cache->next_in_thread;
+            cache->next_in_thread = list.first;
+            list.first            = cache;
+            return cache;
+        }
+    }
+    return nullptr;
+}
+
+thread_cache* thread_cache_owner::create_thread_cache(std::size_t no_bins,
+                                                      std::size_t bin_capacity) noexcept
+{
+    auto& list = thread_caches;
+    if (!list.alive)
+        // thread is already exiting
+        return nullptr;
+
+    auto mem = heap_alloc(sizeof(thread_cache) + no_bins * sizeof(thread_cache_bin));
+    if (!mem)
+        return nullptr;
+
+    auto cache  = ::new (mem) thread_cache;
+    cache->bins = static_cast<thread_cache_bin*>(
+        static_cast<void*>(static_cast<char*>(mem) + sizeof(thread_cache)));
+    for (std::size_t i = 0u; i != no_bins; ++i)
+        ::new (static_cast<void*>(cache->bins + i)) thread_cache_bin{nullptr, 0u};
+    cache->no_bins      = no_bins;
+    cache->bin_capacity = bin_capacity;
+
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    list.purge_orphans();
+
+    cache->owner.store(this, std::memory_order_relaxed);
+    cache->next_in_thread = list.first;
+    list.first            = cache;
+
+    cache->prev_in_owner = nullptr;
+    cache->next_in_owner = caches_;
+    if (caches_)
+        caches_->prev_in_owner = cache;
+    caches_ = cache;
+
+    return cache;
+}
+
+bool thread_cache_owner::reserve_bin(const thread_cache& cache, thread_cache_bin& bin) noexcept
+{
+    FOONATHAN_MEMORY_ASSERT(!bin.nodes);
+    bin.nodes = static_cast<void**>(heap_alloc(cache.bin_capacity * sizeof(void*)));
+    return bin.nodes != nullptr;
+}
+
+thread_cache_owner::~thread_cache_owner() noexcept
+{
+    FOONATHAN_MEMORY_ASSERT_MSG(!caches_, "orphan_caches() not called");
+}
+
+void thread_cache_owner::orphan_caches() noexcept
+{
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    while (caches_)
+    {
+        auto cache = caches_;
+        caches_    = cache->next_in_owner;
+        // the cache itself is destroyed by its thread
+        cache->owner.store(nullptr, std::memory_order_release);
+    }
+}
+
+#endif // FOONATHAN_HOSTED_IMPLEMENTATION
@@ -3,7 +3,9 @@
 
 #include "virtual_memory.hpp"
 
+#include "detail/align.hpp"
 #include "detail/debug_helpers.hpp"
+#include "detail/ilog2.hpp"
 #include "error.hpp"
 #include "memory_arena.hpp"
 
@@ -73,8 +75,100 @@ void foonathan::memory::virtual_memory_decommit(void* memory, std::size_t no_pag
     FOONATHAN_MEMORY_ASSERT_MSG(result, "cannot decommit memory");
     (void)result;
 }
+
+void foonathan::memory::virtual_memory_purge(void* memory, std::size_t no_pages) noexcept
+{
+#if (_MSC_VER <= 1900) || WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_DESKTOP)
+    // the pages stay committed but are no longer written to the page file
+    VirtualAlloc(memory, no_pages * virtual_memory_page_size, MEM_RESET, PAGE_READWRITE);
+#else
+    (void)memory;
+    (void)no_pages;
+#endif
+}
+
+std::size_t foonathan::memory::get_virtual_memory_huge_page_size() noexcept
+{
+    static const auto size = std::size_t(GetLargePageMinimum());
+    return size;
+}
+
+std::size_t foonathan::memory::get_virtual_memory_page_sizes(std::size_t* sizes,
+                                                             std::size_t  max_sizes) noexcept
+{
+    std::size_t no_sizes = 0u;
+    if (no_sizes != max_sizes)
+        sizes[no_sizes++] = virtual_memory_page_size;
+    auto huge_page_size = get_virtual_memory_huge_page_size();
+    if (huge_page_size != 0u && no_sizes != max_sizes)
+        sizes[no_sizes++] = huge_page_size;
+    return no_sizes;
+}
+
+namespace
+{
+    void* allocate_pages(void* address, std::size_t size, DWORD type) noexcept
+    {
+#if (_MSC_VER <= 1900) || WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_DESKTOP)
+        return VirtualAlloc(address, size, type, PAGE_READWRITE);
+#else
+        return VirtualAllocFromApp(address, size, type, PAGE_READWRITE);
+#endif
+    }
+
+    // a reservation can only be released as a whole,
+    // so reserve more memory than needed to find an aligned address, release it and allocate there
+    // another thread might take the address in between, so it is tried multiple times
+    void* allocate_aligned_pages(std::size_t size, std::size_t alignment) noexcept
+    {
+        for (auto i = 0; i != 8; ++i)
+        {
+            auto reserved = allocate_pages(nullptr, size + alignment, MEM_RESERVE);
+            if (!reserved)
+                return nullptr;
+            auto aligned = static_cast<char*>(reserved) + detail::align_offset(reserved, alignment);
+            VirtualFree(reserved, 0u, MEM_RELEASE);
+
+            if (auto memory = allocate_pages(aligned, size, MEM_RESERVE | MEM_COMMIT))
+                return memory;
+        }
+        return nullptr;
+    }
+} // namespace
+
+void* foonathan::memory::virtual_memory_allocate_huge_pages(std::size_t    size,
+                                                            huge_page_mode mode) noexcept
+{
+    auto huge_page_size = get_virtual_memory_huge_page_size();
+    if (huge_page_size == 0u)
+        return allocate_pages(nullptr, size, MEM_RESERVE | MEM_COMMIT);
+
+#if (_MSC_VER <= 1900) || WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_DESKTOP)
+    // large pages require the "lock pages in memory" privilege, they are always aligned
+    if (mode == huge_page_mode::explicit_pages)
+    {
+        auto memory = allocate_pages(nullptr, size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES);
+        if (memory)
+            return memory;
+    }
+#endif
+    (void)mode;
+
+    // there are no transparent huge pages, so fall back to normal ones,
+    // but still aligned as promised
+    return allocate_aligned_pages(size, huge_page_size);
+}
+
+void foonathan::memory::virtual_memory_deallocate_huge_pages(void* memory, std::size_t) noexcept
+{
+    auto result = VirtualFree(memory, 0u, MEM_RELEASE);
+    FOONATHAN_MEMORY_ASSERT_MSG(result, "cannot release pages");
+    (void)result;
+}
 #elif defined(__unix__) || defined(__APPLE__) || defined(__VXWORKS__)                              \
     || defined(__QNXNTO__) // POSIX systems
+#include <cstdio>
+#include <dirent.h>
 #include <sys/mman.h>
 #include <unistd.h>
 
@@ -138,6 +232,154 @@ void foonathan::memory::virtual_memory_decommit(void* memory, std::size_t no_pag
     FOONATHAN_MEMORY_ASSERT_MSG(result == 0, "cannot decommit memory");
     (void)result;
 }
+
+void foonathan::memory::virtual_memory_purge(void* memory, std::size_t no_pages) noexcept
+{
+    auto size = no_pages * virtual_memory_page_size;
+// MADV_FREE is lazy and cheaper, but not supported by older kernels
+#if defined(MADV_FREE)
+    if (madvise(memory, size, MADV_FREE) == 0)
+        return;
+#endif
+#if defined(MADV_DONTNEED)
+    madvise(memory, size, MADV_DONTNEED);
+#elif defined(POSIX_MADV_DONTNEED)
+    posix_madvise(memory, size, POSIX_MADV_DONTNEED);
+#else
+    (void)size;
+#endif
+}
+
+namespace
+{
+    // reads the number of the first line of a file matching the format, returns 0 on error
+    std::size_t read_number(const char* path, const char* format) noexcept
+    {
+        auto file = std::fopen(path, "r");
+        if (!file)
+            return 0u;
+
+        char          line[256];
+        unsigned long number = 0u;
+        while (std::fgets(line, sizeof(line), file))
+            if (std::sscanf(line, format, &number) == 1)
+                break;
+        std::fclose(file);
+        return std::size_t(number);
+    }
+
+    std::size_t read_huge_page_size() noexcept
+    {
+#if defined(__linux__)
+        // size of transparent huge pages
+        auto size = read_number("/sys/kernel/mm/transparent_hugepage/hpage_pmd_size", "%lu");
+        if (size > virtual_memory_page_size)
+            return size;
+        // default size of explicit huge pages
+        return read_number("/proc/meminfo", "Hugepagesize: %lu kB") * 1024u;
+#else
+        return 0u;
+#endif
+    }
+} // namespace
+
+std::size_t foonathan::memory::get_virtual_memory_huge_page_size() noexcept
+{
+    static const auto size = read_huge_page_size();
+    return size;
+}
+
+std::size_t foonathan::memory::get_virtual_memory_page_sizes(std::size_t* sizes,
+                                                             std::size_t  max_sizes) noexcept
+{
+    std::size_t no_sizes = 0u;
+    // inserts a size keeping them sorted and unique
+    auto insert = [&](std::size_t size)
+    {
+        auto pos = std::size_t(0u);
+        while (pos != no_sizes && sizes[pos] < size)
+            ++pos;
+        if (size == 0u || no_sizes == max_sizes || (pos != no_sizes && sizes[pos] == size))
+            return;
+        for (auto i = no_sizes; i != pos; --i)
+            sizes[i] = sizes[i - 1u];
+        sizes[pos] = size;
+        ++no_sizes;
+    };
+
+    insert(virtual_memory_page_size);
+    insert(get_virtual_memory_huge_page_size());
+#if defined(__linux__)
+    // all sizes of explicit huge pages
+    if (auto dir = opendir("/sys/kernel/mm/hugepages"))
+    {
+        while (auto entry = readdir(dir))
+        {
+            unsigned long size_kb = 0u;
+            if (std::sscanf(entry->d_name, "hugepages-%lukB", &size_kb) == 1)
+                insert(std::size_t(size_kb) * 1024u);
+        }
+        closedir(dir);
+    }
+#endif
+    return no_sizes;
+}
+
+void* foonathan::memory::virtual_memory_allocate_huge_pages(std::size_t    size,
+                                                            huge_page_mode mode) noexcept
+{
+    auto huge_page_size = get_virtual_memory_huge_page_size();
+#if defined(MAP_HUGETLB)
+    if (mode == huge_page_mode::explicit_pages && huge_page_size != 0u)
+    {
+        auto flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB;
+#if defined(MAP_HUGE_SHIFT)
+        flags |= static_cast<int>(detail::ilog2(huge_page_size)) << MAP_HUGE_SHIFT;
+#endif
+        auto memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, flags, -1, 0);
+        if (memory != MAP_FAILED)
+            return memory;
+        // no explicit huge pages left, fall back to transparent ones
+    }
+#endif
+    (void)mode;
+
+    if (huge_page_size == 0u)
+    {
+        auto memory =
+            mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        return memory == MAP_FAILED ? nullptr : memory;
+    }
+
+    // map more memory than needed, so it can be aligned to the huge page size
+    auto total_size = size + huge_page_size - virtual_memory_page_size;
+    auto memory =
+        mmap(nullptr, total_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED)
+        return nullptr;
+
+    // unmap the parts before and after the aligned memory
+    auto begin   = static_cast<char*>(memory);
+    auto aligned = begin + detail::align_offset(memory, huge_page_size);
+    auto end     = begin + total_size;
+    if (aligned != begin)
+        munmap(begin, static_cast<std::size_t>(aligned - begin));
+    if (aligned + size != end)
+        munmap(aligned + size, static_cast<std::size_t>(end - (aligned + size)));
+
+#if defined(MADV_HUGEPAGE)
+    madvise(aligned, size, MADV_HUGEPAGE);
+#endif
+    return aligned;
+}
+
+void foonathan::memory::virtual_memory_deallocate_huge_pages(void*       memory,
+                                                             std::size_t size) noexcept
+{
+    auto result = munmap(memory, size);
+    FOONATHAN_MEMORY_ASSERT_MSG(result == 0, "cannot release pages");
+    (void)result;
+}
 #else
 #warning "virtual memory functions not available on your platform, define your own"
 #endif
@@ -182,6 +424,27 @@ void virtual_memory_allocator::deallocate_node(void* node, std::size_t size, std
     virtual_memory_release(pages, no_pages);
 }
 
+bool virtual_memory_allocator::try_expand_node(void* node, std::size_t old_size,
+                                               std::size_t new_size, std::size_t) noexcept
+{
+    if (calc_no_pages(new_size) != calc_no_pages(old_size))
+        return false;
+    detail::debug_resize_node(node, old_size, new_size, virtual_memory_page_size);
+    on_allocate(new_size - old_size);
+    return true;
+}
+
+bool virtual_memory_allocator::try_shrink_node(void* node, std::size_t old_size,
+                                               std::size_t new_size, std::size_t) noexcept
+{
+    // the pages can only be released all at once, so they must not change
+    if (calc_no_pages(new_size) != calc_no_pages(old_size))
+        return false;
+    detail::debug_resize_node(node, old_size, new_size, virtual_memory_page_size);
+    on_deallocate(old_size - new_size);
+    return true;
+}
+
 std::size_t virtual_memory_allocator::max_node_size() const noexcept
 {
     return std::size_t(-1);
@@ -239,3 +502,162 @@ allocator_info virtual_block_allocator::info() noexcept
 {
     return {FOONATHAN_MEMORY_LOG_PREFIX "::virtual_block_allocator", this};
 }
+
+namespace
+{
+    constexpr std::size_t bitmap_word_bits = 64u;
+
+    std::size_t bitmap_word_count(std::size_t no_blocks) noexcept
+    {
+        return (no_blocks + bitmap_word_bits - 1u) / bitmap_word_bits;
+    }
+
+    // number of pages at the beginning of the reserved memory for the bitmap
+    std::size_t bitmap_pages(std::size_t no_blocks) noexcept
+    {
+        auto size = bitmap_word_count(no_blocks) * sizeof(std::uint64_t);
+        return (size + virtual_memory_page_size - 1u) / virtual_memory_page_size;
+    }
+} // namespace
+
+reusable_virtual_block_allocator::reusable_virtual_block_allocator(std::size_t block_size,
+                                                                   std::size_t no_blocks)
+: bitmap_(nullptr),
+  blocks_(nullptr),
+  block_size_(block_size),
+  no_blocks_(no_blocks),
+  no_free_(no_blocks),
+  first_word_(0u)
+{
+    FOONATHAN_MEMORY_ASSERT(block_size % virtual_memory_page_size == 0u);
+    FOONATHAN_MEMORY_ASSERT(no_blocks > 0);
+    auto no_bitmap_pages = bitmap_pages(no_blocks);
+    auto no_pages        = no_bitmap_pages + block_size_ / virtual_memory_page_size * no_blocks;
+
+    auto memory = virtual_memory_reserve(no_pages);
+    if (!memory)
+        FOONATHAN_THROW(out_of_memory(info(), no_pages * virtual_memory_page_size));
+    if (!virtual_memory_commit(memory, no_bitmap_pages))
+    {
+        virtual_memory_release(memory, no_pages);
+        FOONATHAN_THROW(out_of_memory(info(), no_pages * virtual_memory_page_size));
+    }
+
+    // all blocks are free
+    bitmap_ = static_cast<std::uint64_t*>(memory);
+    blocks_ = static_cast<char*>(memory) + no_bitmap_pages * virtual_memory_page_size;
+
+    auto no_words = bitmap_word_count(no_blocks);
+    for (std::size_t i = 0u; i != no_words; ++i)
+        bitmap_[i] = ~std::uint64_t(0u);
+    auto remaining = no_blocks - (no_words - 1u) * bitmap_word_bits;
+    if (remaining != bitmap_word_bits)
+        bitmap_[no_words - 1u] = (std::uint64_t(1u) << remaining) - 1u;
+}
+
+reusable_virtual_block_allocator::~reusable_virtual_block_allocator() noexcept
+{
+    if (bitmap_)
+        virtual_memory_release(bitmap_, bitmap_pages(no_blocks_)
+                                            + block_size_ / virtual_memory_page_size
+                                                  * no_blocks_);
+}
+
+memory_block reusable_virtual_block_allocator::allocate_block()
+{
+    if (no_free_ == 0u)
+        FOONATHAN_THROW(out_of_fixed_memory(info(), block_size_));
+
+    auto word = first_word_;
+    while (bitmap_[word] == 0u)
+        ++word;
+    first_word_ = word;
+
+    auto index = word * bitmap_word_bits + detail::count_trailing_zeros(bitmap_[word]);
+    auto mem   = virtual_memory_commit(blocks_ + index * block_size_,
+                                       block_size_ / virtual_memory_page_size);
+    if (!mem)
+        FOONATHAN_THROW(out_of_fixed_memory(info(), block_size_));
+
+    bitmap_[word] &= bitmap_[word] - 1u; // clear lowest set bit
+    --no_free_;
+    return {mem, block_size_};
+}
+
+void reusable_virtual_block_allocator::deallocate_block(memory_block block) noexcept
+{
+    auto memory = static_cast<char*>(block.memory);
+    detail::debug_check_pointer(
+        [&]
+        {
+            return owns(memory)
+                   && static_cast<std::size_t>(memory - blocks_) % block_size_ == 0u;
+        },
+        info(), block.memory);
+
+    auto index = static_cast<std::size_t>(memory - blocks_) / block_size_;
+    auto word  = index / bitmap_word_bits;
+    auto mask  = std::uint64_t(1u) << (index % bitmap_word_bits);
+    detail::debug_check_double_dealloc([&] { return (bitmap_[word] & mask) == 0u; }, info(),
+                                       block.memory);
+
+    virtual_memory_decommit(memory, block_size_ / virtual_memory_page_size);
+    bitmap_[word] |= mask;
+    if (word < first_word_)
+        first_word_ = word;
+    ++no_free_;
+}
+
+bool reusable_virtual_block_allocator::owns(const void* ptr) const noexcept
+{
+    auto address = reinterpret_cast<std::uintptr_t>(ptr);
+    auto begin   = reinterpret_cast<std::uintptr_t>(blocks_);
+    return begin <= address && address < begin + block_size_ * no_blocks_;
+}
+
+allocator_info reusable_virtual_block_allocator::info() noexcept
+{
+    return {FOONATHAN_MEMORY_LOG_PREFIX "::reusable_virtual_block_allocator", this};
+}
+
+namespace
+{
+    std::size_t round_up_to_page(std::size_t size, std::size_t page_size) noexcept
+    {
+        return (size + page_size - 1u) / page_size * page_size;
+    }
+} // namespace
+
+huge_page_block_allocator::huge_page_block_allocator(std::size_t    block_size,
+                                                     huge_page_mode mode) noexcept
+: block_size_(0u), mode_(mode)
+{
+    FOONATHAN_MEMORY_ASSERT(block_size > 0u);
+    block_size_ = round_up_to_page(block_size, page_size());
+}
+
+memory_block huge_page_block_allocator::allocate_block()
+{
+    auto memory = virtual_memory_allocate_huge_pages(block_size_, mode_);
+    if (!memory)
+        FOONATHAN_THROW(out_of_memory(info(), block_size_));
+    memory_block block(memory, block_size_);
+    block_size_ *= 2u;
+    return block;
+}
+
+void huge_page_block_allocator::deallocate_block(memory_block block) noexcept
+{
+    virtual_memory_deallocate_huge_pages(block.memory, block.size);
+}
+
+std::size_t huge_page_block_allocator::page_size() const noexcept
+{
+    auto huge_page_size = get_virtual_memory_huge_page_size();
+    return huge_page_size != 0u ? huge_page_size : virtual_memory_page_size;
+}
+
+allocator_info huge_page_block_allocator::info() noexcept
+{
+    return {FOONATHAN_MEMORY_LOG_PREFIX "::huge_page_block_allocator", this};
+}
@@ -0,0 +1,82 @@
+// Copyright (C) 2015-2025 Jonathan Müller and foonathan/memory contributors
+// SPDX-License-Identifier: Zlib
+
+#include "virtual_memory_stack.hpp"
+
+#include "debugging.hpp"
+#include "virtual_memory.hpp"
+
+using namespace foonathan::memory;
+
+void detail::virtual_memory_stack_leak_handler::operator()(std::ptrdiff_t amount)
+{
+    get_leak_handler()({FOONATHAN_MEMORY_LOG_PREFIX "::virtual_memory_stack", this}, amount);
+}
+
+namespace
+{
+    std::size_t no_pages_for(std::size_t size) noexcept
+    {
+        return (size + virtual_memory_page_size - 1u) / virtual_memory_page_size;
+    }
+} // namespace
+
+virtual_memory_stack::virtual_memory_stack(std::size_t max_size, std::size_t retained_size)
+: begin_(nullptr),
+  committed_(nullptr),
+  end_(nullptr),
+  retained_size_(retained_size)
+{
+    FOONATHAN_MEMORY_ASSERT(max_size > 0u);
+    auto no_pages = no_pages_for(max_size);
+    auto memory   = virtual_memory_reserve(no_pages);
+    if (!memory)
+        FOONATHAN_THROW(out_of_memory(info(), no_pages * virtual_memory_page_size));
+
+    begin_     = static_cast<char*>(memory);
+    committed_ = begin_;
+    end_       = begin_ + no_pages * virtual_memory_page_size;
+    stack_     = detail::fixed_memory_stack(begin_);
+}
+
+virtual_memory_stack::~virtual_memory_stack() noexcept
+{
+    if (begin_)
+    {
+        if (committed_ != begin_)
+            virtual_memory_decommit(begin_, committed_size() / virtual_memory_page_size);
+        virtual_memory_release(begin_, reserved_size() / virtual_memory_page_size);
+    }
+}
+
+void virtual_memory_stack::commit(std::size_t needed)
+{
+    if (needed > capacity_left())
+        FOONATHAN_THROW(out_of_fixed_memory(info(), needed));
+
+    // commit at least as much as is already committed to keep the number of commits small
+    auto no_pages = no_pages_for(needed - std::size_t(committed_ - stack_.top()));
+    auto doubling = committed_size() / virtual_memory_page_size;
+    auto no_left  = std::size_t(end_ - committed_) / virtual_memory_page_size;
+    if (no_pages < doubling)
+        no_pages = doubling < no_left ? doubling : no_left;
+
+    if (!virtual_memory_commit(committed_, no_pages))
+        FOONATHAN_THROW(out_of_memory(info(), no_pages * virtual_memory_page_size));
+    committed_ += no_pages * virtual_memory_page_size;
+}
+
+void virtual_memory_stack::decommit(const char* new_end) noexcept
+{
+    auto offset = no_pages_for(std::size_t(new_end - begin_)) * virtual_memory_page_size;
+    if (offset >= committed_size())
+        return;
+
+    auto first = begin_ + offset;
+    virtual_memory_decommit(first, std::size_t(committed_ - first) / virtual_memory_page_size);
+    committed_ = first;
+}
+
+#if FOONATHAN_MEMORY_EXTERN_TEMPLATE
+template class foonathan::memory::memory_stack_raii_unwind<virtual_memory_stack>;
+#endif
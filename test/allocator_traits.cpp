@@ -5,6 +5,7 @@
 
 #include <doctest/doctest.h>
 
+#include <new>
 #include <type_traits>
 
 #include "heap_allocator.hpp"
@@ -289,6 +290,175 @@ TEST_CASE("allocator_traits")
         REQUIRE(!array4.alloc);
         REQUIRE(!array4.dealloc);
     }
+    SUBCASE("nodes")
+    {
+        struct counting_allocator
+        {
+            std::size_t allocated = 0u, limit = std::size_t(-1);
+
+            void* allocate_node(std::size_t, std::size_t)
+            {
+                if (allocated == limit)
+                    throw std::bad_alloc();
+                ++allocated;
+                return this;
+            }
+
+            void deallocate_node(void*, std::size_t, std::size_t) noexcept
+            {
+                --allocated;
+            }
+        };
+
+        // minimum interface allocates each node on its own
+        counting_allocator counting;
+        void*              nodes[4];
+        allocator_traits<counting_allocator>::allocate_nodes(counting, 4, 1, 1, nodes);
+        REQUIRE(counting.allocated == 4u);
+        allocator_traits<counting_allocator>::deallocate_nodes(counting, nodes, 4, 1, 1);
+        REQUIRE(counting.allocated == 0u);
+
+        // already allocated nodes are deallocated on failure
+        counting.limit = 2u;
+        REQUIRE_THROWS_AS(allocator_traits<counting_allocator>::allocate_nodes(counting, 4, 1, 1,
+                                                                               nodes),
+                          std::bad_alloc);
+        REQUIRE(counting.allocated == 0u);
+
+        struct nodes_raw : min_raw_allocator
+        {
+            bool alloc_nodes = false, dealloc_nodes = false;
+
+            void allocate_nodes(std::size_t, std::size_t, std::size_t, void**)
+            {
+                alloc_nodes = true;
+            }
+
+            void deallocate_nodes(void**, std::size_t, std::size_t, std::size_t) noexcept
+            {
+                dealloc_nodes = true;
+            }
+        };
+
+        // batch works over node
+        nodes_raw batch;
+        allocator_traits<nodes_raw>::allocate_nodes(batch, 4, 1, 1, nodes);
+        allocator_traits<nodes_raw>::deallocate_nodes(batch, nodes, 4, 1, 1);
+        REQUIRE(batch.alloc_nodes);
+        REQUIRE(batch.dealloc_nodes);
+        REQUIRE(!batch.alloc_node);
+        REQUIRE(!batch.dealloc_node);
+    }
+    SUBCASE("reallocate")
+    {
+        struct buffer_allocator
+        {
+            alignas(int) char buffers[2][64];
+            std::size_t       allocated = 0u, deallocated = 0u;
+
+            void* allocate_node(std::size_t size, std::size_t)
+            {
+                REQUIRE(size <= 64u);
+                return buffers[allocated++];
+            }
+
+            void deallocate_node(void*, std::size_t, std::size_t) noexcept
+            {
+                ++deallocated;
+            }
+        };
+        using traits = allocator_traits<buffer_allocator>;
+
+        // minimum interface cannot resize in place and copies
+        buffer_allocator buffer;
+        auto             array = static_cast<int*>(traits::allocate_array(buffer, 4, sizeof(int),
+                                                                          alignof(int)));
+        for (auto i = 0; i != 4; ++i)
+            array[i] = i;
+        REQUIRE(!traits::try_expand_node(buffer, array, 4 * sizeof(int), 8 * sizeof(int),
+                                         alignof(int)));
+        REQUIRE(!traits::try_shrink_node(buffer, array, 4 * sizeof(int), 2 * sizeof(int),
+                                         alignof(int)));
+
+        auto bigger = static_cast<int*>(
+            traits::reallocate_array(buffer, array, 4, 8, sizeof(int), alignof(int)));
+        REQUIRE(bigger != array);
+        for (auto i = 0; i != 4; ++i)
+            REQUIRE(bigger[i] == i);
+        REQUIRE(buffer.allocated == 2u);
+        REQUIRE(buffer.deallocated == 1u);
+
+        // same size needs nothing
+        REQUIRE(traits::reallocate_array(buffer, bigger, 8, 8, sizeof(int), alignof(int))
+                == bigger);
+        REQUIRE(buffer.allocated == 2u);
+
+        struct resize_raw : min_raw_allocator
+        {
+            bool expand = false, shrink = false;
+
+            bool try_expand_node(void*, std::size_t, std::size_t, std::size_t) noexcept
+            {
+                expand = true;
+                return true;
+            }
+
+            bool try_shrink_node(void*, std::size_t, std::size_t, std::size_t) noexcept
+            {
+                shrink = true;
+                return true;
+            }
+        };
+
+        // reallocation resizes in place if possible
+        resize_raw resize;
+        int        i = 0;
+        REQUIRE(allocator_traits<resize_raw>::reallocate_array(resize, &i, 1, 2, 1, 1) == &i);
+        REQUIRE(allocator_traits<resize_raw>::reallocate_array(resize, &i, 2, 1, 1, 1) == &i);
+        REQUIRE(resize.expand);
+        REQUIRE(resize.shrink);
+        REQUIRE(!resize.alloc_node);
+        REQUIRE(!resize.dealloc_node);
+
+        struct reallocate_raw : min_raw_allocator
+        {
+            bool reallocate = false;
+
+            void* reallocate_array(void* array, std::size_t, std::size_t, std::size_t,
+                                   std::size_t)
+            {
+                reallocate = true;
+                return array;
+            }
+        };
+
+        reallocate_raw realloc;
+        allocator_traits<reallocate_raw>::reallocate_array(realloc, &i, 1, 2, 1, 1);
+        REQUIRE(realloc.reallocate);
+        REQUIRE(!realloc.alloc_node);
+        REQUIRE(!realloc.dealloc_node);
+    }
+    SUBCASE("allocate_at_least")
+    {
+        // minimum interface allocates exactly
+        min_raw_allocator min;
+        auto block = allocator_traits<min_raw_allocator>::allocate_at_least(min, 4, 2, 1);
+        REQUIRE(block.size == 8u);
+        REQUIRE(min.alloc_node);
+
+        struct at_least_raw : min_raw_allocator
+        {
+            memory_block allocate_at_least(std::size_t count, std::size_t size, std::size_t)
+            {
+                return {nullptr, 2 * count * size};
+            }
+        };
+
+        at_least_raw at_least;
+        block = allocator_traits<at_least_raw>::allocate_at_least(at_least, 4, 2, 1);
+        REQUIRE(block.size == 16u);
+        REQUIRE(!at_least.alloc_node);
+    }
     SUBCASE("max getter")
     {
         min_raw_allocator min;
@@ -416,4 +586,159 @@ TEST_CASE("composable_allocator_traits")
         REQUIRE(!array.alloc_node);
         REQUIRE(!array.dealloc_node);
     }
+    SUBCASE("nodes")
+    {
+        struct counting_composable : min_composable_allocator
+        {
+            std::size_t allocated = 0u, limit = std::size_t(-1);
+
+            void* try_allocate_node(std::size_t, std::size_t) noexcept
+            {
+                if (allocated == limit)
+                    return nullptr;
+                ++allocated;
+                return this;
+            }
+
+            bool try_deallocate_node(void* ptr, std::size_t, std::size_t) noexcept
+            {
+                if (ptr != this)
+                    return false;
+                --allocated;
+                return true;
+            }
+        };
+        using traits = composable_allocator_traits<counting_composable>;
+
+        // minimum interface allocates each node on its own
+        counting_composable counting;
+        void*               nodes[4];
+        REQUIRE(traits::try_allocate_nodes(counting, 4, 1, 1, nodes));
+        REQUIRE(counting.allocated == 4u);
+        REQUIRE(traits::try_deallocate_nodes(counting, nodes, 4, 1, 1));
+        REQUIRE(counting.allocated == 0u);
+
+        // nothing is allocated on failure
+        counting.limit = 2u;
+        REQUIRE(!traits::try_allocate_nodes(counting, 4, 1, 1, nodes));
+        REQUIRE(counting.allocated == 0u);
+
+        // foreign nodes are not deallocated
+        void* foreign[2] = {nodes, nodes};
+        REQUIRE(!traits::try_deallocate_nodes(counting, foreign, 2, 1, 1));
+
+        struct nodes_composable : min_composable_allocator
+        {
+            bool alloc_nodes = false, dealloc_nodes = false;
+
+            bool try_allocate_nodes(std::size_t, std::size_t, std::size_t, void**) noexcept
+            {
+                alloc_nodes = true;
+                return true;
+            }
+
+            bool try_deallocate_nodes(void**, std::size_t, std::size_t, std::size_t) noexcept
+            {
+                dealloc_nodes = true;
+                return true;
+            }
+        } batch;
+
+        composable_allocator_traits<nodes_composable>::try_allocate_nodes(batch, 4, 1, 1, nodes);
+        composable_allocator_traits<nodes_composable>::try_deallocate_nodes(batch, nodes, 4, 1,
+                                                                            1);
+        REQUIRE(batch.alloc_nodes);
+        REQUIRE(batch.dealloc_nodes);
+        REQUIRE(!batch.alloc_node);
+        REQUIRE(!batch.dealloc_node);
+    }
+    SUBCASE("reallocate")
+    {
+        struct buffer_composable : min_composable_allocator
+        {
+            alignas(int) char buffers[2][64];
+            std::size_t       allocated = 0u, deallocated = 0u;
+
+            void* try_allocate_node(std::size_t size, std::size_t) noexcept
+            {
+                if (size > 64u || allocated == 2u)
+                    return nullptr;
+                return buffers[allocated++];
+            }
+
+            bool try_deallocate_node(void* ptr, std::size_t, std::size_t) noexcept
+            {
+                if (ptr != buffers[0] && ptr != buffers[1])
+                    return false;
+                ++deallocated;
+                return true;
+            }
+        };
+        using traits = composable_allocator_traits<buffer_composable>;
+
+        buffer_composable buffer;
+        auto array = static_cast<int*>(traits::try_allocate_array(buffer, 4, sizeof(int),
+                                                                  alignof(int)));
+        REQUIRE(array);
+        for (auto i = 0; i != 4; ++i)
+            array[i] = i;
+        REQUIRE(!traits::try_expand_node(buffer, array, 4 * sizeof(int), 8 * sizeof(int),
+                                         alignof(int)));
+
+        // foreign arrays are not reallocated and nothing is leaked
+        int foreign[4] = {};
+        REQUIRE(!traits::try_reallocate_array(buffer, foreign, 4, 8, sizeof(int), alignof(int)));
+        REQUIRE(buffer.allocated == 2u);
+        REQUIRE(buffer.deallocated == 1u);
+
+        // no memory left
+        REQUIRE(!traits::try_reallocate_array(buffer, array, 4, 8, sizeof(int), alignof(int)));
+
+        buffer.allocated = 1u;
+        auto bigger      = static_cast<int*>(
+            traits::try_reallocate_array(buffer, array, 4, 8, sizeof(int), alignof(int)));
+        REQUIRE(bigger);
+        REQUIRE(bigger != array);
+        for (auto i = 0; i != 4; ++i)
+            REQUIRE(bigger[i] == i);
+        REQUIRE(buffer.deallocated == 2u);
+    }
+}
+
+TEST_CASE("allocator_traits w/ heap_allocator")
+{
+    using traits = allocator_traits<heap_allocator>;
+    heap_allocator alloc;
+
+    auto array = static_cast<int*>(traits::allocate_array(alloc, 4, sizeof(int), alignof(int)));
+    for (auto i = 0; i != 4; ++i)
+        array[i] = i;
+
+    // uses realloc(), so the contents are kept regardless of whether the memory moves
+    array = static_cast<int*>(
+        traits::reallocate_array(alloc, array, 4, 1024, sizeof(int), alignof(int)));
+    for (auto i = 0; i != 4; ++i)
+        REQUIRE(array[i] == i);
+    array[1023] = 1023;
+
+    array = static_cast<int*>(
+        traits::reallocate_array(alloc, array, 1024, 2, sizeof(int), alignof(int)));
+    REQUIRE(array[0] == 0);
+    REQUIRE(array[1] == 1);
+    traits::deallocate_array(alloc, array, 2, sizeof(int), alignof(int));
+}
+
+TEST_CASE("allocator_traits w/ heap_allocator allocate_at_least")
+{
+    using traits = allocator_traits<heap_allocator>;
+    heap_allocator alloc;
+
+    // the slack of the C library is not exposed, only the requested size may be written
+    auto block = traits::allocate_at_least(alloc, 3, sizeof(int), alignof(int));
+    REQUIRE(block.size == 3 * sizeof(int));
+    auto count = block.size / sizeof(int);
+    auto array = static_cast<int*>(block.memory);
+    for (std::size_t i = 0u; i != count; ++i)
+        array[i] = int(i);
+    traits::deallocate_array(alloc, block.memory, count, sizeof(int), alignof(int));
 }
@@ -9,6 +9,7 @@
 #include <algorithm>
 #include <chrono>
 #include <random>
+#include <thread>
 #include <vector>
 
 #include "allocator_traits.hpp"
@@ -182,4 +183,81 @@ struct butterfly : basic_bulk
     }
 };
 
+// allocates count nodes of different sizes in bulk, as done by memory_pool_collection users
+struct mixed
+{
+    std::size_t count;
+
+    mixed(std::size_t c) : count(c) {}
+
+    template <class RawAllocator>
+    std::size_t operator()(RawAllocator& alloc, std::size_t max_size)
+    {
+        using namespace foonathan::memory;
+
+        std::vector<std::size_t> sizes;
+        sizes.reserve(count);
+        for (std::size_t i = 0u; i != count; ++i)
+            sizes.push_back(i * 7u % max_size + 1u);
+
+        std::vector<void*> ptrs;
+        ptrs.reserve(count);
+
+        return measure(
+            [&]()
+            {
+                for (auto size : sizes)
+                    ptrs.push_back(allocator_traits<RawAllocator>::allocate_node(alloc, size, 1));
+                for (std::size_t i = 0u; i != count; ++i)
+                    allocator_traits<RawAllocator>::deallocate_node(alloc, ptrs[i], sizes[i], 1);
+            });
+    }
+
+    static const char* name()
+    {
+        return "mixed";
+    }
+};
+
+struct contended
+{
+    std::size_t count, no_threads;
+
+    contended(std::size_t c, std::size_t t) : count(c), no_threads(t) {}
+
+    // each thread allocates and deallocates count nodes in bulk
+    template <class RawAllocator>
+    std::size_t operator()(RawAllocator& alloc, std::size_t node_size)
+    {
+        using namespace foonathan::memory;
+
+        return measure(
+            [&]()
+            {
+                std::vector<std::thread> threads;
+                for (std::size_t t = 0u; t != no_threads; ++t)
+                    threads.emplace_back(
+                        [&]
+                        {
+                            std::vector<void*> ptrs;
+                            ptrs.reserve(count);
+                            for (std::size_t i = 0u; i != count; ++i)
+                                ptrs.push_back(allocator_traits<RawAllocator>::allocate_node(alloc,
+                                                                                             node_size,
+                                                                                             1));
+                            for (auto ptr : ptrs)
+                                allocator_traits<RawAllocator>::deallocate_node(alloc, ptr,
+                                                                                node_size, 1);
+                        });
+                for (auto& thread : threads)
+                    thread.join();
+            });
+    }
+
+    static const char* name()
+    {
+        return "contended";
+    }
+};
+
 #endif // FOONATHAN_MEMORY_TEST_BENCHMARK_HPP_INCLUDED
@@ -0,0 +1,135 @@
+// Copyright (C) 2015-2025 Jonathan Müller and foonathan/memory contributors
+// SPDX-License-Identifier: Zlib
+
+#include "concurrent_memory_stack.hpp"
+
+#include <algorithm>
+#include <doctest/doctest.h>
+#include <thread>
+#include <vector>
+
+#include "allocator_storage.hpp"
+#include "test_allocator.hpp"
+
+using namespace foonathan::memory;
+
+TEST_CASE("concurrent_memory_stack")
+{
+    test_allocator alloc;
+
+    using stack_type = concurrent_memory_stack<allocator_reference<test_allocator>>;
+    stack_type stack(stack_type::min_block_size(256), alloc);
+    REQUIRE(alloc.no_allocated() == 1u);
+    REQUIRE(stack.capacity_left() == 256u);
+
+    SUBCASE("normal allocation/unwind")
+    {
+        auto a = stack.allocate(10, 1);
+        REQUIRE(detail::is_aligned(a, detail::max_alignment));
+        auto capacity = stack.capacity_left();
+        REQUIRE(capacity < 256u);
+
+        auto m = stack.top();
+
+        auto b = stack.allocate(10, 64);
+        REQUIRE(detail::is_aligned(b, 64));
+        REQUIRE(static_cast<char*>(b) >= static_cast<char*>(a) + 10);
+
+        stack.unwind(m);
+        REQUIRE(stack.capacity_left() == capacity);
+        REQUIRE(stack.top() == m);
+
+        REQUIRE(stack.allocate(10, 64) == b);
+        REQUIRE(alloc.no_allocated() == 1u);
+    }
+    SUBCASE("multiple block allocation/unwind")
+    {
+        stack.allocate(10, 1);
+        auto m = stack.top();
+
+        auto old_next = stack.next_capacity();
+
+        stack.allocate(250, 1);
+        REQUIRE(stack.next_capacity() > old_next);
+        REQUIRE(alloc.no_allocated() == 2u);
+
+        auto m2 = stack.top();
+        REQUIRE(m < m2);
+        stack.allocate(10, 1);
+        stack.unwind(m2);
+
+        stack.unwind(m);
+        REQUIRE(stack.top() == m);
+        REQUIRE(alloc.no_allocated() == 2u);
+        REQUIRE(alloc.no_deallocated() == 0u);
+
+        stack.shrink_to_fit();
+        REQUIRE(alloc.no_allocated() == 1u);
+        REQUIRE(alloc.no_deallocated() == 1u);
+    }
+    SUBCASE("try_allocate")
+    {
+        REQUIRE(!stack.try_allocate(1024, 1));
+        while (stack.try_allocate(16, 1))
+            ;
+        REQUIRE(alloc.no_allocated() == 1u);
+        REQUIRE(stack.allocate(16, 1));
+        REQUIRE(alloc.no_allocated() == 2u);
+    }
+    SUBCASE("too big")
+    {
+        REQUIRE_THROWS_AS(stack.allocate(stack.next_capacity() + 1u, 1), bad_allocation_size);
+    }
+    SUBCASE("concurrent allocation")
+    {
+        const auto no_threads = 4u, no_allocations = 500u;
+
+        std::vector<std::vector<char*>> nodes(no_threads);
+        std::vector<std::thread>        threads;
+        for (auto i = 0u; i != no_threads; ++i)
+            threads.emplace_back(
+                [&, i]
+                {
+                    for (auto j = 0u; j != no_allocations; ++j)
+                    {
+                        auto node = static_cast<char*>(stack.allocate(24, 8));
+                        std::fill(node, node + 24, char(i));
+                        nodes[i].push_back(node);
+                    }
+                });
+        for (auto& thread : threads)
+            thread.join();
+        REQUIRE(alloc.no_allocated() > 1u);
+
+        // every thread got its own memory which nobody else has overwritten
+        std::vector<char*> all;
+        for (auto i = 0u; i != no_threads; ++i)
+            for (auto node : nodes[i])
+            {
+                REQUIRE(std::count(node, node + 24, char(i)) == 24);
+                all.push_back(node);
+            }
+        std::sort(all.begin(), all.end());
+        for (std::size_t i = 1u; i < all.size(); ++i)
+            REQUIRE(all[i - 1] + 24 <= all[i]);
+    }
+    SUBCASE("allocator_traits")
+    {
+        using traits = allocator_traits<stack_type>;
+        auto m       = stack.top();
+
+        auto node = traits::allocate_node(stack, 16, 8);
+        REQUIRE(!traits::try_expand_node(stack, node, 16, 32, 8));
+        REQUIRE(composable_allocator_traits<stack_type>::try_deallocate_node(stack, node, 16, 8));
+        traits::deallocate_node(stack, node, 16, 8);
+
+        auto block = traits::allocate_at_least(stack, 3, 4, 4);
+        REQUIRE(block.size == 12u);
+        traits::deallocate_array(stack, block.memory, 3, 4, 4);
+
+        int i = 0;
+        REQUIRE(!composable_allocator_traits<stack_type>::try_deallocate_node(stack, &i, 4, 4));
+
+        stack.unwind(m);
+    }
+}
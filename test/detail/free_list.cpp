@@ -1,6 +1,8 @@
 // Copyright (C) 2015-2025 Jonathan Müller and foonathan/memory contributors
 // SPDX-License-Identifier: Zlib
 
+#include "detail/bitmap_free_list.hpp"
+#include "detail/concurrent_free_list.hpp"
 #include "detail/free_list.hpp"
 #include "detail/small_free_list.hpp"
 
@@ -10,6 +12,7 @@
 #include <vector>
 
 #include "detail/align.hpp"
+#include "memory_arena.hpp"
 #include "static_allocator.hpp"
 
 using namespace foonathan::memory;
@@ -83,6 +86,39 @@ void use_list_node(FreeList& list)
     }
 }
 
+template <class FreeList>
+void use_list_nodes(FreeList& list)
+{
+    auto               capacity = list.capacity();
+    std::vector<void*> ptrs(capacity + 1u);
+
+    // allocate in two batches, the second one can't be satisfied completely
+    auto first = list.allocate_nodes(capacity / 2, ptrs.data());
+    REQUIRE(first == capacity / 2);
+    REQUIRE(list.capacity() == capacity - first);
+
+    auto second = list.allocate_nodes(capacity, ptrs.data() + first);
+    REQUIRE(second == capacity - first);
+    REQUIRE(list.capacity() == 0u);
+    REQUIRE(list.empty());
+    REQUIRE(list.allocate_nodes(1u, ptrs.data() + capacity) == 0u);
+
+    ptrs.resize(capacity);
+    for (auto ptr : ptrs)
+        REQUIRE(is_aligned(ptr, list.alignment()));
+    std::sort(ptrs.begin(), ptrs.end());
+    REQUIRE(std::unique(ptrs.begin(), ptrs.end()) == ptrs.end());
+
+    std::shuffle(ptrs.begin(), ptrs.end(), std::mt19937{});
+    list.deallocate_nodes(ptrs.data(), capacity / 2);
+    REQUIRE(list.capacity() == capacity / 2);
+    list.deallocate_nodes(ptrs.data() + capacity / 2, capacity - capacity / 2);
+    REQUIRE(list.capacity() == capacity);
+
+    // single nodes are still usable
+    use_list_node(list);
+}
+
 template <class FreeList>
 void check_list(FreeList& list, void* memory, std::size_t size)
 {
@@ -103,6 +139,7 @@ void check_list(FreeList& list, void* memory, std::size_t size)
     REQUIRE(list.capacity() == old_cap);
 
     use_list_node(list);
+    use_list_nodes(list);
 }
 
 template <class FreeList>
@@ -177,6 +214,35 @@ TEST_CASE("free_memory_list")
 
         check_move(list);
     }
+    SUBCASE("lazy carving")
+    {
+        static_allocator_storage<1024> a;
+        static_allocator_storage<1024> b;
+        list.insert(&a, 1024);
+        REQUIRE(list.capacity() == 1024 / list.node_size());
+
+        // nodes are carved in address order
+        auto begin = static_cast<char*>(static_cast<void*>(&a));
+        auto node  = list.allocate();
+        REQUIRE(node == begin);
+        REQUIRE(list.allocate() == begin + list.node_size());
+
+        // deallocated nodes are preferred
+        list.deallocate(node);
+        REQUIRE(list.allocate() == node);
+        REQUIRE(list.allocate() == begin + 2 * list.node_size());
+
+        // arrays can be carved too
+        auto array = list.allocate(3 * list.node_size());
+        REQUIRE(array == begin + 3 * list.node_size());
+        list.deallocate(array, 3 * list.node_size());
+
+        // the rest of the first block is still available after inserting another one
+        list.insert(&b, 1024);
+        REQUIRE(list.capacity() == 2 * (1024 / list.node_size()) - 3);
+        use_list_node(list);
+        use_list_nodes(list);
+    }
 }
 
 void use_list_array(ordered_free_memory_list& list)
@@ -280,6 +346,200 @@ TEST_CASE("ordered_free_memory_list")
     }
 }
 
+namespace
+{
+    // frees the nodes [first, last) of an array allocated from list
+    void free_nodes(ordered_free_memory_list& list, std::vector<bool>& is_free, char* base,
+                    std::size_t first, std::size_t last)
+    {
+        list.deallocate(base + first * list.node_size(), (last - first) * list.node_size());
+        for (auto i = first; i != last; ++i)
+            is_free[i] = true;
+    }
+
+    // allocates an array and checks that it only consists of free nodes
+    char* use_nodes(ordered_free_memory_list& list, std::vector<bool>& is_free, char* base,
+                    std::size_t no_nodes)
+    {
+        auto capacity = list.capacity();
+        auto ptr      = static_cast<char*>(list.allocate(no_nodes * list.node_size()));
+        if (ptr)
+        {
+            REQUIRE(list.capacity() == capacity - no_nodes);
+            auto first = static_cast<std::size_t>(ptr - base) / list.node_size();
+            REQUIRE(first + no_nodes <= is_free.size());
+            for (auto i = first; i != first + no_nodes; ++i)
+            {
+                REQUIRE(is_free[i]);
+                is_free[i] = false;
+            }
+        }
+        return ptr;
+    }
+
+    void use_list_runs(std::size_t node_size)
+    {
+        ordered_free_memory_list list(node_size);
+        REQUIRE(list.node_size() >= node_size);
+
+        static_allocator_storage<4096> memory;
+        list.insert(&memory, 4096);
+        REQUIRE(is_aligned(&memory, list.alignment()));
+
+        // take everything, then free runs of different lengths
+        auto              no_nodes = list.capacity();
+        std::vector<bool> is_free(no_nodes, false);
+        auto base = static_cast<char*>(list.allocate(no_nodes * list.node_size()));
+        REQUIRE(base);
+        REQUIRE(list.usable_size(4096) == no_nodes * list.node_size());
+        REQUIRE(list.empty());
+
+        free_nodes(list, is_free, base, 0u, 8u);
+        free_nodes(list, is_free, base, 10u, 15u);
+        free_nodes(list, is_free, base, 20u, 23u);
+        free_nodes(list, is_free, base, 30u, 31u);
+        REQUIRE(list.capacity() == 17u);
+
+        auto a = use_nodes(list, is_free, base, 5u);
+        REQUIRE(a);
+        auto b = use_nodes(list, is_free, base, 3u);
+        REQUIRE(b);
+        auto c = use_nodes(list, is_free, base, 4u);
+        REQUIRE(c);
+        REQUIRE(list.capacity() == 5u);
+        if (node_size >= 2 * sizeof(void*))
+        {
+            // every run is indexed, so the best fit is found
+            REQUIRE(a == base + 10u * list.node_size());
+            REQUIRE(b == base + 20u * list.node_size());
+            REQUIRE(c == base + 4u * list.node_size());
+            REQUIRE(!use_nodes(list, is_free, base, 5u));
+        }
+
+        // freeing everything merges it back to a single run
+        for (std::size_t i = 0u; i != no_nodes; ++i)
+            if (!is_free[i])
+                free_nodes(list, is_free, base, i, i + 1u);
+        REQUIRE(list.capacity() == no_nodes);
+        REQUIRE(use_nodes(list, is_free, base, no_nodes) == base);
+        REQUIRE(list.empty());
+        free_nodes(list, is_free, base, 0u, no_nodes);
+        use_list_array(list);
+    }
+} // namespace
+
+TEST_CASE("ordered_free_memory_list runs")
+{
+    SUBCASE("small nodes")
+    {
+        use_list_runs(4u);
+    }
+    SUBCASE("odd nodes")
+    {
+        use_list_runs(2 * sizeof(void*) - 1u);
+    }
+    SUBCASE("big nodes")
+    {
+        use_list_runs(2 * sizeof(void*));
+        use_list_runs(3 * sizeof(void*) + 1u);
+    }
+}
+
+TEST_CASE("ordered_free_memory_list random deallocation")
+{
+    ordered_free_memory_list list(8u);
+
+    // blocks are inserted out of address order
+    static_allocator_storage<4096>  a;
+    static_allocator_storage<16384> b;
+    static_allocator_storage<1024>  c;
+    list.insert(&b, 16384);
+    list.insert(&c, 1024);
+    list.insert(&a, 4096);
+    auto capacity = list.capacity();
+    REQUIRE(capacity == list.free_nodes_in(&a, 4096) + list.free_nodes_in(&b, 16384)
+                            + list.free_nodes_in(&c, 1024));
+
+    std::vector<void*> nodes;
+    while (!list.empty())
+        nodes.push_back(list.allocate());
+    REQUIRE(nodes.size() == capacity);
+
+    std::mt19937 rng(42);
+    std::shuffle(nodes.begin(), nodes.end(), rng);
+    for (auto i = 0u; i != nodes.size(); ++i)
+    {
+        list.deallocate(nodes[i]);
+        REQUIRE(list.capacity() == i + 1u);
+    }
+
+    // everything is merged again, so each block is a single run
+    REQUIRE(list.allocate(list.usable_size(16384)));
+    REQUIRE(list.free_nodes_in(&b, 16384) == 0u);
+    list.remove_nodes_in(&a, 4096);
+    list.remove_nodes_in(&c, 1024);
+    REQUIRE(list.empty());
+}
+
+TEST_CASE("ordered_free_memory_list many blocks")
+{
+    ordered_free_memory_list list(8u);
+
+    // adjacent blocks inserted out of address order
+    static_allocator_storage<64 * 256> memory;
+    auto                               begin = reinterpret_cast<char*>(&memory);
+    std::vector<char*>                 blocks;
+    for (auto i = 0u; i != 64u; ++i)
+        blocks.push_back(begin + i * 256u);
+    std::mt19937 rng(42);
+    std::shuffle(blocks.begin(), blocks.end(), rng);
+    for (auto block : blocks)
+        list.insert(block, 256u);
+    auto capacity = list.capacity();
+    REQUIRE(capacity == 64u * list.usable_size(256u) / list.node_size());
+    REQUIRE(list.free_nodes_in(begin, 64u * 256u) == capacity);
+
+    std::vector<void*> nodes;
+    while (!list.empty())
+        nodes.push_back(list.allocate());
+    std::shuffle(nodes.begin(), nodes.end(), rng);
+    for (auto node : nodes)
+        list.deallocate(node);
+    REQUIRE(list.capacity() == capacity);
+
+    // every block is a single run again
+    auto per_block = list.usable_size(256u);
+    for (auto block : blocks)
+        REQUIRE(list.free_nodes_in(block, 256u) == per_block / list.node_size());
+    nodes.clear();
+    while (!list.empty())
+    {
+        nodes.push_back(list.allocate(per_block));
+        REQUIRE(nodes.back());
+    }
+    REQUIRE(nodes.size() == 64u);
+    REQUIRE(list.empty());
+    for (auto array : nodes)
+        list.deallocate(array, per_block);
+
+    // the blocks of the second half are still found after removing the first half
+    auto half = begin + 32u * 256u;
+    list.remove_nodes_in(begin, 32u * 256u);
+    REQUIRE(list.capacity() == capacity / 2u);
+    REQUIRE(list.free_nodes_in(begin, 32u * 256u) == 0u);
+
+    nodes.clear();
+    while (!list.empty())
+    {
+        nodes.push_back(list.allocate());
+        REQUIRE(static_cast<char*>(nodes.back()) >= half);
+    }
+    std::shuffle(nodes.begin(), nodes.end(), rng);
+    for (auto node : nodes)
+        list.deallocate(node);
+    REQUIRE(list.capacity() == capacity / 2u);
+}
+
 TEST_CASE("small_free_memory_list")
 {
     small_free_memory_list list(4);
@@ -317,6 +577,297 @@ TEST_CASE("small_free_memory_list")
         check_list(list, &b, 100);
         check_list(list, &c, 1337);
 
+        check_move(list);
+    }
+    SUBCASE("random deallocation")
+    {
+        // many chunks in multiple blocks
+        static_allocator_storage<16384> a;
+        static_allocator_storage<4096>  b;
+        list.insert(&b, 4096);
+        list.insert(&a, 16384);
+        REQUIRE(list.capacity() * list.node_size()
+                == list.usable_size(4096) + list.usable_size(16384));
+
+        std::vector<void*> nodes;
+        while (!list.empty())
+            nodes.push_back(list.allocate());
+
+        std::mt19937 rng(42);
+        std::shuffle(nodes.begin(), nodes.end(), rng);
+        for (auto node : nodes)
+            list.deallocate(node);
+        REQUIRE(list.capacity() == nodes.size());
+
+        list.remove_nodes_in(&a, 16384);
+        REQUIRE(list.capacity() * list.node_size() == list.usable_size(4096));
+        list.remove_nodes_in(&b, 4096);
+        REQUIRE(list.empty());
+    }
+}
+
+TEST_CASE("wide_small_free_memory_list")
+{
+    wide_small_free_memory_list list(1);
+    REQUIRE(list.empty());
+    REQUIRE(list.node_size() == 2);
+    REQUIRE(list.capacity() == 0u);
+
+    SUBCASE("normal insert")
+    {
+        static_allocator_storage<1024> memory;
+        check_list(list, &memory, 1024);
+
+        check_move(list);
+    }
+    SUBCASE("uneven insert")
+    {
+        static_allocator_storage<1023> memory; // not dividable
+        check_list(list, &memory, 1023);
+
+        check_move(list);
+    }
+    SUBCASE("single chunk")
+    {
+        // a chunk covers the entire block, not just 255 nodes
+        static_allocator_storage<4096> memory;
+        list.insert(&memory, 4096);
+        REQUIRE(list.capacity() > 255u);
+        REQUIRE(list.capacity() * list.node_size() == list.usable_size(4096));
+        REQUIRE(list.find_chunk(list.capacity()));
+
+        std::vector<void*> nodes;
+        while (!list.empty())
+            nodes.push_back(list.allocate());
+        std::shuffle(nodes.begin(), nodes.end(), std::mt19937(42));
+        for (auto node : nodes)
+            list.deallocate(node);
+        REQUIRE(list.capacity() == nodes.size());
+    }
+}
+
+TEST_CASE("bitmap_free_memory_list")
+{
+    bitmap_free_memory_list list(4);
+    REQUIRE(list.empty());
+    REQUIRE(list.node_size() == 4);
+    REQUIRE(list.capacity() == 0u);
+
+    SUBCASE("normal insert")
+    {
+        static_allocator_storage<1024> memory;
+        check_list(list, &memory, 1024);
+        REQUIRE(list.capacity() * list.node_size() == list.usable_size(1024));
+
+        check_move(list);
+    }
+    SUBCASE("uneven insert")
+    {
+        static_allocator_storage<1023> memory; // not dividable
+        check_list(list, &memory, 1023);
+
+        check_move(list);
+    }
+    SUBCASE("multiple insert")
+    {
+        static_allocator_storage<1024> a;
+        static_allocator_storage<100>  b;
+        static_allocator_storage<1337> c;
+        check_list(list, &a, 1024);
+        check_list(list, &b, 100);
+        check_list(list, &c, 1337);
+
+        check_move(list);
+    }
+    SUBCASE("min_block_size")
+    {
+        static_allocator_storage<4096> memory;
+        for (auto no_nodes : {1u, 63u, 64u, 65u, 500u})
+        {
+            bitmap_free_memory_list other(1u, &memory,
+                                          bitmap_free_memory_list::min_block_size(1u, no_nodes));
+            REQUIRE(other.capacity() >= no_nodes);
+        }
+    }
+    SUBCASE("many blocks")
+    {
+        // adjacent blocks, so the block of a node is found by its address alone
+        static_allocator_storage<64 * 128> memory;
+        auto                               begin = reinterpret_cast<char*>(&memory);
+        for (auto i = 0u; i != 64u; ++i)
+            list.insert(begin + i * 128u, 128u);
+        auto capacity = list.capacity();
+
+        std::vector<void*> nodes;
+        while (!list.empty())
+            nodes.push_back(list.allocate());
+        std::shuffle(nodes.begin(), nodes.end(), std::mt19937{});
+        for (auto node : nodes)
+            list.deallocate(node);
+        REQUIRE(list.capacity() == capacity);
+
+        // the blocks of the second half are still found after removing the first half
+        auto half = begin + 32u * 128u;
+        list.remove_nodes_in(begin, 32u * 128u);
+        REQUIRE(list.capacity() == capacity / 2u);
+
+        nodes.clear();
+        while (!list.empty())
+        {
+            nodes.push_back(list.allocate());
+            REQUIRE(static_cast<char*>(nodes.back()) >= half);
+        }
+        std::shuffle(nodes.begin(), nodes.end(), std::mt19937{});
+        for (auto node : nodes)
+            list.deallocate(node);
+        REQUIRE(list.capacity() == capacity / 2u);
+    }
+    SUBCASE("full blocks")
+    {
+        static_allocator_storage<8 * 128> memory;
+        auto                              begin = reinterpret_cast<char*>(&memory);
+        for (auto i = 0u; i != 8u; ++i)
+            list.insert(begin + i * 128u, 128u);
+
+        std::vector<void*> nodes;
+        while (!list.empty())
+            nodes.push_back(list.allocate());
+        REQUIRE(list.free_nodes_in(begin, 8u * 128u) == 0u);
+
+        // a full block with a deallocated node is found again
+        auto node = nodes[nodes.size() / 2u];
+        list.deallocate(node);
+        REQUIRE(list.free_nodes_in(begin, 8u * 128u) == 1u);
+        REQUIRE(list.allocate() == node);
+        REQUIRE(list.empty());
+
+        // only full blocks remain after removing the first half
+        auto half = begin + 4u * 128u;
+        for (auto ptr : nodes)
+            if (static_cast<char*>(ptr) < half)
+                list.deallocate(ptr);
+        list.remove_nodes_in(begin, 4u * 128u);
+        REQUIRE(list.empty());
+
+        auto last = *std::max_element(nodes.begin(), nodes.end());
+        list.deallocate(last);
+        REQUIRE(list.capacity() == 1u);
+        REQUIRE(list.allocate() == last);
+    }
+#if !FOONATHAN_MEMORY_DEBUG_FILL
+    SUBCASE("nodes untouched")
+    {
+        static_allocator_storage<1024> memory;
+        list.insert(&memory, 1024);
+
+        auto node = static_cast<unsigned char*>(list.allocate());
+        for (auto i = 0u; i != list.node_size(); ++i)
+            node[i] = static_cast<unsigned char>(i + 1u);
+        list.deallocate(node);
+        for (auto i = 0u; i != list.node_size(); ++i)
+            REQUIRE(node[i] == i + 1u);
+    }
+#endif
+}
+
+template <class FreeList>
+void check_count_free_nodes(FreeList& list)
+{
+    static_allocator_storage<1024> a;
+    static_allocator_storage<4096> b;
+    static_allocator_storage<2048> c;
+
+    memory_block_stack blocks;
+    blocks.push({&a, 1024});
+    blocks.push({&b, 4096});
+    blocks.push({&c, 2048});
+    blocks.for_each([&](memory_block block) { list.insert(block.memory, block.size); });
+
+    // leave some nodes of every block allocated
+    std::vector<void*> nodes;
+    for (auto i = 0u; i != 100u && !list.empty(); ++i)
+        nodes.push_back(list.allocate());
+    for (auto i = 0u; i < nodes.size(); i += 3u)
+        list.deallocate(nodes[i]);
+
+    memory_block_tally tally(blocks);
+    list.count_free_nodes(tally);
+    std::size_t total = 0u;
+    blocks.for_each(
+        [&](memory_block block)
+        {
+            REQUIRE(memory_block_stack::tally(block)
+                    == list.free_nodes_in(block.memory, block.size));
+            total += memory_block_stack::tally(block);
+        });
+    REQUIRE(total == list.capacity());
+
+    // counting again starts from zero
+    memory_block_tally again(blocks);
+    list.count_free_nodes(again);
+    blocks.for_each([&](memory_block block)
+                    { REQUIRE(memory_block_stack::tally(block)
+                              == list.free_nodes_in(block.memory, block.size)); });
+
+    while (!blocks.empty())
+        blocks.pop();
+}
+
+TEST_CASE("count_free_nodes")
+{
+    SUBCASE("free_memory_list")
+    {
+        free_memory_list list(16u);
+        check_count_free_nodes(list);
+    }
+    SUBCASE("ordered_free_memory_list")
+    {
+        ordered_free_memory_list list(16u);
+        check_count_free_nodes(list);
+    }
+    SUBCASE("small_free_memory_list")
+    {
+        small_free_memory_list list(16u);
+        check_count_free_nodes(list);
+    }
+    SUBCASE("bitmap_free_memory_list")
+    {
+        bitmap_free_memory_list list(16u);
+        check_count_free_nodes(list);
+    }
+}
+
+TEST_CASE("concurrent_free_memory_list")
+{
+    concurrent_free_memory_list list(4);
+    REQUIRE(list.empty());
+    REQUIRE(list.node_size() == 4);
+    REQUIRE(list.capacity() == 0u);
+    REQUIRE(list.allocate() == nullptr);
+
+    SUBCASE("normal insert")
+    {
+        static_allocator_storage<1024> memory;
+        check_list(list, &memory, 1024);
+
+        check_move(list);
+    }
+    SUBCASE("uneven insert")
+    {
+        static_allocator_storage<1023> memory; // not dividable
+        check_list(list, &memory, 1023);
+
+        check_move(list);
+    }
+    SUBCASE("multiple insert")
+    {
+        static_allocator_storage<1024> a;
+        static_allocator_storage<100>  b;
+        static_allocator_storage<1337> c;
+        check_list(list, &a, 1024);
+        check_list(list, &b, 100);
+        check_list(list, &c, 1337);
+
         check_move(list);
     }
 }
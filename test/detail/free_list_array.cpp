@@ -30,6 +30,81 @@ TEST_CASE("detail::log2_access_policy")
     REQUIRE(ap::size_from_index(3) == 8u);
 }
 
+TEST_CASE("detail::geometric_access_policy")
+{
+    using ap = detail::geometric_access_policy<4>;
+    // identity up to 2 * 4
+    for (std::size_t size = 1u; size <= 8u; ++size)
+    {
+        REQUIRE(ap::index_from_size(size) == size);
+        REQUIRE(ap::size_from_index(size) == size);
+    }
+
+    REQUIRE(ap::index_from_size(9) == 9u);
+    REQUIRE(ap::index_from_size(10) == 9u);
+    REQUIRE(ap::size_from_index(9) == 10u);
+    REQUIRE(ap::size_from_index(12) == 16u);
+    REQUIRE(ap::index_from_size(64) == ap::index_from_size(57));
+    REQUIRE(ap::size_from_index(ap::index_from_size(65)) == 80u);
+    REQUIRE(ap::size_from_index(ap::index_from_size(4097)) == 5120u);
+
+    // the table and the computation agree, the sizes are a monotonic cover
+    for (std::size_t size = 1u; size != 4 * detail::geometric_table_size; ++size)
+    {
+        auto index = ap::index_from_size(size);
+        REQUIRE(index == detail::geometric_index_from_size(size, 2u));
+        REQUIRE(ap::size_from_index(index) >= size);
+        REQUIRE(ap::size_from_index(index - 1u) < size);
+        // never wastes more than a fifth
+        REQUIRE((ap::size_from_index(index) - size) * 5u < ap::size_from_index(index));
+    }
+
+    using ap2 = detail::geometric_access_policy<2>;
+    REQUIRE(ap2::size_from_index(ap2::index_from_size(5)) == 6u);
+    REQUIRE(ap2::size_from_index(ap2::index_from_size(7)) == 8u);
+    REQUIRE(ap2::size_from_index(ap2::index_from_size(9)) == 12u);
+
+    // a single class per power of two is the same as log2
+    using ap1 = detail::geometric_access_policy<1>;
+    for (std::size_t size = 1u; size != 2 * detail::geometric_table_size; ++size)
+        REQUIRE(ap1::size_from_index(ap1::index_from_size(size))
+                == log2_access_policy::size_from_index(log2_access_policy::index_from_size(size)));
+}
+
+TEST_CASE("detail::static_access_policy")
+{
+    using ap = detail::static_access_policy<8, 16, 24, 32, 48, 64, 96, 128>;
+    static_assert(ap::granularity == 8u, "");
+    static_assert(ap::no_slots == 17u, "");
+
+    REQUIRE(ap::index_from_size(1) == 0u);
+    REQUIRE(ap::index_from_size(8) == 0u);
+    REQUIRE(ap::index_from_size(9) == 1u);
+    REQUIRE(ap::index_from_size(33) == 4u);
+    REQUIRE(ap::index_from_size(48) == 4u);
+    REQUIRE(ap::index_from_size(49) == 5u);
+    REQUIRE(ap::index_from_size(128) == 7u);
+    // bigger sizes saturate
+    REQUIRE(ap::index_from_size(129) == 7u);
+    REQUIRE(ap::index_from_size(4096) == 7u);
+
+    for (std::size_t size = 1u; size <= 128u; ++size)
+    {
+        auto index = ap::index_from_size(size);
+        REQUIRE(ap::size_from_index(index) >= size);
+        if (index > 0u)
+            REQUIRE(ap::size_from_index(index - 1u) < size);
+    }
+
+    // granularity is the greatest common divisor
+    using ap2 = detail::static_access_policy<12, 18, 30>;
+    static_assert(ap2::granularity == 6u, "");
+    REQUIRE(ap2::index_from_size(12) == 0u);
+    REQUIRE(ap2::index_from_size(13) == 1u);
+    REQUIRE(ap2::index_from_size(19) == 2u);
+    REQUIRE(ap2::size_from_index(2) == 30u);
+}
+
 TEST_CASE("detail::free_list_array")
 {
     static_allocator_storage<1024> memory;
@@ -66,6 +141,32 @@ TEST_CASE("detail::free_list_array")
         REQUIRE(arr.get(9u).node_size() == 16u);
         REQUIRE(arr.get(15u).node_size() == 16u);
     }
+    SUBCASE("geometric, normal list")
+    {
+        using array =
+            detail::free_list_array<detail::free_memory_list, detail::geometric_access_policy<4>>;
+        array arr(stack, stack.top() + 1024, 65);
+        REQUIRE(arr.max_node_size() == 80u);
+
+        REQUIRE(arr.get(1u).node_size() == detail::free_memory_list::min_element_size);
+        REQUIRE(arr.get(9u).node_size() == 10u);
+        REQUIRE(arr.get(33u).node_size() == 40u);
+        REQUIRE(arr.get(65u).node_size() == 80u);
+    }
+    SUBCASE("static, normal list")
+    {
+        using array = detail::free_list_array<detail::free_memory_list,
+                                              detail::static_access_policy<4, 8, 24, 40, 64>>;
+        array arr(stack, stack.top() + 1024, 32);
+        REQUIRE(arr.max_node_size() == 40u);
+        REQUIRE(arr.size() == 3u);
+
+        REQUIRE(arr.get(1u).node_size() == 8u);
+        REQUIRE(arr.get(4u).node_size() == 8u);
+        REQUIRE(arr.get(9u).node_size() == 24u);
+        REQUIRE(arr.get(25u).node_size() == 40u);
+        REQUIRE(arr.get(40u).node_size() == 40u);
+    }
     SUBCASE("non power of two max size, normal list")
     {
         using array = detail::free_list_array<detail::free_memory_list, detail::log2_access_policy>;
@@ -5,7 +5,11 @@
 
 #include <doctest/doctest.h>
 
+#include <cstring>
+
+#include "memory_stack.hpp"
 #include "static_allocator.hpp"
+#include "virtual_memory.hpp"
 
 using namespace foonathan::memory;
 using namespace detail;
@@ -114,6 +118,81 @@ TEST_CASE("detail::memory_block_stack")
         block = stack.pop();
         REQUIRE(block.memory == static_cast<void*>(&b));
     }
+    SUBCASE("erase")
+    {
+        auto block = stack.erase(
+            {reinterpret_cast<char*>(&b) + memory_block_stack::implementation_offset(),
+             1024 - memory_block_stack::implementation_offset()});
+        REQUIRE(block.memory == static_cast<void*>(&b));
+        REQUIRE(block.size == 1024);
+        REQUIRE(!stack.owns(reinterpret_cast<char*>(&b)
+                            + memory_block_stack::implementation_offset()));
+
+        block = stack.erase(stack.top());
+        REQUIRE(block.memory == static_cast<void*>(&c));
+
+        block = stack.pop();
+        REQUIRE(block.memory == static_cast<void*>(&a));
+        block = stack.pop();
+        REQUIRE(block.memory == static_cast<void*>(&memory));
+        REQUIRE(stack.empty());
+    }
+    SUBCASE("erase bottom")
+    {
+        auto bottom = stack.erase(
+            {reinterpret_cast<char*>(&memory) + memory_block_stack::implementation_offset(),
+             1024 - memory_block_stack::implementation_offset()});
+        REQUIRE(bottom.memory == static_cast<void*>(&memory));
+
+        // the list is still linked in both directions
+        stack.push(bottom);
+        auto block = stack.erase(stack.top());
+        REQUIRE(block.memory == static_cast<void*>(&memory));
+        block = stack.pop();
+        REQUIRE(block.memory == static_cast<void*>(&c));
+        block = stack.pop();
+        REQUIRE(block.memory == static_cast<void*>(&b));
+        block = stack.pop();
+        REQUIRE(block.memory == static_cast<void*>(&a));
+        REQUIRE(stack.empty());
+    }
+    SUBCASE("many blocks")
+    {
+        static_allocator_storage<64> blocks[64];
+        // push in an order that is not sorted by address
+        for (std::size_t i = 0u; i != 64u; ++i)
+            stack.push({&blocks[(i * 37u) % 64u], 64});
+        REQUIRE(stack.size() == 68u);
+
+        for (auto& block : blocks)
+        {
+            auto begin = reinterpret_cast<char*>(&block);
+            REQUIRE(!stack.owns(begin));
+            REQUIRE(stack.owns(begin + memory_block_stack::implementation_offset()));
+            REQUIRE(stack.owns(begin + 63));
+        }
+
+        memory_block_stack other;
+        for (std::size_t i = 0u; i != 32u; ++i)
+            other.steal_top(stack);
+        REQUIRE(stack.size() == 36u);
+        REQUIRE(other.size() == 32u);
+
+        std::size_t no_owned = 0u;
+        for (auto& block : blocks)
+        {
+            auto mem =
+                reinterpret_cast<char*>(&block) + memory_block_stack::implementation_offset();
+            REQUIRE(stack.owns(mem) != other.owns(mem));
+            if (stack.owns(mem))
+                ++no_owned;
+        }
+        REQUIRE(no_owned == 32u);
+
+        while (!other.empty())
+            other.pop();
+        REQUIRE(other.size() == 0u);
+    }
 }
 
 template <std::size_t N>
@@ -207,6 +286,84 @@ TEST_CASE("memory_arena w/ caching")
     }
 }
 
+TEST_CASE("memory_arena w/ scavenging")
+{
+    auto page_size = get_virtual_memory_page_size();
+
+    using arena_type = memory_arena<virtual_block_allocator>;
+    arena_type arena(4 * page_size, 8u);
+
+    auto fill = [&](memory_block block) { std::memset(block.memory, 0xFF, block.size); };
+    fill(arena.allocate_block());
+    fill(arena.allocate_block());
+    fill(arena.allocate_block());
+
+    SUBCASE("explicit")
+    {
+        arena.deallocate_block();
+        arena.deallocate_block();
+        REQUIRE(arena.cache_size() == 2u);
+        REQUIRE(arena.resident_cache_size() == 2u);
+
+        // the first page holds the bookkeeping
+        REQUIRE(arena.scavenge() == 2 * 3 * page_size);
+        REQUIRE(arena.cache_size() == 2u);
+        REQUIRE(arena.resident_cache_size() == 0u);
+        REQUIRE(arena.scavenge() == 0u);
+
+        // the blocks are still usable
+        fill(arena.allocate_block());
+        fill(arena.allocate_block());
+        REQUIRE(arena.get_allocator().capacity_left() == 5u);
+        REQUIRE(arena.cache_size() == 0u);
+    }
+    SUBCASE("block limit")
+    {
+        arena.set_cache_limits({std::size_t(-1), 1u});
+        REQUIRE(arena.cache_limits().max_blocks == 1u);
+
+        arena.deallocate_block();
+        arena.deallocate_block();
+        arena.deallocate_block();
+        REQUIRE(arena.cache_size() == 3u);
+        REQUIRE(arena.resident_cache_size() == 1u);
+
+        // the most recently cached block is still resident
+        fill(arena.allocate_block());
+        REQUIRE(arena.resident_cache_size() == 0u);
+        fill(arena.allocate_block());
+        REQUIRE(arena.cache_size() == 1u);
+    }
+    SUBCASE("byte limit")
+    {
+        arena.deallocate_block();
+        arena.deallocate_block();
+        REQUIRE(arena.resident_cache_size() == 2u);
+
+        arena.set_cache_limits({4 * page_size, std::size_t(-1)});
+        REQUIRE(arena.resident_cache_size() == 1u);
+
+        arena.deallocate_block();
+        REQUIRE(arena.cache_size() == 3u);
+        REQUIRE(arena.resident_cache_size() == 1u);
+    }
+    SUBCASE("memory_stack")
+    {
+        memory_stack<virtual_block_allocator> stack(4 * page_size, 8u);
+        stack.set_cache_limits({0u, 0u});
+
+        auto m = stack.top();
+        stack.allocate(2 * page_size, 1);
+        stack.allocate(2 * page_size, 1);
+        stack.unwind(m);
+        REQUIRE(stack.scavenge() == 0u);
+
+        // the second allocation reuses the scavenged block
+        std::memset(stack.allocate(3 * page_size, 1), 0, 3 * page_size);
+        std::memset(stack.allocate(3 * page_size, 1), 0, 3 * page_size);
+    }
+}
+
 TEST_CASE("memory_arena w/o caching")
 {
     using arena_type = memory_arena<test_block_allocator<10>, false>;
@@ -260,6 +417,51 @@ TEST_CASE("memory_arena w/o caching")
         REQUIRE(small_arena.size() == 1u);
         REQUIRE(small_arena.capacity() == 1u);
     }
+    SUBCASE("deallocate given block")
+    {
+        arena_type arena(1024);
+        auto       a = arena.allocate_block();
+        auto       b = arena.allocate_block();
+        arena.allocate_block();
+        REQUIRE(arena.get_allocator().i == 3u);
+
+        // for_each() only visits the blocks
+        auto first     = true;
+        auto no_blocks = 0u;
+        arena.for_each(
+            [&](memory_block block)
+            {
+                REQUIRE(first == (block.memory == arena.current_block().memory));
+                first = false;
+                ++no_blocks;
+            });
+        REQUIRE(no_blocks == 3u);
+        REQUIRE(arena.size() == 3u);
+
+        // blocks are visited starting at the current one
+        std::size_t visited = 0u;
+        auto        count   = arena.deallocate_blocks_if(
+            [&](memory_block block)
+            {
+                ++visited;
+                return block.memory != b.memory && block.memory != a.memory;
+            });
+        REQUIRE(visited == 3u);
+        REQUIRE(count == 1u);
+        REQUIRE(arena.get_allocator().i == 2u);
+        REQUIRE(arena.size() == 2u);
+        REQUIRE(arena.current_block().memory == b.memory);
+
+        arena.deallocate_block(b);
+        REQUIRE(arena.get_allocator().i == 1u);
+        REQUIRE(arena.size() == 1u);
+        REQUIRE(arena.current_block().memory == a.memory);
+        REQUIRE(arena.owns(a.memory));
+        REQUIRE(!arena.owns(b.memory));
+
+        arena.deallocate_block(a);
+        REQUIRE(arena.size() == 0u);
+    }
 }
 
 static_assert(
@@ -4,8 +4,10 @@
 #include "memory_pool.hpp"
 
 #include <algorithm>
+#include <cstring>
 #include <doctest/doctest.h>
 #include <random>
+#include <thread>
 #include <vector>
 
 #include "allocator_storage.hpp"
@@ -61,6 +63,29 @@ TEST_CASE("memory_pool")
             REQUIRE(pool.capacity_left() >= capacity);
             REQUIRE(alloc.no_allocated() == 2u);
         }
+        SUBCASE("batch alloc/dealloc")
+        {
+            auto capacity = pool.capacity_left();
+            auto no_nodes = capacity / pool.node_size();
+
+            std::vector<void*> ptrs(no_nodes + 1u);
+            REQUIRE(!pool.try_allocate_nodes(no_nodes + 1u, ptrs.data()));
+            REQUIRE(pool.capacity_left() == capacity);
+            REQUIRE(pool.try_allocate_nodes(no_nodes, ptrs.data()));
+            REQUIRE(pool.capacity_left() == 0u);
+            pool.deallocate_nodes(ptrs.data(), no_nodes);
+            REQUIRE(pool.capacity_left() == capacity);
+
+            // needs to grow
+            pool.allocate_nodes(no_nodes + 1u, ptrs.data());
+            REQUIRE(alloc.no_allocated() == 2u);
+            std::sort(ptrs.begin(), ptrs.end());
+            REQUIRE(std::adjacent_find(ptrs.begin(), ptrs.end()) == ptrs.end());
+
+            std::shuffle(ptrs.begin(), ptrs.end(), std::mt19937{});
+            REQUIRE(pool.try_deallocate_nodes(ptrs.data(), ptrs.size()));
+            REQUIRE(pool.capacity_left() >= capacity);
+        }
     }
     {
         pool_type pool(16, pool_type::min_block_size(16, 1), alloc);
@@ -97,8 +122,62 @@ namespace
         auto ptr = pool.allocate_node();
         CHECK(ptr);
     }
+
+    template <class PoolType>
+    void check_release_empty_blocks()
+    {
+        using pool_type = memory_pool<PoolType, allocator_reference<test_allocator>>;
+        test_allocator alloc;
+        {
+            pool_type pool(16, pool_type::min_block_size(16, 10), alloc);
+            REQUIRE(alloc.no_allocated() == 1u);
+
+            // fill the first block and get a node from a second one
+            auto               no_nodes = pool.capacity_left() / pool.node_size();
+            std::vector<void*> first;
+            for (auto i = 0u; i != no_nodes; ++i)
+                first.push_back(pool.allocate_node());
+            auto second = pool.allocate_node();
+            REQUIRE(alloc.no_allocated() == 2u);
+
+            REQUIRE(pool.release_empty_blocks() == 0u);
+            REQUIRE(alloc.no_allocated() == 2u);
+
+            pool.deallocate_node(second);
+            REQUIRE(pool.release_empty_blocks() == 1u);
+            REQUIRE(alloc.no_allocated() == 1u);
+            REQUIRE(pool.capacity_left() == 0u);
+
+            pool.deallocate_node(first.back());
+            first.pop_back();
+            REQUIRE(pool.release_empty_blocks() == 0u);
+            REQUIRE(alloc.no_allocated() == 1u);
+            REQUIRE(pool.capacity_left() == pool.node_size());
+
+            for (auto node : first)
+                pool.deallocate_node(node);
+            REQUIRE(pool.release_empty_blocks() == 1u);
+            REQUIRE(alloc.no_allocated() == 0u);
+            REQUIRE(pool.capacity_left() == 0u);
+
+            // the pool still works afterwards
+            auto node = pool.allocate_node();
+            REQUIRE(alloc.no_allocated() == 1u);
+            pool.deallocate_node(node);
+        }
+        REQUIRE(alloc.no_allocated() == 0u);
+    }
 } // namespace
 
+TEST_CASE("memory_pool release_empty_blocks")
+{
+    check_release_empty_blocks<node_pool>();
+    check_release_empty_blocks<array_pool>();
+    check_release_empty_blocks<small_node_pool>();
+    check_release_empty_blocks<wide_small_node_pool>();
+    check_release_empty_blocks<bitmap_node_pool>();
+}
+
 TEST_CASE("memory_pool::min_block_size()")
 {
     SUBCASE("node_pool")
@@ -122,5 +201,317 @@ TEST_CASE("memory_pool::min_block_size()")
         use_min_block_size<small_node_pool>(1, 1000);
         use_min_block_size<small_node_pool>(16, 1000);
     }
+    SUBCASE("wide_small_node_pool")
+    {
+        use_min_block_size<wide_small_node_pool>(1, 1);
+        use_min_block_size<wide_small_node_pool>(16, 1);
+        use_min_block_size<wide_small_node_pool>(1, 1000);
+        use_min_block_size<wide_small_node_pool>(16, 100000);
+    }
+    SUBCASE("bitmap_node_pool")
+    {
+        use_min_block_size<bitmap_node_pool>(1, 1);
+        use_min_block_size<bitmap_node_pool>(16, 1);
+        use_min_block_size<bitmap_node_pool>(1, 1000);
+        use_min_block_size<bitmap_node_pool>(16, 1000);
+    }
+    SUBCASE("concurrent_node_pool")
+    {
+        use_min_block_size<concurrent_node_pool>(1, 1);
+        use_min_block_size<concurrent_node_pool>(16, 1);
+        use_min_block_size<concurrent_node_pool>(1, 1000);
+        use_min_block_size<concurrent_node_pool>(16, 1000);
+    }
+}
+
+TEST_CASE("memory_pool<concurrent_node_pool>")
+{
+    using pool_type = memory_pool<concurrent_node_pool>;
+    REQUIRE(is_thread_safe_allocator<pool_type>::value);
+
+    // small blocks to force concurrent growth
+    pool_type pool(16, pool_type::min_block_size(16, 64));
+    REQUIRE(pool.node_size() == 16u);
+
+    std::vector<std::thread> threads;
+    for (auto t = 0u; t != 4u; ++t)
+        threads.emplace_back(
+            [&]
+            {
+                std::vector<void*> ptrs;
+                for (auto round = 0u; round != 50u; ++round)
+                {
+                    for (auto i = 0u; i != 100u; ++i)
+                    {
+                        auto ptr = pool.allocate_node();
+                        // make sure no other thread got the same node
+                        *static_cast<void**>(ptr) = &ptrs;
+                        ptrs.push_back(ptr);
+                    }
+                    for (auto ptr : ptrs)
+                    {
+                        REQUIRE(*static_cast<void**>(ptr) == &ptrs);
+                        pool.deallocate_node(ptr);
+                    }
+                    ptrs.clear();
+                }
+            });
+    for (auto& thread : threads)
+        thread.join();
+
+    auto capacity = pool.capacity_left();
+    REQUIRE(capacity >= 100u * pool.node_size());
+
+    std::vector<void*> ptrs;
+    for (auto i = 0u; i != capacity / pool.node_size(); ++i)
+        ptrs.push_back(pool.try_allocate_node());
+    REQUIRE(std::find(ptrs.begin(), ptrs.end(), nullptr) == ptrs.end());
+    REQUIRE(pool.try_allocate_node() == nullptr);
+    std::sort(ptrs.begin(), ptrs.end());
+    REQUIRE(std::adjacent_find(ptrs.begin(), ptrs.end()) == ptrs.end());
+
+    for (auto ptr : ptrs)
+        pool.deallocate_node(ptr);
+    REQUIRE(pool.capacity_left() == capacity);
+
+    // batches are unlinked and pushed as a whole
+    threads.clear();
+    for (auto t = 0u; t != 4u; ++t)
+        threads.emplace_back(
+            [&]
+            {
+                void* nodes[32];
+                for (auto round = 0u; round != 50u; ++round)
+                {
+                    pool.allocate_nodes(32u, nodes);
+                    for (auto ptr : nodes)
+                        *static_cast<void**>(ptr) = nodes;
+                    for (auto ptr : nodes)
+                        REQUIRE(*static_cast<void**>(ptr) == nodes);
+                    pool.deallocate_nodes(nodes, 32u);
+                }
+            });
+    for (auto& thread : threads)
+        thread.join();
+    REQUIRE(pool.capacity_left() >= capacity);
+
+    // ownership is checked while other threads grow the pool
+    pool_type owning_pool(16, pool_type::min_block_size(16, 64));
+    threads.clear();
+    for (auto t = 0u; t != 4u; ++t)
+        threads.emplace_back(
+            [&]
+            {
+                int                foreign = 0;
+                std::vector<void*> ptrs;
+                for (auto i = 0u; i != 200u; ++i)
+                {
+                    ptrs.push_back(owning_pool.allocate_node());
+                    REQUIRE(!owning_pool.try_deallocate_node(&foreign));
+                }
+                for (auto ptr : ptrs)
+                    REQUIRE(owning_pool.try_deallocate_node(ptr));
+            });
+    for (auto& thread : threads)
+        thread.join();
+
+    // arrays of a single node grow through the same path as nodes
+    pool_type array_pool(16, pool_type::min_block_size(16, 64));
+    threads.clear();
+    for (auto t = 0u; t != 4u; ++t)
+        threads.emplace_back(
+            [&]
+            {
+                using traits = allocator_traits<pool_type>;
+                std::vector<void*> ptrs;
+                for (auto i = 0u; i != 200u; ++i)
+                {
+                    auto ptr = traits::allocate_array(array_pool, 1u, 16u, 8u);
+                    *static_cast<void**>(ptr) = &ptrs;
+                    ptrs.push_back(ptr);
+                }
+                for (auto ptr : ptrs)
+                {
+                    REQUIRE(*static_cast<void**>(ptr) == &ptrs);
+                    traits::deallocate_array(array_pool, ptr, 1u, 16u, 8u);
+                }
+            });
+    for (auto& thread : threads)
+        thread.join();
+    REQUIRE_THROWS_AS(allocator_traits<pool_type>::allocate_array(array_pool, 2u, 16u, 8u),
+                      bad_array_size);
+    // does not depend on the size of the next block, which changes during concurrent growth
+    REQUIRE(allocator_traits<pool_type>::max_array_size(array_pool) == array_pool.node_size());
 }
 
+TEST_CASE("memory_pool<concurrent_node_pool> full block table")
+{
+    // blocks of constant size, so the block allocator could grow forever
+    using pool_type =
+        memory_pool<concurrent_node_pool,
+                    growing_block_allocator<allocator_reference<test_allocator>, 1u, 1u>>;
+    test_allocator alloc;
+    {
+        pool_type pool(16, pool_type::min_block_size(16, 4), alloc);
+
+        std::vector<void*> ptrs;
+        while (alloc.no_allocated() != detail::concurrent_free_memory_list::max_blocks
+               || pool.capacity_left() != 0u)
+            ptrs.push_back(pool.allocate_node());
+
+        // the table is full, no block is allocated and the error is not about fixed memory
+        auto thrown = false;
+        try
+        {
+            pool.allocate_node();
+        }
+        catch (out_of_memory& ex)
+        {
+            thrown = dynamic_cast<out_of_fixed_memory*>(&ex) == nullptr;
+        }
+        REQUIRE(thrown);
+        REQUIRE(alloc.no_allocated() == detail::concurrent_free_memory_list::max_blocks);
+
+        for (auto ptr : ptrs)
+            pool.deallocate_node(ptr);
+    }
+    REQUIRE(alloc.no_allocated() == 0u);
+}
+
+TEST_CASE("memory_pool<remote_free_node_pool>")
+{
+    using pool_type = memory_pool<remote_free_node_pool, allocator_reference<test_allocator>>;
+    test_allocator alloc;
+    {
+        pool_type pool(16, pool_type::min_block_size(16, 100), alloc);
+        REQUIRE(alloc.no_allocated() == 1u);
+        auto capacity = pool.capacity_left();
+        auto no_nodes = capacity / pool.node_size();
+
+        std::vector<void*> nodes;
+        for (auto i = 0u; i != no_nodes; ++i)
+        {
+            nodes.push_back(pool.allocate_node());
+            std::memset(nodes.back(), 0x11, pool.node_size());
+        }
+        REQUIRE(pool.capacity_left() == 0u);
+
+        SUBCASE("remote deallocate_node")
+        {
+            std::thread thread(
+                [&]
+                {
+                    for (auto node : nodes)
+                        pool.deallocate_node(node);
+                });
+            thread.join();
+            // not taken by the owner yet
+            REQUIRE(pool.capacity_left() == 0u);
+
+            std::vector<void*> reused;
+            reused.push_back(pool.allocate_node());
+#if FOONATHAN_MEMORY_DEBUG_FILL
+            // the remaining nodes were filled when they were taken by the owner
+            for (auto node : nodes)
+                if (node != reused.back())
+                {
+                    auto memory = static_cast<unsigned char*>(node) + sizeof(void*);
+                    REQUIRE(std::count(memory, memory + pool.node_size() - sizeof(void*),
+                                       static_cast<unsigned char>(0x11))
+                            == 0);
+                }
+#endif
+            for (auto i = 1u; i != no_nodes; ++i)
+                reused.push_back(pool.allocate_node());
+            REQUIRE(alloc.no_allocated() == 1u);
+            std::sort(nodes.begin(), nodes.end());
+            std::sort(reused.begin(), reused.end());
+            REQUIRE(nodes == reused);
+
+            for (auto node : reused)
+                pool.deallocate_node(node);
+            REQUIRE(pool.capacity_left() == capacity);
+        }
+        SUBCASE("remote deallocate_nodes")
+        {
+            std::thread thread([&] { pool.deallocate_nodes(nodes.data(), nodes.size()); });
+            thread.join();
+            REQUIRE(pool.capacity_left() == 0u);
+
+            REQUIRE(pool.try_allocate_nodes(no_nodes, nodes.data()));
+            REQUIRE(alloc.no_allocated() == 1u);
+            pool.deallocate_nodes(nodes.data(), nodes.size());
+            REQUIRE(pool.capacity_left() == capacity);
+        }
+        SUBCASE("claim_ownership")
+        {
+            std::thread thread(
+                [&]
+                {
+                    pool.claim_ownership();
+                    // the owner deallocates onto its own list
+                    for (auto node : nodes)
+                        pool.deallocate_node(node);
+                    REQUIRE(pool.capacity_left() == capacity);
+                    for (auto& node : nodes)
+                        node = pool.allocate_node();
+                });
+            thread.join();
+
+            // the creating thread is no longer the owner
+            for (auto node : nodes)
+                pool.deallocate_node(node);
+            REQUIRE(pool.capacity_left() == 0u);
+
+            pool.claim_ownership();
+            for (auto& node : nodes)
+                node = pool.allocate_node();
+            REQUIRE(alloc.no_allocated() == 1u);
+            for (auto node : nodes)
+                pool.deallocate_node(node);
+            REQUIRE(pool.capacity_left() == capacity);
+        }
+        SUBCASE("producer/consumer")
+        {
+            for (auto node : nodes)
+                pool.deallocate_node(node);
+
+            std::atomic<void*> slots[8] = {};
+            std::atomic<bool>  done(false);
+            std::thread        consumer(
+                [&]
+                {
+                    auto consumed = 0u;
+                    while (!done || consumed != 1000u)
+                        for (auto& slot : slots)
+                            if (auto node = slot.exchange(nullptr))
+                            {
+                                REQUIRE(*static_cast<void**>(node) == &slot);
+                                pool.deallocate_node(node);
+                                ++consumed;
+                            }
+                });
+
+            for (auto i = 0u; i != 1000u; ++i)
+            {
+                auto  node = pool.allocate_node();
+                auto& slot = slots[i % 8u];
+                *static_cast<void**>(node) = &slot;
+                void* expected             = nullptr;
+                while (!slot.compare_exchange_weak(expected, node))
+                {
+                    expected = nullptr;
+                    std::this_thread::yield();
+                }
+            }
+            done = true;
+            consumer.join();
+
+            // at most eight nodes are in flight, the remote nodes were reused
+            REQUIRE(alloc.no_allocated() == 1u);
+            REQUIRE(pool.release_empty_blocks() == 1u);
+            REQUIRE(alloc.no_allocated() == 0u);
+        }
+    }
+    REQUIRE(alloc.no_allocated() == 0u);
+}
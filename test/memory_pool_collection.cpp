@@ -4,12 +4,15 @@
 #include "memory_pool_collection.hpp"
 
 #include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include <doctest/doctest.h>
 #include <random>
 #include <vector>
 
 #include "allocator_storage.hpp"
 #include "test_allocator.hpp"
+#include "virtual_memory.hpp"
 
 using namespace foonathan::memory;
 using namespace detail;
@@ -50,6 +53,29 @@ TEST_CASE("memory_pool_collection")
             for (auto ptr : b)
                 pool.deallocate_node(ptr, 5);
         }
+        SUBCASE("batch alloc/dealloc")
+        {
+            std::vector<void*> a(100u), b(5u);
+            pool.allocate_nodes(a.size(), 1, a.data());
+            REQUIRE(pool.try_allocate_nodes(b.size(), 5, b.data()));
+            REQUIRE(alloc.no_allocated() == 1u);
+            REQUIRE(!pool.try_allocate_nodes(5u, max_size + 1u, b.data()));
+
+            std::sort(a.begin(), a.end());
+            REQUIRE(std::adjacent_find(a.begin(), a.end()) == a.end());
+
+            auto capacity = pool.pool_capacity_left(1);
+            REQUIRE(pool.try_deallocate_nodes(a.data(), a.size(), 1));
+            REQUIRE(pool.pool_capacity_left(1) == capacity + a.size());
+            pool.deallocate_nodes(b.data(), b.size(), 5);
+        }
+        SUBCASE("reserve")
+        {
+            // the reserved memory is put onto the free list
+            pool.reserve(8, 256u);
+            REQUIRE(pool.pool_capacity_left(8) > 0u);
+            REQUIRE(alloc.no_allocated() == 1u);
+        }
         SUBCASE("single array alloc")
         {
             auto memory = pool.allocate_array(4, 4);
@@ -93,6 +119,318 @@ TEST_CASE("memory_pool_collection")
             for (auto ptr : b)
                 pool.deallocate_node(ptr, 5);
         }
+        SUBCASE("multiple block batch alloc/dealloc")
+        {
+            std::vector<void*> a(1000u);
+            pool.allocate_nodes(a.size(), 5, a.data());
+            REQUIRE(alloc.no_allocated() > 1u);
+
+            std::shuffle(a.begin(), a.end(), std::mt19937{});
+            pool.deallocate_nodes(a.data(), a.size(), 5);
+        }
+    }
+    REQUIRE(alloc.no_allocated() == 0u);
+}
+
+TEST_CASE("memory_pool_collection w/ geometric_buckets")
+{
+    using pools =
+        memory_pool_collection<node_pool, geometric_buckets<>, allocator_reference<test_allocator>>;
+    test_allocator alloc;
+    {
+        pools pool(200, 8000, alloc);
+        REQUIRE(pool.max_node_size() >= 200u);
+        REQUIRE(pool.max_node_size() < 250u);
+
+        // 65 bytes use the 80 byte pool, not a 128 byte one
+        auto node = pool.allocate_node(65);
+        REQUIRE(pool.pool_capacity_left(65) > 0u);
+        REQUIRE(pool.pool_capacity_left(80) == pool.pool_capacity_left(65));
+        REQUIRE(pool.pool_capacity_left(81) == 0u);
+        REQUIRE(pool.pool_capacity_left(64) == 0u);
+        pool.deallocate_node(node, 65);
+
+        std::vector<void*> nodes;
+        for (std::size_t size = 1u; size <= 200u; ++size)
+            nodes.push_back(pool.allocate_node(size));
+        for (std::size_t size = 1u; size <= 200u; ++size)
+            pool.deallocate_node(nodes[size - 1u], size);
+    }
+    REQUIRE(alloc.no_allocated() == 0u);
+}
+
+TEST_CASE("memory_pool_collection allocate_at_least")
+{
+    using pools =
+        memory_pool_collection<node_pool, log2_buckets, allocator_reference<test_allocator>>;
+    using traits = allocator_traits<pools>;
+    test_allocator alloc;
+    {
+        pools pool(128, 4000, alloc);
+
+        // 72 bytes occupy three nodes of the 32 byte pool
+        auto block = traits::allocate_at_least(pool, 3, 24, 8);
+        REQUIRE(block.size == 96u);
+        auto capacity = pool.pool_capacity_left(24);
+        traits::deallocate_array(pool, block.memory, block.size / 24, 24, 8);
+        REQUIRE(pool.pool_capacity_left(24) == capacity + 3u);
+
+        // two 5 byte elements occupy two 8 byte nodes, leaving room for a third
+        block = traits::allocate_at_least(pool, 2, 5, 1);
+        REQUIRE(block.size == 15u);
+        traits::deallocate_array(pool, block.memory, 3, 5, 1);
+
+        // a single node uses the whole bucket
+        block = traits::allocate_at_least(pool, 1, 4, 4);
+        REQUIRE(block.size == 8u);
+        traits::deallocate_array(pool, block.memory, 2, 4, 4);
+
+        // no size classes for large allocations
+        pool.set_large_allocations(true);
+        block = traits::allocate_at_least(pool, 2, 200, 8);
+        REQUIRE(block.size == 400u);
+        traits::deallocate_array(pool, block.memory, 2, 200, 8);
+    }
+    REQUIRE(alloc.no_allocated() == 0u);
+}
+
+TEST_CASE("memory_pool_collection w/ static_buckets")
+{
+    using pools = memory_pool_collection<node_pool, static_buckets<8, 16, 24, 32, 48, 64, 96>,
+                                         allocator_reference<test_allocator>>;
+    test_allocator alloc;
+    {
+        pools pool(64, 4000, alloc);
+        REQUIRE(pool.max_node_size() == 64u);
+
+        auto node = pool.allocate_node(33);
+        REQUIRE(pool.pool_capacity_left(33) > 0u);
+        REQUIRE(pool.pool_capacity_left(48) == pool.pool_capacity_left(33));
+        REQUIRE(pool.pool_capacity_left(32) == 0u);
+        REQUIRE(pool.pool_capacity_left(49) == 0u);
+        pool.deallocate_node(node, 33);
+
+        REQUIRE_THROWS_AS(pool.allocate_node(65), bad_node_size);
+        REQUIRE(!pool.try_allocate_node(65));
+
+        std::vector<void*> nodes;
+        for (std::size_t size = 1u; size <= 64u; ++size)
+            nodes.push_back(pool.allocate_node(size));
+        for (std::size_t size = 1u; size <= 64u; ++size)
+            pool.deallocate_node(nodes[size - 1u], size);
+    }
+    REQUIRE(alloc.no_allocated() == 0u);
+}
+
+TEST_CASE("memory_pool_collection donates the rest of a block")
+{
+    using pools =
+        memory_pool_collection<node_pool, log2_buckets, allocator_reference<test_allocator>>;
+    test_allocator alloc;
+    {
+        pools pool(256, 4096, alloc);
+
+        std::vector<void*> nodes;
+        while (auto node = pool.try_allocate_node(256))
+            nodes.push_back(node);
+        REQUIRE(alloc.no_allocated() == 1u);
+
+        // what did not fit a 256 byte node went to the smaller pools
+        REQUIRE(pool.capacity_left() < 64u);
+        std::size_t donated = 0u;
+        for (std::size_t size = 8u; size != 256u; size *= 2u)
+            donated += pool.pool_capacity_left(size);
+        REQUIRE(donated > 0u);
+
+        for (auto node : nodes)
+            pool.deallocate_node(node, 256);
+    }
+    REQUIRE(alloc.no_allocated() == 0u);
+}
+
+TEST_CASE("memory_pool_collection reclaim_empty_blocks")
+{
+    using pools =
+        memory_pool_collection<node_pool, log2_buckets, allocator_reference<test_allocator>>;
+    test_allocator alloc;
+    {
+        pools pool(256, 4096, alloc);
+
+        // fill a second block with 16 byte nodes and continue in a third one
+        std::vector<void*> nodes;
+        while (alloc.no_allocated() != 3u)
+            nodes.push_back(pool.allocate_node(16));
+        for (auto node : nodes)
+            pool.deallocate_node(node, 16);
+        nodes.clear();
+
+        // neither the first block nor the one currently used for growth
+        REQUIRE(pool.reclaim_empty_blocks() == 1u);
+        REQUIRE(pool.reclaim_empty_blocks() == 0u);
+
+        SUBCASE("reuse")
+        {
+            // once the third block is exhausted, the 64 byte nodes continue in the reclaimed one
+            auto left = pool.capacity_left();
+            while (pool.capacity_left() <= left)
+            {
+                left = pool.capacity_left();
+                nodes.push_back(pool.allocate_node(64));
+            }
+            REQUIRE(alloc.no_allocated() == 3u);
+
+            for (auto node : nodes)
+                pool.deallocate_node(node, 64);
+            REQUIRE(pool.release_empty_blocks() == 2u);
+            REQUIRE(alloc.no_allocated() == 1u);
+        }
+        SUBCASE("reuse bigger block")
+        {
+            // empty two more blocks, the smallest reclaimed block ends up first in the list
+            while (alloc.no_allocated() != 5u)
+                nodes.push_back(pool.allocate_node(16));
+            for (auto node : nodes)
+                pool.deallocate_node(node, 16);
+            REQUIRE(pool.reclaim_empty_blocks() == 3u);
+
+            // only the biggest reclaimed block fits, the others are skipped
+            pool.reserve(64, 20000u);
+            REQUIRE(alloc.no_allocated() == 5u);
+            REQUIRE(pool.release_empty_blocks() == 4u);
+            REQUIRE(alloc.no_allocated() == 1u);
+        }
+        SUBCASE("release")
+        {
+            REQUIRE(pool.release_empty_blocks() == 2u);
+            REQUIRE(alloc.no_allocated() == 1u);
+            REQUIRE(pool.reclaim_empty_blocks() == 0u);
+
+            nodes.push_back(pool.allocate_node(64));
+            REQUIRE(alloc.no_allocated() == 2u);
+            pool.deallocate_node(nodes.back(), 64);
+        }
+    }
+    REQUIRE(alloc.no_allocated() == 0u);
+}
+
+namespace
+{
+    template <class PoolType>
+    void check_collection_release_empty_blocks()
+    {
+        using pools =
+            memory_pool_collection<PoolType, identity_buckets, allocator_reference<test_allocator>>;
+        test_allocator alloc;
+        {
+            pools pool(32, 4000, alloc);
+            REQUIRE(alloc.no_allocated() == 1u);
+
+            // the first block stores the free lists and is never released
+            auto first = pool.allocate_node(16);
+            pool.deallocate_node(first, 16);
+            REQUIRE(pool.release_empty_blocks() == 0u);
+
+            // allocate until the 16 byte nodes of a second block are exhausted
+            std::vector<void*> nodes;
+            while (alloc.no_allocated() == 1u || pool.pool_capacity_left(16) != 0u)
+                nodes.push_back(pool.allocate_node(16));
+            REQUIRE(alloc.no_allocated() == 2u);
+            // comes from the second block as well
+            auto other = pool.allocate_node(32);
+            REQUIRE(alloc.no_allocated() == 2u);
+
+            REQUIRE(pool.release_empty_blocks() == 0u);
+            for (auto node : nodes)
+                pool.deallocate_node(node, 16);
+            REQUIRE(pool.release_empty_blocks() == 0u);
+            REQUIRE(alloc.no_allocated() == 2u);
+
+            pool.deallocate_node(other, 32);
+            REQUIRE(pool.release_empty_blocks() == 1u);
+            REQUIRE(alloc.no_allocated() == 1u);
+            // the released block was the current one
+            REQUIRE(pool.capacity_left() == 0u);
+
+            // the collection still works afterwards
+            nodes.clear();
+            while (alloc.no_allocated() == 1u)
+                nodes.push_back(pool.allocate_node(16));
+            for (auto node : nodes)
+                pool.deallocate_node(node, 16);
+            REQUIRE(pool.release_empty_blocks() == 1u);
+            REQUIRE(alloc.no_allocated() == 1u);
+        }
+        REQUIRE(alloc.no_allocated() == 0u);
+    }
+} // namespace
+
+TEST_CASE("memory_pool_collection release_empty_blocks")
+{
+    check_collection_release_empty_blocks<node_pool>();
+    check_collection_release_empty_blocks<array_pool>();
+    check_collection_release_empty_blocks<small_node_pool>();
+}
+
+TEST_CASE("memory_pool_collection large allocations")
+{
+    using pools =
+        memory_pool_collection<array_pool, log2_buckets, allocator_reference<test_allocator>>;
+    test_allocator alloc;
+    {
+        pools pool(256, 4096, alloc);
+        REQUIRE(!pool.large_allocations());
+        REQUIRE_THROWS_AS(pool.allocate_node(257), bad_node_size);
+        REQUIRE(!pool.try_allocate_node(257));
+        REQUIRE(allocator_traits<pools>::max_node_size(pool) == 256u);
+
+        pool.set_large_allocations(true);
+        REQUIRE(pool.large_allocations());
+        REQUIRE(allocator_traits<pools>::max_node_size(pool) == std::size_t(-1));
+
+        auto node = pool.allocate_node(10000);
+        REQUIRE(node);
+        REQUIRE(reinterpret_cast<std::uintptr_t>(node) % max_alignment == 0u);
+        std::memset(node, 0xAB, 10000);
+        auto array = pool.allocate_array(4, 1000);
+        REQUIRE(array);
+        auto small = pool.allocate_node(16);
+        REQUIRE(alloc.no_allocated() == 1u);
+
+        auto stats = pool.large_stats();
+        REQUIRE(stats.count == 2u);
+        REQUIRE(stats.bytes == 14000u);
+        REQUIRE(stats.mapped >= 14000u);
+        REQUIRE(stats.peak_bytes == 14000u);
+        REQUIRE(stats.total == 2u);
+
+        int i = 0;
+        REQUIRE(!pool.try_deallocate_node(&i, 10000));
+        REQUIRE(!pool.try_deallocate_node(small, 10000));
+        // at the same offset into its page as a large allocation, but inside of one
+        auto inside = static_cast<char*>(node) + get_virtual_memory_page_size();
+        REQUIRE(!pool.try_deallocate_node(inside, 10000));
+        REQUIRE(pool.try_deallocate_node(node, 10000));
+        pool.deallocate_array(array, 4, 1000);
+        pool.deallocate_node(small, 16);
+
+        stats = pool.large_stats();
+        REQUIRE(stats.count == 0u);
+        REQUIRE(stats.bytes == 0u);
+        REQUIRE(stats.mapped == 0u);
+        REQUIRE(stats.peak_bytes == 14000u);
+        REQUIRE(stats.total == 2u);
+
+        void* nodes[3];
+        pool.allocate_nodes(3, 300, nodes);
+        REQUIRE(pool.large_stats().count == 3u);
+
+        pools other(detail::move(pool));
+        REQUIRE(other.large_stats().count == 3u);
+        REQUIRE(other.try_deallocate_nodes(nodes, 3, 300));
+        REQUIRE(other.large_stats().count == 0u);
+
+        // left alive on purpose, released by the destructor
+        REQUIRE(other.try_allocate_node(5000));
     }
     REQUIRE(alloc.no_allocated() == 0u);
 }
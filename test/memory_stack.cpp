@@ -146,4 +146,50 @@ TEST_CASE("memory_stack")
         auto mem   = stack.allocate(align, align);
         REQUIRE(detail::is_aligned(mem, align));
     }
+    SUBCASE("resize")
+    {
+        auto first  = stack.allocate(10, 1);
+        auto memory = stack.allocate(10, 1);
+        REQUIRE(!stack.try_resize(first, 10, 20));
+
+        auto left = stack.capacity_left();
+        REQUIRE(stack.try_resize(memory, 10, 30));
+        REQUIRE(stack.capacity_left() == left - 20);
+        REQUIRE(stack.try_resize(memory, 30, 5));
+        REQUIRE(stack.capacity_left() == left + 5);
+        REQUIRE(!stack.try_resize(memory, 5, 5 + stack.capacity_left() + 1));
+
+        using traits = allocator_traits<stack_type>;
+        auto array   = static_cast<char*>(traits::allocate_array(stack, 4, 1, 1));
+        for (auto i = 0; i != 4; ++i)
+            array[i] = char(i);
+        REQUIRE(traits::reallocate_array(stack, array, 4, 8, 1, 1) == array);
+
+        // not the topmost allocation anymore, needs a copy
+        auto other   = traits::allocate_node(stack, 1, 1);
+        auto growing = static_cast<char*>(traits::reallocate_array(stack, array, 8, 16, 1, 1));
+        REQUIRE(growing != array);
+        for (auto i = 0; i != 4; ++i)
+            REQUIRE(growing[i] == char(i));
+        REQUIRE(composable_allocator_traits<stack_type>::try_shrink_node(stack, growing, 16, 8, 1));
+        REQUIRE(!composable_allocator_traits<stack_type>::try_expand_node(stack, other, 1, 2, 1));
+        traits::deallocate_array(stack, growing, 8, 1, 1);
+        traits::deallocate_node(stack, other, 1, 1);
+        traits::deallocate_array(stack, array, 8, 1, 1);
+    }
+    SUBCASE("allocate_at_least")
+    {
+        using traits = allocator_traits<stack_type>;
+
+        // expanded up to the alignment of the next allocation
+        auto block = traits::allocate_at_least(stack, 3, 1, 1);
+        REQUIRE(block.size == detail::max_alignment);
+        REQUIRE(traits::try_expand_node(stack, block.memory, block.size, block.size + 1, 1));
+        traits::deallocate_array(stack, block.memory, block.size + 1, 1, 1);
+
+        // but only in multiples of the element size
+        block = traits::allocate_at_least(stack, 2, detail::max_alignment - 1u, 1);
+        REQUIRE(block.size == 2 * (detail::max_alignment - 1u));
+        traits::deallocate_array(stack, block.memory, 2, detail::max_alignment - 1u, 1);
+    }
 }
@@ -0,0 +1,64 @@
+// Copyright (C) 2015-2025 Jonathan Müller and foonathan/memory contributors
+// SPDX-License-Identifier: Zlib
+
+#include "numa_block_allocator.hpp"
+
+#include <cstring>
+#include <doctest/doctest.h>
+
+#include "memory_pool.hpp"
+
+using namespace foonathan::memory;
+
+TEST_CASE("numa queries")
+{
+    REQUIRE(get_numa_node_count() >= 1u);
+    REQUIRE(get_current_numa_node() < get_numa_node_count());
+}
+
+TEST_CASE("numa_block_allocator")
+{
+    auto check_block = [](numa_block_allocator& alloc, std::size_t expected_node)
+    {
+        auto size  = alloc.next_block_size();
+        auto block = alloc.allocate_block();
+        REQUIRE(block.memory);
+        REQUIRE(block.size == size);
+        REQUIRE(alloc.next_block_size() == 2u * size);
+
+        std::memset(block.memory, 0, block.size);
+        auto node = get_numa_node_of(block.memory);
+        if (node != std::size_t(-1) && expected_node != std::size_t(-1))
+            REQUIRE(node == expected_node);
+
+        alloc.deallocate_block(block);
+    };
+
+    SUBCASE("bind")
+    {
+        numa_block_allocator alloc(1u, numa_policy::bind, 0u);
+        REQUIRE(alloc.policy() == numa_policy::bind);
+        REQUIRE(alloc.node() == 0u);
+        REQUIRE(alloc.next_block_size() == get_virtual_memory_page_size());
+        check_block(alloc, 0u);
+    }
+    SUBCASE("local")
+    {
+        numa_block_allocator alloc(4096u);
+        REQUIRE(alloc.policy() == numa_policy::local);
+        // the thread might be moved to another node in between
+        check_block(alloc, get_numa_node_count() == 1u ? 0u : std::size_t(-1));
+    }
+    SUBCASE("interleave")
+    {
+        numa_block_allocator alloc(4096u, numa_policy::interleave);
+        check_block(alloc, get_numa_node_count() == 1u ? 0u : std::size_t(-1));
+    }
+    SUBCASE("memory_pool")
+    {
+        memory_pool<node_pool, numa_block_allocator> pool(16u, 4096u, numa_policy::bind, 0u);
+        auto node = pool.allocate_node();
+        REQUIRE(node);
+        pool.deallocate_node(node);
+    }
+}
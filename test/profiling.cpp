@@ -11,6 +11,7 @@
 #include "heap_allocator.hpp"
 #include "new_allocator.hpp"
 #include "memory_pool.hpp"
+#include "memory_pool_collection.hpp"
 #include "memory_stack.hpp"
 
 using namespace foonathan::memory;
@@ -63,6 +64,34 @@ void benchmark_node(std::initializer_list<std::size_t> counts,
     benchmark_node<Second, Tail...>(counts, node_sizes);
 }
 
+void benchmark_contended(std::initializer_list<std::size_t> thread_counts, std::size_t count,
+                         std::initializer_list<std::size_t> node_sizes)
+{
+    std::cout << "##" << contended::name() << "\n";
+    std::cout << '\n';
+    std::cout << "Size|Locked Node|Concurrent Node\n";
+    std::cout << "----|-----------|---------------\n";
+    for (auto no_threads : thread_counts)
+        for (auto size : node_sizes)
+        {
+            auto block_size = no_threads * count * std::max(size, sizeof(char*)) + 1024;
+
+            auto locked_alloc = [&]
+            {
+                return thread_safe_allocator<memory_pool<node_pool>>(
+                    memory_pool<node_pool>(size, block_size));
+            };
+            auto concurrent_alloc = [&]
+            { return memory_pool<concurrent_node_pool>(size, block_size); };
+
+            std::cout << no_threads << "\\*" << count << "\\*" << size << "|";
+            std::cout << benchmark(contended{count, no_threads}, locked_alloc, size) << '|';
+            std::cout << benchmark(contended{count, no_threads}, concurrent_alloc, size) << '|';
+            std::cout << '\n';
+        }
+    std::cout << '\n';
+}
+
 template <class Func, class... Allocators>
 void benchmark_array(std::size_t count, std::size_t array_size, std::size_t node_size,
                      Allocators&... allocators)
@@ -113,6 +142,74 @@ void benchmark_array(std::initializer_list<std::size_t> counts,
     benchmark_array<Second, Tail...>(counts, node_sizes, array_sizes);
 }
 
+using static_sizes = static_buckets<8, 16, 24, 32, 48, 64, 80, 96, 128, 160, 192, 256>;
+
+// time of count size to bucket lookups
+template <class BucketDistribution>
+std::size_t benchmark_lookup(const std::vector<std::size_t>& sizes)
+{
+    auto min_time = std::size_t(-1);
+    for (std::size_t i = 0u; i != sample_size; ++i)
+    {
+        volatile std::size_t sink = 0u;
+        auto                 time = measure(
+            [&]
+            {
+                std::size_t sum = 0u;
+                for (auto size : sizes)
+                    sum += BucketDistribution::type::index_from_size(size);
+                sink = sum;
+            });
+        if (time < min_time)
+            min_time = time;
+    }
+    return min_time;
+}
+
+void benchmark_buckets(std::initializer_list<std::size_t> counts, std::size_t max_size)
+{
+    std::cout << "##lookup\n";
+    std::cout << '\n';
+    std::cout << "Count|Log2|Geometric|Static\n";
+    std::cout << "-----|----|---------|------\n";
+    for (auto count : counts)
+    {
+        std::vector<std::size_t> sizes;
+        for (std::size_t i = 0u; i != count; ++i)
+            sizes.push_back(i * 7u % max_size + 1u);
+
+        std::cout << count << "|";
+        std::cout << benchmark_lookup<log2_buckets>(sizes) << '|';
+        std::cout << benchmark_lookup<geometric_buckets<>>(sizes) << '|';
+        std::cout << benchmark_lookup<static_sizes>(sizes) << '|';
+        std::cout << '\n';
+    }
+    std::cout << '\n';
+
+    std::cout << "##" << mixed::name() << "\n";
+    std::cout << '\n';
+    std::cout << "Count|Log2|Geometric|Static\n";
+    std::cout << "-----|----|---------|------\n";
+    for (auto count : counts)
+    {
+        auto block_size = count * max_size * 2u + 4096u;
+
+        auto log2_alloc = [&]
+        { return memory_pool_collection<node_pool, log2_buckets>(max_size, block_size); };
+        auto geometric_alloc = [&]
+        { return memory_pool_collection<node_pool, geometric_buckets<>>(max_size, block_size); };
+        auto static_alloc = [&]
+        { return memory_pool_collection<node_pool, static_sizes>(max_size, block_size); };
+
+        std::cout << count << "|";
+        std::cout << benchmark(mixed{count}, log2_alloc, max_size) << '|';
+        std::cout << benchmark(mixed{count}, geometric_alloc, max_size) << '|';
+        std::cout << benchmark(mixed{count}, static_alloc, max_size) << '|';
+        std::cout << '\n';
+    }
+    std::cout << '\n';
+}
+
 int main(int argc, char* argv[])
 {
     if (argc >= 2)
@@ -138,4 +235,8 @@ int main(int argc, char* argv[])
     benchmark_node<single, bulk, bulk_reversed, butterfly>({256, 512, 1024}, {1, 4, 8, 256});
     std::cout << "#Array\n\n";
     benchmark_array<single, bulk, bulk_reversed, butterfly>({256, 512}, {1, 4, 8}, {1, 4, 8});
+    std::cout << "#Contention\n\n";
+    benchmark_contended({2, 4, 8}, 1024, {8, 256});
+    std::cout << "#Buckets\n\n";
+    benchmark_buckets({256, 1024, 4096}, 256);
 }
@@ -0,0 +1,161 @@
+// Copyright (C) 2015-2025 Jonathan Müller and foonathan/memory contributors
+// SPDX-License-Identifier: Zlib
+
+#include "static_pool_collection.hpp"
+
+#include <algorithm>
+#include <doctest/doctest.h>
+#include <random>
+#include <vector>
+
+#include "allocator_storage.hpp"
+#include "test_allocator.hpp"
+
+using namespace foonathan::memory;
+
+template <class PoolType>
+using static_pools =
+    static_pool_collection<PoolType, allocator_reference<test_allocator>, 16, 32, 48, 64, 96>;
+
+TEST_CASE("static_pool_collection")
+{
+    using pools = static_pools<node_pool>;
+    test_allocator alloc;
+    {
+        pools pool(4000, alloc);
+        REQUIRE(pool.max_node_size() == 96u);
+        REQUIRE(pool.capacity_left() <= 4000u);
+        REQUIRE(pool.next_capacity() >= 4000u);
+        REQUIRE(alloc.no_allocated() == 1u);
+
+        for (std::size_t size = 1u; size <= 96u; ++size)
+            REQUIRE(pool.pool_capacity_left(size) == 0u);
+
+        SUBCASE("normal alloc/dealloc")
+        {
+            std::vector<void*> a, b;
+            for (auto i = 0u; i != 5u; ++i)
+            {
+                a.push_back(pool.allocate_node(1));
+                b.push_back(pool.try_allocate_node(40));
+                REQUIRE(b.back());
+            }
+            REQUIRE(alloc.no_allocated() == 1u);
+
+            // 1 uses the 16 byte pool, 40 the 48 byte one
+            REQUIRE(pool.pool_capacity_left(16) == pool.pool_capacity_left(1));
+            REQUIRE(pool.pool_capacity_left(48) == pool.pool_capacity_left(40));
+            REQUIRE(pool.pool_capacity_left(32) == 0u);
+            REQUIRE(pool.pool_capacity_left(64) == 0u);
+
+            std::shuffle(a.begin(), a.end(), std::mt19937{});
+            std::shuffle(b.begin(), b.end(), std::mt19937{});
+
+            for (auto ptr : a)
+                REQUIRE(pool.try_deallocate_node(ptr, 1));
+            for (auto ptr : b)
+                pool.deallocate_node(ptr, 40);
+        }
+        SUBCASE("compile-time size")
+        {
+            auto node = pool.allocate_node<33>();
+            REQUIRE(pool.pool_capacity_left(48) > 0u);
+            REQUIRE(pool.pool_capacity_left(32) == 0u);
+
+            auto capacity = pool.pool_capacity_left(48);
+            pool.deallocate_node<48>(node);
+            REQUIRE(pool.pool_capacity_left(48) == capacity + 1u);
+
+            node = pool.allocate_node(48);
+            REQUIRE(pool.pool_capacity_left(33) == capacity);
+            pool.deallocate_node<33>(node);
+        }
+        SUBCASE("too big")
+        {
+            REQUIRE_THROWS_AS(pool.allocate_node(97), bad_node_size);
+            REQUIRE(!pool.try_allocate_node(97));
+
+            int i = 0;
+            REQUIRE(!pool.try_deallocate_node(&i, 16));
+        }
+        SUBCASE("multiple block alloc/dealloc")
+        {
+            std::vector<void*> a, b;
+            for (auto i = 0u; i != 1000u; ++i)
+            {
+                a.push_back(pool.allocate_node(16));
+                b.push_back(pool.allocate_node(96));
+            }
+            REQUIRE(alloc.no_allocated() > 1u);
+
+            std::shuffle(a.begin(), a.end(), std::mt19937{});
+            std::shuffle(b.begin(), b.end(), std::mt19937{});
+
+            for (auto ptr : a)
+                pool.deallocate_node(ptr, 16);
+            for (auto ptr : b)
+                pool.deallocate_node(ptr, 96);
+        }
+        SUBCASE("move")
+        {
+            auto node = pool.allocate_node(64);
+
+            pools other(detail::move(pool));
+            REQUIRE(other.pool_capacity_left(64) > 0u);
+            REQUIRE(other.try_deallocate_node(node, 64));
+
+            pool = detail::move(other);
+            REQUIRE(pool.allocate_node(64) == node);
+            pool.deallocate_node(node, 64);
+        }
+        SUBCASE("allocator_traits")
+        {
+            using traits            = allocator_traits<pools>;
+            using composable_traits = composable_allocator_traits<pools>;
+
+            auto node = traits::allocate_node(pool, 24, 8);
+            REQUIRE(pool.pool_capacity_left(32) > 0u);
+            traits::deallocate_node(pool, node, 24, 8);
+
+            node = composable_traits::try_allocate_node(pool, 24, 8);
+            REQUIRE(node);
+            REQUIRE(composable_traits::try_deallocate_node(pool, node, 24, 8));
+            REQUIRE(!composable_traits::try_allocate_node(pool, 24, 1024));
+        }
+    }
+    REQUIRE(alloc.no_allocated() == 0u);
+}
+
+TEST_CASE("static_pool_collection w/ arrays")
+{
+    using pools = static_pools<array_pool>;
+    test_allocator alloc;
+    {
+        pools pool(4000, alloc);
+
+        auto array = pool.allocate_array(4, 16);
+        REQUIRE(array);
+        auto big = pool.allocate_array(100, 64);
+        REQUIRE(big);
+        REQUIRE(pool.try_deallocate_array(big, 100, 64));
+        pool.deallocate_array(array, 4, 16);
+    }
+    REQUIRE(alloc.no_allocated() == 0u);
+}
+
+TEST_CASE("static_pool_collection w/ small_node_pool")
+{
+    using pools = static_pools<small_node_pool>;
+    test_allocator alloc;
+    {
+        pools pool(4000, alloc);
+
+        std::vector<void*> nodes;
+        for (std::size_t size = 1u; size <= 96u; ++size)
+            nodes.push_back(pool.allocate_node(size));
+        REQUIRE(!pool.try_allocate_array(2, 16));
+        for (std::size_t size = 1u; size <= 96u; ++size)
+            pool.deallocate_node(nodes[size - 1u], size);
+    }
+    REQUIRE(alloc.no_allocated() == 0u);
+}
@@ -0,0 +1,34 @@
+// Copyright (C) 2015-2025 Jonathan Müller and foonathan/memory contributors
+// SPDX-License-Identifier: Zlib
+
+#include "std_allocator.hpp"
+
+#include <doctest/doctest.h>
+
+#include "memory_stack.hpp"
+#include "test_allocator.hpp"
+
+using namespace foonathan::memory;
+
+TEST_CASE("std_allocator allocate_at_least")
+{
+    using stack_type = memory_stack<allocator_reference<test_allocator>>;
+    test_allocator alloc;
+    {
+        stack_type                      stack(1024, alloc);
+        std_allocator<char, stack_type> std_alloc(stack);
+
+        // a single object is always allocated on its own
+        auto single = std_alloc.allocate_at_least(1);
+        REQUIRE(single.count == 1u);
+        std_alloc.deallocate(single.ptr, single.count);
+
+        // arrays use the padding up to the next allocation
+        auto result = std_alloc.allocate_at_least(3);
+        REQUIRE(result.count == detail::max_alignment);
+        for (std::size_t i = 0u; i != result.count; ++i)
+            result.ptr[i] = char(i);
+        std_alloc.deallocate(result.ptr, result.count);
+    }
+    REQUIRE(alloc.no_allocated() == 0u);
+}
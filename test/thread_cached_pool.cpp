@@ -0,0 +1,123 @@
+// Copyright (C) 2015-2025 Jonathan Müller and foonathan/memory contributors
+// SPDX-License-Identifier: Zlib
+
+#include "thread_cached_pool.hpp"
+
+#include <doctest/doctest.h>
+#include <thread>
+#include <vector>
+
+using namespace foonathan::memory;
+
+TEST_CASE("thread_cached_pool")
+{
+    using pool_type = memory_pool<node_pool>;
+    thread_cached_pool<pool_type> pool(pool_type(16, pool_type::min_block_size(16, 1000)), 8u, 2u);
+    REQUIRE(pool.high_watermark() == 8u);
+    REQUIRE(pool.low_watermark() == 2u);
+    REQUIRE(pool.cached_nodes() == 0u);
+    auto capacity = pool.lock()->capacity_left();
+
+    SUBCASE("refill and flush")
+    {
+        auto node = pool.allocate_node(16, 1);
+        // refilled with low watermark nodes, one of them returned
+        REQUIRE(pool.cached_nodes() == 1u);
+        REQUIRE(pool.lock()->capacity_left() == capacity - 2 * 16u);
+        pool.deallocate_node(node, 16, 1);
+        REQUIRE(pool.cached_nodes() == 2u);
+
+        std::vector<void*> nodes;
+        for (auto i = 0u; i != 20u; ++i)
+            nodes.push_back(pool.allocate_node(16, 1));
+        REQUIRE(pool.cached_nodes() <= 2u);
+        for (auto n : nodes)
+        {
+            pool.deallocate_node(n, 16, 1);
+            REQUIRE(pool.cached_nodes() <= pool.high_watermark());
+        }
+        REQUIRE(pool.cached_nodes() >= pool.low_watermark());
+
+        pool.flush();
+        REQUIRE(pool.cached_nodes() == 0u);
+        REQUIRE(pool.lock()->capacity_left() == capacity);
+    }
+    SUBCASE("invalid size")
+    {
+        REQUIRE_THROWS_AS(pool.allocate_node(32, 1), bad_node_size);
+        REQUIRE(pool.cached_nodes() == 0u);
+    }
+    SUBCASE("threads")
+    {
+        std::vector<std::thread> threads;
+        for (auto t = 0u; t != 4u; ++t)
+            threads.emplace_back([&] {
+                std::vector<void*> nodes;
+                for (auto round = 0u; round != 10u; ++round)
+                {
+                    for (auto i = 0u; i != 20u; ++i)
+                        nodes.push_back(pool.allocate_node(16, 1));
+                    for (auto n : nodes)
+                        pool.deallocate_node(n, 16, 1);
+                    nodes.clear();
+                }
+            });
+        for (auto& thread : threads)
+            thread.join();
+
+        // exited threads have returned their caches
+        REQUIRE(pool.cached_nodes() == 0u);
+        REQUIRE(pool.lock()->capacity_left() == capacity);
+    }
+}
+
+TEST_CASE("thread_cached_pool with memory_pool_collection")
+{
+    using pool_type = memory_pool_collection<node_pool, log2_buckets>;
+    thread_cached_pool<pool_type> pool(pool_type(64, 4000));
+
+    auto a = pool.allocate_node(4, 4);
+    auto b = pool.allocate_node(32, 8);
+    auto c = pool.allocate_node(64, 8);
+    REQUIRE(a != b);
+    REQUIRE(b != c);
+    REQUIRE_THROWS_AS(pool.allocate_node(65, 1), bad_node_size);
+
+    pool.deallocate_node(c, 64, 8);
+    pool.deallocate_node(b, 32, 8);
+    pool.deallocate_node(a, 4, 4);
+    REQUIRE(pool.cached_nodes() != 0u);
+
+    // freed node is reused by the same size class
+    auto d = pool.allocate_node(20, 4);
+    REQUIRE(d == b);
+    pool.deallocate_node(d, 20, 4);
+
+    pool.flush();
+    REQUIRE(pool.cached_nodes() == 0u);
+}
+
+TEST_CASE("thread_cached_pool destroyed before thread exit")
+{
+    using pool_type = memory_pool<node_pool>;
+    auto pool = new thread_cached_pool<pool_type>(pool_type(16, 4000));
+
+    std::atomic<int> stage(0);
+    std::thread      thread([&] {
+        pool->deallocate_node(pool->allocate_node(16, 1), 16, 1);
+        stage = 1;
+        while (stage != 2)
+            std::this_thread::yield();
+        // the cache is orphaned now and released on exit
+    });
+
+    while (stage != 1)
+        std::this_thread::yield();
+    delete pool;
+    stage = 2;
+    thread.join();
+
+    // a new pool doesn't see the orphaned cache
+    thread_cached_pool<pool_type> other(pool_type(16, 4000));
+    REQUIRE(other.cached_nodes() == 0u);
+}
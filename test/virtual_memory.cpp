@@ -0,0 +1,175 @@
+// Copyright (C) 2015-2025 Jonathan Müller and foonathan/memory contributors
+// SPDX-License-Identifier: Zlib
+
+#include "virtual_memory.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <doctest/doctest.h>
+#include <functional>
+#include <random>
+#include <vector>
+
+#include "detail/align.hpp"
+#include "memory_pool.hpp"
+#include "memory_stack.hpp"
+
+using namespace foonathan::memory;
+
+TEST_CASE("get_virtual_memory_page_sizes")
+{
+    std::size_t sizes[8];
+    auto        no_sizes = get_virtual_memory_page_sizes(sizes, 8u);
+    REQUIRE(no_sizes >= 1u);
+    REQUIRE(sizes[0] == get_virtual_memory_page_size());
+    for (std::size_t i = 1u; i < no_sizes; ++i)
+        REQUIRE(sizes[i - 1u] < sizes[i]);
+
+    auto huge_page_size = get_virtual_memory_huge_page_size();
+    if (huge_page_size != 0u)
+    {
+        REQUIRE(no_sizes >= 2u);
+        auto found = false;
+        for (std::size_t i = 0u; i != no_sizes; ++i)
+            found |= sizes[i] == huge_page_size;
+        REQUIRE(found);
+    }
+
+    REQUIRE(get_virtual_memory_page_sizes(sizes, 1u) == 1u);
+    REQUIRE(sizes[0] == get_virtual_memory_page_size());
+}
+
+TEST_CASE("virtual_memory_allocate_huge_pages")
+{
+    auto huge_page_size = get_virtual_memory_huge_page_size();
+    auto page_size      = huge_page_size != 0u ? huge_page_size : get_virtual_memory_page_size();
+
+    for (auto mode : {huge_page_mode::transparent, huge_page_mode::explicit_pages})
+    {
+        auto memory = virtual_memory_allocate_huge_pages(2u * page_size, mode);
+        REQUIRE(memory);
+#if !defined(_WIN32)
+        REQUIRE(detail::is_aligned(memory, page_size));
+#endif
+        std::memset(memory, 0xFF, 2u * page_size);
+        virtual_memory_deallocate_huge_pages(memory, 2u * page_size);
+    }
+}
+
+TEST_CASE("huge_page_block_allocator")
+{
+    huge_page_block_allocator alloc(1u);
+    REQUIRE(alloc.mode() == huge_page_mode::transparent);
+    REQUIRE(alloc.next_block_size() == alloc.page_size());
+
+    auto block = alloc.allocate_block();
+    REQUIRE(block.size == alloc.page_size());
+    REQUIRE(alloc.next_block_size() == 2u * alloc.page_size());
+    std::memset(block.memory, 0, block.size);
+    alloc.deallocate_block(block);
+
+    SUBCASE("memory_stack")
+    {
+        memory_stack<huge_page_block_allocator> stack(1024u);
+        REQUIRE(stack.capacity_left() > 0u);
+        auto first = stack.allocate(1024u, 16u);
+        REQUIRE(detail::is_aligned(first, 16u));
+
+        // needs to grow
+        stack.allocate(stack.capacity_left(), 1u);
+        REQUIRE(stack.allocate(16u, 1u));
+    }
+    SUBCASE("memory_pool")
+    {
+        memory_pool<node_pool, huge_page_block_allocator> pool(16u, 4096u,
+                                                               huge_page_mode::explicit_pages);
+        auto node = pool.allocate_node();
+        REQUIRE(node);
+        REQUIRE(pool.capacity_left() > 0u);
+        pool.deallocate_node(node);
+    }
+}
+
+TEST_CASE("reusable_virtual_block_allocator")
+{
+    auto page_size = get_virtual_memory_page_size();
+    reusable_virtual_block_allocator alloc(page_size, 100u);
+    REQUIRE(alloc.next_block_size() == page_size);
+    REQUIRE(alloc.capacity_left() == 100u);
+
+    std::vector<memory_block> blocks;
+    for (auto i = 0u; i != 100u; ++i)
+    {
+        auto block = alloc.allocate_block();
+        REQUIRE(block.size == page_size);
+        REQUIRE(alloc.owns(block.memory));
+        REQUIRE(alloc.owns(static_cast<char*>(block.memory) + page_size - 1u));
+        std::memset(block.memory, 0xFF, block.size);
+        blocks.push_back(block);
+    }
+    REQUIRE(alloc.capacity_left() == 0u);
+    REQUIRE(!alloc.owns(&alloc));
+
+    // deallocate in any order
+    std::shuffle(blocks.begin(), blocks.end(), std::mt19937(42));
+    for (auto i = 0u; i != 50u; ++i)
+        alloc.deallocate_block(blocks[i]);
+    REQUIRE(alloc.capacity_left() == 50u);
+
+    // the deallocated blocks are reused
+    for (auto i = 0u; i != 50u; ++i)
+    {
+        blocks[i] = alloc.allocate_block();
+        std::memset(blocks[i].memory, 0, blocks[i].size);
+    }
+    std::sort(blocks.begin(), blocks.end(), [](const memory_block& a, const memory_block& b)
+              { return std::less<void*>()(a.memory, b.memory); });
+    for (auto i = 1u; i != blocks.size(); ++i)
+        REQUIRE(blocks[i - 1u].memory != blocks[i].memory);
+
+    auto other = detail::move(alloc);
+    REQUIRE(alloc.capacity_left() == 0u);
+    REQUIRE(other.owns(blocks.front().memory));
+    for (auto& block : blocks)
+        other.deallocate_block(block);
+    REQUIRE(other.capacity_left() == 100u);
+
+    SUBCASE("memory_pool")
+    {
+        memory_pool<node_pool, reusable_virtual_block_allocator> pool(16u, page_size, 4u);
+        std::vector<void*> nodes;
+        auto               no_nodes = pool.capacity_left() / pool.node_size();
+        for (auto i = 0u; i != 3u * no_nodes; ++i)
+            nodes.push_back(pool.allocate_node());
+        for (auto i = 0u; i != no_nodes; ++i)
+            pool.deallocate_node(nodes[i]);
+
+        // a block in the middle can be released
+        REQUIRE(pool.release_empty_blocks() >= 1u);
+        REQUIRE(pool.get_allocator().capacity_left() >= 2u);
+        for (auto i = no_nodes; i != nodes.size(); ++i)
+            pool.deallocate_node(nodes[i]);
+    }
+}
+
+TEST_CASE("virtual_memory_allocator resize")
+{
+    using traits = allocator_traits<virtual_memory_allocator>;
+    virtual_memory_allocator alloc;
+    auto                     page_size = get_virtual_memory_page_size();
+
+    auto node = static_cast<char*>(traits::allocate_node(alloc, 16, 1));
+    std::memset(node, 'a', 16);
+
+    // the pages are big enough
+    REQUIRE(traits::try_expand_node(alloc, node, 16, page_size / 2, 1));
+    std::memset(node, 'b', page_size / 2);
+    REQUIRE(traits::try_shrink_node(alloc, node, page_size / 2, 8, 1));
+    REQUIRE(!traits::try_expand_node(alloc, node, 8, 4 * page_size, 1));
+
+    auto bigger = static_cast<char*>(traits::reallocate_array(alloc, node, 8, 4 * page_size, 1, 1));
+    REQUIRE(bigger != node);
+    REQUIRE(std::count(bigger, bigger + 8, 'b') == 8);
+    std::memset(bigger, 'c', 4 * page_size);
+    traits::deallocate_array(alloc, bigger, 4 * page_size, 1, 1);
+}
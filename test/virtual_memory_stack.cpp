@@ -0,0 +1,130 @@
+// Copyright (C) 2015-2025 Jonathan Müller and foonathan/memory contributors
+// SPDX-License-Identifier: Zlib
+
+#include "virtual_memory_stack.hpp"
+
+#include <doctest/doctest.h>
+
+#include <cstring>
+
+#include "allocator_storage.hpp"
+#include "virtual_memory.hpp"
+
+using namespace foonathan::memory;
+
+TEST_CASE("virtual_memory_stack")
+{
+    auto page_size = get_virtual_memory_page_size();
+
+    virtual_memory_stack stack(64 * page_size);
+    REQUIRE(stack.reserved_size() == 64 * page_size);
+    REQUIRE(stack.committed_size() == 0u);
+    REQUIRE(stack.capacity_left() == 64 * page_size);
+
+    SUBCASE("empty unwind")
+    {
+        auto m = stack.top();
+        stack.unwind(m);
+        REQUIRE(stack.top() == m);
+        REQUIRE(stack.capacity_left() == 64 * page_size);
+    }
+    SUBCASE("allocation commits pages")
+    {
+        REQUIRE(!stack.try_allocate(10, 1));
+
+        auto memory = stack.allocate(10, 1);
+        REQUIRE(stack.owns(memory));
+        REQUIRE(stack.committed_size() == page_size);
+        REQUIRE(stack.capacity_left() == 64 * page_size - 10 - 2 * detail::debug_fence_size);
+
+        auto m = stack.top();
+
+        auto aligned = stack.allocate(10, 16);
+        REQUIRE(detail::is_aligned(aligned, 16));
+        REQUIRE(stack.top() > m);
+
+        stack.unwind(m);
+        REQUIRE(stack.top() == m);
+        REQUIRE(stack.allocate(10, 16) == aligned);
+    }
+    SUBCASE("contiguous growth")
+    {
+        auto first = static_cast<char*>(stack.allocate(page_size / 2, 1));
+        auto m     = stack.top();
+
+        // crosses the committed pages, but stays contiguous
+        auto second = static_cast<char*>(stack.allocate(3 * page_size, 1));
+        REQUIRE(second == first + page_size / 2 + 2 * detail::debug_fence_size);
+        REQUIRE(stack.committed_size() >= 4 * page_size);
+        std::memset(second, 0, 3 * page_size);
+
+        // commits at least as many pages as are already committed
+        auto committed = stack.committed_size();
+        stack.allocate(committed - (page_size / 2 + 3 * page_size) + 1, 1);
+        REQUIRE(stack.committed_size() >= 2 * committed);
+
+        // keeps the pages by default
+        stack.unwind(m);
+        REQUIRE(stack.committed_size() >= 2 * committed);
+
+        stack.shrink_to_fit();
+        REQUIRE(stack.committed_size() == page_size);
+        REQUIRE(stack.allocate(3 * page_size, 1) == second);
+    }
+    SUBCASE("retained size")
+    {
+        stack.set_retained_size(2 * page_size);
+        REQUIRE(stack.retained_size() == 2 * page_size);
+
+        auto m = stack.top();
+        stack.allocate(16 * page_size, 1);
+        REQUIRE(stack.committed_size() >= 16 * page_size);
+
+        stack.unwind(m);
+        REQUIRE(stack.committed_size() == 2 * page_size);
+
+        // unwinding below the retained size does not decommit
+        m = stack.top();
+        stack.allocate(page_size, 1);
+        stack.unwind(m);
+        REQUIRE(stack.committed_size() == 2 * page_size);
+    }
+    SUBCASE("exhaustion")
+    {
+        stack.allocate(32 * page_size, 1);
+        REQUIRE_THROWS_AS(stack.allocate(33 * page_size, 1), out_of_fixed_memory);
+        stack.allocate(16 * page_size, 1);
+        REQUIRE(stack.committed_size() <= stack.reserved_size());
+    }
+    SUBCASE("raii unwind")
+    {
+        auto m = stack.top();
+        {
+            memory_stack_raii_unwind<virtual_memory_stack> unwind(stack);
+            stack.allocate(2 * page_size, 1);
+            REQUIRE(stack.top() > m);
+        }
+        REQUIRE(stack.top() == m);
+    }
+    SUBCASE("move")
+    {
+        auto memory = stack.allocate(10, 1);
+        auto m      = stack.top();
+
+        virtual_memory_stack other(detail::move(stack));
+        REQUIRE(other.owns(memory));
+        REQUIRE(other.top() == m);
+        other.unwind(m);
+    }
+    SUBCASE("allocator_traits")
+    {
+        using traits = allocator_traits<virtual_memory_stack>;
+        auto node    = traits::allocate_node(stack, 32, 8);
+        REQUIRE(stack.owns(node));
+        REQUIRE(composable_allocator_traits<virtual_memory_stack>::try_deallocate_node(stack, node,
+                                                                                       32, 8));
+        REQUIRE(traits::try_expand_node(stack, node, 32, 64, 8));
+        REQUIRE(traits::reallocate_array(stack, node, 64, 16, 1, 8) == node);
+        traits::deallocate_node(stack, node, 16, 8);
+    }
+}